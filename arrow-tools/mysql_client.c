@@ -10,8 +10,10 @@
 #include <mysql/mysql.h>
 #include "sql2arrow.h"
 #include <ctype.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdarg.h>
+#include <strings.h>
 
 /* static variables */
 static char	   *mysql_timezone = NULL;
@@ -859,6 +861,7 @@ mysql_setup_attribute(MYSQL *conn,
 typedef struct {
 	MYSQL	   *conn;
 	MYSQL_RES  *res;
+	bool		in_snapshot;	/* transaction is already opened */
 } MYSTATE;
 
 /*
@@ -968,10 +971,13 @@ sqldb_begin_query(void *sqldb_state,
 	const char *query;
 
 	/* start transaction with read-only mode */
-	query = "START TRANSACTION READ ONLY";
-	if (mysql_query(conn, query) != 0)
-		Elog("failed on mysql_query('%s'): %s",
-			 query, mysql_error(conn));
+	if (!mystate->in_snapshot)
+	{
+		query = "START TRANSACTION READ ONLY";
+		if (mysql_query(conn, query) != 0)
+			Elog("failed on mysql_query('%s'): %s",
+				 query, mysql_error(conn));
+	}
 
 	/* exec SQL command  */
 	if (mysql_query(conn, sqldb_command) != 0)
@@ -1049,6 +1055,166 @@ sqldb_close_connection(void *sqldb_state)
 	mysql_close(mystate->conn);
 }
 
+/*
+ * sqldb_parallel_snapshot
+ *
+ * It opens a consistent snapshot on the worker connections, while the
+ * leader connection blocks writes to the table, then splits the table by
+ * the range of its primary key. It returns the SQL command for each worker.
+ */
+static void
+__mysql_exec_query(MYSQL *conn, const char *query)
+{
+	if (mysql_query(conn, query) != 0)
+		Elog("failed on mysql_query('%s'): %s",
+			 query, mysql_error(conn));
+}
+
+static MYSQL_RES *
+__mysql_store_query(MYSQL *conn, const char *query)
+{
+	MYSQL_RES  *res;
+
+	__mysql_exec_query(conn, query);
+	res = mysql_store_result(conn);
+	if (!res)
+		Elog("failed on mysql_store_result: %s", mysql_error(conn));
+	return res;
+}
+
+static int64_t
+__mysql_fetch_pkey_value(const char *value, const char *pkey)
+{
+	char	   *end;
+	int64_t		ival;
+
+	errno = 0;
+	ival = strtoll(value, &end, 10);
+	if (errno != 0 || *end != '\0')
+		Elog("primary key '%s' has out of range value (%s) for --parallel",
+			 pkey, value);
+	return ival;
+}
+
+char **
+sqldb_parallel_snapshot(void *leader_state,
+						void **worker_states,
+						int nworkers,
+						const char *table_name)
+{
+	MYSTATE	   *leader = (MYSTATE *)leader_state;
+	MYSQL	   *conn = leader->conn;
+	MYSQL_RES  *res;
+	MYSQL_ROW	row;
+	MYSQL_FIELD *my_field;
+	char	  **commands;
+	char	   *query;
+	char	   *pkey = NULL;
+	int64_t		lower = 0;
+	int64_t		upper = 0;
+	uint64_t	width = 0;
+	bool		is_empty = false;
+	int			i, j;
+
+	query = alloca(strlen(table_name) + 200);
+	/* block writes to the table, until all the workers open snapshot */
+	sprintf(query, "LOCK TABLES %s READ", table_name);
+	__mysql_exec_query(conn, query);
+
+	/* lookup the primary key */
+	sprintf(query, "SHOW KEYS FROM %s WHERE Key_name = 'PRIMARY'", table_name);
+	res = __mysql_store_query(conn, query);
+	if (mysql_num_rows(res) != 1)
+		Elog("--parallel requires single-column primary key on '%s'",
+			 table_name);
+	row = mysql_fetch_row(res);
+	for (j=0; j < mysql_num_fields(res); j++)
+	{
+		my_field = mysql_fetch_field_direct(res, j);
+		if (strcasecmp(my_field->name, "Column_name") == 0)
+		{
+			pkey = pstrdup(row[j]);
+			break;
+		}
+	}
+	if (!pkey)
+		Elog("unexpected query result for '%s'", query);
+	mysql_free_result(res);
+
+	/* range of the primary key */
+	query = alloca(strlen(table_name) + 2 * strlen(pkey) + 200);
+	sprintf(query, "SELECT MIN(`%s`), MAX(`%s`) FROM %s",
+			pkey, pkey, table_name);
+	res = __mysql_store_query(conn, query);
+	if (mysql_num_fields(res) != 2 ||
+		mysql_num_rows(res) != 1)
+		Elog("unexpected query result for '%s'", query);
+	my_field = mysql_fetch_field_direct(res, 0);
+	if (my_field->type != MYSQL_TYPE_TINY &&
+		my_field->type != MYSQL_TYPE_SHORT &&
+		my_field->type != MYSQL_TYPE_INT24 &&
+		my_field->type != MYSQL_TYPE_LONG &&
+		my_field->type != MYSQL_TYPE_LONGLONG)
+		Elog("--parallel requires integer primary key, but '%s' is not",
+			 pkey);
+	row = mysql_fetch_row(res);
+	if (!row[0] || !row[1])
+		is_empty = true;
+	else
+	{
+		lower = __mysql_fetch_pkey_value(row[0], pkey);
+		upper = __mysql_fetch_pkey_value(row[1], pkey);
+		width = ((uint64_t)upper - (uint64_t)lower) / nworkers + 1;
+	}
+	mysql_free_result(res);
+
+	/* open a consistent snapshot on the worker connections */
+	for (i=0; i < nworkers; i++)
+	{
+		MYSTATE	   *mystate = (MYSTATE *)worker_states[i];
+
+		__mysql_exec_query(mystate->conn,
+						   "SET SESSION TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+		__mysql_exec_query(mystate->conn,
+						   "START TRANSACTION WITH CONSISTENT SNAPSHOT, READ ONLY");
+		mystate->in_snapshot = true;
+	}
+	__mysql_exec_query(conn, "UNLOCK TABLES");
+
+	/* SQL command for each worker */
+	commands = palloc0(sizeof(char *) * nworkers);
+	for (i=0; i < nworkers; i++)
+	{
+		__int128	head = (__int128)lower + (__int128)width * i;
+		__int128	tail = head + width;
+		char	   *buf = palloc(strlen(table_name) + 2 * strlen(pkey) + 200);
+
+		if (is_empty || head > upper)
+			sprintf(buf, "SELECT * FROM %s WHERE false", table_name);
+		else if (i == nworkers - 1 || tail > upper)
+			sprintf(buf, "SELECT * FROM %s WHERE `%s` >= %ld AND `%s` <= %ld",
+					table_name, pkey, (int64_t)head, pkey, upper);
+		else
+			sprintf(buf, "SELECT * FROM %s WHERE `%s` >= %ld AND `%s` < %ld",
+					table_name, pkey, (int64_t)head, pkey, (int64_t)tail);
+		commands[i] = buf;
+	}
+	return commands;
+}
+
+void
+sqldb_thread_init(void)
+{
+	if (mysql_thread_init() != 0)
+		Elog("failed on mysql_thread_init");
+}
+
+void
+sqldb_thread_end(void)
+{
+	mysql_thread_end();
+}
+
 /*
  * PG12 or later replaces XXprintf by pg_XXprintf
  */
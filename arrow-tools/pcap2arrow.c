@@ -5,17 +5,26 @@
  *
  * Portions Copyright (c) 2021, HeteroDB Inc
  */
+#include <arpa/inet.h>
 #include <ctype.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <limits.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
 #include <pcap.h>		/* install libpcap-devel */
+#ifdef HAVE_PFRING
 #include <pfring.h>		/* install pfring; see https://packages.ntop.org/ */
+#endif
+#include <poll.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -67,6 +76,12 @@ static bool				no_payload = false;
 static bool				composite_options = false;
 static int				print_stat_interval = -1;
 static bool				enable_interface_id = false;	/* for PCAP-NG */
+#ifdef HAVE_PFRING
+static bool				enable_af_packet = false;
+#else
+static bool				enable_af_packet = true;		/* no PF-RING support */
+#endif
+static size_t			af_packet_ring_size = (64UL << 20);		/* 64MB */
 static __thread uint32_t *current_interface_id = NULL;	/* for PCAP-NG */
 
 /*
@@ -95,11 +110,53 @@ static bool			   *arrow_workers_completed;
 static SQLtable		  **arrow_chunks_array;			/* chunk buffer per-thread */
 static sem_t			pcap_worker_sem;
 
+/*
+ * asynchronous chunk writer (only if --direct-io)
+ *
+ * Each worker thread has a shadow chunk buffer and a writer thread.
+ * Once a chunk buffer gets filled up, worker swaps its contents with
+ * the shadow buffer, then continues packet capture without waiting for
+ * the storage i/o, while the writer thread writes out the shadow buffer.
+ */
+typedef struct
+{
+	pthread_t			thread;
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	SQLtable		   *chunk;		/* shadow chunk buffer */
+	bool				pending;	/* true, if chunk is not written yet */
+	bool				terminate;	/* true, if no more chunks */
+} arrowChunkWriter;
+
+static arrowChunkWriter *arrow_writers_array = NULL;	/* per-thread */
+
 /* static variable for PF-RING capture mode */
+#ifdef HAVE_PFRING
 static pfring		  **pfring_desc_array = NULL;
 static uint64_t			pfring_desc_selector = 0;
+#endif
 static int				pfring_desc_nums = -1;
 
+/* static variable for AF_PACKET (TPACKET_V3) capture mode */
+#define AF_PACKET_BLOCK_SIZE		(1UL << 20)		/* 1MB */
+#define AF_PACKET_FRAME_SIZE		2048
+#define AF_PACKET_BLOCK_TIMEOUT		10				/* 10ms */
+
+typedef struct
+{
+	int				sockfd;
+	char		   *ring_buffer;	/* mmap'ed TPACKET_V3 rx-ring */
+	size_t			ring_sz;
+	uint32_t		block_sz;
+	uint32_t		block_nr;
+	uint32_t		block_index;	/* next block to be processed */
+	uint64_t		stat_recv;		/* accumulated PACKET_STATISTICS */
+	uint64_t		stat_drop;
+} afPacketDesc;
+
+static afPacketDesc	   *af_packet_desc_array = NULL;	/* per-thread */
+static int				af_packet_desc_nums = 0;
+
 /* definitions for PCAP/PCAPNG file scan mode */
 #define PCAP_MAGIC_LE		0xd4c3b2a1U
 #define PCAP_MAGIC_BE		0xa1b2c3d4U
@@ -221,11 +278,13 @@ on_sigint_handler(int signal)
 	int		i;
 
 	do_shutdown = true;
+#ifdef HAVE_PFRING
 	if (pfring_desc_array)
 	{
 		for (i=0; i < pfring_desc_nums; i++)
 			pfring_breakloop(pfring_desc_array[i]);
 	}
+#endif
 	if (pcap_file_desc_array)
 	{
 		for (i=0; i < pcap_file_desc_nums; i++)
@@ -876,7 +935,7 @@ arrowPcapSchemaInit(SQLtable *table)
  */
 static const u_char *
 handlePacketRawEthernet(SQLtable *chunk,
-						struct pfring_pkthdr *hdr,
+						struct pcap_pkthdr *hdr,
 						const u_char *buf, uint16_t *p_ether_type)
 {
 	__FIELD_PUT_VALUE_DECL;
@@ -1500,7 +1559,7 @@ retry:
 		int		flags = fcntl(fdesc, F_GETFL);
 
 		flags |= O_DIRECT;
-		if (fcntl(fdesc, F_SETFL, &flags) != 0)
+		if (fcntl(fdesc, F_SETFL, flags) != 0)
 			Elog("failed on fcntl('%s', F_SETFL, O_DIRECT): %m", path);
 		outfd->table.f_pos = DIRECT_IO_ALIGN(outfd->table.f_pos);
 	}
@@ -1539,62 +1598,39 @@ arrowCloseOutputFile(arrowFileDesc *outfd)
 
 /*
  * arrowFileDirectWriteIOV
+ *
+ * The chunk buffer with --direct-io has page-aligned buffers (see palloc),
+ * and setupArrowRecordBatchIOV() pads every buffer to the page boundary
+ * according to chunk->buffer_align, so we can issue pwritev(2) on the
+ * O_DIRECT file descriptor without copy to the bounce buffer.
  */
 static void
 arrowFileDirectWriteIOV(SQLtable *chunk, size_t length)
 {
-	static __thread char   *dio_buffer = NULL;
-	static __thread size_t	dio_buffer_sz = 0;
-	char	   *pos;
-	int			i, gap;
+	void	   *meta_image = chunk->__iov[0].iov_base;
+	int			i;
 
 	Assert(length == DIRECT_IO_ALIGN(length));
-	/* DIO buffer allocation on the demand */
-	if (!dio_buffer)
-	{
-		dio_buffer_sz = PAGE_ALIGN(length) + (1UL << 21);	/* 2MB margin */
-		dio_buffer = mmap(NULL, dio_buffer_sz,
-						  PROT_READ | PROT_WRITE,
-						  MAP_PRIVATE | MAP_ANONYMOUS,
-						  -1, 0);
-		if (dio_buffer == MAP_FAILED)
-			Elog("failed on mmap(sz=%zu): %m", dio_buffer_sz);
-	}
-	else if (length > dio_buffer_sz)
-	{
-		size_t		sz = PAGE_ALIGN(length) + (1UL << 21);	/* 2MB margin */
-
-		dio_buffer = mremap(dio_buffer, dio_buffer_sz, sz, MREMAP_MAYMOVE);
-		if (dio_buffer == MAP_FAILED)
-			Elog("failed on mremap(sz=%zu -> %zu): %m", dio_buffer_sz, sz);
-		dio_buffer_sz = sz;
-	}
-
-	/* setup DIO buffer */
-	pos = dio_buffer;
 	for (i=0; i < chunk->__iov_cnt; i++)
 	{
 		struct iovec *iov = &chunk->__iov[i];
 
-		memcpy(pos, iov->iov_base, iov->iov_len);
-		pos += iov->iov_len;
+		if ((uintptr_t)iov->iov_base != DIRECT_IO_ALIGN(iov->iov_base) ||
+			iov->iov_len != DIRECT_IO_ALIGN(iov->iov_len))
+			Elog("Bug? iovec[%d] (addr=%p, len=%zu) is not aligned for direct-io",
+				 i, iov->iov_base, iov->iov_len);
 	}
-	Assert(pos <= dio_buffer + length);
-	gap = (dio_buffer + length) - pos;
-	if (gap > 0)
-		memset(pos, 0, gap);
-
 	/* issue direct i/o */
-	arrowFileWrite(chunk, dio_buffer, length);
-
-	chunk->__iov_cnt = 0;	/* rewind iovec */
+	arrowFileWriteIOV(chunk);
+	/* release the metadata image (see setupFlatBufferMessageIOV) */
+	pfree(meta_image);
 }
 
 /*
- * arrowChunkWriteOut
+ * __arrowChunkWriteOut
  */
 static void
-arrowChunkWriteOut(SQLtable *chunk)
+__arrowChunkWriteOut(SQLtable *chunk)
 {
 	arrowFileDesc *outfd = NULL;
 	ArrowBlock	block;
@@ -1608,8 +1644,7 @@ arrowChunkWriteOut(SQLtable *chunk)
 	 */
 	Assert(chunk->fdesc < 0);
 	length = setupArrowRecordBatchIOV(chunk);
-	if (enable_direct_io)
-		length = DIRECT_IO_ALIGN(length);
+	Assert(!enable_direct_io || length == DIRECT_IO_ALIGN(length));
 
 	/*
 	 * attach file descriptor
@@ -1693,6 +1728,91 @@ arrowChunkWriteOut(SQLtable *chunk)
 	chunk->f_pos = 0;
 }
 
+/*
+ * arrowChunkWriterMain
+ */
+static void *
+arrowChunkWriterMain(void *__arg)
+{
+	arrowChunkWriter *writer = __arg;
+
+	pthreadMutexLock(&writer->mutex);
+	for (;;)
+	{
+		if (writer->pending)
+		{
+			pthreadMutexUnlock(&writer->mutex);
+			__arrowChunkWriteOut(writer->chunk);
+			sql_table_clear(writer->chunk);
+			pthreadMutexLock(&writer->mutex);
+			writer->pending = false;
+			pthreadCondBroadcast(&writer->cond);
+		}
+		else if (writer->terminate)
+			break;
+		else
+			pthreadCondWait(&writer->cond, &writer->mutex);
+	}
+	pthreadMutexUnlock(&writer->mutex);
+
+	return NULL;
+}
+
+/*
+ * arrowChunkWriteOut
+ */
+static void
+arrowChunkWriteOut(SQLtable *chunk)
+{
+	arrowChunkWriter *writer;
+	size_t		sz = offsetof(SQLtable, columns[PCAP_SCHEMA_MAX_NFIELDS]);
+	SQLtable   *temp;
+
+	if (!arrow_writers_array)
+	{
+		/* synchronous write */
+		__arrowChunkWriteOut(chunk);
+		return;
+	}
+	/* wait for completion of the previous write */
+	Assert(worker_id >= 0 && worker_id < num_threads);
+	writer = &arrow_writers_array[worker_id];
+	pthreadMutexLock(&writer->mutex);
+	while (writer->pending)
+		pthreadCondWait(&writer->cond, &writer->mutex);
+	/* swap the filled-up chunk and the (empty) shadow buffer */
+	temp = alloca(sz);
+	memcpy(temp, writer->chunk, sz);
+	memcpy(writer->chunk, chunk, sz);
+	memcpy(chunk, temp, sz);
+	writer->pending = true;
+	pthreadCondBroadcast(&writer->cond);
+	pthreadMutexUnlock(&writer->mutex);
+}
+
+/*
+ * arrowChunkWriterShutdown
+ */
+static void
+arrowChunkWriterShutdown(void)
+{
+	arrowChunkWriter *writer;
+	int			rv;
+
+	if (!arrow_writers_array)
+		return;
+	Assert(worker_id >= 0 && worker_id < num_threads);
+	writer = &arrow_writers_array[worker_id];
+	pthreadMutexLock(&writer->mutex);
+	writer->terminate = true;
+	pthreadCondBroadcast(&writer->cond);
+	pthreadMutexUnlock(&writer->mutex);
+
+	rv = pthread_join(writer->thread, NULL);
+	if (rv != 0)
+		Elog("failed on pthread_join: %s", strerror(rv));
+}
+
 /*
  * arrowMergeChunkWriteOut
  */
@@ -1841,7 +1961,7 @@ arrowMergeChunkWriteOut(SQLtable *dchunk, SQLtable *schunk)
  */
 static inline void
 __execCaptureOnePacket(SQLtable *chunk,
-					   struct pfring_pkthdr *hdr, const u_char *pos)
+					   struct pcap_pkthdr *hdr, const u_char *pos)
 {
 	const u_char   *end = pos + hdr->caplen;
 	const u_char   *next;
@@ -1964,6 +2084,7 @@ fillup_by_null:
 	chunk->nitems++;
 }
 
+#ifdef HAVE_PFRING
 /*
  * execCapturePackets
  */
@@ -1971,6 +2092,7 @@ static int
 execCapturePackets(pfring *pd, SQLtable *chunk)
 {
 	struct pfring_pkthdr hdr;
+	struct pcap_pkthdr __hdr;
 	u_char		__buffer[65536];
 	u_char	   *buffer = __buffer;
 	int			rv;
@@ -1982,7 +2104,10 @@ execCapturePackets(pfring *pd, SQLtable *chunk)
 		rv = pfring_recv(pd, &buffer, sizeof(__buffer), &hdr, 1);
 		if (rv > 0)
 		{
-			__execCaptureOnePacket(chunk, &hdr, buffer);
+			__hdr.ts = hdr.ts;
+			__hdr.caplen = hdr.caplen;
+			__hdr.len = hdr.len;
+			__execCaptureOnePacket(chunk, &__hdr, buffer);
 			if (chunk->usage >= record_batch_threshold)
 				return 1;	/* write out the buffer */
 		}
@@ -1990,6 +2115,7 @@ execCapturePackets(pfring *pd, SQLtable *chunk)
 	/* interrupted, thus chunk-buffer is partially filled up */
 	return 0;
 }
+#endif	/* HAVE_PFRING */
 
 /*
  * final_merge_pending_chunks
@@ -2019,7 +2145,9 @@ final_merge_pending_chunks(SQLtable *chunk)
 	}
 	if (worker_id == 0 && chunk->nitems > 0)
 		arrowChunkWriteOut(chunk);
-	
+	/* wait for completion of the asynchronous write, if any */
+	arrowChunkWriterShutdown();
+
 	/* Ok, this worker exit */
 	pthreadMutexLock(&arrow_workers_mutex);
 	arrow_workers_completed[worker_id] = true;
@@ -2029,6 +2157,7 @@ final_merge_pending_chunks(SQLtable *chunk)
 	return NULL;
 }
 
+#ifdef HAVE_PFRING
 /*
  * pfring_worker_main
  */
@@ -2073,6 +2202,89 @@ pfring_worker_main(void *__arg)
 	}
 	return final_merge_pending_chunks(chunk);
 }
+#endif	/* HAVE_PFRING */
+
+/*
+ * execCaptureAfPacketBlock
+ *
+ * It walks on the packets in a TPACKET_V3 ring block, and put them
+ * onto the chunk buffer directly.
+ */
+static void
+execCaptureAfPacketBlock(SQLtable *chunk, struct tpacket_block_desc *bdesc)
+{
+	struct tpacket3_hdr *thdr;
+	uint32_t	i, num_pkts = bdesc->hdr.bh1.num_pkts;
+
+	thdr = (struct tpacket3_hdr *)
+		((char *)bdesc + bdesc->hdr.bh1.offset_to_first_pkt);
+	for (i=0; i < num_pkts; i++)
+	{
+		struct sockaddr_ll *sll = (struct sockaddr_ll *)
+			((char *)thdr + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+		/* rx only, like PF-RING mode */
+		if (sll->sll_pkttype != PACKET_OUTGOING)
+		{
+			struct pcap_pkthdr hdr;
+
+			hdr.ts.tv_sec  = thdr->tp_sec;
+			hdr.ts.tv_usec = thdr->tp_nsec / 1000;
+			hdr.caplen = thdr->tp_snaplen;
+			hdr.len = thdr->tp_len;
+			__execCaptureOnePacket(chunk, &hdr,
+								   (const u_char *)thdr + thdr->tp_mac);
+			if (chunk->usage >= record_batch_threshold)
+			{
+				arrowChunkWriteOut(chunk);
+				sql_table_clear(chunk);
+			}
+		}
+		thdr = (struct tpacket3_hdr *)((char *)thdr + thdr->tp_next_offset);
+	}
+}
+
+/*
+ * af_packet_worker_main
+ */
+static void *
+af_packet_worker_main(void *__arg)
+{
+	SQLtable	   *chunk;
+	afPacketDesc   *apdesc;
+
+	/* assign worker-id of this thread */
+	worker_id = (long)__arg;
+	chunk = arrow_chunks_array[worker_id];
+	apdesc = &af_packet_desc_array[worker_id];
+
+	sql_table_clear(chunk);
+	while (!do_shutdown)
+	{
+		struct tpacket_block_desc *bdesc = (struct tpacket_block_desc *)
+			(apdesc->ring_buffer + (size_t)apdesc->block_sz * apdesc->block_index);
+
+		if ((__atomic_load_n(&bdesc->hdr.bh1.block_status,
+							 __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+		{
+			struct pollfd	pfd;
+
+			/* wait for the next block to be retired */
+			pfd.fd = apdesc->sockfd;
+			pfd.events = POLLIN | POLLERR;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, 100) < 0 && errno != EINTR)
+				Elog("worker-%ld: failed on poll: %m", worker_id);
+			continue;
+		}
+		execCaptureAfPacketBlock(chunk, bdesc);
+		/* release the block to the kernel */
+		__atomic_store_n(&bdesc->hdr.bh1.block_status,
+						 TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		apdesc->block_index = (apdesc->block_index + 1) % apdesc->block_nr;
+	}
+	return final_merge_pending_chunks(chunk);
+}
 
 /*
  * process_one_pcap_file
@@ -2094,15 +2306,11 @@ process_one_pcap_file(SQLtable *chunk, pcapFileDesc *pfdesc)
 	while (!do_shutdown)
 	{
 		struct pcap_pkthdr hdr;
-		struct pfring_pkthdr __hdr;
 
 		buffer = pcap_next(pfdesc->pcap_handle, &hdr);
 		if (!buffer)
 			break;
-		__hdr.ts = hdr.ts;
-		__hdr.caplen = hdr.caplen;
-		__hdr.len = hdr.len;
-		__execCaptureOnePacket(chunk, &__hdr, buffer);
+		__execCaptureOnePacket(chunk, &hdr, buffer);
 		if (chunk->usage >= record_batch_threshold)
 		{
 			arrowChunkWriteOut(chunk);
@@ -2394,7 +2602,7 @@ __process_pcapng_simple_packet(SQLtable *chunk, pcapngSectionState *section,
 							   pcapngSimplePacketBlock *spb)
 {
 	uint32_t	block_sz = __to_host32(spb->c.block_length);
-	struct pfring_pkthdr phdr;
+	struct pcap_pkthdr phdr;
 
 	memset(&phdr.ts, 0, sizeof(phdr.ts));	//no timestamp
 	phdr.caplen = (block_sz - offsetof(pcapngSimplePacketBlock,
@@ -2427,7 +2635,7 @@ __process_pcapng_enhanced_packet(SQLtable *chunk, pcapngSectionState *section,
 								 pcapngEnhancedPacketBlock *epb)
 {
 	pcapngInterfaceState *i_state;
-	struct pfring_pkthdr phdr;
+	struct pcap_pkthdr phdr;
 	uint32_t	block_sz = __to_host32(epb->c.block_length);
 	uint32_t	interface_id = __to_host32(epb->interface_id);
 	uint64_t	ts_raw;
@@ -2817,6 +3025,10 @@ usage(int status)
 		  "  -i|--input=DEVICE\n"
 		  "       specifies a network device to capture packet.\n"
 		  "     --num-queues=N_QUEUE : num of PF-RING queues.\n"
+		  "     --af-packet : uses AF_PACKET (TPACKET_V3) socket per thread,\n"
+		  "       instead of PF-RING\n"
+		  "     --ring-size=SIZE : size of AF_PACKET ring buffer per thread\n"
+		  "       (default: 64MB)\n"
 		  "  -o|--output=<output file; with format>\n"
 		  "       filename format can contains:\n"
 		  "         %i : interface name\n"
@@ -2834,7 +3046,8 @@ usage(int status)
 		  "     --parallel-write=N_FILES\n"
 		  "       opens multiple output files simultaneously (default: 1)\n"
 		  "     --chunk-size=SIZE : size of record batch (default: 128MB)\n"
-		  "     --direct-io : enables O_DIRECT for write-i/o\n"
+		  "     --direct-io : enables O_DIRECT for write-i/o, with\n"
+		  "       double-buffered asynchronous write per thread\n"
 		  "  -l|--limit=LIMIT : (default: no limit)\n"
 		  "  -p|--protocol=PROTO\n"
 		  "       PROTO is a comma separated string contains\n"
@@ -2880,6 +3093,8 @@ parse_options(int argc, char *argv[])
 		{"parallel-write", required_argument, NULL, 1005},
 		{"composite-options", no_argument,    NULL, 1006},
 		{"interface-id",   no_argument,       NULL, 1007},
+		{"af-packet",      no_argument,       NULL, 1008},
+		{"ring-size",      required_argument, NULL, 1009},
 		{"help",           no_argument,       NULL, 'h'},
 		{NULL, 0, NULL, 0}
 	};
@@ -3020,6 +3235,25 @@ parse_options(int argc, char *argv[])
 				enable_interface_id = true;
 				break;
 
+			case 1008:	/* --af-packet */
+				enable_af_packet = true;
+				break;
+
+			case 1009:	/* --ring-size */
+				af_packet_ring_size = strtol(optarg, &pos, 10);
+				if (strcasecmp(pos, "k") == 0 || strcasecmp(pos, "kb") == 0)
+					af_packet_ring_size <<= 10;
+				else if (strcasecmp(pos, "m") == 0 || strcasecmp(pos, "mb") == 0)
+					af_packet_ring_size <<= 20;
+				else if (strcasecmp(pos, "g") == 0 || strcasecmp(pos, "gb") == 0)
+					af_packet_ring_size <<= 30;
+				else if (*pos != '\0')
+					Elog("unknown unit size '%s' in --ring-size option",
+						 optarg);
+				if (af_packet_ring_size < 4 * AF_PACKET_BLOCK_SIZE)
+					Elog("--ring-size too small (should be >= 4MB)");
+				break;
+
 			default:
 				usage(code == 'h' ? 0 : 1);
 				break;
@@ -3095,7 +3329,16 @@ parse_options(int argc, char *argv[])
 	/*
 	 * number of threads have different default; depending on the input
 	 */
-	if (input_devname)
+	if (input_devname && enable_af_packet)
+	{
+		if (num_threads < 0)
+			num_threads = 2 * NCPUS;
+		if (num_pcap_threads >= 0)
+			Elog("--pcap-threads cannot be used with AF_PACKET capture");
+		if (pfring_desc_nums >= 0)
+			Elog("--num-queues cannot be used with AF_PACKET capture");
+	}
+	else if (input_devname)
 	{
 		if (pfring_desc_nums < 0)
 			pfring_desc_nums = 4;
@@ -3117,6 +3360,51 @@ parse_options(int argc, char *argv[])
 	}
 }
 
+/*
+ * pcap_capture_stat - fetch the accumulated receive/drop counter
+ */
+static void
+pcap_capture_stat(uint64_t *p_recv, uint64_t *p_drop)
+{
+	uint64_t	recv = 0;
+	uint64_t	drop = 0;
+	int			i;
+
+	if (af_packet_desc_array)
+	{
+		for (i=0; i < af_packet_desc_nums; i++)
+		{
+			afPacketDesc *apdesc = &af_packet_desc_array[i];
+			struct tpacket_stats_v3 st;
+			socklen_t	len = sizeof(st);
+
+			/* PACKET_STATISTICS resets the counter on read */
+			if (getsockopt(apdesc->sockfd, SOL_PACKET, PACKET_STATISTICS,
+						   &st, &len) != 0)
+				Elog("failed on getsockopt(PACKET_STATISTICS): %m");
+			apdesc->stat_recv += st.tp_packets;
+			apdesc->stat_drop += st.tp_drops;
+			recv += apdesc->stat_recv;
+			drop += apdesc->stat_drop;
+		}
+	}
+#ifdef HAVE_PFRING
+	else if (pfring_desc_array)
+	{
+		for (i=0; i < pfring_desc_nums; i++)
+		{
+			pfring_stat	temp;
+
+			pfring_stats(pfring_desc_array[i], &temp);
+			recv += temp.recv;
+			drop += temp.drop;
+		}
+	}
+#endif
+	*p_recv = recv;
+	*p_drop = drop;
+}
+
 static void
 pcap_print_stat(bool is_final_call)
 {
@@ -3127,29 +3415,25 @@ pcap_print_stat(bool is_final_call)
 	static uint64_t last_tcp_packet_count = 0;
 	static uint64_t last_udp_packet_count = 0;
 	static uint64_t last_icmp_packet_count = 0;
-	static pfring_stat last_pfring_stat = {0,0,0};
+	static uint64_t last_recv_packet_count = 0;
+	static uint64_t last_drop_packet_count = 0;
 	uint64_t curr_raw_packet_length = atomicRead64(&stat_raw_packet_length);
 	uint64_t curr_ip4_packet_count = atomicRead64(&stat_ip4_packet_count);
 	uint64_t curr_ip6_packet_count = atomicRead64(&stat_ip6_packet_count);
 	uint64_t curr_tcp_packet_count = atomicRead64(&stat_tcp_packet_count);
 	uint64_t curr_udp_packet_count = atomicRead64(&stat_udp_packet_count);
 	uint64_t curr_icmp_packet_count = atomicRead64(&stat_icmp_packet_count);
+	uint64_t curr_recv_packet_count;
+	uint64_t curr_drop_packet_count;
 	uint64_t diff_raw_packet_length;
-	pfring_stat	curr_pfring_stat, temp;
 	char		linebuf[1024];
 	char	   *pos = linebuf;
 	time_t		t = time(NULL);
 	struct tm	tm;
-	int			i;
 
 	localtime_r(&t, &tm);
-	pfring_stats(pfring_desc_array[0], &curr_pfring_stat);
-	for (i=1; i < pfring_desc_nums; i++)
-	{
-		pfring_stats(pfring_desc_array[i], &temp);
-		curr_pfring_stat.recv += temp.recv;
-		curr_pfring_stat.drop += temp.drop;
-	}
+	pcap_capture_stat(&curr_recv_packet_count,
+					  &curr_drop_packet_count);
 
 	if (is_final_call)
 	{
@@ -3157,8 +3441,8 @@ pcap_print_stat(bool is_final_call)
 			   "Recv packets: %lu\n"
 			   "Drop packets: %lu\n"
 			   "Total bytes: %lu\n",
-			   curr_pfring_stat.recv,
-			   curr_pfring_stat.drop,
+			   curr_recv_packet_count,
+			   curr_drop_packet_count,
 			   curr_raw_packet_length);
 		if ((protocol_mask & __PCAP_PROTO__IPv4) != 0)
 			printf("IPv4 packets: %lu\n", curr_ip4_packet_count);
@@ -3200,8 +3484,8 @@ pcap_print_stat(bool is_final_call)
 				   tm.tm_hour,
 				   tm.tm_min,
 				   tm.tm_sec,
-				   curr_pfring_stat.recv - last_pfring_stat.recv,
-				   curr_pfring_stat.drop - last_pfring_stat.drop);
+				   curr_recv_packet_count - last_recv_packet_count,
+				   curr_drop_packet_count - last_drop_packet_count);
 	diff_raw_packet_length = curr_raw_packet_length - last_raw_packet_length;
 	if (diff_raw_packet_length < 10000UL)
 		pos += sprintf(pos, "  % 8ldB", diff_raw_packet_length);
@@ -3238,9 +3522,11 @@ pcap_print_stat(bool is_final_call)
 	last_tcp_packet_count	= curr_tcp_packet_count;
 	last_udp_packet_count	= curr_udp_packet_count;
 	last_icmp_packet_count	= curr_icmp_packet_count;
-	last_pfring_stat		= curr_pfring_stat;
+	last_recv_packet_count	= curr_recv_packet_count;
+	last_drop_packet_count	= curr_drop_packet_count;
 }
 
+#ifdef HAVE_PFRING
 /*
  * init_pfring_device_input - open the network device using PF-RING
  */
@@ -3299,6 +3585,123 @@ init_pfring_input(void)
 		pfring_desc_array[i] = pd;
 	}
 }
+#endif	/* HAVE_PFRING */
+
+/*
+ * init_af_packet_input - open the network device using AF_PACKET socket
+ *
+ * Each worker thread has its own TPACKET_V3 rx-ring, and all the sockets
+ * join a PACKET_FANOUT group, to distribute the flows across the threads.
+ */
+static void
+init_af_packet_input(void)
+{
+	unsigned int ifindex = if_nametoindex(input_devname);
+	uint32_t	fanout_id = ((uint32_t)getpid() & 0xffffU);
+	struct bpf_program bpf_prog;
+	struct sock_fprog bpf_fprog;
+	int			i, ival;
+
+	if (ifindex == 0)
+		Elog("failed on if_nametoindex('%s'): %m", input_devname);
+	/* compile the packet filtering rules, if any */
+	if (bpf_filter_rule)
+	{
+		pcap_t	   *pcap_dead = pcap_open_dead(DLT_EN10MB, 65535);
+
+		if (!pcap_dead)
+			Elog("failed on pcap_open_dead");
+		if (pcap_compile(pcap_dead, &bpf_prog, bpf_filter_rule,
+						 1, PCAP_NETMASK_UNKNOWN) != 0)
+			Elog("failed on pcap_compile('%s'): %s",
+				 bpf_filter_rule, pcap_geterr(pcap_dead));
+		pcap_close(pcap_dead);
+		bpf_fprog.len = bpf_prog.bf_len;
+		bpf_fprog.filter = (struct sock_filter *)bpf_prog.bf_insns;
+	}
+
+	af_packet_desc_nums = num_threads;
+	af_packet_desc_array = palloc0(sizeof(afPacketDesc) * af_packet_desc_nums);
+	for (i=0; i < af_packet_desc_nums; i++)
+	{
+		afPacketDesc   *apdesc = &af_packet_desc_array[i];
+		struct tpacket_req3 req;
+		struct sockaddr_ll sll;
+		struct packet_mreq mreq;
+		int			sockfd;
+
+		/*
+		 * protocol 0 receives no packets until bind(), so packets of the
+		 * other devices never come into the rx-ring.
+		 */
+		sockfd = socket(AF_PACKET, SOCK_RAW, 0);
+		if (sockfd < 0)
+			Elog("failed on socket(AF_PACKET): %m");
+
+		ival = TPACKET_V3;
+		if (setsockopt(sockfd, SOL_PACKET, PACKET_VERSION,
+					   &ival, sizeof(ival)) != 0)
+			Elog("failed on setsockopt(PACKET_VERSION): %m");
+
+		if (bpf_filter_rule &&
+			setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_FILTER,
+					   &bpf_fprog, sizeof(bpf_fprog)) != 0)
+			Elog("failed on setsockopt(SO_ATTACH_FILTER): %m");
+
+		/* setup rx-ring */
+		memset(&req, 0, sizeof(req));
+		req.tp_block_size = AF_PACKET_BLOCK_SIZE;
+		req.tp_block_nr = af_packet_ring_size / AF_PACKET_BLOCK_SIZE;
+		req.tp_frame_size = AF_PACKET_FRAME_SIZE;
+		req.tp_frame_nr = ((req.tp_block_size / req.tp_frame_size) *
+						   req.tp_block_nr);
+		req.tp_retire_blk_tov = AF_PACKET_BLOCK_TIMEOUT;
+		if (setsockopt(sockfd, SOL_PACKET, PACKET_RX_RING,
+					   &req, sizeof(req)) != 0)
+			Elog("failed on setsockopt(PACKET_RX_RING): %m");
+
+		apdesc->ring_sz = (size_t)req.tp_block_size * req.tp_block_nr;
+		apdesc->ring_buffer = mmap(NULL, apdesc->ring_sz,
+								   PROT_READ | PROT_WRITE,
+								   MAP_SHARED | MAP_POPULATE,
+								   sockfd, 0);
+		if (apdesc->ring_buffer == MAP_FAILED)
+			Elog("failed on mmap(sz=%zu) of AF_PACKET rx-ring: %m",
+				 apdesc->ring_sz);
+		apdesc->sockfd = sockfd;
+		apdesc->block_sz = req.tp_block_size;
+		apdesc->block_nr = req.tp_block_nr;
+
+		/* bind the socket to the device */
+		memset(&sll, 0, sizeof(sll));
+		sll.sll_family = AF_PACKET;
+		sll.sll_protocol = htons(ETH_P_ALL);
+		sll.sll_ifindex = ifindex;
+		if (bind(sockfd, (struct sockaddr *)&sll, sizeof(sll)) != 0)
+			Elog("failed on bind('%s'): %m", input_devname);
+
+		/* promiscuous mode */
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = ifindex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		if (setsockopt(sockfd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+					   &mreq, sizeof(mreq)) != 0)
+			Elog("failed on setsockopt(PACKET_ADD_MEMBERSHIP): %m");
+
+		/*
+		 * join the fanout group; packets of the same flow are delivered
+		 * to the same socket, and rolled over to others if its ring is full.
+		 */
+		ival = (fanout_id | ((PACKET_FANOUT_HASH |
+							  PACKET_FANOUT_FLAG_ROLLOVER |
+							  PACKET_FANOUT_FLAG_DEFRAG) << 16));
+		if (setsockopt(sockfd, SOL_PACKET, PACKET_FANOUT,
+					   &ival, sizeof(ival)) != 0)
+			Elog("failed on setsockopt(PACKET_FANOUT): %m");
+	}
+	if (bpf_filter_rule)
+		pcap_freecode(&bpf_prog);
+}
 
 int main(int argc, char *argv[])
 {
@@ -3321,11 +3724,44 @@ int main(int argc, char *argv[])
 								 columns[PCAP_SCHEMA_MAX_NFIELDS]));
 		arrowPcapSchemaInit(chunk);
 		chunk->fdesc = -1;
+		if (enable_direct_io)
+			chunk->buffer_align = PAGESIZE;
 		arrow_chunks_array[i] = chunk;
 	}
+	/* asynchronous chunk writers, if --direct-io */
+	if (enable_direct_io)
+	{
+		arrow_writers_array = palloc0(sizeof(arrowChunkWriter) * num_threads);
+		for (i=0; i < num_threads; i++)
+		{
+			arrowChunkWriter *writer = &arrow_writers_array[i];
+			SQLtable   *chunk;
+
+			chunk = palloc0(offsetof(SQLtable,
+									 columns[PCAP_SCHEMA_MAX_NFIELDS]));
+			arrowPcapSchemaInit(chunk);
+			chunk->fdesc = -1;
+			chunk->buffer_align = PAGESIZE;
+
+			pthreadMutexInit(&writer->mutex);
+			pthreadCondInit(&writer->cond);
+			writer->chunk = chunk;
+			rv = pthread_create(&writer->thread, NULL,
+								arrowChunkWriterMain, writer);
+			if (rv != 0)
+				Elog("failed on pthread_create: %s", strerror(rv));
+		}
+	}
 
 	if (input_devname)
-		init_pfring_input();
+	{
+		if (enable_af_packet)
+			init_af_packet_input();
+#ifdef HAVE_PFRING
+		else
+			init_pfring_input();
+#endif
+	}
 
 	/* open the output files, and related initialization */
 	arrow_file_desc_locks = palloc0(sizeof(pthread_mutex_t) * arrow_file_desc_nums);
@@ -3353,15 +3789,22 @@ int main(int argc, char *argv[])
 	workers = alloca(sizeof(pthread_t) * num_threads);
 	for (i=0; i < num_threads; i++)
 	{
-		rv = pthread_create(&workers[i], NULL,
-							input_devname ?
-							pfring_worker_main :
-							pcap_file_worker_main, (void *)i);
+		void	 *(*worker_main)(void *);
+
+		if (!input_devname)
+			worker_main = pcap_file_worker_main;
+#ifdef HAVE_PFRING
+		else if (!enable_af_packet)
+			worker_main = pfring_worker_main;
+#endif
+		else
+			worker_main = af_packet_worker_main;
+		rv = pthread_create(&workers[i], NULL, worker_main, (void *)i);
 		if (rv != 0)
 			Elog("failed on pthread_create: %s", strerror(rv));
 	}
 	/* print statistics */
-	if (pfring_desc_array && print_stat_interval > 0)
+	if (input_devname && print_stat_interval > 0)
 	{
 		sleep(print_stat_interval);
 		while (!do_shutdown)
@@ -3387,12 +3830,26 @@ int main(int argc, char *argv[])
 /*
  * memory allocation handlers
  */
+/*
+ * NOTE: With --direct-io, allocation of multiple of PAGESIZE (SQLbuffer
+ * always expands in 1MB unit, and metadata images are padded to PAGESIZE)
+ * is aligned to the page boundary, to write out the buffers by O_DIRECT
+ * without copy.
+ */
+#define __DIRECT_IO_BUFFER(sz)	\
+	(enable_direct_io && (sz) > 0 && (sz) == DIRECT_IO_ALIGN(sz))
+
 void *
 palloc(size_t sz)
 {
-	void   *ptr = malloc(sz);
+	void   *ptr;
 
-	if (!ptr)
+	if (__DIRECT_IO_BUFFER(sz))
+	{
+		if ((errno = posix_memalign(&ptr, PAGESIZE, sz)) != 0)
+			Elog("out of memory: %m");
+	}
+	else if (!(ptr = malloc(sz)))
 		Elog("out of memory");
 	return ptr;
 }
@@ -3400,10 +3857,8 @@ palloc(size_t sz)
 void *
 palloc0(size_t sz)
 {
-	void   *ptr = malloc(sz);
+	void   *ptr = palloc(sz);
 
-	if (!ptr)
-		Elog("out of memory");
 	memset(ptr, 0, sz);
 	return ptr;
 }
@@ -3425,6 +3880,15 @@ repalloc(void *old, size_t sz)
 
 	if (!ptr)
 		Elog("out of memory");
+	if (__DIRECT_IO_BUFFER(sz) && (uintptr_t)ptr != DIRECT_IO_ALIGN(ptr))
+	{
+		/* realloc(3) does not keep the alignment */
+		char   *temp = palloc(sz);
+
+		memcpy(temp, ptr, sz);
+		free(ptr);
+		ptr = temp;
+	}
 	return ptr;
 }
 
@@ -12,10 +12,12 @@
 #include <ctype.h>
 #include <getopt.h>
 #include <limits.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <strings.h>
+#include <time.h>
 
 /* command options */
 static char	   *sqldb_command = NULL;
@@ -29,6 +31,11 @@ static char	   *sqldb_password = NULL;
 static char	   *sqldb_database = NULL;
 static char	   *dump_arrow_filename = NULL;
 static char	   *stat_embedded_columns = NULL;
+static char	   *incremental_column = NULL;
+#ifdef __MYSQL2ARROW__
+static char	   *sqldb_table_name = NULL;
+static int		num_parallel_workers = 0;
+#endif
 static int		shows_progress = 0;
 static userConfigOption *sqldb_session_configs = NULL;
 static nestLoopOption *sqldb_nestloop_options = NULL;
@@ -560,6 +567,431 @@ enable_embedded_stats(SQLtable *table)
 	}
 }
 
+/*
+ * Routines for --incremental mode
+ *
+ * The high-water mark of the key column is saved in the custom metadata
+ * of the schema, then the next run with --append fetches only the rows
+ * beyond the watermark, and updates it. An empty watermark means that no
+ * rows were exported yet, so the next run fetches all the rows.
+ */
+#define INCREMENTAL_KEY_NAME		"incremental_key"
+#define INCREMENTAL_WATERMARK_NAME	"incremental_watermark"
+
+static void
+lookup_incremental_metadata(ArrowFileInfo *af_info,
+							const char **p_key,
+							const char **p_watermark)
+{
+	ArrowSchema *schema = &af_info->footer.schema;
+	const char *key = NULL;
+	const char *watermark = NULL;
+	int			i;
+
+	for (i=0; i < schema->_num_custom_metadata; i++)
+	{
+		ArrowKeyValue *kv = &schema->custom_metadata[i];
+
+		if (!kv->key)
+			continue;
+		if (strcmp(kv->key, INCREMENTAL_KEY_NAME) == 0)
+			key = kv->value;
+		else if (strcmp(kv->key, INCREMENTAL_WATERMARK_NAME) == 0)
+		{
+			/* empty value is not written, so it is read as NULL */
+			watermark = (kv->value ? kv->value : "");
+		}
+	}
+	*p_key = key;
+	*p_watermark = watermark;
+}
+
+static char *
+setup_incremental_command(ArrowFileInfo *af_info, const char *command,
+						  const char **p_watermark)
+{
+	const char *key;
+	const char *watermark;
+	const char *pos;
+	char	   *buf, *dst;
+	int			len;
+#ifdef __MYSQL2ARROW__
+	const char	quote = '`';
+#else
+	const char	quote = '"';
+#endif
+
+	lookup_incremental_metadata(af_info, &key, &watermark);
+	if (!key || !watermark)
+		Elog("'%s' has no incremental watermark; build it using -o and --incremental first",
+			 append_filename);
+	if (strcmp(key, incremental_column) != 0)
+		Elog("--incremental=%s mismatch to the key column [%s] of '%s'",
+			 incremental_column, key, append_filename);
+	/* no rows were exported yet */
+	if (*watermark == '\0')
+	{
+		*p_watermark = watermark;
+		return pstrdup(command);
+	}
+
+	/* trim the tailing semicolon, if any */
+	len = strlen(command);
+	while (len > 0 && (isspace(command[len-1]) || command[len-1] == ';'))
+		len--;
+
+	buf = palloc(len + 2 * strlen(key) + 2 * strlen(watermark) + 100);
+	dst = buf + sprintf(buf, "SELECT * FROM (%.*s) __incremental WHERE %c",
+						len, command, quote);
+	/* the key column is quoted as an identifier */
+	for (pos = key; *pos != '\0'; pos++)
+	{
+		if (*pos == quote)
+			*dst++ = quote;
+		*dst++ = *pos;
+	}
+	dst += sprintf(dst, "%c > '", quote);
+	for (pos = watermark; *pos != '\0'; pos++)
+	{
+		if (*pos == '\'')
+			*dst++ = '\'';
+		*dst++ = *pos;
+	}
+	strcpy(dst, "'");
+	*p_watermark = watermark;
+
+	return buf;
+}
+
+static SQLfield *
+lookup_incremental_field(SQLtable *table)
+{
+	SQLfield   *field = NULL;
+	int			j;
+
+	for (j=0; j < table->nfields; j++)
+	{
+		if (strcmp(table->columns[j].field_name, incremental_column) == 0)
+		{
+			field = &table->columns[j];
+			break;
+		}
+	}
+	if (!field)
+		Elog("field name [%s], specified by --incremental option, was not found",
+			 incremental_column);
+	if (field->arrow_type.node.tag != ArrowNodeTag__Int &&
+		field->arrow_type.node.tag != ArrowNodeTag__Date &&
+		field->arrow_type.node.tag != ArrowNodeTag__Timestamp)
+		Elog("--incremental field [%s; %s] must be integer, date or timestamp",
+			 field->field_name, field->arrow_type.node.tagName);
+	/* min/max statistics tracks the watermark of each record batch */
+	if (!field->stat_enabled)
+	{
+		if (!__enable_field_stats(field))
+			Elog("--incremental field [%s; %s] does not support min/max statistics",
+				 field->field_name, field->arrow_type.node.tagName);
+		table->has_statistics = true;
+	}
+	return field;
+}
+
+static int64_t
+__fetch_incremental_value(SQLfield *field, const SQLstat__datum *datum)
+{
+	switch (field->arrow_type.node.tag)
+	{
+		case ArrowNodeTag__Int:
+			switch (field->arrow_type.Int.bitWidth)
+			{
+				case 8:
+					return datum->i8;
+				case 16:
+					return datum->i16;
+				case 32:
+					return datum->i32;
+				default:
+					return datum->i64;
+			}
+		case ArrowNodeTag__Date:
+			if (field->arrow_type.Date.unit == ArrowDateUnit__Day)
+				return datum->i32;
+			return datum->i64;
+		default:
+			return datum->i64;
+	}
+}
+
+static char *
+build_incremental_watermark(SQLfield *field, int rb_base,
+							const char *old_watermark)
+{
+	SQLstat	   *curr;
+	int64_t		value = 0;
+	int64_t		unit_sz = 1;
+	int64_t		usec;
+	bool		found = false;
+	time_t		t;
+	struct tm	tm;
+	char		buf[128];
+	int			off;
+
+	for (curr = field->stat_list; curr; curr = curr->next)
+	{
+		int64_t		curr_value;
+
+		if (curr->rb_index < rb_base || !curr->is_valid)
+			continue;
+		curr_value = __fetch_incremental_value(field, &curr->max);
+		if (!found || value < curr_value)
+			value = curr_value;
+		found = true;
+	}
+	/* no new rows, so keep the watermark as is, or leave an empty one */
+	if (!found)
+		return (char *)(old_watermark ? old_watermark : "");
+
+	switch (field->arrow_type.node.tag)
+	{
+		case ArrowNodeTag__Int:
+			snprintf(buf, sizeof(buf), "%ld", value);
+			break;
+
+		case ArrowNodeTag__Date:
+			if (field->arrow_type.Date.unit == ArrowDateUnit__Day)
+				t = value * 86400L;
+			else
+				t = value / 1000L;
+			gmtime_r(&t, &tm);
+			strftime(buf, sizeof(buf), "%Y-%m-%d", &tm);
+			break;
+
+		case ArrowNodeTag__Timestamp:
+			switch (field->arrow_type.Timestamp.unit)
+			{
+				case ArrowTimeUnit__Second:
+					unit_sz = 1L;
+					break;
+				case ArrowTimeUnit__MilliSecond:
+					unit_sz = 1000L;
+					break;
+				case ArrowTimeUnit__MicroSecond:
+					unit_sz = 1000000L;
+					break;
+				case ArrowTimeUnit__NanoSecond:
+					unit_sz = 1000000000L;
+					break;
+				default:
+					Elog("ArrowTypeTimestamp has unknown unit (%d)",
+						 field->arrow_type.Timestamp.unit);
+			}
+			t = value / unit_sz;
+			usec = value % unit_sz;
+			if (usec < 0)
+			{
+				t--;
+				usec += unit_sz;
+			}
+			usec = usec * 1000000L / unit_sz;
+			gmtime_r(&t, &tm);
+			off = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+			snprintf(buf+off, sizeof(buf)-off, ".%06ld", usec);
+#ifdef __PG2ARROW__
+			/* timestamp with time zone is always UTC */
+			if (field->arrow_type.Timestamp.timezone)
+				strcat(buf, "+00");
+#endif
+			break;
+
+		default:
+			Elog("Bug? unexpected --incremental field type (%s)",
+				 field->arrow_type.node.tagName);
+	}
+	return pstrdup(buf);
+}
+
+static void
+__setup_custom_metadata(ArrowKeyValue *kv, const char *key, const char *value)
+{
+	initArrowNode(kv, KeyValue);
+	kv->key = key;
+	kv->_key_len = strlen(key);
+	kv->value = value;
+	kv->_value_len = strlen(value);
+}
+
+#ifdef __MYSQL2ARROW__
+/*
+ * Routines for --parallel mode
+ *
+ * Each worker has its own connection in a consistent snapshot, and
+ * converts a range of the primary key to record batches. The record
+ * batches are written to the shared output file under the lock, then
+ * the main table (used only for the schema, dictionaries and footer)
+ * tracks the record batches and min/max statistics. It is never touched
+ * by the workers without the lock.
+ */
+typedef struct
+{
+	pthread_t	thread;
+	void	   *sqldb_state;
+	const char *command;
+	SQLtable   *table;
+	SQLtable   *main_table;
+} parallelWorker;
+
+static pthread_mutex_t	parallel_write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static parallelWorker *
+setup_parallel_workers(void *leader_state)
+{
+	parallelWorker *workers;
+	void	  **worker_states;
+	char	  **worker_commands;
+	int			i;
+
+	workers = palloc0(sizeof(parallelWorker) * num_parallel_workers);
+	worker_states = alloca(sizeof(void *) * num_parallel_workers);
+	for (i=0; i < num_parallel_workers; i++)
+	{
+		worker_states[i] = sqldb_server_connect(sqldb_hostname,
+												sqldb_port_num,
+												sqldb_username,
+												sqldb_password,
+												sqldb_database,
+												sqldb_session_configs,
+												sqldb_nestloop_options);
+		workers[i].sqldb_state = worker_states[i];
+	}
+	worker_commands = sqldb_parallel_snapshot(leader_state,
+											  worker_states,
+											  num_parallel_workers,
+											  sqldb_table_name);
+	for (i=0; i < num_parallel_workers; i++)
+		workers[i].command = worker_commands[i];
+	return workers;
+}
+
+static SQLtable *
+begin_parallel_queries(parallelWorker *workers,
+					   ArrowFileInfo *af_info,
+					   SQLdictionary *sql_dict_list)
+{
+	SQLtable   *main_table = NULL;
+	size_t		sz;
+	int			i, j;
+
+	for (i=0; i < num_parallel_workers; i++)
+	{
+		SQLtable   *table;
+
+		table = sqldb_begin_query(workers[i].sqldb_state,
+								  workers[i].command,
+								  af_info,
+								  sql_dict_list);
+		if (!table)
+			Elog("Empty results by the query: %s", workers[i].command);
+		table->segment_sz = batch_segment_sz;
+		enable_embedded_stats(table);
+		workers[i].table = table;
+	}
+	/* main table shares the schema, but no buffers with the workers */
+	sz = offsetof(SQLtable, columns[workers[0].table->nfields]);
+	main_table = palloc(sz);
+	memcpy(main_table, workers[0].table, sz);
+	for (j=0; j < main_table->nfields; j++)
+	{
+		SQLfield   *field = &main_table->columns[j];
+
+		sql_buffer_init(&field->nullmap);
+		sql_buffer_init(&field->values);
+		sql_buffer_init(&field->extra);
+		field->stat_enabled = false;	/* enabled by the caller */
+	}
+	main_table->has_statistics = false;
+	main_table->__iov = NULL;
+	main_table->__iov_len = 0;
+	main_table->__iov_cnt = 0;
+	for (i=0; i < num_parallel_workers; i++)
+		workers[i].main_table = main_table;
+	return main_table;
+}
+
+static void
+parallelWriteRecordBatch(SQLtable *main_table, SQLtable *table)
+{
+	int			j;
+
+	pthread_mutex_lock(&parallel_write_lock);
+	/*
+	 * write out the record batch at the tail of the shared file, as if
+	 * the worker's table owns the record batches and statistics of the
+	 * main table.
+	 */
+	table->fdesc = main_table->fdesc;
+	table->filename = main_table->filename;
+	table->f_pos = main_table->f_pos;
+	table->recordBatches = main_table->recordBatches;
+	table->numRecordBatches = main_table->numRecordBatches;
+	for (j=0; j < table->nfields; j++)
+		table->columns[j].stat_list = main_table->columns[j].stat_list;
+
+	writeArrowRecordBatch(table);
+
+	main_table->f_pos = table->f_pos;
+	main_table->recordBatches = table->recordBatches;
+	main_table->numRecordBatches = table->numRecordBatches;
+	for (j=0; j < table->nfields; j++)
+	{
+		main_table->columns[j].stat_list = table->columns[j].stat_list;
+		table->columns[j].stat_list = NULL;
+	}
+	table->recordBatches = NULL;
+	table->numRecordBatches = 0;
+	shows_record_batch_progress(main_table, table->nitems);
+	pthread_mutex_unlock(&parallel_write_lock);
+
+	sql_table_clear(table);
+}
+
+static void *
+parallelWorkerMain(void *__priv)
+{
+	parallelWorker *worker = __priv;
+	SQLtable   *table = worker->table;
+
+	sqldb_thread_init();
+	while (sqldb_fetch_results(worker->sqldb_state, table))
+	{
+		if (table->usage > batch_segment_sz)
+			parallelWriteRecordBatch(worker->main_table, table);
+	}
+	if (table->nitems > 0)
+		parallelWriteRecordBatch(worker->main_table, table);
+	sqldb_thread_end();
+
+	return NULL;
+}
+
+static void
+exec_parallel_workers(parallelWorker *workers)
+{
+	int		i;
+
+	for (i=0; i < num_parallel_workers; i++)
+	{
+		if ((errno = pthread_create(&workers[i].thread, NULL,
+									parallelWorkerMain, &workers[i])) != 0)
+			Elog("failed on pthread_create: %m");
+	}
+	for (i=0; i < num_parallel_workers; i++)
+	{
+		if ((errno = pthread_join(workers[i].thread, NULL)) != 0)
+			Elog("failed on pthread_join: %m");
+	}
+}
+#endif	/* __MYSQL2ARROW__ */
+
 static void
 usage(void)
 {
@@ -585,6 +1017,16 @@ usage(void)
 		  "  -S, --stat[=COLUMNS] embeds min/max statistics for each record batch\n"
 		  "                       COLUMNS is a comma-separated list of the target\n"
 		  "                       columns if partially enabled.\n"
+		  "      --incremental=COLUMN\n"
+		  "                       saves the high-water mark of COLUMN (integer,\n"
+		  "                       date or timestamp) in the result file. With\n"
+		  "                       --append, it fetches only rows whose COLUMN is\n"
+		  "                       larger than the watermark, then updates it.\n"
+#ifdef __MYSQL2ARROW__
+		  "      --parallel=N     exports the table (-t) using N connections in\n"
+		  "                       a consistent snapshot, split by the range of\n"
+		  "                       the primary key.\n"
+#endif
 		  "\n"
 		  "Arrow format options:\n"
 		  "  -s, --segment-size=SIZE size of record batch for each\n"
@@ -638,6 +1080,10 @@ parse_options(int argc, char * const argv[])
 		{"inner-join",   required_argument, NULL, 1004},
 		{"outer-join",   required_argument, NULL, 1005},
 		{"stat",         optional_argument, NULL, 'S'},
+		{"incremental",  required_argument, NULL, 1006},
+#ifdef __MYSQL2ARROW__
+		{"parallel",     required_argument, NULL, 1007},
+#endif /* __MYSQL2ARROW__ */
 		{"help",         no_argument,       NULL, 9999},
 		{NULL, 0, NULL, 0},
 	};
@@ -687,6 +1133,9 @@ parse_options(int argc, char * const argv[])
 				if (!sqldb_command)
 					Elog("out of memory");
 				sprintf(sqldb_command, "SELECT * FROM %s", optarg);
+#ifdef __MYSQL2ARROW__
+				sqldb_table_name = optarg;
+#endif
 				break;
 
 			case 'o':
@@ -821,6 +1270,20 @@ parse_options(int argc, char * const argv[])
 						stat_embedded_columns = "*";
 				}
 				break;
+			case 1006:		/* --incremental */
+				if (incremental_column)
+					Elog("--incremental option was supplied twice");
+				incremental_column = optarg;
+				break;
+#ifdef __MYSQL2ARROW__
+			case 1007:		/* --parallel */
+				if (num_parallel_workers > 0)
+					Elog("--parallel option was supplied twice");
+				num_parallel_workers = atoi(optarg);
+				if (num_parallel_workers < 1 || num_parallel_workers > 256)
+					Elog("--parallel=%s is out of range [1..256]", optarg);
+				break;
+#endif /* __MYSQL2ARROW__ */
 			case 9999:		/* --help */
 			default:
 				usage();
@@ -860,6 +1323,17 @@ parse_options(int argc, char * const argv[])
 	}
 	if (!sqldb_command)
 		Elog("Neither -c nor -t options are supplied");
+	if (incremental_column && !output_filename && !append_filename)
+		Elog("--incremental option must be used with -o or --append");
+#ifdef __MYSQL2ARROW__
+	if (num_parallel_workers > 0)
+	{
+		if (!sqldb_table_name)
+			Elog("--parallel option must be used with -t");
+		if (incremental_column)
+			Elog("--parallel and --incremental are exclusive");
+	}
+#endif
 	if (batch_segment_sz == 0)
 		batch_segment_sz = (1UL << 28);		/* 256MB in default */
 }
@@ -875,8 +1349,17 @@ int main(int argc, char * const argv[])
 	SQLtable	   *table;
 	ArrowKeyValue  *kv;
 	SQLdictionary  *sql_dict_list = NULL;
-	
+	char		   *base_command;
+	SQLfield	   *incremental_field = NULL;
+	const char	   *incremental_watermark = NULL;
+	int				rb_base = 0;
+#ifdef __MYSQL2ARROW__
+	parallelWorker *workers = NULL;
+	int				i;
+#endif
+
 	parse_options(argc, argv);
+	base_command = sqldb_command;
 
 	/* special case if --dump=FILENAME */
 	if (dump_arrow_filename)
@@ -890,6 +1373,11 @@ int main(int argc, char * const argv[])
 									   sqldb_database,
 									   sqldb_session_configs,
 									   sqldb_nestloop_options);
+#ifdef __MYSQL2ARROW__
+	/* open worker connections in a consistent snapshot, if --parallel */
+	if (num_parallel_workers > 0)
+		workers = setup_parallel_workers(sqldb_state);
+#endif
 	/* read the original arrow file, if --append mode */
 	if (append_filename)
 	{
@@ -898,8 +1386,20 @@ int main(int argc, char * const argv[])
 			Elog("failed on open('%s'): %m", append_filename);
 		readArrowFileDesc(append_fdesc, &af_info);
 		sql_dict_list = loadArrowDictionaryBatches(append_fdesc, &af_info);
+		/* fetch only rows beyond the watermark, if --incremental */
+		if (incremental_column)
+			sqldb_command = setup_incremental_command(&af_info,
+													  sqldb_command,
+													  &incremental_watermark);
 	}
 	/* begin SQL command execution */
+#ifdef __MYSQL2ARROW__
+	if (workers)
+		table = begin_parallel_queries(workers,
+									   append_filename ? &af_info : NULL,
+									   sql_dict_list);
+	else
+#endif
 	table = sqldb_begin_query(sqldb_state,
 							  sqldb_command,
 							  append_filename ? &af_info : NULL,
@@ -909,16 +1409,35 @@ int main(int argc, char * const argv[])
 	table->segment_sz = batch_segment_sz;
 	/* enables embedded min/max statistics, if any */
 	enable_embedded_stats(table);
+	if (incremental_column)
+		incremental_field = lookup_incremental_field(table);
 
-	/* save the SQL command as custom metadata */
-	kv = palloc0(sizeof(ArrowKeyValue));
-	initArrowNode(kv, KeyValue);
-	kv->key = "sql_command";
-	kv->_key_len = 11;
-	kv->value = sqldb_command;
-	kv->_value_len = strlen(sqldb_command);
+	/* save the SQL command (and incremental key) as custom metadata */
+	kv = palloc0(sizeof(ArrowKeyValue) * 3);
+	__setup_custom_metadata(&kv[0], "sql_command", base_command);
 	table->customMetadata = kv;
 	table->numCustomMetadata = 1;
+	if (incremental_column)
+	{
+		__setup_custom_metadata(&kv[1], INCREMENTAL_KEY_NAME,
+								incremental_column);
+		table->numCustomMetadata = 2;
+	}
+	else if (append_filename)
+	{
+		const char *key;
+		const char *watermark;
+
+		/* --append without --incremental keeps the watermark as is */
+		lookup_incremental_metadata(&af_info, &key, &watermark);
+		if (key && watermark)
+		{
+			__setup_custom_metadata(&kv[1], INCREMENTAL_KEY_NAME, key);
+			__setup_custom_metadata(&kv[2], INCREMENTAL_WATERMARK_NAME,
+									watermark);
+			table->numCustomMetadata = 3;
+		}
+	}
 
 	/* open & setup result file */
 	if (!append_filename)
@@ -929,29 +1448,57 @@ int main(int argc, char * const argv[])
 		table->filename = append_filename;
 		setup_append_file(table, &af_info);
 	}
+	rb_base = table->numRecordBatches;
 	/* write out dictionary batch, if any */
 	writeArrowDictionaryBatches(table);
 	
 	/* main loop to fetch and write result */
-	while (sqldb_fetch_results(sqldb_state, table))
+#ifdef __MYSQL2ARROW__
+	if (workers)
+		exec_parallel_workers(workers);
+	else
+#endif
 	{
-		if (table->usage > batch_segment_sz)
+		while (sqldb_fetch_results(sqldb_state, table))
+		{
+			if (table->usage > batch_segment_sz)
+			{
+				writeArrowRecordBatch(table);
+				shows_record_batch_progress(table, table->nitems);
+				sql_table_clear(table);
+			}
+		}
+		if (table->nitems > 0)
 		{
 			writeArrowRecordBatch(table);
 			shows_record_batch_progress(table, table->nitems);
 			sql_table_clear(table);
 		}
 	}
-	if (table->nitems > 0)
+	/* update the watermark, if --incremental */
+	if (incremental_field)
 	{
-		writeArrowRecordBatch(table);
-		shows_record_batch_progress(table, table->nitems);
-		sql_table_clear(table);
+		incremental_watermark = build_incremental_watermark(incremental_field,
+															rb_base,
+															incremental_watermark);
+		if (incremental_watermark)
+		{
+			__setup_custom_metadata(&kv[2], INCREMENTAL_WATERMARK_NAME,
+									incremental_watermark);
+			table->numCustomMetadata = 3;
+		}
 	}
 	/* write out footer portion */
 	writeArrowFooter(table);
 
-	/* cleanup */
+	/* cleanup; the leader connection is released with the workers */
+#ifdef __MYSQL2ARROW__
+	if (workers)
+	{
+		for (i=0; i < num_parallel_workers; i++)
+			sqldb_close_connection(workers[i].sqldb_state);
+	}
+#endif
 	sqldb_close_connection(sqldb_state);
 	close(table->fdesc);
 
@@ -39,6 +39,17 @@ sqldb_fetch_results(void *sqldb_state, SQLtable *table);
 extern void
 sqldb_close_connection(void *sqldb_state);
 
+/* only mysql2arrow supports --parallel right now */
+extern char **
+sqldb_parallel_snapshot(void *leader_state,
+						void **worker_states,
+						int nworkers,
+						const char *table_name);
+extern void
+sqldb_thread_init(void);
+extern void
+sqldb_thread_end(void);
+
 /* misc functions */
 extern void	   *palloc(size_t sz);
 extern void	   *palloc0(size_t sz);
@@ -11,6 +11,7 @@
  */
 #include <ruby.h>
 #include <ctype.h>
+#include <endian.h>
 #include <libgen.h>
 #include <sys/file.h>
 #include "float2.h"
@@ -1997,13 +1998,6 @@ arrowFileSetupAppend(SQLtable *table)
 	table->f_pos = offset;
 }
 
-typedef struct
-{
-	VALUE		self;
-	VALUE		chunk;
-	SQLtable   *table;
-} WriteChunkArgs;
-
 static SQLtable *
 __arrowFileCreateTable(VALUE self)
 {
@@ -2102,55 +2096,572 @@ __arrowFileReleaseTable(SQLtable *table)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *
+ * Routines to decode the msgpack binary of the buffer chunk
+ *
+ * The chunk is a sequence of [tag, time, record] in msgpack format.
+ * We decode the raw bytes, then put the values onto the column buffers
+ * directly, without materialization of Ruby Hash objects per row.
+ *
+ * ----------------------------------------------------------------
+ */
+typedef enum
+{
+	MSGPACK_KIND__NIL,
+	MSGPACK_KIND__BOOL,
+	MSGPACK_KIND__INT,
+	MSGPACK_KIND__UINT,
+	MSGPACK_KIND__FLOAT,
+	MSGPACK_KIND__STR,
+	MSGPACK_KIND__BIN,
+	MSGPACK_KIND__ARRAY,
+	MSGPACK_KIND__MAP,
+	MSGPACK_KIND__EXT,
+	MSGPACK_KIND__EVENTTIME,
+	MSGPACK_KIND__OBJECT,	/* nested array/map/ext in the record */
+} MsgpackKind;
+
+typedef struct
+{
+	MsgpackKind	kind;
+	union {
+		bool		bval;
+		int64_t		ival;
+		uint64_t	uval;
+		double		fval;
+		uint32_t	nitems;		/* ARRAY/MAP */
+		struct {
+			int64_t		sec;
+			uint32_t	nsec;
+		} ts;					/* EVENTTIME */
+	} v;
+	const char *ptr;	/* STR/BIN/EXT payload, or OBJECT image */
+	uint32_t	len;
+} MsgpackDatum;
+
+typedef struct
+{
+	const char *pos;
+	const char *end;
+} MsgpackCursor;
+
+static inline const char *
+__msgpack_advance(MsgpackCursor *cursor, size_t sz)
+{
+	const char *pos = cursor->pos;
+
+	if (cursor->end - pos < sz)
+		Elog("msgpack binary of the buffer chunk is truncated");
+	cursor->pos += sz;
+	return pos;
+}
+
+static inline uint8_t
+__msgpack_fetch_u8(MsgpackCursor *cursor)
+{
+	return *((const uint8_t *)__msgpack_advance(cursor, 1));
+}
+
+static inline uint16_t
+__msgpack_fetch_u16(MsgpackCursor *cursor)
+{
+	uint16_t	val;
+
+	memcpy(&val, __msgpack_advance(cursor, sizeof(uint16_t)), sizeof(uint16_t));
+	return be16toh(val);
+}
+
+static inline uint32_t
+__msgpack_fetch_u32(MsgpackCursor *cursor)
+{
+	uint32_t	val;
+
+	memcpy(&val, __msgpack_advance(cursor, sizeof(uint32_t)), sizeof(uint32_t));
+	return be32toh(val);
+}
+
+static inline uint64_t
+__msgpack_fetch_u64(MsgpackCursor *cursor)
+{
+	uint64_t	val;
+
+	memcpy(&val, __msgpack_advance(cursor, sizeof(uint64_t)), sizeof(uint64_t));
+	return be64toh(val);
+}
+
+static inline void
+__msgpack_fetch_payload(MsgpackCursor *cursor, MsgpackDatum *datum,
+						MsgpackKind kind, uint32_t len)
+{
+	datum->kind = kind;
+	datum->len = len;
+	datum->ptr = __msgpack_advance(cursor, len);
+}
+
+static void
+__msgpack_fetch_ext(MsgpackCursor *cursor, MsgpackDatum *datum, uint32_t len)
+{
+	int8_t		ext_type = (int8_t)__msgpack_fetch_u8(cursor);
+
+	__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__EXT, len);
+	/* Fluent::EventTime (ext type 0; 32bit sec + 32bit nsec) */
+	if (ext_type == 0 && len == 8)
+	{
+		uint32_t	sec, nsec;
+
+		memcpy(&sec,  datum->ptr,     sizeof(uint32_t));
+		memcpy(&nsec, datum->ptr + 4, sizeof(uint32_t));
+		datum->kind = MSGPACK_KIND__EVENTTIME;
+		datum->v.ts.sec = be32toh(sec);
+		datum->v.ts.nsec = be32toh(nsec);
+	}
+}
+
+/*
+ * msgpackFetchDatum - fetch one item from the cursor. ARRAY/MAP returns
+ * only the number of items; the caller must fetch or skip the elements.
+ */
+static void
+msgpackFetchDatum(MsgpackCursor *cursor, MsgpackDatum *datum)
+{
+	uint8_t		c = __msgpack_fetch_u8(cursor);
+
+	datum->ptr = NULL;
+	datum->len = 0;
+	if (c <= 0x7f)
+	{
+		datum->kind = MSGPACK_KIND__INT;
+		datum->v.ival = c;
+	}
+	else if (c >= 0xe0)
+	{
+		datum->kind = MSGPACK_KIND__INT;
+		datum->v.ival = (int8_t)c;
+	}
+	else if ((c & 0xe0) == 0xa0)
+		__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__STR, c & 0x1f);
+	else if ((c & 0xf0) == 0x90)
+	{
+		datum->kind = MSGPACK_KIND__ARRAY;
+		datum->v.nitems = c & 0x0f;
+	}
+	else if ((c & 0xf0) == 0x80)
+	{
+		datum->kind = MSGPACK_KIND__MAP;
+		datum->v.nitems = c & 0x0f;
+	}
+	else
+	{
+		switch (c)
+		{
+			case 0xc0:
+				datum->kind = MSGPACK_KIND__NIL;
+				break;
+			case 0xc2:
+			case 0xc3:
+				datum->kind = MSGPACK_KIND__BOOL;
+				datum->v.bval = (c == 0xc3);
+				break;
+			case 0xc4:
+				__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__BIN,
+										__msgpack_fetch_u8(cursor));
+				break;
+			case 0xc5:
+				__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__BIN,
+										__msgpack_fetch_u16(cursor));
+				break;
+			case 0xc6:
+				__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__BIN,
+										__msgpack_fetch_u32(cursor));
+				break;
+			case 0xc7:
+				__msgpack_fetch_ext(cursor, datum, __msgpack_fetch_u8(cursor));
+				break;
+			case 0xc8:
+				__msgpack_fetch_ext(cursor, datum, __msgpack_fetch_u16(cursor));
+				break;
+			case 0xc9:
+				__msgpack_fetch_ext(cursor, datum, __msgpack_fetch_u32(cursor));
+				break;
+			case 0xca: {
+				uint32_t	ival = __msgpack_fetch_u32(cursor);
+				float		fval;
+
+				memcpy(&fval, &ival, sizeof(float));
+				datum->kind = MSGPACK_KIND__FLOAT;
+				datum->v.fval = fval;
+				break;
+			}
+			case 0xcb: {
+				uint64_t	ival = __msgpack_fetch_u64(cursor);
+
+				datum->kind = MSGPACK_KIND__FLOAT;
+				memcpy(&datum->v.fval, &ival, sizeof(double));
+				break;
+			}
+			case 0xcc:
+				datum->kind = MSGPACK_KIND__UINT;
+				datum->v.uval = __msgpack_fetch_u8(cursor);
+				break;
+			case 0xcd:
+				datum->kind = MSGPACK_KIND__UINT;
+				datum->v.uval = __msgpack_fetch_u16(cursor);
+				break;
+			case 0xce:
+				datum->kind = MSGPACK_KIND__UINT;
+				datum->v.uval = __msgpack_fetch_u32(cursor);
+				break;
+			case 0xcf:
+				datum->kind = MSGPACK_KIND__UINT;
+				datum->v.uval = __msgpack_fetch_u64(cursor);
+				break;
+			case 0xd0:
+				datum->kind = MSGPACK_KIND__INT;
+				datum->v.ival = (int8_t)__msgpack_fetch_u8(cursor);
+				break;
+			case 0xd1:
+				datum->kind = MSGPACK_KIND__INT;
+				datum->v.ival = (int16_t)__msgpack_fetch_u16(cursor);
+				break;
+			case 0xd2:
+				datum->kind = MSGPACK_KIND__INT;
+				datum->v.ival = (int32_t)__msgpack_fetch_u32(cursor);
+				break;
+			case 0xd3:
+				datum->kind = MSGPACK_KIND__INT;
+				datum->v.ival = (int64_t)__msgpack_fetch_u64(cursor);
+				break;
+			case 0xd4:
+				__msgpack_fetch_ext(cursor, datum, 1);
+				break;
+			case 0xd5:
+				__msgpack_fetch_ext(cursor, datum, 2);
+				break;
+			case 0xd6:
+				__msgpack_fetch_ext(cursor, datum, 4);
+				break;
+			case 0xd7:
+				__msgpack_fetch_ext(cursor, datum, 8);
+				break;
+			case 0xd8:
+				__msgpack_fetch_ext(cursor, datum, 16);
+				break;
+			case 0xd9:
+				__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__STR,
+										__msgpack_fetch_u8(cursor));
+				break;
+			case 0xda:
+				__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__STR,
+										__msgpack_fetch_u16(cursor));
+				break;
+			case 0xdb:
+				__msgpack_fetch_payload(cursor, datum, MSGPACK_KIND__STR,
+										__msgpack_fetch_u32(cursor));
+				break;
+			case 0xdc:
+				datum->kind = MSGPACK_KIND__ARRAY;
+				datum->v.nitems = __msgpack_fetch_u16(cursor);
+				break;
+			case 0xdd:
+				datum->kind = MSGPACK_KIND__ARRAY;
+				datum->v.nitems = __msgpack_fetch_u32(cursor);
+				break;
+			case 0xde:
+				datum->kind = MSGPACK_KIND__MAP;
+				datum->v.nitems = __msgpack_fetch_u16(cursor);
+				break;
+			case 0xdf:
+				datum->kind = MSGPACK_KIND__MAP;
+				datum->v.nitems = __msgpack_fetch_u32(cursor);
+				break;
+			default:
+				Elog("unknown msgpack format byte (0x%02x)", c);
+		}
+	}
+}
+
+/*
+ * msgpackFetchValue - fetch one value; nested array/map are returned
+ * as a binary image (MSGPACK_KIND__OBJECT) to be unpacked by Ruby.
+ */
+static void
+msgpackFetchValue(MsgpackCursor *cursor, MsgpackDatum *datum)
+{
+	const char *head = cursor->pos;
+	uint64_t	nitems;
+
+	msgpackFetchDatum(cursor, datum);
+	if (datum->kind != MSGPACK_KIND__ARRAY &&
+		datum->kind != MSGPACK_KIND__MAP)
+		return;
+	nitems = datum->v.nitems;
+	if (datum->kind == MSGPACK_KIND__MAP)
+		nitems *= 2;
+	while (nitems > 0)
+	{
+		MsgpackDatum	temp;
+
+		msgpackFetchDatum(cursor, &temp);
+		nitems--;
+		if (temp.kind == MSGPACK_KIND__ARRAY)
+			nitems += temp.v.nitems;
+		else if (temp.kind == MSGPACK_KIND__MAP)
+			nitems += 2 * (uint64_t)temp.v.nitems;
+	}
+	datum->kind = MSGPACK_KIND__OBJECT;
+	datum->ptr = head;
+	datum->len = cursor->pos - head;
+}
+
+/*
+ * msgpackDatumToRuby - Ruby VALUE for the put_value handlers.
+ * Integer, Float, Bool and nil are immediate values in most cases, so no
+ * object allocation happens.
+ */
 static VALUE
-__arrowFileWriteRow(RB_BLOCK_CALL_FUNC_ARGLIST(__yield, __private))
+msgpackDatumToRuby(MsgpackDatum *datum)
+{
+	static VALUE msgpack_module = Qnil;
+	VALUE		image;
+
+	switch (datum->kind)
+	{
+		case MSGPACK_KIND__NIL:
+			return Qnil;
+		case MSGPACK_KIND__BOOL:
+			return (datum->v.bval ? Qtrue : Qfalse);
+		case MSGPACK_KIND__INT:
+			return LL2NUM(datum->v.ival);
+		case MSGPACK_KIND__UINT:
+			return ULL2NUM(datum->v.uval);
+		case MSGPACK_KIND__FLOAT:
+			return DBL2NUM(datum->v.fval);
+		case MSGPACK_KIND__STR:
+			return rb_utf8_str_new(datum->ptr, datum->len);
+		case MSGPACK_KIND__BIN:
+			return rb_str_new(datum->ptr, datum->len);
+		case MSGPACK_KIND__EVENTTIME:
+			return rb_time_nano_new(datum->v.ts.sec, datum->v.ts.nsec);
+		default:
+			break;
+	}
+	/* elsewhere, unpack the binary image by the msgpack module */
+	if (msgpack_module == Qnil)
+	{
+		rb_require("msgpack");
+		msgpack_module = rb_path2class("MessagePack");
+	}
+	if (datum->kind == MSGPACK_KIND__OBJECT)
+		image = rb_str_new(datum->ptr, datum->len);
+	else
+		Elog("unexpected msgpack datum kind (%d)", datum->kind);
+	return rb_funcall(msgpack_module, rb_intern("unpack"), 1, image);
+}
+
+/*
+ * put_msgpack_utf8_value - fast path of Utf8 columns; the msgpack 'str'
+ * is already UTF-8, so we can copy the payload as is.
+ */
+static size_t
+put_msgpack_utf8_value(SQLfield *column, MsgpackDatum *datum)
+{
+	size_t		row_index = column->nitems++;
+
+	if (row_index == 0)
+		sql_buffer_append_zero(&column->values, sizeof(uint32_t));
+	sql_buffer_setbit(&column->nullmap, row_index);
+	sql_buffer_append(&column->extra, datum->ptr, datum->len);
+	sql_buffer_append(&column->values,
+					  &column->extra.usage, sizeof(uint32_t));
+	return __buffer_usage_varlena_type(column);
+}
+
+static inline void
+__arrowFileWriteMsgpackValue(SQLfield *column, MsgpackDatum *datum)
 {
-	WriteChunkArgs *args = (WriteChunkArgs *)__private;
-	SQLtable   *table = args->table;
-	VALUE		tag;
-	VALUE		ts;
-	VALUE		record;
+	if (datum->kind == MSGPACK_KIND__STR &&
+		column->arrow_type.node.tag == ArrowNodeTag__Utf8)
+		put_msgpack_utf8_value(column, datum);
+	else
+		column->put_value(column, (const char *)msgpackDatumToRuby(datum), -1);
+}
+
+/*
+ * Field-name to column lookup table; built once per SQLtable.
+ */
+typedef struct
+{
+	uint32_t	nslots;		/* power of 2 */
+	int		   *slots;		/* column index, or -1 if empty */
+	uint32_t   *fname_len;
+} FieldLookup;
+
+static inline uint32_t
+__field_lookup_hash(const char *name, uint32_t len)
+{
+	uint32_t	hash = 2166136261U;		/* FNV-1a */
+	uint32_t	i;
+
+	for (i=0; i < len; i++)
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void
+buildFieldLookup(SQLtable *table, FieldLookup *lookup)
+{
+	uint32_t	nslots = 16;
 	int			j;
 
-	tag = rb_funcall(__yield, rb_intern("fetch"), 1, INT2NUM(0));
-	ts = rb_funcall(__yield, rb_intern("fetch"), 1, INT2NUM(1));
-	record = rb_funcall(__yield, rb_intern("fetch"), 1, INT2NUM(2));
+	while (nslots < 2 * table->nfields)
+		nslots *= 2;
+	lookup->nslots = nslots;
+	lookup->slots = palloc(sizeof(int) * nslots);
+	lookup->fname_len = palloc(sizeof(uint32_t) * table->nfields);
+	memset(lookup->slots, -1, sizeof(int) * nslots);
 	for (j=0; j < table->nfields; j++)
 	{
 		SQLfield   *column = &table->columns[j];
-		VALUE		datum;
+		uint32_t	len = strlen(column->field_name);
+		uint32_t	index;
 
-		if (column->sql_type.fluent.ts_column)
-			datum = ts;
-		else if (column->sql_type.fluent.tag_column)
-			datum = tag;
-		else
+		lookup->fname_len[j] = len;
+		/* tag/ts columns are never fetched from the record */
+		if (column->sql_type.fluent.ts_column ||
+			column->sql_type.fluent.tag_column)
+			continue;
+		index = __field_lookup_hash(column->field_name, len) & (nslots - 1);
+		while (lookup->slots[index] >= 0)
+			index = (index + 1) & (nslots - 1);
+		lookup->slots[index] = j;
+	}
+}
+
+static inline int
+searchFieldLookup(SQLtable *table, FieldLookup *lookup,
+				  const char *name, uint32_t len)
+{
+	uint32_t	mask = lookup->nslots - 1;
+	uint32_t	index = __field_lookup_hash(name, len) & mask;
+	int			j;
+
+	while ((j = lookup->slots[index]) >= 0)
+	{
+		if (lookup->fname_len[j] == len &&
+			memcmp(table->columns[j].field_name, name, len) == 0)
+			return j;
+		index = (index + 1) & mask;
+	}
+	return -1;
+}
+
+static void
+releaseFieldLookup(FieldLookup *lookup)
+{
+	if (lookup->slots)
+		pfree(lookup->slots);
+	if (lookup->fname_len)
+		pfree(lookup->fname_len);
+	memset(lookup, 0, sizeof(FieldLookup));
+}
+
+/*
+ * __arrowFileWriteMsgpackChunk
+ *
+ * decodes [tag, time, record] rows in the msgpack binary, and put them
+ * onto the column buffers.
+ */
+static void
+__arrowFileWriteMsgpackChunk(SQLtable *table, FieldLookup *lookup,
+							 const char *buf, size_t len)
+{
+	MsgpackCursor cursor;
+	MsgpackDatum *values = alloca(sizeof(MsgpackDatum) * table->nfields);
+	MsgpackDatum tag;
+	MsgpackDatum ts;
+	MsgpackDatum temp;
+	uint32_t	i, nkeys;
+	int			j;
+
+	cursor.pos = buf;
+	cursor.end = buf + len;
+	while (cursor.pos < cursor.end)
+	{
+		msgpackFetchDatum(&cursor, &temp);
+		if (temp.kind != MSGPACK_KIND__ARRAY || temp.v.nitems != 3)
+			Elog("buffer chunk is not a sequence of [tag, time, record]");
+		msgpackFetchValue(&cursor, &tag);
+		msgpackFetchValue(&cursor, &ts);
+		msgpackFetchDatum(&cursor, &temp);
+		if (temp.kind != MSGPACK_KIND__MAP)
+			Elog("record of the buffer chunk is not a map");
+		nkeys = temp.v.nitems;
+
+		for (j=0; j < table->nfields; j++)
+			values[j].kind = MSGPACK_KIND__NIL;
+		for (i=0; i < nkeys; i++)
 		{
-			datum = rb_funcall(record, rb_intern("fetch"), 2,
-							   rb_str_new_cstr(column->field_name), Qnil);
+			msgpackFetchDatum(&cursor, &temp);
+			if (temp.kind == MSGPACK_KIND__STR)
+				j = searchFieldLookup(table, lookup, temp.ptr, temp.len);
+			else
+			{
+				/* non-string key never matches to the field name */
+				if (temp.kind == MSGPACK_KIND__ARRAY ||
+					temp.kind == MSGPACK_KIND__MAP)
+					Elog("record of the buffer chunk has a composite key");
+				j = -1;
+			}
+			if (j >= 0)
+				msgpackFetchValue(&cursor, &values[j]);
+			else
+				msgpackFetchValue(&cursor, &temp);
 		}
-		column->put_value(column, (const char *)datum, -1);
-	}
-	table->nitems++;
 
-	return Qtrue;
+		for (j=0; j < table->nfields; j++)
+		{
+			SQLfield   *column = &table->columns[j];
+
+			if (column->sql_type.fluent.ts_column)
+				__arrowFileWriteMsgpackValue(column, &ts);
+			else if (column->sql_type.fluent.tag_column)
+				__arrowFileWriteMsgpackValue(column, &tag);
+			else
+				__arrowFileWriteMsgpackValue(column, &values[j]);
+		}
+		table->nitems++;
+	}
 }
 
+typedef struct
+{
+	VALUE		self;
+	VALUE		chunk;
+	SQLtable   *table;
+	FieldLookup	lookup;
+} WriteChunkArgs;
+
 static VALUE
 __arrowFileWriteChunk(VALUE __args)
 {
 	WriteChunkArgs *args = (WriteChunkArgs *)__args;
 	SQLtable   *table;
+	VALUE		image;
 
 	/* setup SQLtable buffer */
 	args->table = table = __arrowFileCreateTable(args->self);
-	/* iterate chunk to fill up the buffer */
-	rb_block_call(args->chunk,
-				  rb_intern("each"),
-				  0,
-				  NULL,
-				  __arrowFileWriteRow,
-				  __args);
+	buildFieldLookup(table, &args->lookup);
+	/* decode the msgpack binary of the chunk to fill up the buffer */
+	image = rb_funcall(args->chunk, rb_intern("read"), 0);
+	StringValue(image);
+	__arrowFileWriteMsgpackChunk(table, &args->lookup,
+								 RSTRING_PTR(image),
+								 RSTRING_LEN(image));
+	RB_GC_GUARD(image);
 	/* open the destination file */
 	if (arrowFileOpenFile(args->self, args->table))
 		arrowFileSetupNewFile(args->table);
@@ -2187,10 +2698,12 @@ rb_ArrowFileWrite__writeChunk(VALUE self,
 				close(args.table->fdesc);
 			__arrowFileReleaseTable(args.table);
 		}
+		releaseFieldLookup(&args.lookup);
 		rb_jump_tag(status);
 	}
 	assert(args.table->fdesc < 0);
 	__arrowFileReleaseTable(args.table);
+	releaseFieldLookup(&args.lookup);
 
 	return retval;
 }
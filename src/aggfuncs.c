@@ -33,16 +33,28 @@ PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_fp16);
 PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_fp32);
 PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_fp64);
 PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_numeric);
+PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_bool);
+PG_FUNCTION_INFO_V1(pgstrom_partial_minmax_bytes);
+PG_FUNCTION_INFO_V1(pgstrom_partial_minmax_uuid);
+PG_FUNCTION_INFO_V1(pgstrom_fmin_trans_bytes);
+PG_FUNCTION_INFO_V1(pgstrom_fmax_trans_bytes);
+PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_bytes);
+PG_FUNCTION_INFO_V1(pgstrom_fminmax_final_uuid);
+PG_FUNCTION_INFO_V1(pgstrom_fbitand_trans_int64);
+PG_FUNCTION_INFO_V1(pgstrom_fbitor_trans_int64);
 
 PG_FUNCTION_INFO_V1(pgstrom_partial_sum_asis);
 
 PG_FUNCTION_INFO_V1(pgstrom_partial_avg_int);
 PG_FUNCTION_INFO_V1(pgstrom_partial_avg_fp);
+PG_FUNCTION_INFO_V1(pgstrom_partial_avg_num);
 PG_FUNCTION_INFO_V1(pgstrom_favg_trans_int);
 PG_FUNCTION_INFO_V1(pgstrom_favg_trans_fp);
+PG_FUNCTION_INFO_V1(pgstrom_favg_trans_num);
 PG_FUNCTION_INFO_V1(pgstrom_favg_final_int);
 PG_FUNCTION_INFO_V1(pgstrom_favg_final_fp);
 PG_FUNCTION_INFO_V1(pgstrom_favg_final_num);
+PG_FUNCTION_INFO_V1(pgstrom_fsum_final_num);
 
 PG_FUNCTION_INFO_V1(pgstrom_partial_variance);
 PG_FUNCTION_INFO_V1(pgstrom_stddev_trans);
@@ -70,6 +82,18 @@ PG_FUNCTION_INFO_V1(pgstrom_regr_sxx_final);
 PG_FUNCTION_INFO_V1(pgstrom_regr_sxy_final);
 PG_FUNCTION_INFO_V1(pgstrom_regr_syy_final);
 
+PG_FUNCTION_INFO_V1(pgstrom_hll_sketch_new);
+PG_FUNCTION_INFO_V1(pgstrom_hll_sketch_merge);
+PG_FUNCTION_INFO_V1(pgstrom_hll_count_final);
+PG_FUNCTION_INFO_V1(pgstrom_hll_sketch_histogram);
+/* PERCENTILE_CONT/PERCENTILE_DISC by quantile sketch */
+PG_FUNCTION_INFO_V1(pgstrom_partial_quantile);
+PG_FUNCTION_INFO_V1(pgstrom_quantile_merge);
+PG_FUNCTION_INFO_V1(pgstrom_quantile_cont);
+PG_FUNCTION_INFO_V1(pgstrom_quantile_cont_multi);
+PG_FUNCTION_INFO_V1(pgstrom_quantile_disc);
+PG_FUNCTION_INFO_V1(pgstrom_quantile_disc_multi);
+
 /*
  * float8 validator
  */
@@ -190,6 +214,21 @@ pgstrom_fmax_trans_fp64(PG_FUNCTION_ARGS)
 	__MINMAX_TRANS_TEMPLATE(fp64,Max);
 }
 
+#define __BITAND(a,b)		((a) & (b))
+#define __BITOR(a,b)		((a) | (b))
+
+Datum
+pgstrom_fbitand_trans_int64(PG_FUNCTION_ARGS)
+{
+	__MINMAX_TRANS_TEMPLATE(int64,__BITAND);
+}
+
+Datum
+pgstrom_fbitor_trans_int64(PG_FUNCTION_ARGS)
+{
+	__MINMAX_TRANS_TEMPLATE(int64,__BITOR);
+}
+
 Datum
 pgstrom_fminmax_final_int8(PG_FUNCTION_ARGS)
 {
@@ -277,6 +316,158 @@ pgstrom_fminmax_final_numeric(PG_FUNCTION_ARGS)
 							   Float8GetDatum(state->value));
 }
 
+Datum
+pgstrom_fminmax_final_bool(PG_FUNCTION_ARGS)
+{
+	kagg_state__pminmax_int64_packed *state
+		= (kagg_state__pminmax_int64_packed *)PG_GETARG_BYTEA_P(0);
+	if (state->nitems == 0)
+		PG_RETURN_NULL();
+	PG_RETURN_BOOL(state->value != 0);
+}
+
+/*
+ * MIN(X) and MAX(X) functions for text, bytea and uuid
+ */
+static kagg_state__pminmax_bytes_packed *
+__make_pminmax_bytes_state(const char *addr, uint32 len)
+{
+	kagg_state__pminmax_bytes_packed *r;
+	size_t		sz = KAGG_PMINMAX_BYTES_STATE_LENGTH(len);
+
+	r = palloc0(sz);
+	r->nitems = 1;
+	r->prefix = __kagg_bytes_prefix(addr, len);
+	r->attrs  = KAGG_BYTES_ATTR__HAS_VALUE;
+	r->length = len;
+	memcpy(r->value, addr, len);
+	SET_VARSIZE(r, sz);
+
+	return r;
+}
+
+Datum
+pgstrom_partial_minmax_bytes(PG_FUNCTION_ARGS)
+{
+	struct varlena *datum = PG_GETARG_VARLENA_PP(0);
+
+	PG_RETURN_POINTER(__make_pminmax_bytes_state(VARDATA_ANY(datum),
+												 VARSIZE_ANY_EXHDR(datum)));
+}
+
+Datum
+pgstrom_partial_minmax_uuid(PG_FUNCTION_ARGS)
+{
+	pg_uuid_t  *uuid = PG_GETARG_UUID_P(0);
+
+	PG_RETURN_POINTER(__make_pminmax_bytes_state((const char *)uuid->data,
+												 UUID_LEN));
+}
+
+static Datum
+__pgstrom_fminmax_trans_bytes(PG_FUNCTION_ARGS, bool is_min)
+{
+	kagg_state__pminmax_bytes_packed *state;
+	kagg_state__pminmax_bytes_packed *arg;
+	MemoryContext	aggcxt;
+	uint32			capacity;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(0))
+	{
+		if (PG_ARGISNULL(1))
+			PG_RETURN_NULL();
+		arg = (kagg_state__pminmax_bytes_packed *)PG_GETARG_BYTEA_P(1);
+		state = MemoryContextAlloc(aggcxt, VARSIZE(arg));
+		memcpy(state, arg, VARSIZE(arg));
+	}
+	else
+	{
+		state = (kagg_state__pminmax_bytes_packed *)PG_GETARG_BYTEA_P(0);
+		if (!PG_ARGISNULL(1))
+		{
+			arg = (kagg_state__pminmax_bytes_packed *)PG_GETARG_BYTEA_P(1);
+			if ((arg->attrs & KAGG_BYTES_ATTR__HAS_VALUE) != 0)
+			{
+				capacity = VARSIZE(state) - offsetof(kagg_state__pminmax_bytes_packed, value);
+				if (capacity < arg->length)
+				{
+					capacity = arg->length;
+					state = repalloc(state, KAGG_PMINMAX_BYTES_STATE_LENGTH(capacity));
+					SET_VARSIZE(state, KAGG_PMINMAX_BYTES_STATE_LENGTH(capacity));
+				}
+				__kagg_pminmax_bytes_update(state, capacity,
+											arg->value, arg->length,
+											(arg->attrs & KAGG_BYTES_ATTR__TRUNCATED) != 0,
+											is_min);
+			}
+			state->nitems += arg->nitems;
+		}
+	}
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+pgstrom_fmin_trans_bytes(PG_FUNCTION_ARGS)
+{
+	return __pgstrom_fminmax_trans_bytes(fcinfo, true);
+}
+
+Datum
+pgstrom_fmax_trans_bytes(PG_FUNCTION_ARGS)
+{
+	return __pgstrom_fminmax_trans_bytes(fcinfo, false);
+}
+
+static kagg_state__pminmax_bytes_packed *
+__fetch_pminmax_bytes_final(PG_FUNCTION_ARGS)
+{
+	kagg_state__pminmax_bytes_packed *state
+		= (kagg_state__pminmax_bytes_packed *)PG_GETARG_BYTEA_P(0);
+
+	if (state->nitems == 0 ||
+		(state->attrs & KAGG_BYTES_ATTR__HAS_VALUE) == 0)
+		return NULL;
+	if ((state->attrs & KAGG_BYTES_ATTR__TRUNCATED) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("MIN/MAX result is longer than the device buffer (%u bytes)",
+						(uint32)state->length),
+				 errhint("Try larger pg_strom.minmax_varlena_buffer_size")));
+	return state;
+}
+
+Datum
+pgstrom_fminmax_final_bytes(PG_FUNCTION_ARGS)
+{
+	kagg_state__pminmax_bytes_packed *state = __fetch_pminmax_bytes_final(fcinfo);
+	bytea	   *result;
+
+	if (!state)
+		PG_RETURN_NULL();
+	result = palloc(VARHDRSZ + state->length);
+	memcpy(VARDATA(result), state->value, state->length);
+	SET_VARSIZE(result, VARHDRSZ + state->length);
+	PG_RETURN_BYTEA_P(result);
+}
+
+Datum
+pgstrom_fminmax_final_uuid(PG_FUNCTION_ARGS)
+{
+	kagg_state__pminmax_bytes_packed *state = __fetch_pminmax_bytes_final(fcinfo);
+	pg_uuid_t  *result;
+
+	if (!state)
+		PG_RETURN_NULL();
+	if (state->length != UUID_LEN)
+		elog(ERROR, "Bug? min/max(uuid) state has wrong length: %u",
+			 (uint32)state->length);
+	result = palloc(sizeof(pg_uuid_t));
+	memcpy(result->data, state->value, UUID_LEN);
+	PG_RETURN_UUID_P(result);
+}
+
 /*
  * SUM(X) functions
  */
@@ -313,6 +504,36 @@ pgstrom_partial_avg_fp(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(r);
 }
 
+Datum
+pgstrom_partial_avg_num(PG_FUNCTION_ARGS)
+{
+	kagg_state__pavg_num_packed *r = palloc0(sizeof(kagg_state__pavg_num_packed));
+	varlena		   *addr = PG_GETARG_VARLENA_PP(0);
+	xpu_numeric_t	num;
+	uint64_t		ival[3];
+
+	memset(&num, 0, sizeof(num));
+	if (__xpu_numeric_from_varlena(&num, addr) != NULL)
+		r->attrs |= KAGG_NUMERIC_ATTR__OVERFLOW;
+	else if (num.kind == XPU_NUMERIC_KIND__NAN)
+		r->attrs |= KAGG_NUMERIC_ATTR__NAN;
+	else if (num.kind == XPU_NUMERIC_KIND__POS_INF)
+		r->attrs |= KAGG_NUMERIC_ATTR__POS_INF;
+	else if (num.kind == XPU_NUMERIC_KIND__NEG_INF)
+		r->attrs |= KAGG_NUMERIC_ATTR__NEG_INF;
+	else
+	{
+		__kagg_int192_from_int128(ival, num.value);
+		if (!__kagg_pavg_num_update(r, ival, num.weight,
+									__xpu_numeric_dscale_from_varlena(addr)))
+			r->attrs |= KAGG_NUMERIC_ATTR__OVERFLOW;
+	}
+	r->nitems = 1;
+	SET_VARSIZE(r, sizeof(kagg_state__pavg_num_packed));
+
+	PG_RETURN_POINTER(r);
+}
+
 Datum
 pgstrom_favg_trans_int(PG_FUNCTION_ARGS)
 {
@@ -373,6 +594,121 @@ pgstrom_favg_trans_fp(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(state);
 }
 
+Datum
+pgstrom_favg_trans_num(PG_FUNCTION_ARGS)
+{
+	kagg_state__pavg_num_packed *state;
+	kagg_state__pavg_num_packed *arg;
+	MemoryContext	aggcxt;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(0))
+	{
+		if (PG_ARGISNULL(1))
+			PG_RETURN_NULL();
+		arg = (kagg_state__pavg_num_packed *)PG_GETARG_BYTEA_P(1);
+		state = MemoryContextAlloc(aggcxt, sizeof(*state));
+		memcpy(state, arg, sizeof(*state));
+	}
+	else
+	{
+		state = (kagg_state__pavg_num_packed *)PG_GETARG_BYTEA_P(0);
+		if (!PG_ARGISNULL(1))
+		{
+			arg = (kagg_state__pavg_num_packed *)PG_GETARG_BYTEA_P(1);
+			if (!__kagg_pavg_num_update(state, arg->sum, arg->scale, arg->dscale))
+				state->attrs |= KAGG_NUMERIC_ATTR__OVERFLOW;
+			state->nitems += arg->nitems;
+			state->attrs  |= arg->attrs;
+		}
+	}
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * __pavg_num_state_to_numeric
+ *
+ * It constructs the total sum of the exact numeric aggregation, or returns
+ * false if no rows were accumulated. The sum has the largest display scale
+ * of the inputs, as numeric_add() doing.
+ */
+static bool
+__pavg_num_state_to_numeric(kagg_state__pavg_num_packed *state, Datum *p_sum)
+{
+	uint32_t	attrs = state->attrs;
+
+	if (state->nitems == 0)
+		return false;
+	if ((attrs & KAGG_NUMERIC_ATTR__OVERFLOW) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("numeric aggregation overflowed 192bit integer on the device"),
+				 errhint("try 'pg_strom.enable_gpupreagg = off' to run the aggregation by CPU")));
+	if ((attrs & KAGG_NUMERIC_ATTR__NAN) != 0 ||
+		((attrs & KAGG_NUMERIC_ATTR__POS_INF) != 0 &&
+		 (attrs & KAGG_NUMERIC_ATTR__NEG_INF) != 0))
+		*p_sum = DirectFunctionCall3(numeric_in,
+									 CStringGetDatum("NaN"),
+									 ObjectIdGetDatum(InvalidOid),
+									 Int32GetDatum(-1));
+	else if ((attrs & KAGG_NUMERIC_ATTR__POS_INF) != 0)
+		*p_sum = DirectFunctionCall3(numeric_in,
+									 CStringGetDatum("Infinity"),
+									 ObjectIdGetDatum(InvalidOid),
+									 Int32GetDatum(-1));
+	else if ((attrs & KAGG_NUMERIC_ATTR__NEG_INF) != 0)
+		*p_sum = DirectFunctionCall3(numeric_in,
+									 CStringGetDatum("-Infinity"),
+									 ObjectIdGetDatum(InvalidOid),
+									 Int32GetDatum(-1));
+	else
+	{
+		uint64_t	uval[3];
+		bool		is_negative = ((int64_t)state->sum[2] < 0);
+		char		digits[64];
+		char		buf[100];
+		char	   *pos = buf;
+		int			i, ndigits = 0;
+
+		/* absolute value of the 192bit integer */
+		for (i=0; i < 3; i++)
+			uval[i] = (is_negative ? ~state->sum[i] : state->sum[i]);
+		if (is_negative)
+		{
+			for (i=0; i < 3 && ++uval[i] == 0; i++);
+		}
+		do {
+			unsigned __int128 rem = 0;
+
+			for (i=2; i >= 0; i--)
+			{
+				unsigned __int128 curr = ((rem << 64) | uval[i]);
+
+				uval[i] = (uint64_t)(curr / 10);
+				rem = curr % 10;
+			}
+			digits[ndigits++] = '0' + (int)rem;
+		} while (uval[0] != 0 || uval[1] != 0 || uval[2] != 0);
+		if (is_negative)
+			*pos++ = '-';
+		while (ndigits > 0)
+			*pos++ = digits[--ndigits];
+		/* the scale is applied using the exponent notation */
+		sprintf(pos, "e%d", -state->scale);
+		*p_sum = DirectFunctionCall3(numeric_in,
+									 CStringGetDatum(buf),
+									 ObjectIdGetDatum(InvalidOid),
+									 Int32GetDatum(-1));
+		/* trailing zeros are stripped on the device; restore them */
+		if (state->dscale > state->scale)
+			*p_sum = DirectFunctionCall2(numeric_round,
+										 *p_sum,
+										 Int32GetDatum(state->dscale));
+	}
+	return true;
+}
+
 Datum
 pgstrom_favg_final_int(PG_FUNCTION_ARGS)
 {
@@ -401,18 +737,29 @@ pgstrom_favg_final_fp(PG_FUNCTION_ARGS)
 Datum
 pgstrom_favg_final_num(PG_FUNCTION_ARGS)
 {
-	kagg_state__pavg_fp_packed *state;
+	kagg_state__pavg_num_packed *state;
 	Datum	n, sum;
 
-	state = (kagg_state__pavg_fp_packed *)PG_GETARG_BYTEA_P(0);
-	if (state->nitems == 0)
+	state = (kagg_state__pavg_num_packed *)PG_GETARG_BYTEA_P(0);
+	if (!__pavg_num_state_to_numeric(state, &sum))
 		PG_RETURN_NULL();
-	n = DirectFunctionCall1(int4_numeric, Int32GetDatum(state->nitems));
-	sum = DirectFunctionCall1(float8_numeric, Float8GetDatum(state->sum));
+	n = DirectFunctionCall1(int8_numeric, Int64GetDatum(state->nitems));
 
 	PG_RETURN_DATUM(DirectFunctionCall2(numeric_div, sum, n));
 }
 
+Datum
+pgstrom_fsum_final_num(PG_FUNCTION_ARGS)
+{
+	kagg_state__pavg_num_packed *state;
+	Datum	sum;
+
+	state = (kagg_state__pavg_num_packed *)PG_GETARG_BYTEA_P(0);
+	if (!__pavg_num_state_to_numeric(state, &sum))
+		PG_RETURN_NULL();
+	PG_RETURN_DATUM(sum);
+}
+
 /*
  * STDDEV/VARIANCE
  */
@@ -754,7 +1101,6 @@ pgstrom_regr_syy_final(PG_FUNCTION_ARGS)
 	PG_RETURN_NULL();
 }
 
-#if 0
 /*
  * ----------------------------------------------------------------
  *
@@ -763,146 +1109,31 @@ pgstrom_regr_syy_final(PG_FUNCTION_ARGS)
  * ----------------------------------------------------------------
  */
 
-/*
- * Hash-function based on Sip-Hash
- *
- * See https://en.wikipedia.org/wiki/SipHash
- *     and https://github.com/veorq/SipHash
- */
-/* default: SipHash-2-4 */
-#define cROUNDS 2
-#define dROUNDS 4
-#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
-
-#define U8TO64_LE(p)											\
-    (((uint64_t)((p)[0]))       | ((uint64_t)((p)[1]) <<  8) |	\
-     ((uint64_t)((p)[2]) << 16) | ((uint64_t)((p)[3]) << 24) |	\
-     ((uint64_t)((p)[4]) << 32) | ((uint64_t)((p)[5]) << 40) |	\
-     ((uint64_t)((p)[6]) << 48) | ((uint64_t)((p)[7]) << 56))
-
-#define SIPROUND					\
-    do {							\
-        v0 += v1;					\
-        v1 = ROTL(v1, 13);			\
-        v1 ^= v0;					\
-        v0 = ROTL(v0, 32);			\
-        v2 += v3;					\
-        v3 = ROTL(v3, 16);			\
-        v3 ^= v2;					\
-        v0 += v3;					\
-        v3 = ROTL(v3, 21);			\
-        v3 ^= v0;					\
-        v2 += v1;					\
-        v1 = ROTL(v1, 17);			\
-        v1 ^= v2;					\
-        v2 = ROTL(v2, 32);			\
-    } while (0)
-
-static uint64_t
-__pgstrom_hll_siphash_value(const void *ptr, const size_t len)
-{
-	const unsigned char *ni = (const unsigned char *)ptr;
-	uint64_t	v0 = 0x736f6d6570736575UL;
-	uint64_t	v1 = 0x646f72616e646f6dUL;
-	uint64_t	v2 = 0x6c7967656e657261UL;
-	uint64_t	v3 = 0x7465646279746573UL;
-	uint64_t	k0 = 0x9c38151cda15a76bUL;	/* random key-0 */
-	uint64_t	k1 = 0xfb4ff68fbd3e6658UL;	/* random key-1 */
-	uint64_t	m;
-	int			i;
-    const unsigned char *end = ni + len - (len % sizeof(uint64_t));
-    const int	left = len & 7;
-    uint64_t	b = ((uint64_t)len) << 56;
-
-    v3 ^= k1;
-    v2 ^= k0;
-    v1 ^= k1;
-    v0 ^= k0;
-
-	for (; ni != end; ni += 8)
-	{
-		m = U8TO64_LE(ni);
-		v3 ^= m;
-
-		for (i = 0; i < cROUNDS; ++i)
-			SIPROUND;
-
-		v0 ^= m;
-	}
-
-#if 1
-	if (left > 0)
-	{
-		uint64_t	temp = 0;
-
-		memcpy(&temp, ni, left);
-		b |= (temp & ((1UL << (BITS_PER_BYTE * left)) - 1));
-	}
-#else
-	/* original code */
-	switch (left)
-	{
-		case 7:
-			b |= ((uint64_t)ni[6]) << 48;		__attribute__ ((fallthrough));
-		case 6:
-			b |= ((uint64_t)ni[5]) << 40;		__attribute__ ((fallthrough));
-		case 5:
-			b |= ((uint64_t)ni[4]) << 32;		__attribute__ ((fallthrough));
-		case 4:
-			b |= ((uint64_t)ni[3]) << 24;		__attribute__ ((fallthrough));
-		case 3:
-			b |= ((uint64_t)ni[2]) << 16;		__attribute__ ((fallthrough));
-		case 2:
-			b |= ((uint64_t)ni[1]) << 8;		__attribute__ ((fallthrough));
-		case 1:
-			b |= ((uint64_t)ni[0]);
-			break;
-		case 0:
-			break;
-    }
-#endif
-
-    v3 ^= b;
-	for (i = 0; i < cROUNDS; ++i)
-		SIPROUND;
-
-	v0 ^= b;
-
-	v2 ^= 0xff;
-
-	for (i = 0; i < dROUNDS; ++i)
-		SIPROUND;
-
-	b = v0 ^ v1 ^ v2 ^ v3;
-
-	return b;
-}
-
 /*
  * pgstrom_hll_hash_xxxx functions
  */
 static uint64
 __pgstrom_hll_hash_int1(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(int8));
+	return pg_hll_siphash_value(&datum, sizeof(int8));
 }
 
 static uint64
 __pgstrom_hll_hash_int2(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(int16));
+	return pg_hll_siphash_value(&datum, sizeof(int16));
 }
 
 static uint64
 __pgstrom_hll_hash_int4(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(int32));
+	return pg_hll_siphash_value(&datum, sizeof(int32));
 }
 
 static uint64
 __pgstrom_hll_hash_int8(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(int64));
+	return pg_hll_siphash_value(&datum, sizeof(int64));
 }
 
 static uint64
@@ -912,43 +1143,47 @@ __pgstrom_hll_hash_numeric(Datum datum)
 	const char	   *emsg;
 
 	memset(&num, 0, sizeof(num));
-	emsg = __xpu_numeric_from_varlena(&num, (struct varlena *)datum);
+	emsg = __xpu_numeric_from_varlena(&num, PG_DETOAST_DATUM_PACKED(datum));
 	if (emsg)
 		elog(ERROR, "failed on hash calculation of device numeric: %s", emsg);
-	return __pgstrom_hll_siphash_value(&num.weight,
-									   offsetof(xpu_numeric_t, value)
-									   + sizeof(int128_t)
-									   - offsetof(xpu_numeric_t, weight));
+	return pg_hll_hash_numeric(&num);
 }
 
 static uint64
 __pgstrom_hll_hash_date(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(DateADT));
+	return pg_hll_siphash_value(&datum, sizeof(DateADT));
 }
 
 static uint64
 __pgstrom_hll_hash_time(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(TimeADT));
+	return pg_hll_siphash_value(&datum, sizeof(TimeADT));
 }
 
 static uint64
 __pgstrom_hll_hash_timetz(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(DatumGetPointer(datum), sizeof(TimeTzADT));
+	TimeTzADT  *tz = DatumGetTimeTzADTP(datum);
+	TimeTzADT	temp;
+
+	/* padding bytes must be cleared, as the device code doing */
+	memset(&temp, 0, sizeof(TimeTzADT));
+	temp.time = tz->time;
+	temp.zone = tz->zone;
+	return pg_hll_siphash_value(&temp, sizeof(TimeTzADT));
 }
 
 static uint64
 __pgstrom_hll_hash_timestamp(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(Timestamp));
+	return pg_hll_siphash_value(&datum, sizeof(Timestamp));
 }
 
 static uint64
 __pgstrom_hll_hash_timestamptz(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(&datum, sizeof(TimestampTz));
+	return pg_hll_siphash_value(&datum, sizeof(TimestampTz));
 }
 
 static uint64
@@ -957,7 +1192,7 @@ __pgstrom_hll_hash_bpchar(Datum datum)
 	BpChar	   *val = DatumGetBpCharPP(datum);
 	int			len = bpchartruelen(VARDATA_ANY(val),
 									VARSIZE_ANY_EXHDR(val));
-	return __pgstrom_hll_siphash_value(VARDATA_ANY(val), len);
+	return pg_hll_siphash_value(VARDATA_ANY(val), len);
 }
 
 static uint64
@@ -965,13 +1200,13 @@ __pgstrom_hll_hash_varlena(Datum datum)
 {
 	struct varlena *val = PG_DETOAST_DATUM(datum);
 
-	return __pgstrom_hll_siphash_value(VARDATA_ANY(val), VARSIZE_ANY_EXHDR(val));
+	return pg_hll_siphash_value(VARDATA_ANY(val), VARSIZE_ANY_EXHDR(val));
 }
 
 static uint64
 __pgstrom_hll_hash_uuid(Datum datum)
 {
-	return __pgstrom_hll_siphash_value(DatumGetUUIDP(datum), sizeof(pg_uuid_t));
+	return pg_hll_siphash_value(DatumGetUUIDP(datum), sizeof(pg_uuid_t));
 }
 
 static bytea *
@@ -981,15 +1216,18 @@ __pgstrom_hll_sketch_update_common(PG_FUNCTION_ARGS, uint64 hash)
 	bytea		   *hll_state;
 	uint8		   *hll_regs;
 	uint64			nrooms;
+	int				nbits;
 	uint32			index;
 	uint32			count;
 
 	if (!AggCheckCallContext(fcinfo, &aggcxt))
 		elog(ERROR, "aggregate function called in non-aggregate context");
-	nrooms = (1UL << pgstrom_hll_register_bits);
 	if (PG_ARGISNULL(0))
 	{
-		size_t	sz = VARHDRSZ + sizeof(uint8) * nrooms;
+		size_t	sz;
+
+		nrooms = (1UL << pgstrom_hll_register_bits);
+		sz = VARHDRSZ + sizeof(uint8) * nrooms;
 		hll_state = MemoryContextAllocZero(aggcxt, sz);
 		SET_VARSIZE(hll_state, sz);
 	}
@@ -997,11 +1235,14 @@ __pgstrom_hll_sketch_update_common(PG_FUNCTION_ARGS, uint64 hash)
 	{
 		hll_state = PG_GETARG_BYTEA_P(0);
 	}
-	Assert(VARSIZE(hll_state) == VARHDRSZ + sizeof(uint8) * nrooms);
+	/* the number of registers is determined by the state, not GUC */
+	nrooms = VARSIZE(hll_state) - VARHDRSZ;
+	if (nrooms < 1 || (nrooms & (nrooms - 1)) != 0)
+		elog(ERROR, "HLL sketch must have 2^N rooms (%lu)", nrooms);
+	for (nbits=0; (1UL << nbits) < nrooms; nbits++);
 	hll_regs = (uint8 *)VARDATA(hll_state);
 
-	index = hash & (nrooms - 1);
-	count = __builtin_ctzll(hash >> pgstrom_hll_register_bits) + 1;
+	count = pg_hll_register_position(hash, nbits, &index);
 	if (hll_regs[index] < count)
 		hll_regs[index] = count;
 	return hll_state;
@@ -1052,24 +1293,30 @@ PGSTROM_HLL_HANDLER_TEMPLATE(uuid)
 
 /*
  * pgstrom_hll_sketch_new
+ *
+ * The number of register bits is given by the planner, as the device
+ * code doing, so the sketch is compatible even if GUC is changed.
  */
 Datum
 pgstrom_hll_sketch_new(PG_FUNCTION_ARGS)
 {
-	uint64		nrooms = (1UL << pgstrom_hll_register_bits);
 	uint64		hll_hash = DatumGetUInt64(PG_GETARG_DATUM(0));
+	int32		nbits = PG_GETARG_INT32(1);
+	uint64		nrooms;
 	bytea	   *hll_state;
 	uint8	   *hll_regs;
 	uint32		count;
 	uint32		index;
 
+	if (nbits < 4 || nbits > 15)
+		elog(ERROR, "HLL register bits out of range (%d)", nbits);
+	nrooms = (1UL << nbits);
 	hll_state = palloc0(VARHDRSZ + sizeof(uint8) * nrooms);
 	SET_VARSIZE(hll_state, VARHDRSZ + sizeof(uint8) * nrooms);
 	hll_regs = (uint8 *)VARDATA(hll_state);
 
-	index = hll_hash & (nrooms - 1);
+	count = pg_hll_register_position(hll_hash, nbits, &index);
 	Assert(index < nrooms);
-	count = __builtin_ctzll(hll_hash >> pgstrom_hll_register_bits) + 1;
 	if (hll_regs[index] < count)
 		hll_regs[index] = count;
 
@@ -1137,6 +1384,7 @@ pgstrom_hll_count_final(PG_FUNCTION_ARGS)
 	uint8	   *hll_regs;
 	uint32		nrooms;
 	uint32		index;
+	uint32		nzeros = 0;
 	double		divider = 0.0;
 	double		weight;
 	double		estimate;
@@ -1162,7 +1410,11 @@ pgstrom_hll_count_final(PG_FUNCTION_ARGS)
 	hll_regs = (uint8 *)VARDATA(hll_state);
 
 	for (index = 0; index < nrooms; index++)
+	{
 		divider += 1.0 / (double)(1UL << hll_regs[index]);
+		if (hll_regs[index] == 0)
+			nzeros++;
+	}
 	if (nrooms <= 16)
 		weight = 0.673;
 	else if (nrooms <= 32)
@@ -1173,6 +1425,9 @@ pgstrom_hll_count_final(PG_FUNCTION_ARGS)
 		weight = 0.7213 / (1.0 + 1.079 / (double)nrooms);
 
 	estimate = (weight * (double)nrooms * (double)nrooms) / divider;
+	/* small range correction by linear counting */
+	if (estimate <= 2.5 * (double)nrooms && nzeros > 0)
+		estimate = (double)nrooms * log((double)nrooms / (double)nzeros);
 	PG_RETURN_INT64((int64)estimate);
 }
 
@@ -1220,4 +1475,264 @@ pgstrom_hll_sketch_histogram(PG_FUNCTION_ARGS)
 							 'i');
 	PG_RETURN_POINTER(result);
 }
-#endif
+
+/*
+ * Quantile sketch for PERCENTILE_CONT(X) and PERCENTILE_DISC(X)
+ */
+static int
+__qsketch_bits_by_state(kagg_state__quantile_packed *state)
+{
+	for (int qsketch_bits=1; qsketch_bits <= 16; qsketch_bits++)
+	{
+		if (VARSIZE_ANY(state) == KAGG_QUANTILE_STATE_LENGTH(qsketch_bits))
+			return qsketch_bits;
+	}
+	elog(ERROR, "quantile sketch looks corrupted");
+}
+
+/*
+ * __qsketch_bucket_value - it returns the representative value of the
+ * bucket; harmonic mean of the lower and upper bound minimizes the
+ * relative error in the bucket.
+ */
+static float8
+__qsketch_bucket_value(uint32 index, int qsketch_bits)
+{
+	uint32		nrooms = ((QSKETCH_EXPONENT_MAX -
+						   QSKETCH_EXPONENT_MIN) << qsketch_bits);
+	uint32		mask = ((1U << qsketch_bits) - 1);
+	int			expo;
+	float8		lower, upper;
+	bool		negative;
+
+	if (index == nrooms)
+		return 0.0;
+	negative = (index < nrooms);
+	index = (negative ? nrooms - 1 - index : index - nrooms - 1);
+	expo = (int)(index >> qsketch_bits) + QSKETCH_EXPONENT_MIN;
+	lower = ldexp(1.0 + (float8)(index & mask) / (float8)(mask + 1), expo);
+	upper = ldexp(1.0 + (float8)((index & mask) + 1) / (float8)(mask + 1), expo);
+	lower = 2.0 * lower * upper / (lower + upper);
+
+	return (negative ? -lower : lower);
+}
+
+/*
+ * __qsketch_value_at - it returns the estimated value at the position
+ * (0-origin) in the sorted input; the smallest and the largest ones are
+ * exact because the sketch tracks min/max values.
+ */
+static float8
+__qsketch_value_at(kagg_state__quantile_packed *state,
+				   int qsketch_bits, uint64 pos)
+{
+	uint32		nbuckets = pg_qsketch_nbuckets(qsketch_bits);
+	uint64		count = 0;
+	float8		fval;
+
+	if (pos == 0)
+		return state->min_value;
+	if (pos + 1 >= state->nitems)
+		return state->max_value;
+	for (uint32 index=0; index < nbuckets; index++)
+	{
+		count += state->counters[index];
+		if (pos < count)
+		{
+			fval = __qsketch_bucket_value(index, qsketch_bits);
+			return Max(state->min_value, Min(fval, state->max_value));
+		}
+	}
+	return state->max_value;
+}
+
+static float8
+__qsketch_percentile_cont(kagg_state__quantile_packed *state,
+						  int qsketch_bits, float8 percentile)
+{
+	float8		pos = percentile * (float8)(state->nitems - 1);
+	uint64		first_row;
+	uint64		second_row;
+	float8		first_val;
+	float8		second_val;
+
+	if (percentile < 0.0 || percentile > 1.0 || isnan(percentile))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("percentile value %g is not between 0 and 1",
+						percentile)));
+	first_row = (uint64)floor(pos);
+	second_row = (uint64)ceil(pos);
+	first_val = __qsketch_value_at(state, qsketch_bits, first_row);
+	if (first_row == second_row)
+		return first_val;
+	second_val = __qsketch_value_at(state, qsketch_bits, second_row);
+	return first_val + (pos - (float8)first_row) * (second_val - first_val);
+}
+
+static float8
+__qsketch_percentile_disc(kagg_state__quantile_packed *state,
+						  int qsketch_bits, float8 percentile)
+{
+	uint64		rownum;
+
+	if (percentile < 0.0 || percentile > 1.0 || isnan(percentile))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("percentile value %g is not between 0 and 1",
+						percentile)));
+	rownum = (uint64)ceil(percentile * (float8)state->nitems);
+	if (rownum > 0)
+		rownum--;
+	return __qsketch_value_at(state, qsketch_bits, rownum);
+}
+
+/*
+ * pgstrom_partial_quantile
+ *
+ * The number of sketch bits is given by the planner, as the device
+ * code doing, so the sketch is compatible even if GUC is changed.
+ */
+Datum
+pgstrom_partial_quantile(PG_FUNCTION_ARGS)
+{
+	float8		fval = PG_GETARG_FLOAT8(0);
+	int32		qsketch_bits = PG_GETARG_INT32(1);
+	size_t		sz;
+	kagg_state__quantile_packed *r;
+
+	if (qsketch_bits < 1 || qsketch_bits > 6)
+		elog(ERROR, "quantile sketch bits out of range (%d)", qsketch_bits);
+	sz = KAGG_QUANTILE_STATE_LENGTH(qsketch_bits);
+	r = palloc0(sz);
+	r->nitems = 1;
+	r->min_value = fval;
+	r->max_value = fval;
+	r->counters[pg_qsketch_bucket_index(fval, qsketch_bits)] = 1;
+	SET_VARSIZE(r, sz);
+
+	PG_RETURN_POINTER(r);
+}
+
+Datum
+pgstrom_quantile_merge(PG_FUNCTION_ARGS)
+{
+	kagg_state__quantile_packed *state;
+	kagg_state__quantile_packed *arg;
+	MemoryContext	aggcxt;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(0))
+	{
+		if (PG_ARGISNULL(1))
+			PG_RETURN_NULL();
+		arg = (kagg_state__quantile_packed *)PG_GETARG_BYTEA_P(1);
+		(void)__qsketch_bits_by_state(arg);
+		state = MemoryContextAlloc(aggcxt, VARSIZE(arg));
+		memcpy(state, arg, VARSIZE(arg));
+	}
+	else
+	{
+		state = (kagg_state__quantile_packed *)PG_GETARG_BYTEA_P(0);
+		if (!PG_ARGISNULL(1))
+		{
+			uint32	nbuckets;
+
+			arg = (kagg_state__quantile_packed *)PG_GETARG_BYTEA_P(1);
+			if (VARSIZE(state) != VARSIZE(arg))
+				elog(ERROR, "incompatible quantile sketch");
+			nbuckets = pg_qsketch_nbuckets(__qsketch_bits_by_state(state));
+			if (arg->nitems > 0)
+			{
+				state->nitems += arg->nitems;
+				state->min_value = Min(state->min_value, arg->min_value);
+				state->max_value = Max(state->max_value, arg->max_value);
+				for (uint32 index=0; index < nbuckets; index++)
+					state->counters[index] += arg->counters[index];
+			}
+		}
+	}
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+pgstrom_quantile_cont(PG_FUNCTION_ARGS)
+{
+	kagg_state__quantile_packed *state
+		= (kagg_state__quantile_packed *)PG_GETARG_BYTEA_P(0);
+	float8		percentile = PG_GETARG_FLOAT8(1);
+	int			qsketch_bits = __qsketch_bits_by_state(state);
+
+	if (state->nitems == 0)
+		PG_RETURN_NULL();
+	PG_RETURN_FLOAT8(__qsketch_percentile_cont(state, qsketch_bits, percentile));
+}
+
+Datum
+pgstrom_quantile_disc(PG_FUNCTION_ARGS)
+{
+	kagg_state__quantile_packed *state
+		= (kagg_state__quantile_packed *)PG_GETARG_BYTEA_P(0);
+	float8		percentile = PG_GETARG_FLOAT8(1);
+	int			qsketch_bits = __qsketch_bits_by_state(state);
+
+	if (state->nitems == 0)
+		PG_RETURN_NULL();
+	PG_RETURN_FLOAT8(__qsketch_percentile_disc(state, qsketch_bits, percentile));
+}
+
+static Datum
+__pgstrom_quantile_multi(FunctionCallInfo fcinfo, bool is_cont)
+{
+	kagg_state__quantile_packed *state
+		= (kagg_state__quantile_packed *)PG_GETARG_BYTEA_P(0);
+	ArrayType  *percentiles = PG_GETARG_ARRAYTYPE_P(1);
+	int			qsketch_bits = __qsketch_bits_by_state(state);
+	Datum	   *values;
+	bool	   *isnull;
+	int			nitems;
+
+	if (state->nitems == 0)
+		PG_RETURN_NULL();
+	deconstruct_array(percentiles,
+					  FLOAT8OID,
+					  sizeof(float8),
+					  FLOAT8PASSBYVAL,
+					  TYPALIGN_DOUBLE,
+					  &values, &isnull, &nitems);
+	for (int i=0; i < nitems; i++)
+	{
+		float8		percentile;
+
+		if (isnull[i])
+			continue;
+		percentile = DatumGetFloat8(values[i]);
+		if (is_cont)
+			percentile = __qsketch_percentile_cont(state, qsketch_bits, percentile);
+		else
+			percentile = __qsketch_percentile_disc(state, qsketch_bits, percentile);
+		values[i] = Float8GetDatum(percentile);
+	}
+	PG_RETURN_POINTER(construct_md_array(values,
+										 isnull,
+										 ARR_NDIM(percentiles),
+										 ARR_DIMS(percentiles),
+										 ARR_LBOUND(percentiles),
+										 FLOAT8OID,
+										 sizeof(float8),
+										 FLOAT8PASSBYVAL,
+										 TYPALIGN_DOUBLE));
+}
+
+Datum
+pgstrom_quantile_cont_multi(PG_FUNCTION_ARGS)
+{
+	return __pgstrom_quantile_multi(fcinfo, true);
+}
+
+Datum
+pgstrom_quantile_disc_multi(PG_FUNCTION_ARGS)
+{
+	return __pgstrom_quantile_multi(fcinfo, false);
+}
@@ -96,6 +96,8 @@ struct ArrowFdwState
 	pg_atomic_uint32	__rbatch_nload_local;	/* if single process */
 	pg_atomic_uint32   *rbatch_nskip;
 	pg_atomic_uint32	__rbatch_nskip_local;	/* if single process */
+	pg_atomic_uint32   *rbatch_nhits;
+	pg_atomic_uint32	__rbatch_nhits_local;	/* if single process */
 	StringInfoData		chunk_buffer;	/* buffer to load record-batch */
 	File				curr_filp;		/* current arrow file to read */
 	kern_data_store	   *curr_kds;		/* current chunk to read */
@@ -176,6 +178,8 @@ typedef struct
 	dlist_head	free_mcaches;	/* list of arrowMetadataCache */
 	dlist_head	free_fcaches;	/* list of arrowMetadataFieldCache */
 	dlist_head	hash_slots[ARROW_METADATA_HASH_NSLOTS];
+	/* bytes written to the result cache since the last reclaim */
+	pg_atomic_uint64 rcache_written;
 } arrowMetadataCacheHead;
 
 /*
@@ -188,6 +192,8 @@ static arrowMetadataCacheHead *arrow_metadata_cache = NULL;
 static bool					arrow_fdw_enabled;	/* GUC */
 static bool					arrow_fdw_stats_hint_enabled;	/* GUC */
 static int					arrow_metadata_cache_size_kb;	/* GUC */
+static char				   *arrow_result_cache_dir;	/* GUC */
+static int					arrow_result_cache_size_kb;	/* GUC */
 
 PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_handler);
 PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_validator);
@@ -3458,6 +3464,7 @@ __arrowFdwExecInit(ScanState *ss,
 	arrow_state->rbatch_index = &arrow_state->__rbatch_index_local;
 	arrow_state->rbatch_nload = &arrow_state->__rbatch_nload_local;
 	arrow_state->rbatch_nskip = &arrow_state->__rbatch_nskip_local;
+	arrow_state->rbatch_nhits = &arrow_state->__rbatch_nhits_local;
 	initStringInfo(&arrow_state->chunk_buffer);
 	arrow_state->curr_filp  = -1;
 	arrow_state->curr_kds   = NULL;
@@ -3537,7 +3544,7 @@ ArrowBeginForeignScan(ForeignScanState *node, int eflags)
  * ExecArrowScanChunk
  */
 static inline RecordBatchState *
-__arrowFdwNextRecordBatch(ArrowFdwState *arrow_state)
+__arrowFdwNextRecordBatch(ArrowFdwState *arrow_state, uint32_t *p_rb_index)
 {
 	RecordBatchState *rb_state;
 	uint32_t	rb_index;
@@ -3556,9 +3563,238 @@ retry:
 		}
 		pg_atomic_fetch_add_u32(arrow_state->rbatch_nload, 1);
 	}
+	if (p_rb_index)
+		*p_rb_index = rb_index;
 	return rb_state;
 }
 
+/*
+ * Result cache for xPU scan over arrow files
+ *
+ * Arrow files are usually immutable, so the result of a GpuScan/DpuScan
+ * on a particular record-batch is determined by the file identity, the
+ * record-batch index and the xpucode with parameters of the session.
+ * If arrow_fdw.result_cache_dir is configured, the per-chunk results are
+ * kept on the directory, then we answer the same chunk without xPU.
+ * The total size of the cache files is limited by arrow_fdw.result_cache_size;
+ * the least recently used ones (by mtime, updated on cache hit) are evicted.
+ */
+static bool
+__arrowResultCacheEnabled(pgstromTaskState *pts)
+{
+	return (arrow_result_cache_dir != NULL &&
+			*arrow_result_cache_dir != '\0' &&
+			pts->conn != NULL &&
+			(pts->xpu_task_flags & DEVTASK__MASK) == DEVTASK__SCAN &&
+			pts->pp_info->topn_nrows == 0);	/* results are not per chunk */
+}
+
+static char *
+__arrowResultCacheFilename(pgstromTaskState *pts, RecordBatchState *rb_state)
+{
+	struct stat	   *stat_buf = &rb_state->af_state->stat_buf;
+
+	return psprintf("%s/arrow_%lx_%lx_%lx_%lx.%09lx_%d_%016lx.xrc",
+					arrow_result_cache_dir,
+					(uint64_t)stat_buf->st_dev,
+					(uint64_t)stat_buf->st_ino,
+					(uint64_t)stat_buf->st_size,
+					(uint64_t)stat_buf->st_mtim.tv_sec,
+					(uint64_t)stat_buf->st_mtim.tv_nsec,
+					rb_state->rb_index,
+					pts->session_hash);
+}
+
+static XpuCommand *
+__arrowResultCacheLookup(pgstromTaskState *pts, RecordBatchState *rb_state)
+{
+	char	   *fname = __arrowResultCacheFilename(pts, rb_state);
+	XpuCommand *resp = NULL;
+	struct stat	stat_buf;
+	int			fdesc;
+
+	fdesc = OpenTransientFile(fname, O_RDONLY | PG_BINARY);
+	if (fdesc < 0)
+		goto bailout;
+	if (fstat(fdesc, &stat_buf) != 0 ||
+		stat_buf.st_size < offsetof(XpuCommand, u.results.stats))
+		goto bailout;
+	resp = malloc(stat_buf.st_size);
+	if (!resp)
+		goto bailout;
+	if (__readFile(fdesc, resp, stat_buf.st_size) != stat_buf.st_size ||
+		resp->magic != XpuCommandMagicNumber ||
+		resp->tag != XpuCommandTag__Success ||
+		resp->length != stat_buf.st_size ||
+		resp->u.results.chunks_offset > resp->length)
+	{
+		elog(DEBUG1, "arrow_fdw: result cache '%s' is corrupted", fname);
+		free(resp);
+		resp = NULL;
+		goto bailout;
+	}
+	/* never store the cached result again */
+	resp->u.results.chunk_id = 0;
+	/* update mtime for LRU eviction; never mind if failed */
+	(void) futimens(fdesc, NULL);
+bailout:
+	if (fdesc >= 0)
+		CloseTransientFile(fdesc);
+	pfree(fname);
+	return resp;
+}
+
+/*
+ * __arrowResultCacheReclaim
+ *
+ * It scans the cache directory, then removes the least recently used files
+ * until the total size fits arrow_fdw.result_cache_size.
+ */
+typedef struct
+{
+	char	   *fname;
+	size_t		fsize;
+	struct timespec mtime;
+} arrowResultCacheFile;
+
+static int
+__arrowResultCacheFileComp(const void *__a, const void *__b)
+{
+	const arrowResultCacheFile *a = __a;
+	const arrowResultCacheFile *b = __b;
+
+	if (a->mtime.tv_sec != b->mtime.tv_sec)
+		return (a->mtime.tv_sec < b->mtime.tv_sec ? -1 : 1);
+	if (a->mtime.tv_nsec != b->mtime.tv_nsec)
+		return (a->mtime.tv_nsec < b->mtime.tv_nsec ? -1 : 1);
+	return 0;
+}
+
+static void
+__arrowResultCacheReclaim(void)
+{
+	const char *dir_path = arrow_result_cache_dir;
+	size_t		limit = (size_t)arrow_result_cache_size_kb << 10;
+	size_t		total = 0;
+	arrowResultCacheFile *files;
+	int			nrooms = 1000;
+	int			nitems = 0;
+	int			i;
+	DIR		   *dir;
+	struct dirent *dentry;
+
+	files = palloc(sizeof(arrowResultCacheFile) * nrooms);
+	dir = AllocateDir(dir_path);
+	while ((dentry = ReadDir(dir, dir_path)) != NULL)
+	{
+		struct stat	stat_buf;
+		char	   *fname;
+		size_t		len = strlen(dentry->d_name);
+
+		/* temporary files being written are not candidates */
+		if (len < 4 || strcmp(dentry->d_name + len - 4, ".xrc") != 0)
+			continue;
+		fname = psprintf("%s/%s", dir_path, dentry->d_name);
+		if (stat(fname, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode))
+		{
+			pfree(fname);
+			continue;
+		}
+		if (nitems >= nrooms)
+		{
+			nrooms *= 2;
+			files = repalloc(files, sizeof(arrowResultCacheFile) * nrooms);
+		}
+		files[nitems].fname = fname;
+		files[nitems].fsize = stat_buf.st_size;
+		files[nitems].mtime = stat_buf.st_mtim;
+		nitems++;
+		total += stat_buf.st_size;
+	}
+	FreeDir(dir);
+
+	if (total > limit)
+	{
+		qsort(files, nitems, sizeof(arrowResultCacheFile),
+			  __arrowResultCacheFileComp);
+		for (i=0; i < nitems && total > limit; i++)
+		{
+			if (unlink(files[i].fname) != 0)
+			{
+				/* someone else may already remove it */
+				if (errno != ENOENT)
+					elog(DEBUG1, "arrow_fdw: failed on unlink('%s'): %m",
+						 files[i].fname);
+				continue;
+			}
+			total -= files[i].fsize;
+		}
+	}
+	for (i=0; i < nitems; i++)
+		pfree(files[i].fname);
+	pfree(files);
+}
+
+/*
+ * pgstromArrowFdwResultCacheStore
+ */
+void
+pgstromArrowFdwResultCacheStore(pgstromTaskState *pts, XpuCommand *resp)
+{
+	ArrowFdwState  *arrow_state = pts->arrow_state;
+	RecordBatchState *rb_state;
+	uint32_t		rb_index = resp->u.results.chunk_id - 1;
+	char		   *fname;
+	char		   *tname;
+	int				fdesc;
+	uint64			written;
+
+	if (!__arrowResultCacheEnabled(pts) ||
+		resp->u.results.chunk_id == 0 ||
+		rb_index >= arrow_state->rb_nitems)
+		return;
+	rb_state = arrow_state->rb_states[rb_index];
+	fname = __arrowResultCacheFilename(pts, rb_state);
+	tname = psprintf("%s.%u.tmp", fname, MyProcPid);
+
+	/* write to the temporary file, then rename it atomically */
+	fdesc = OpenTransientFile(tname, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fdesc < 0)
+	{
+		elog(DEBUG1, "arrow_fdw: failed on open('%s'): %m", tname);
+		goto bailout;
+	}
+	if (__writeFile(fdesc, resp, resp->length) != resp->length)
+	{
+		elog(DEBUG1, "arrow_fdw: failed on write('%s'): %m", tname);
+		CloseTransientFile(fdesc);
+		unlink(tname);
+		goto bailout;
+	}
+	CloseTransientFile(fdesc);
+	if (rename(tname, fname) != 0)
+	{
+		elog(DEBUG1, "arrow_fdw: failed on rename('%s','%s'): %m", tname, fname);
+		unlink(tname);
+		goto bailout;
+	}
+
+	/*
+	 * Directory scan is not cheap, so we reclaim the cache once every 1/16
+	 * of arrow_fdw.result_cache_size is written. Only one backend that
+	 * resets the counter runs the reclaim.
+	 */
+	written = pg_atomic_add_fetch_u64(&arrow_metadata_cache->rcache_written,
+									  resp->length);
+	if (written >= ((uint64)arrow_result_cache_size_kb << 10) / 16 &&
+		pg_atomic_compare_exchange_u64(&arrow_metadata_cache->rcache_written,
+									   &written, 0))
+		__arrowResultCacheReclaim();
+bailout:
+	pfree(tname);
+	pfree(fname);
+}
+
 /*
  * pgstromScanChunkArrowFdw
  */
@@ -3575,8 +3811,9 @@ pgstromScanChunkArrowFdw(pgstromTaskState *pts,
 	uint32_t		kds_src_offset;
 	uint32_t		kds_src_iovec;
 	uint32_t		kds_src_pathname;
+	uint32_t		rb_index;
 
-	rb_state = __arrowFdwNextRecordBatch(arrow_state);
+	rb_state = __arrowFdwNextRecordBatch(arrow_state, &rb_index);
 	if (!rb_state)
 	{
 		pts->scan_done = true;
@@ -3584,6 +3821,19 @@ pgstromScanChunkArrowFdw(pgstromTaskState *pts,
 	}
 	af_state = rb_state->af_state;
 
+	/* answer the record-batch from the result cache, if any */
+	if (__arrowResultCacheEnabled(pts))
+	{
+		XpuCommand *resp = __arrowResultCacheLookup(pts, rb_state);
+
+		if (resp)
+		{
+			pg_atomic_fetch_add_u32(arrow_state->rbatch_nhits, 1);
+			xpuClientPushResponse(pts->conn, resp);
+			return NULL;
+		}
+	}
+
 	/* XpuCommand header */
 	resetStringInfo(chunk_buffer);
 	appendBinaryStringInfo(chunk_buffer,
@@ -3613,6 +3863,7 @@ pgstromScanChunkArrowFdw(pgstromTaskState *pts,
 	xcmd->u.task.kds_src_pathname = kds_src_pathname;
 	xcmd->u.task.kds_src_iovec    = kds_src_iovec;
 	xcmd->u.task.kds_src_offset   = kds_src_offset;
+	xcmd->u.task.chunk_id         = rb_index + 1;
 
 	xcmd_iov->iov_base = xcmd;
 	xcmd_iov->iov_len  = xcmd->length;
@@ -3638,7 +3889,7 @@ ArrowIterateForeignScan(ForeignScanState *node)
 
 		arrow_state->curr_index = 0;
 		arrow_state->curr_kds = NULL;
-		rb_state = __arrowFdwNextRecordBatch(arrow_state);
+		rb_state = __arrowFdwNextRecordBatch(arrow_state, NULL);
 		if (!rb_state)
 			return NULL;
 		arrow_state->curr_kds
@@ -3723,6 +3974,7 @@ pgstromArrowFdwInitDSM(ArrowFdwState *arrow_state,
 	arrow_state->rbatch_index = &ps_state->arrow_rbatch_index;
 	arrow_state->rbatch_nload = &ps_state->arrow_rbatch_nload;
 	arrow_state->rbatch_nskip = &ps_state->arrow_rbatch_nskip;
+	arrow_state->rbatch_nhits = &ps_state->arrow_rbatch_nhits;
 }
 
 static void
@@ -3746,6 +3998,7 @@ pgstromArrowFdwAttachDSM(ArrowFdwState *arrow_state,
 	arrow_state->rbatch_index = &ps_state->arrow_rbatch_index;
 	arrow_state->rbatch_nload = &ps_state->arrow_rbatch_nload;
 	arrow_state->rbatch_nskip = &ps_state->arrow_rbatch_nskip;
+	arrow_state->rbatch_nhits = &ps_state->arrow_rbatch_nhits;
 }
 
 static void
@@ -3778,6 +4031,9 @@ pgstromArrowFdwShutdown(ArrowFdwState *arrow_state)
 	pg_atomic_write_u32(&arrow_state->__rbatch_nskip_local, temp);
 	arrow_state->rbatch_nskip = &arrow_state->__rbatch_nskip_local;
 
+	temp = pg_atomic_read_u32(arrow_state->rbatch_nhits);
+	pg_atomic_write_u32(&arrow_state->__rbatch_nhits_local, temp);
+	arrow_state->rbatch_nhits = &arrow_state->__rbatch_nhits_local;
 }
 
 static void
@@ -3846,6 +4102,14 @@ pgstromArrowFdwExplain(ArrowFdwState *arrow_state,
 							 pg_atomic_read_u32(arrow_state->rbatch_nskip));
 		ExplainPropertyText("Stats-Hint", buf.data, es);
 	}
+	/* shows result cache hits if any */
+	if (es->analyze)
+	{
+		uint32		nhits = pg_atomic_read_u32(arrow_state->rbatch_nhits);
+
+		if (nhits > 0)
+			ExplainPropertyInteger("Result-Cache Hits", NULL, nhits, es);
+	}
 
 	/* shows files on behalf of the foreign table */
 	chunk_sz = alloca(sizeof(size_t) * tupdesc->natts);
@@ -4558,6 +4822,7 @@ pgstrom_startup_arrow_fdw(void)
 	dlist_init(&arrow_metadata_cache->free_fcaches);
 	for (i=0; i < ARROW_METADATA_HASH_NSLOTS; i++)
 		dlist_init(&arrow_metadata_cache->hash_slots[i]);
+	pg_atomic_init_u64(&arrow_metadata_cache->rcache_written, 0);
 
 	/* slab allocator */
 	sz = TYPEALIGN(ARROW_METADATA_BLOCKSZ,
@@ -4643,6 +4908,27 @@ pgstrom_init_arrow_fdw(void)
 							PGC_POSTMASTER,
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
+	/*
+	 * Directory of the result cache for xPU scan
+	 */
+	DefineCustomStringVariable("arrow_fdw.result_cache_dir",
+							   "Directory to cache the results of xPU scan on arrow files",
+							   NULL,
+							   &arrow_result_cache_dir,
+							   NULL,
+							   PGC_SUSET,
+							   GUC_NOT_IN_SAMPLE,
+							   NULL, NULL, NULL);
+	DefineCustomIntVariable("arrow_fdw.result_cache_size",
+							"Total size limit of the result cache for xPU scan",
+							NULL,
+							&arrow_result_cache_size_kb,
+							1024 * 1024,	/* 1GB */
+							1024,			/* 1MB */
+							INT_MAX,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	/* shared memory size */
 	shmem_request_next = shmem_request_hook;
 	shmem_request_hook = pgstrom_request_arrow_fdw;
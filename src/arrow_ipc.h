@@ -184,6 +184,7 @@ struct SQLtable
 	int			__iov_len;		/* for internal use of pwritev support */
 	int			__iov_cnt;
 	struct iovec *__iov;
+	uint32_t	buffer_align;	/* alignment of buffers (0 = ARROWALIGN) */
 
 	ArrowBlock *recordBatches;	/* recordBatches written in the past */
 	int			numRecordBatches;
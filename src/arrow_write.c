@@ -988,10 +988,25 @@ sql_buffer_write(SQLtable *table, SQLbuffer *buf)
 	arrowFileWrite(table, buf->data, length);
 }
 
+/*
+ * sql_table_buffer_align - alignment of the buffers in record batch
+ *
+ * Buffers are usually aligned to 64bytes boundary (ARROWALIGN), however,
+ * the caller may require larger alignment (e.g, PAGE_SIZE for direct-io)
+ * by table->buffer_align.
+ */
+static inline size_t
+sql_table_buffer_align(SQLtable *table, size_t len)
+{
+	if (table->buffer_align > 0)
+		return TYPEALIGN(table->buffer_align, len);
+	return ARROWALIGN(len);
+}
+
 static inline size_t
 sql_buffer_append_iov(SQLtable *table, SQLbuffer *buf)
 {
-	size_t	length = ARROWALIGN(buf->usage);
+	size_t	length = sql_table_buffer_align(table, buf->usage);
 	size_t	gap = length - buf->usage;
 
 	if (gap > 0)
@@ -1026,6 +1041,8 @@ setupFlatBufferMessageIOV(SQLtable *table, ArrowMessage *message)
 	gap = offset - payload->vtable.vlen;
 	length = LONGALIGN(offsetof(FBMessageFileImage,
 								data[gap + payload->length]));
+	if (table->buffer_align > 0)
+		length = TYPEALIGN(table->buffer_align, length);
 	image = palloc0(length);
 	image->continuation = 0xffffffff;
 	image->metaLength = length - offsetof(FBMessageFileImage, rootOffset);
@@ -1391,17 +1408,19 @@ setupArrowFieldNode(ArrowFieldNode *fnode, SQLfield *column)
  * setupArrowBuffer
  */
 static inline size_t
-__setup_arrow_buffer(ArrowBuffer *bnode, size_t offset, size_t length)
+__setup_arrow_buffer(SQLtable *table, ArrowBuffer *bnode,
+					 size_t offset, size_t length)
 {
 	initArrowNode(bnode, Buffer);
 	bnode->offset = offset;
 	bnode->length = ARROWALIGN(length);
 
-	return bnode->length;
+	return sql_table_buffer_align(table, length);
 }
 
 static int
-setupArrowBuffer(ArrowBuffer *bnode, SQLfield *column, size_t *p_offset)
+setupArrowBuffer(SQLtable *table, ArrowBuffer *bnode,
+				 SQLfield *column, size_t *p_offset)
 {
 	size_t		offset = *p_offset;
 	int			j, retval = -1;
@@ -1412,12 +1431,12 @@ setupArrowBuffer(ArrowBuffer *bnode, SQLfield *column, size_t *p_offset)
 		assert(column->arrow_type.node.tag == ArrowNodeTag__Utf8);
 		/* nullmap */
 		if (column->nullcount == 0)
-			offset += __setup_arrow_buffer(bnode, offset, 0);
+			offset += __setup_arrow_buffer(table, bnode, offset, 0);
 		else
-			offset += __setup_arrow_buffer(bnode, offset,
+			offset += __setup_arrow_buffer(table, bnode, offset,
 										   column->nullmap.usage);
 		/* dictionary indexes (int32) */
-		offset += __setup_arrow_buffer(bnode+1, offset,
+		offset += __setup_arrow_buffer(table, bnode+1, offset,
 									   column->values.usage);
 		retval = 2;
 	}
@@ -1429,14 +1448,14 @@ setupArrowBuffer(ArrowBuffer *bnode, SQLfield *column, size_t *p_offset)
 			   column->arrow_type.node.tag == ArrowNodeTag__LargeList);
 		/* nullmap */
 		if (column->nullcount == 0)
-			offset += __setup_arrow_buffer(bnode, offset, 0);
+			offset += __setup_arrow_buffer(table, bnode, offset, 0);
 		else
-			offset += __setup_arrow_buffer(bnode, offset,
+			offset += __setup_arrow_buffer(table, bnode, offset,
 										   column->nullmap.usage);
 		/* array index values */
-		offset += __setup_arrow_buffer(bnode+1, offset,
+		offset += __setup_arrow_buffer(table, bnode+1, offset,
 									   column->values.usage);
-		retval += setupArrowBuffer(bnode+2, column->element, &offset);
+		retval += setupArrowBuffer(table, bnode+2, column->element, &offset);
 	}
 	else if (column->subfields)
 	{
@@ -1445,13 +1464,13 @@ setupArrowBuffer(ArrowBuffer *bnode, SQLfield *column, size_t *p_offset)
 		assert(column->arrow_type.node.tag == ArrowNodeTag__Struct);
 		/* nullmap */
 		if (column->nullcount == 0)
-			offset += __setup_arrow_buffer(bnode, offset, 0);
+			offset += __setup_arrow_buffer(table, bnode, offset, 0);
 		else
-			offset += __setup_arrow_buffer(bnode, offset,
+			offset += __setup_arrow_buffer(table, bnode, offset,
 										   column->nullmap.usage);
 		/* for each sub-fields */
 		for (j=0; j < column->nfields; j++)
-			retval += setupArrowBuffer(bnode + retval,
+			retval += setupArrowBuffer(table, bnode + retval,
 									   &column->subfields[j],
 									   &offset);
 	}
@@ -1472,12 +1491,12 @@ setupArrowBuffer(ArrowBuffer *bnode, SQLfield *column, size_t *p_offset)
 				retval = 2;
 				/* nullmap */
 				if (column->nullcount == 0)
-					offset += __setup_arrow_buffer(bnode, offset, 0);
+					offset += __setup_arrow_buffer(table, bnode, offset, 0);
 				else
-					offset += __setup_arrow_buffer(bnode, offset,
+					offset += __setup_arrow_buffer(table, bnode, offset,
 												   column->nullmap.usage);
 				/* inline values */
-				offset += __setup_arrow_buffer(bnode+1, offset,
+				offset += __setup_arrow_buffer(table, bnode+1, offset,
 											   column->values.usage);
 				break;
 
@@ -1489,15 +1508,15 @@ setupArrowBuffer(ArrowBuffer *bnode, SQLfield *column, size_t *p_offset)
 				retval = 3;
 				/* nullmap */
 				if (column->nullcount == 0)
-					offset += __setup_arrow_buffer(bnode, offset, 0);
+					offset += __setup_arrow_buffer(table, bnode, offset, 0);
 				else
-					offset += __setup_arrow_buffer(bnode, offset,
+					offset += __setup_arrow_buffer(table, bnode, offset,
 												   column->nullmap.usage);
 				/* index values */
-				offset += __setup_arrow_buffer(bnode+1, offset,
+				offset += __setup_arrow_buffer(table, bnode+1, offset,
 											   column->values.usage);
 				/* extra values */
-				offset += __setup_arrow_buffer(bnode+2, offset,
+				offset += __setup_arrow_buffer(table, bnode+2, offset,
 											   column->extra.usage);
 				break;
 
@@ -1611,7 +1630,7 @@ setupArrowRecordBatchIOV(SQLtable *table)
 	buffers = alloca(sizeof(ArrowBuffer) * table->numBuffers);
 	for (i=0, j=0; i < table->nfields; i++)
 	{
-		j += setupArrowBuffer(&buffers[j], &table->columns[i],
+		j += setupArrowBuffer(table, &buffers[j], &table->columns[i],
 							  &bodyLength);
 	}
 	assert(j == table->numBuffers);
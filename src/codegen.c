@@ -3070,6 +3070,27 @@ codegen_build_groupby_keycomp(codegen_context *context,
 	pp_info->kexp_groupby_keycomp = (bytea *)xpucode;
 }
 
+/*
+ * __codegen_sketch_bits
+ *
+ * The number of sketch bits is fixed at the planner, and given to the
+ * partial function as the last constant argument, so the host code
+ * builds the compatible sketch with the device.
+ */
+static int
+__codegen_sketch_bits(FuncExpr *func)
+{
+	Const	   *con = llast(func->args);
+
+	if (list_length(func->args) < 2 ||
+		!IsA(con, Const) ||
+		con->consttype != INT4OID ||
+		con->constisnull)
+		elog(ERROR, "Bug? sketch bits must be an int4 constant: %s",
+			 nodeToString(func));
+	return DatumGetInt32(con->constvalue);
+}
+
 /*
  * __codegen_build_groupby_actions
  */
@@ -3133,6 +3154,10 @@ __codegen_build_groupby_actions(codegen_context *context,
 			{
 				Expr   *fn_arg = lfirst(lc2);
 
+				/* number of the sketch bits is not a kvars-slot */
+				if ((action == KAGG_ACTION__HLL ||
+					 action == KAGG_ACTION__QUANTILE) && count > 0)
+					break;
 				slot_id = __try_inject_projection_expression(context,
 															 &buf,
 															 fn_arg,
@@ -3150,6 +3175,20 @@ __codegen_build_groupby_actions(codegen_context *context,
 					elog(ERROR, "Bug? too much partial function arguments");
 				count++;
 			}
+			if (action == KAGG_ACTION__HLL)
+				desc->arg_option = __codegen_sketch_bits(func);
+			else if (action == KAGG_ACTION__QUANTILE)
+				desc->arg_option = __codegen_sketch_bits(func);
+			else if (action == KAGG_ACTION__PMIN_BYTES ||
+					 action == KAGG_ACTION__PMAX_BYTES)
+				desc->arg_option = pgstrom_minmax_bytes_capacity(linitial(func->args));
+			else if (action == KAGG_ACTION__PAVG_NUM)
+			{
+				/* initial scale; it grows per group if unknown */
+				int		scale = pgstrom_numeric_expr_scale(linitial(func->args));
+
+				desc->arg_option = (scale >= 0 && scale <= PG_MAX_DIGITS ? scale : 0);
+			}
 		}
 	}
 	Assert(index == nattrs);
@@ -3545,6 +3584,10 @@ __xpucode_aggfuncs_cstring(StringInfo buf,
 				appendStringInfo(buf, "pavg::fp[%d]",
 								 desc->arg0_slot_id);
 				break;
+			case KAGG_ACTION__PAVG_NUM:
+				appendStringInfo(buf, "pavg::num[%d]",
+								 desc->arg0_slot_id);
+				break;
 			case KAGG_ACTION__STDDEV:
 				appendStringInfo(buf, "stddev[%d]",
 								 desc->arg0_slot_id);
@@ -3554,6 +3597,30 @@ __xpucode_aggfuncs_cstring(StringInfo buf,
 								 desc->arg0_slot_id,
 								 desc->arg1_slot_id);
 				break;
+			case KAGG_ACTION__HLL:
+				appendStringInfo(buf, "hll[%d]",
+								 desc->arg0_slot_id);
+				break;
+			case KAGG_ACTION__QUANTILE:
+				appendStringInfo(buf, "quantile[%d]",
+								 desc->arg0_slot_id);
+				break;
+			case KAGG_ACTION__PMIN_BYTES:
+				appendStringInfo(buf, "pmin::bytes[%d]",
+								 desc->arg0_slot_id);
+				break;
+			case KAGG_ACTION__PMAX_BYTES:
+				appendStringInfo(buf, "pmax::bytes[%d]",
+								 desc->arg0_slot_id);
+				break;
+			case KAGG_ACTION__PBITAND:
+				appendStringInfo(buf, "pbitand[%d]",
+								 desc->arg0_slot_id);
+				break;
+			case KAGG_ACTION__PBITOR:
+				appendStringInfo(buf, "pbitor[%d]",
+								 desc->arg0_slot_id);
+				break;
 			default:
 				appendStringInfo(buf, "unknown[%d,%d]",
 								 desc->arg0_slot_id,
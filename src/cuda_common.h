@@ -162,9 +162,11 @@ typedef struct
 /*
  * definitions related to generic device executor routines
  */
+struct kern_gputask;
 EXTERN_FUNCTION(int)
 execGpuScanLoadSource(kern_context *kcxt,
 					  kern_warp_context *wp,
+					  struct kern_gputask *kgtask,
 					  kern_data_store *kds_src,
 					  kern_data_extra *kds_extra,
 					  kern_expression *kexp_load_vars,
@@ -189,7 +191,9 @@ execGpuPreAggGroupBy(kern_context *kcxt,
 /*
  * Definitions related to GpuScan/GpuJoin/GpuPreAgg
  */
-typedef struct {
+#define KERN_GPUTASK_RECHECK_MAXBLOCKS	((65534U << 10) / BLCKSZ)	/* see PGSTROM_CHUNK_SIZE */
+
+typedef struct kern_gputask {
 	kern_errorbuf	kerror;
 	uint32_t		grid_sz;
 	uint32_t		block_sz;
@@ -207,6 +211,9 @@ typedef struct {
 	uint32_t		nitems_raw;		/* nitems in the raw data chunk */
 	uint32_t		nitems_in;		/* nitems after the scan_quals */
 	uint32_t		nitems_out;		/* nitems of final results */
+	/* blocks to be rechecked by CPU, due to unknown MVCC visibility */
+	uint32_t		recheck_nblocks;
+	BlockNumber		recheck_blocks[KERN_GPUTASK_RECHECK_MAXBLOCKS];
 	struct {
 		uint32_t	nitems_gist;	/* nitems picked up by GiST index */
 		uint32_t	nitems_out;		/* nitems after this depth */
@@ -446,6 +453,26 @@ __atomic_or_uint32(uint32_t *ptr, uint32_t mask)
 #endif
 }
 
+INLINE_FUNCTION(uint64_t)
+__atomic_and_uint64(uint64_t *ptr, uint64_t mask)
+{
+#ifdef __CUDACC__
+	return atomicAnd((unsigned long long *)ptr, (unsigned long long)mask);
+#else
+	return __atomic_fetch_and(ptr, mask, __ATOMIC_SEQ_CST);
+#endif
+}
+
+INLINE_FUNCTION(uint64_t)
+__atomic_or_uint64(uint64_t *ptr, uint64_t mask)
+{
+#ifdef __CUDACC__
+	return atomicOr((unsigned long long *)ptr, (unsigned long long)mask);
+#else
+	return __atomic_fetch_or(ptr, mask, __ATOMIC_SEQ_CST);
+#endif
+}
+
 INLINE_FUNCTION(uint32_t)
 __atomic_max_uint32(uint32_t *ptr, uint32_t ival)
 {
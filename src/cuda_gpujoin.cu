@@ -774,6 +774,7 @@ kern_gpujoin_main(kern_session_info *session,
 		{
 			/* LOAD FROM THE SOURCE */
 			depth = execGpuScanLoadSource(kcxt, wp,
+										  kgtask,
 										  kds_src,
 										  kds_extra,
 										  SESSION_KEXP_SCAN_LOAD_VARS(session),
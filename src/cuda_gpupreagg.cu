@@ -208,6 +208,34 @@ __writeOutOneTuplePreAgg(kern_context *kcxt,
 				t_infomask |= HEAP_HASVARWIDTH;
 				break;
 
+			case KAGG_ACTION__PMIN_BYTES:
+			case KAGG_ACTION__PMAX_BYTES:
+				nbytes = KAGG_PMINMAX_BYTES_STATE_LENGTH(desc->arg_option);
+				if (buffer)
+				{
+					kagg_state__pminmax_bytes_packed *r =
+						(kagg_state__pminmax_bytes_packed *)buffer;
+					memset(r, 0, offsetof(kagg_state__pminmax_bytes_packed, value));
+					r->prefix = (desc->action == KAGG_ACTION__PMIN_BYTES ? ULONG_MAX : 0);
+					SET_VARSIZE(r, nbytes);
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
+			case KAGG_ACTION__PBITAND:
+			case KAGG_ACTION__PBITOR:
+				nbytes = sizeof(kagg_state__pminmax_int64_packed);
+				if (buffer)
+				{
+					kagg_state__pminmax_int64_packed *r =
+						(kagg_state__pminmax_int64_packed *)buffer;
+					r->nitems = 0;
+					r->value = (desc->action == KAGG_ACTION__PBITAND ? ~0L : 0L);
+					SET_VARSIZE(r, sizeof(kagg_state__pminmax_int64_packed));
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
 			case KAGG_ACTION__PAVG_INT:
 				nbytes = sizeof(kagg_state__pavg_int_packed);
 				if (buffer)
@@ -228,6 +256,20 @@ __writeOutOneTuplePreAgg(kern_context *kcxt,
 				t_infomask |= HEAP_HASVARWIDTH;
 				break;
 
+			case KAGG_ACTION__PAVG_NUM:
+				nbytes = sizeof(kagg_state__pavg_num_packed);
+				if (buffer)
+				{
+					kagg_state__pavg_num_packed *r =
+						(kagg_state__pavg_num_packed *)buffer;
+					memset(r, 0, sizeof(kagg_state__pavg_num_packed));
+					r->scale = desc->arg_option;
+					r->dscale = desc->arg_option;
+					SET_VARSIZE(r, sizeof(kagg_state__pavg_num_packed));
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
 			case KAGG_ACTION__STDDEV:
 				nbytes = sizeof(kagg_state__stddev_packed);
 				if (buffer)
@@ -248,6 +290,30 @@ __writeOutOneTuplePreAgg(kern_context *kcxt,
 				t_infomask |= HEAP_HASVARWIDTH;
 				break;
 
+			case KAGG_ACTION__HLL:
+				nbytes = VARHDRSZ + (1U << desc->arg_option);
+				if (buffer)
+				{
+					memset(buffer, 0, nbytes);
+					SET_VARSIZE(buffer, nbytes);
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
+			case KAGG_ACTION__QUANTILE:
+				nbytes = KAGG_QUANTILE_STATE_LENGTH(desc->arg_option);
+				if (buffer)
+				{
+					kagg_state__quantile_packed *r =
+						(kagg_state__quantile_packed *)buffer;
+					memset(r, 0, nbytes);
+					r->min_value = DBL_MAX;
+					r->max_value = -DBL_MAX;
+					SET_VARSIZE(r, nbytes);
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
 			default:
 				STROM_ELOG(kcxt, "unknown xpuPreAgg action");
 				return -1;
@@ -779,6 +845,167 @@ __update_nogroups__pavg_fp(kern_context *kcxt,
 		}
 	}
 }
+/*
+ * __fetch_pavg_num_kvar
+ *
+ * It fetches the numeric argument and its display scale, and updates the
+ * NaN/Inf flags of the state. It returns true only if the argument is
+ * a finite number.
+ */
+INLINE_FUNCTION(bool)
+__fetch_pavg_num_kvar(kern_context *kcxt,
+					  kagg_state__pavg_num_packed *r,
+					  int slot_id,
+					  xpu_numeric_t *num,
+					  int *p_dscale)
+{
+	int			vclass = kcxt->kvars_class[slot_id];
+	const kern_variable *kvar = &kcxt->kvars_slot[slot_id];
+
+	if (vclass == KVAR_CLASS__XPU_DATUM)
+	{
+		memcpy(num, kvar->ptr, sizeof(xpu_numeric_t));
+		*p_dscale = Max(num->weight, 0);
+	}
+	else if (vclass == KVAR_CLASS__VARLENA)
+	{
+		const varlena *addr = (const varlena *)kvar->ptr;
+		const char *errmsg = __xpu_numeric_from_varlena(num, addr);
+
+		if (errmsg)
+		{
+			STROM_ELOG(kcxt, errmsg);
+			return false;
+		}
+		*p_dscale = __xpu_numeric_dscale_from_varlena(addr);
+	}
+	else
+	{
+		assert(vclass == KVAR_CLASS__NULL);
+		return false;
+	}
+	switch (num->kind)
+	{
+		case XPU_NUMERIC_KIND__VALID:
+			return true;
+		case XPU_NUMERIC_KIND__NAN:
+			__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__NAN);
+			break;
+		case XPU_NUMERIC_KIND__POS_INF:
+			__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__POS_INF);
+			break;
+		case XPU_NUMERIC_KIND__NEG_INF:
+			__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__NEG_INF);
+			break;
+		default:
+			STROM_ELOG(kcxt, "unknown numeric kind");
+			break;
+	}
+	return false;
+}
+
+/*
+ * __update_pavg_num_state
+ *
+ * It adds the 192bit integer scaled by 10^scale to the state under the
+ * spinlock; the critical section is inside of the branch, for the diverged
+ * lanes.
+ */
+INLINE_FUNCTION(void)
+__update_pavg_num_state(kagg_state__pavg_num_packed *r,
+						const uint64_t *ival, int scale, int dscale)
+{
+	bool		done = false;
+
+	do {
+		if (__atomic_cas_uint32(&r->lock, 0, 1) == 0)
+		{
+			__threadfence();
+			if (!__kagg_pavg_num_update(r, ival, scale, dscale))
+				__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__OVERFLOW);
+			__threadfence();
+			__atomic_write_uint32(&r->lock, 0);
+			done = true;
+		}
+	} while (!done);
+}
+
+/*
+ * __update_nogroups__pavg_num
+ *
+ * Values are scaled to the largest scale in the warp, then reduced in the
+ * warp-level as 192bit integers; it never overflows for 32 values of 128bit.
+ * Only lane-0 updates the state, except for the values that cannot be
+ * scaled as 128bit integer.
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__pavg_num(kern_context *kcxt,
+							char *buffer,
+							kern_colmeta *cmeta,
+							kern_aggregate_desc *desc,
+							bool kvars_is_valid)
+{
+	kagg_state__pavg_num_packed *r =
+		(kagg_state__pavg_num_packed *)buffer;
+	xpu_numeric_t num;
+	bool		is_finite = false;
+	int			scale = INT_MIN;
+	int			dscale = 0;
+	int			temp;
+	int128_t	ival = 0;
+	uint64_t	sum[3];
+	uint32_t	mask;
+
+	if (kvars_is_valid)
+	{
+		int		slot_id = desc->arg0_slot_id;
+
+		if (kcxt->kvars_class[slot_id] == KVAR_CLASS__NULL)
+			kvars_is_valid = false;
+		else
+			is_finite = __fetch_pavg_num_kvar(kcxt, r, slot_id, &num, &dscale);
+	}
+	mask = __ballot_sync(__activemask(), kvars_is_valid);
+	if (mask == 0)
+		return;
+	/* largest scale and display scale in the warp */
+	if (is_finite)
+		scale = Max(num.weight, 0);
+	for (int k=0x0001; k < 0x0020; k <<= 1)
+	{
+		temp = __shfl_xor_sync(__activemask(), scale, k);
+		scale = Max(scale, temp);
+		temp = __shfl_xor_sync(__activemask(), dscale, k);
+		dscale = Max(dscale, temp);
+	}
+	if (is_finite && !__xpu_numeric_to_scaled_int128(&ival, &num, scale))
+	{
+		uint64_t	val[3];
+
+		/* the value itself is updated individually */
+		__kagg_int192_from_int128(val, num.value);
+		__update_pavg_num_state(r, val, num.weight, dscale);
+		ival = 0;
+	}
+	/* warp-level reduction */
+	__kagg_int192_from_int128(sum, ival);
+	for (int k=0x0001; k < 0x0020; k <<= 1)
+	{
+		uint64_t	peer[3];
+
+		peer[0] = __shfl_xor_sync(__activemask(), sum[0], k);
+		peer[1] = __shfl_xor_sync(__activemask(), sum[1], k);
+		peer[2] = __shfl_xor_sync(__activemask(), sum[2], k);
+		__kagg_int192_add(sum, peer);
+	}
+	if (LaneId() == 0)
+	{
+		__atomic_add_uint32(&r->nitems, __popc(mask));
+		if (scale != INT_MIN)
+			__update_pavg_num_state(r, sum, scale, dscale);
+	}
+}
+
 /*
  * __update_nogroups__pstddev
  */
@@ -919,6 +1146,299 @@ __update_nogroups__pcovar(kern_context *kcxt,
 	}
 }
 
+/*
+ * __update_hll_register
+ *
+ * It updates one HLL register (8bits) by CAS operation on the 32bit word
+ * that contains the register.
+ */
+INLINE_FUNCTION(void)
+__update_hll_register(char *buffer, int hll_regbits, uint64_t hash)
+{
+	uint8_t	   *hll_regs = (uint8_t *)VARDATA(buffer);
+	uint32_t	index;
+	uint32_t	count;
+	uintptr_t	addr;
+	uint32_t   *wptr;
+	uint32_t	shift;
+	uint32_t	curval, newval, oldval;
+
+	count = pg_hll_register_position(hash, hll_regbits, &index);
+	addr  = (uintptr_t)(hll_regs + index);
+	wptr  = (uint32_t *)(addr & ~(sizeof(uint32_t) - 1));
+	shift = (addr & (sizeof(uint32_t) - 1)) * 8;
+	curval = __volatileRead(wptr);
+	while (((curval >> shift) & 0xffU) < count)
+	{
+		newval = ((curval & ~(0xffU << shift)) | (count << shift));
+		oldval = __atomic_cas_uint32(wptr, curval, newval);
+		if (oldval == curval)
+			break;
+		curval = oldval;
+	}
+}
+
+/*
+ * __update_nogroups__hll
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__hll(kern_context *kcxt,
+					   char *buffer,
+					   kern_colmeta *cmeta,
+					   kern_aggregate_desc *desc,
+					   bool kvars_is_valid)
+{
+	/*
+	 * HLL registers are scattered, so warp-level reduction makes no sense.
+	 * Each thread updates the register by itself.
+	 */
+	if (kvars_is_valid &&
+		kcxt->kvars_class[desc->arg0_slot_id] == KVAR_CLASS__INLINE)
+	{
+		uint64_t	hash = kcxt->kvars_slot[desc->arg0_slot_id].u64;
+
+		__update_hll_register(buffer, desc->arg_option, hash);
+	}
+}
+
+/*
+ * __update_nogroups__quantile
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__quantile(kern_context *kcxt,
+							char *buffer,
+							kern_colmeta *cmeta,
+							kern_aggregate_desc *desc,
+							bool kvars_is_valid)
+{
+	kagg_state__quantile_packed *r =
+		(kagg_state__quantile_packed *)buffer;
+	float8_t	fval = 0.0;
+	float8_t	min_val = DBL_MAX;
+	float8_t	max_val = -DBL_MAX;
+	float8_t	temp;
+	uint32_t	mask;
+
+	if (kvars_is_valid)
+	{
+		int		slot_id = desc->arg0_slot_id;
+		int		vclass = kcxt->kvars_class[slot_id];
+
+		if (vclass == KVAR_CLASS__INLINE)
+		{
+			fval = kcxt->kvars_slot[slot_id].fp64;
+			min_val = max_val = fval;
+		}
+		else
+		{
+			assert(vclass == KVAR_CLASS__NULL);
+			kvars_is_valid = false;
+		}
+	}
+	/*
+	 * Buckets are scattered, so each thread updates the counter by itself.
+	 * Only nitems and min/max values are reduced in the warp-level.
+	 */
+	if (kvars_is_valid)
+	{
+		uint32_t	index = pg_qsketch_bucket_index(fval, desc->arg_option);
+
+		__atomic_add_uint32(&r->counters[index], 1);
+	}
+	mask = __ballot_sync(__activemask(), kvars_is_valid);
+	if (mask != 0)
+	{
+		temp = __shfl_xor_sync(__activemask(), min_val, 0x0001);
+		min_val = Min(min_val, temp);
+		temp = __shfl_xor_sync(__activemask(), min_val, 0x0002);
+		min_val = Min(min_val, temp);
+		temp = __shfl_xor_sync(__activemask(), min_val, 0x0004);
+		min_val = Min(min_val, temp);
+		temp = __shfl_xor_sync(__activemask(), min_val, 0x0008);
+		min_val = Min(min_val, temp);
+		temp = __shfl_xor_sync(__activemask(), min_val, 0x0010);
+		min_val = Min(min_val, temp);
+
+		temp = __shfl_xor_sync(__activemask(), max_val, 0x0001);
+		max_val = Max(max_val, temp);
+		temp = __shfl_xor_sync(__activemask(), max_val, 0x0002);
+		max_val = Max(max_val, temp);
+		temp = __shfl_xor_sync(__activemask(), max_val, 0x0004);
+		max_val = Max(max_val, temp);
+		temp = __shfl_xor_sync(__activemask(), max_val, 0x0008);
+		max_val = Max(max_val, temp);
+		temp = __shfl_xor_sync(__activemask(), max_val, 0x0010);
+		max_val = Max(max_val, temp);
+
+		if (LaneId() == 0)
+		{
+			__atomic_add_uint32(&r->nitems, __popc(mask));
+			__atomic_min_fp64(&r->min_value, min_val);
+			__atomic_max_fp64(&r->max_value, max_val);
+		}
+	}
+}
+
+/*
+ * __update_pminmax_bytes
+ *
+ * min/max of variable-length values cannot be reduced by the warp-level
+ * shuffle, so each thread updates the state under the spinlock, unless
+ * the prefix tells the candidate never wins.
+ */
+INLINE_FUNCTION(void)
+__update_pminmax_bytes(kern_context *kcxt,
+					   char *buffer,
+					   kern_aggregate_desc *desc,
+					   bool is_min)
+{
+	kagg_state__pminmax_bytes_packed *r =
+		(kagg_state__pminmax_bytes_packed *)buffer;
+	const char *addr;
+	uint32_t	len;
+	uint64_t	prefix;
+	uint64_t	curr;
+	bool		done = false;
+
+	if (!__kagg_fetch_bytes_kvar(kcxt, desc->arg0_slot_id, &addr, &len))
+		return;
+	__atomic_add_uint32(&r->nitems, 1);
+	prefix = __kagg_bytes_prefix(addr, len);
+	curr = __volatileRead(&r->prefix);
+	if (is_min ? prefix > curr : prefix < curr)
+		return;
+	/* critical section is inside of the branch, for the diverged lanes */
+	do {
+		if (__atomic_cas_uint32(&r->lock, 0, 1) == 0)
+		{
+			__threadfence();
+			__kagg_pminmax_bytes_update(r, desc->arg_option,
+										addr, len, false, is_min);
+			__threadfence();
+			__atomic_write_uint32(&r->lock, 0);
+			done = true;
+		}
+	} while (!done);
+}
+
+/*
+ * __update_nogroups__pmin_bytes
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__pmin_bytes(kern_context *kcxt,
+							  char *buffer,
+							  kern_colmeta *cmeta,
+							  kern_aggregate_desc *desc,
+							  bool kvars_is_valid)
+{
+	if (kvars_is_valid)
+		__update_pminmax_bytes(kcxt, buffer, desc, true);
+}
+
+/*
+ * __update_nogroups__pmax_bytes
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__pmax_bytes(kern_context *kcxt,
+							  char *buffer,
+							  kern_colmeta *cmeta,
+							  kern_aggregate_desc *desc,
+							  bool kvars_is_valid)
+{
+	if (kvars_is_valid)
+		__update_pminmax_bytes(kcxt, buffer, desc, false);
+}
+
+/*
+ * __update_nogroups__pbitand
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__pbitand(kern_context *kcxt,
+						   char *buffer,
+						   kern_colmeta *cmeta,
+						   kern_aggregate_desc *desc,
+						   bool kvars_is_valid)
+{
+	int64_t		ival = ~0L;
+	uint32_t	mask;
+
+	if (kvars_is_valid)
+	{
+		int		slot_id = desc->arg0_slot_id;
+		int		vclass = kcxt->kvars_class[slot_id];
+
+		if (vclass == KVAR_CLASS__INLINE)
+			ival = kcxt->kvars_slot[slot_id].i64;
+		else
+		{
+			assert(vclass == KVAR_CLASS__NULL);
+			kvars_is_valid = false;
+		}
+	}
+	mask = __ballot_sync(__activemask(), kvars_is_valid);
+	if (mask != 0)
+	{
+		kagg_state__pminmax_int64_packed *r =
+			(kagg_state__pminmax_int64_packed *)buffer;
+
+		ival &= __shfl_xor_sync(__activemask(), ival, 0x0001);
+		ival &= __shfl_xor_sync(__activemask(), ival, 0x0002);
+		ival &= __shfl_xor_sync(__activemask(), ival, 0x0004);
+		ival &= __shfl_xor_sync(__activemask(), ival, 0x0008);
+		ival &= __shfl_xor_sync(__activemask(), ival, 0x0010);
+		if (LaneId() == 0)
+		{
+			__atomic_add_uint32(&r->nitems, __popc(mask));
+			__atomic_and_uint64((uint64_t *)&r->value, (uint64_t)ival);
+		}
+	}
+}
+
+/*
+ * __update_nogroups__pbitor
+ */
+INLINE_FUNCTION(void)
+__update_nogroups__pbitor(kern_context *kcxt,
+						  char *buffer,
+						  kern_colmeta *cmeta,
+						  kern_aggregate_desc *desc,
+						  bool kvars_is_valid)
+{
+	int64_t		ival = 0;
+	uint32_t	mask;
+
+	if (kvars_is_valid)
+	{
+		int		slot_id = desc->arg0_slot_id;
+		int		vclass = kcxt->kvars_class[slot_id];
+
+		if (vclass == KVAR_CLASS__INLINE)
+			ival = kcxt->kvars_slot[slot_id].i64;
+		else
+		{
+			assert(vclass == KVAR_CLASS__NULL);
+			kvars_is_valid = false;
+		}
+	}
+	mask = __ballot_sync(__activemask(), kvars_is_valid);
+	if (mask != 0)
+	{
+		kagg_state__pminmax_int64_packed *r =
+			(kagg_state__pminmax_int64_packed *)buffer;
+
+		ival |= __shfl_xor_sync(__activemask(), ival, 0x0001);
+		ival |= __shfl_xor_sync(__activemask(), ival, 0x0002);
+		ival |= __shfl_xor_sync(__activemask(), ival, 0x0004);
+		ival |= __shfl_xor_sync(__activemask(), ival, 0x0008);
+		ival |= __shfl_xor_sync(__activemask(), ival, 0x0010);
+		if (LaneId() == 0)
+		{
+			__atomic_add_uint32(&r->nitems, __popc(mask));
+			__atomic_or_uint64((uint64_t *)&r->value, (uint64_t)ival);
+		}
+	}
+}
+
 /*
  * __updateOneTupleNoGroups
  */
@@ -1023,6 +1543,11 @@ __updateOneTupleNoGroups(kern_context *kcxt,
 										   cmeta, desc,
 										   kvars_is_valid);
 				break;
+			case KAGG_ACTION__PAVG_NUM:
+				__update_nogroups__pavg_num(kcxt, buffer,
+											cmeta, desc,
+											kvars_is_valid);
+				break;
 			case KAGG_ACTION__STDDEV:
 				__update_nogroups__pstddev(kcxt, buffer,
 										   cmeta, desc,
@@ -1033,6 +1558,36 @@ __updateOneTupleNoGroups(kern_context *kcxt,
 										  cmeta, desc,
 										  kvars_is_valid);
 				break;
+			case KAGG_ACTION__HLL:
+				__update_nogroups__hll(kcxt, buffer,
+									   cmeta, desc,
+									   kvars_is_valid);
+				break;
+			case KAGG_ACTION__QUANTILE:
+				__update_nogroups__quantile(kcxt, buffer,
+											cmeta, desc,
+											kvars_is_valid);
+				break;
+			case KAGG_ACTION__PMIN_BYTES:
+				__update_nogroups__pmin_bytes(kcxt, buffer,
+											  cmeta, desc,
+											  kvars_is_valid);
+				break;
+			case KAGG_ACTION__PMAX_BYTES:
+				__update_nogroups__pmax_bytes(kcxt, buffer,
+											  cmeta, desc,
+											  kvars_is_valid);
+				break;
+			case KAGG_ACTION__PBITAND:
+				__update_nogroups__pbitand(kcxt, buffer,
+										   cmeta, desc,
+										   kvars_is_valid);
+				break;
+			case KAGG_ACTION__PBITOR:
+				__update_nogroups__pbitor(kcxt, buffer,
+										  cmeta, desc,
+										  kvars_is_valid);
+				break;
 			default:
 				/*
 				 * No more partial aggregation exists after grouping-keys
@@ -1063,7 +1618,6 @@ __insertOneTupleNoGroups(kern_context *kcxt,
 									 kexp_groupby_actions);
 	assert(tupsz > 0);
 	required = MAXALIGN(offsetof(kern_tupitem, htup) + tupsz);
-	assert(required < 1000);
 	total_sz = (KDS_HEAD_LENGTH(kds_final) +
 				MAXALIGN(sizeof(uint32_t)) +
 				required + __kds_unpack(kds_final->usage));
@@ -1497,6 +2051,103 @@ __update_groupby__pavg_fp(kern_context *kcxt,
 	}
 }
 
+/*
+ * __update_groupby__pavg_num
+ *
+ * The lanes that update the same group are reduced in the warp-level first,
+ * as __update_nogroups__pavg_num doing, then only the leader lane of the
+ * peers takes the spinlock of the group. So, a low-cardinality GROUP BY
+ * does not serialize the whole warp on a few locks.
+ */
+INLINE_FUNCTION(void)
+__update_groupby__pavg_num(kern_context *kcxt,
+						   char *buffer,
+						   kern_colmeta *cmeta,
+						   kern_aggregate_desc *desc)
+{
+	kagg_state__pavg_num_packed *r =
+		(kagg_state__pavg_num_packed *)buffer;
+	xpu_numeric_t num;
+	bool		is_valid;
+	bool		is_finite;
+	int			scale = INT_MIN;
+	int			dscale = 0;
+	int128_t	ival = 0;
+	uint64_t	own[3];
+	uint64_t	sum[3];
+	uint32_t	mask = __activemask();
+	uint32_t	peers;
+	uint32_t	valids;
+
+	is_valid = (kcxt->kvars_class[desc->arg0_slot_id] != KVAR_CLASS__NULL);
+	is_finite = __fetch_pavg_num_kvar(kcxt, r, desc->arg0_slot_id, &num, &dscale);
+	/* lanes that update the same group */
+	peers = __match_any_sync(mask, (uint64_t)buffer);
+	valids = __ballot_sync(mask, is_valid);
+	if (__all_sync(mask, __popc(peers) == 1))
+	{
+		/* no lanes share the group, so no need to reduce */
+		if (is_finite)
+		{
+			uint64_t	val[3];
+
+			__kagg_int192_from_int128(val, num.value);
+			__update_pavg_num_state(r, val, num.weight, dscale);
+		}
+		if (is_valid)
+			__atomic_add_uint32(&r->nitems, 1);
+		return;
+	}
+	/* largest scale and display scale in the peers */
+	if (is_finite)
+		scale = Max(num.weight, 0);
+	for (uint32_t m = mask; m != 0; m &= (m - 1))
+	{
+		int		k = __ffs(m) - 1;
+		int		peer_scale  = __shfl_sync(mask, scale, k);
+		int		peer_dscale = __shfl_sync(mask, dscale, k);
+
+		if ((peers & (1U << k)) != 0)
+		{
+			scale  = Max(scale, peer_scale);
+			dscale = Max(dscale, peer_dscale);
+		}
+	}
+	if (is_finite && !__xpu_numeric_to_scaled_int128(&ival, &num, scale))
+	{
+		uint64_t	val[3];
+
+		/* the value itself is updated individually */
+		__kagg_int192_from_int128(val, num.value);
+		__update_pavg_num_state(r, val, num.weight, dscale);
+		ival = 0;
+	}
+	/*
+	 * reduction in the peers; it never overflows for 32 values of 128bit,
+	 * and only the sum of the leader lane is used.
+	 */
+	__kagg_int192_from_int128(own, ival);
+	__kagg_int192_from_int128(sum, ival);
+	for (uint32_t m = mask; m != 0; m &= (m - 1))
+	{
+		int			k = __ffs(m) - 1;
+		uint64_t	peer[3];
+
+		peer[0] = __shfl_sync(mask, own[0], k);
+		peer[1] = __shfl_sync(mask, own[1], k);
+		peer[2] = __shfl_sync(mask, own[2], k);
+		if ((peers & (1U << k)) != 0 && k != LaneId())
+			__kagg_int192_add(sum, peer);
+	}
+	if (LaneId() == __ffs(peers) - 1)
+	{
+		if ((peers & valids) != 0)
+			__atomic_add_uint32(&r->nitems, __popc(peers & valids));
+		if (scale != INT_MIN)
+			__update_pavg_num_state(r, sum, scale, dscale);
+	}
+}
+
 INLINE_FUNCTION(void)
 __update_groupby__pstddev(kern_context *kcxt,
 						  char *buffer,
@@ -1549,6 +2200,116 @@ __update_groupby__pcovar(kern_context *kcxt,
 	}
 }
 
+INLINE_FUNCTION(void)
+__update_groupby__hll(kern_context *kcxt,
+					  char *buffer,
+					  kern_colmeta *cmeta,
+					  kern_aggregate_desc *desc)
+{
+	int		vclass = kcxt->kvars_class[desc->arg0_slot_id];
+
+	if (vclass == KVAR_CLASS__INLINE)
+	{
+		uint64_t	hash = kcxt->kvars_slot[desc->arg0_slot_id].u64;
+
+		__update_hll_register(buffer, desc->arg_option, hash);
+	}
+	else
+	{
+		assert(vclass == KVAR_CLASS__NULL);
+	}
+}
+
+INLINE_FUNCTION(void)
+__update_groupby__quantile(kern_context *kcxt,
+						   char *buffer,
+						   kern_colmeta *cmeta,
+						   kern_aggregate_desc *desc)
+{
+	int		vclass = kcxt->kvars_class[desc->arg0_slot_id];
+
+	if (vclass == KVAR_CLASS__INLINE)
+	{
+		kagg_state__quantile_packed *r =
+			(kagg_state__quantile_packed *)buffer;
+		float8_t	fval = kcxt->kvars_slot[desc->arg0_slot_id].fp64;
+		uint32_t	index = pg_qsketch_bucket_index(fval, desc->arg_option);
+
+		__atomic_add_uint32(&r->nitems, 1);
+		__atomic_add_uint32(&r->counters[index], 1);
+		__atomic_min_fp64(&r->min_value, fval);
+		__atomic_max_fp64(&r->max_value, fval);
+	}
+	else
+	{
+		assert(vclass == KVAR_CLASS__NULL);
+	}
+}
+
+INLINE_FUNCTION(void)
+__update_groupby__pmin_bytes(kern_context *kcxt,
+							 char *buffer,
+							 kern_colmeta *cmeta,
+							 kern_aggregate_desc *desc)
+{
+	__update_pminmax_bytes(kcxt, buffer, desc, true);
+}
+
+INLINE_FUNCTION(void)
+__update_groupby__pmax_bytes(kern_context *kcxt,
+							 char *buffer,
+							 kern_colmeta *cmeta,
+							 kern_aggregate_desc *desc)
+{
+	__update_pminmax_bytes(kcxt, buffer, desc, false);
+}
+
+INLINE_FUNCTION(void)
+__update_groupby__pbitand(kern_context *kcxt,
+						  char *buffer,
+						  kern_colmeta *cmeta,
+						  kern_aggregate_desc *desc)
+{
+	int		vclass = kcxt->kvars_class[desc->arg0_slot_id];
+
+	if (vclass == KVAR_CLASS__INLINE)
+	{
+		kagg_state__pminmax_int64_packed *r =
+			(kagg_state__pminmax_int64_packed *)buffer;
+		int64_t		ival = kcxt->kvars_slot[desc->arg0_slot_id].i64;
+
+		__atomic_add_uint32(&r->nitems, 1);
+		__atomic_and_uint64((uint64_t *)&r->value, (uint64_t)ival);
+	}
+	else
+	{
+		assert(vclass == KVAR_CLASS__NULL);
+	}
+}
+
+INLINE_FUNCTION(void)
+__update_groupby__pbitor(kern_context *kcxt,
+						 char *buffer,
+						 kern_colmeta *cmeta,
+						 kern_aggregate_desc *desc)
+{
+	int		vclass = kcxt->kvars_class[desc->arg0_slot_id];
+
+	if (vclass == KVAR_CLASS__INLINE)
+	{
+		kagg_state__pminmax_int64_packed *r =
+			(kagg_state__pminmax_int64_packed *)buffer;
+		int64_t		ival = kcxt->kvars_slot[desc->arg0_slot_id].i64;
+
+		__atomic_add_uint32(&r->nitems, 1);
+		__atomic_or_uint64((uint64_t *)&r->value, (uint64_t)ival);
+	}
+	else
+	{
+		assert(vclass == KVAR_CLASS__NULL);
+	}
+}
+
 /*
  * __updateOneTupleGroupBy
  */
@@ -1628,12 +2389,33 @@ __updateOneTupleGroupBy(kern_context *kcxt,
 			case KAGG_ACTION__PAVG_FP:
 				__update_groupby__pavg_fp(kcxt, buffer, cmeta, desc);
 				break;
+			case KAGG_ACTION__PAVG_NUM:
+				__update_groupby__pavg_num(kcxt, buffer, cmeta, desc);
+				break;
 			case KAGG_ACTION__STDDEV:
 				__update_groupby__pstddev(kcxt, buffer, cmeta, desc);
 				break;
 			case KAGG_ACTION__COVAR:
 				__update_groupby__pcovar(kcxt, buffer, cmeta, desc);
 				break;
+			case KAGG_ACTION__HLL:
+				__update_groupby__hll(kcxt, buffer, cmeta, desc);
+				break;
+			case KAGG_ACTION__QUANTILE:
+				__update_groupby__quantile(kcxt, buffer, cmeta, desc);
+				break;
+			case KAGG_ACTION__PMIN_BYTES:
+				__update_groupby__pmin_bytes(kcxt, buffer, cmeta, desc);
+				break;
+			case KAGG_ACTION__PMAX_BYTES:
+				__update_groupby__pmax_bytes(kcxt, buffer, cmeta, desc);
+				break;
+			case KAGG_ACTION__PBITAND:
+				__update_groupby__pbitand(kcxt, buffer, cmeta, desc);
+				break;
+			case KAGG_ACTION__PBITOR:
+				__update_groupby__pbitor(kcxt, buffer, cmeta, desc);
+				break;
 			default:
 				/*
 				 * No more partial aggregation exists after grouping-keys
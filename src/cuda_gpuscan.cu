@@ -94,12 +94,46 @@ __gpuscan_load_source_row(kern_context *kcxt,
 	return (WARP_WRITE_POS(wp,0) >= WARP_READ_POS(wp,0) + warpSize ? 1 : 0);
 }
 
+/*
+ * __gpuscan_check_page_visibility
+ *
+ * It checks whether MVCC visibility of all the tuples in the page can be
+ * determined on the device. Elsewhere, the page shall be rechecked by CPU.
+ * The pages loaded by the backend (block_index < block_nloaded) are already
+ * checked and invalidated on the CPU side, so we don't touch them again.
+ */
+STATIC_FUNCTION(bool)
+__gpuscan_check_page_visibility(kern_context *kcxt,
+								kern_data_store *kds_src,
+								uint32_t block_index)
+{
+	PageHeaderData *pg_page = KDS_BLOCK_PGPAGE(kds_src, block_index);
+	uint32_t	lp_nitems = PageGetMaxOffsetNumber(pg_page);
+	bool		unknown = false;
+
+	if (!SESSION_XACT_SNAPSHOT(kcxt->session) ||
+		block_index < kds_src->block_nloaded ||
+		(pg_page->pd_flags & PD_ALL_VISIBLE) != 0)
+		return true;
+	for (uint32_t i=LaneId(); i < lp_nitems; i += warpSize)
+	{
+		ItemIdData *lpp = &pg_page->pd_linp[i];
+
+		if (ItemIdIsNormal(lpp) &&
+			kern_heaptuple_visibility(kcxt->session,
+									  PageGetItem(pg_page, lpp)) == XPU_MVCC__UNKNOWN)
+			unknown = true;
+	}
+	return !__any_sync(__activemask(), unknown);
+}
+
 /*
  * __gpuscan_load_source_block
  */
 STATIC_FUNCTION(int)
 __gpuscan_load_source_block(kern_context *kcxt,
 							kern_warp_context *wp,
+							kern_gputask *kgtask,
 							kern_data_store *kds_src,
 							kern_expression *kexp_load_vars,
 							kern_expression *kexp_scan_quals,
@@ -200,7 +234,22 @@ __gpuscan_load_source_block(kern_context *kcxt,
 		BlockNumber		block_nr = KDS_BLOCK_BLCKNR(kds_src, block_id-1);
 
 		count = __shfl_sync(__activemask(), wp->lp_count, 0);
-		if (count < PageGetMaxOffsetNumber(pg_page))
+		if (count == 0 && !__gpuscan_check_page_visibility(kcxt, kds_src,
+															block_id-1))
+		{
+			/* this page shall be rechecked by CPU */
+			if (LaneId() == 0)
+			{
+				uint32_t	index = atomicAdd(&kgtask->recheck_nblocks, 1);
+
+				assert(index < KERN_GPUTASK_RECHECK_MAXBLOCKS);
+				kgtask->recheck_blocks[index] = block_nr;
+				wp->block_id = 0;
+				wp->lp_count = 0;
+			}
+			__syncwarp();
+		}
+		else if (count < PageGetMaxOffsetNumber(pg_page))
 		{
 			count += LaneId();
 			if (count < PageGetMaxOffsetNumber(pg_page))
@@ -208,7 +257,10 @@ __gpuscan_load_source_block(kern_context *kcxt,
 				ItemIdData *lpp = &pg_page->pd_linp[count];
 
 				assert((char *)lpp < (char *)pg_page + BLCKSZ);
-				if (ItemIdIsNormal(lpp))
+				if (ItemIdIsNormal(lpp) &&
+					((pg_page->pd_flags & PD_ALL_VISIBLE) != 0 ||
+					 kern_heaptuple_visibility(kcxt->session,
+											   PageGetItem(pg_page, lpp)) == XPU_MVCC__VISIBLE))
 				{
 					htup = (HeapTupleHeaderData *)PageGetItem(pg_page, lpp);
 					/* for ctid system column reference */
@@ -451,6 +503,7 @@ __gpuscan_load_source_column(kern_context *kcxt,
 PUBLIC_FUNCTION(int)
 execGpuScanLoadSource(kern_context *kcxt,
 					  kern_warp_context *wp,
+					  kern_gputask *kgtask,
 					  kern_data_store *kds_src,
 					  kern_data_extra *kds_extra,
 					  kern_expression *kexp_load_vars,
@@ -476,6 +529,7 @@ execGpuScanLoadSource(kern_context *kcxt,
 											 p_smx_row_count);
 		case KDS_FORMAT_BLOCK:
 			return __gpuscan_load_source_block(kcxt, wp,
+											   kgtask,
 											   kds_src,
 											   kexp_load_vars,
 											   kexp_scan_quals,
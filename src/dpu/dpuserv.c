@@ -21,10 +21,13 @@ typedef struct
 	kern_multirels	   *kmrels;		/* join inner buffer */
 	size_t				kmrels_sz;	/* join inner buffer mmap-sz */
 	struct groupby_final_buffer *gf_buf; /* group-by final buffer */
+	xpuTopNBuffer	   *topn_buf;	/* Top-N results buffer, if any */
+	pthread_mutex_t		topn_lock;	/* lock of topn_buf */
 	volatile bool		in_termination; /* true, if error status */
 	volatile int32_t	refcnt;	/* odd-number as long as socket is active */
 	pthread_mutex_t		mutex;	/* mutex to write the socket */
 	int					sockfd;	/* connection to PG-backend */
+	xpuWireCompressor	wcomp;	/* wire compression (under the mutex) */
 	pthread_t			worker;	/* receiver thread */
 	char				peer_addr[PEER_ADDR_LEN];
 } dpuClient;
@@ -35,6 +38,8 @@ static char			   *dpuserv_base_directory = NULL;
 static long				dpuserv_num_workers = -1;
 static char			   *dpuserv_identifier = NULL;
 static const char	   *dpuserv_logfile = NULL;
+static const char	   *dpuserv_spill_directory = NULL;
+static long				dpuserv_groupby_mem_limit = -1;	/* bytes */
 static bool				verbose = false;
 static pthread_mutex_t	dpu_client_mutex;
 static dlist_head		dpu_client_list;
@@ -63,6 +68,12 @@ struct dpuTaskExecState
 	uint32_t		nitems_in;		/* nitems after the scan_quals */
 	uint32_t		nitems_out;		/* nitems of final results */
 	uint32_t		num_rels;		/* >0, if JOIN */
+	uint32_t		chunk_id;		/* kern_exec_task.chunk_id */
+	BlockNumber	   *recheck_blocks;	/* blocks to be rechecked by CPU */
+	uint32_t		recheck_nblocks;
+	uint32_t		recheck_nrooms;
+	bool			cpu_fallback;	/* chunk shall be processed by CPU */
+	bool			topn_kept;		/* kds_dst is kept in the Top-N buffer */
 	struct {
 		uint32_t	nitems_gist;	/* nitems picked up by GiST index */
 		uint32_t	nitems_out;		/* nitems after this depth */
@@ -78,11 +89,48 @@ typedef struct dpuTaskExecState		dpuTaskExecState;
 static void
 __dpuClientWriteBack(dpuClient *dclient, struct iovec *iov, int iovcnt)
 {
+	xpuWireCompressor wcomp;
+	void	   *zbuf = NULL;
+	XpuCommand *zcmd = NULL;
+	struct iovec ziov;
+	size_t		zbufsz;
+	uint64_t	tv1 = 0;
+
+	/*
+	 * Compress the response, if wire compression is enabled, without
+	 * dclient->mutex; it blocks the other workers that write back to
+	 * the same client. The compressor state is copied under the lock.
+	 */
+	pthreadMutexLock(&dclient->mutex);
+	memcpy(&wcomp, &dclient->wcomp, sizeof(xpuWireCompressor));
+	pthreadMutexUnlock(&dclient->mutex);
+
+	zbufsz = xpuWireCompressBufsz(&wcomp, iov, iovcnt);
+	if (zbufsz > 0 && (zbuf = malloc(zbufsz)) != NULL)
+	{
+		zcmd = xpuWireCompressIOV(&wcomp, iov, iovcnt, zbuf, zbufsz);
+		if (zcmd)
+		{
+			ziov.iov_base = zcmd;
+			ziov.iov_len  = zcmd->length;
+			iov = &ziov;
+			iovcnt = 1;
+		}
+	}
+
 	pthreadMutexLock(&dclient->mutex);
+	if (zbuf)
+	{
+		/* compression level may be adjusted by xpuWireCompressIOV */
+		dclient->wcomp.level     = wcomp.level;
+		dclient->wcomp.comp_usec = wcomp.comp_usec;
+	}
 	if (dclient->sockfd >= 0)
 	{
 		ssize_t		nbytes;
 
+		if (zcmd)
+			tv1 = __xpuWireClockUsec();
 		while (iovcnt > 0)
 		{
 			nbytes = writev(dclient->sockfd, iov, iovcnt);
@@ -114,8 +162,13 @@ __dpuClientWriteBack(dpuClient *dclient, struct iovec *iov, int iovcnt)
 				break;
 			}
 		}
+		if (zcmd && iovcnt == 0)
+			xpuWireCompressFeedback(&dclient->wcomp, zcmd,
+									__xpuWireClockUsec() - tv1);
 	}
 	pthreadMutexUnlock(&dclient->mutex);
+	if (zbuf)
+		free(zbuf);
 }
 
 static void
@@ -127,15 +180,29 @@ dpuClientWriteBack(dpuClient *dclient,
 	struct iovec   *iov;
 	int				iovcnt = 0;
 	int				resp_sz;
+	int				sz;
+	/* Top-N rows are already kept in the buffer */
+	uint32_t		kds_dst_nitems = (dtes->topn_kept ? 0 : dtes->kds_dst_nitems);
 
 	/* Xcmd for the response */
 	resp_sz = MAXALIGN(offsetof(XpuCommand, u.results.stats[dtes->num_rels]));
-	resp = alloca(resp_sz);
-	memset(resp, 0, resp_sz);
+	sz = MAXALIGN(sizeof(BlockNumber) * dtes->recheck_nblocks);
+	resp = alloca(resp_sz + sz);
+	memset(resp, 0, resp_sz + sz);
 	resp->magic = XpuCommandMagicNumber;
 	resp->tag   = XpuCommandTag__Success;
+	if (dtes->recheck_nblocks > 0)
+	{
+		resp->u.results.recheck_offset = resp_sz;
+		resp->u.results.recheck_nblocks = dtes->recheck_nblocks;
+		memcpy((char *)resp + resp_sz,
+			   dtes->recheck_blocks,
+			   sizeof(BlockNumber) * dtes->recheck_nblocks);
+		resp_sz += sz;
+	}
 	resp->u.results.chunks_offset = resp_sz;
-	resp->u.results.chunks_nitems = dtes->kds_dst_nitems;
+	resp->u.results.chunks_nitems = kds_dst_nitems;
+	resp->u.results.chunk_id   = dtes->chunk_id;
 	resp->u.results.nitems_raw = dtes->nitems_raw;
 	resp->u.results.nitems_in  = dtes->nitems_in;
 	resp->u.results.nitems_out = dtes->nitems_out;
@@ -147,11 +214,11 @@ dpuClientWriteBack(dpuClient *dclient,
 	}
 
 	/* Setup iovec */
-	iov_array = alloca(sizeof(struct iovec) * (2 * dtes->kds_dst_nitems + 1));
+	iov_array = alloca(sizeof(struct iovec) * (2 * kds_dst_nitems + 1));
 	iov = &iov_array[iovcnt++];
 	iov->iov_base = resp;
 	iov->iov_len  = resp_sz;
-	for (int i=0; i < dtes->kds_dst_nitems; i++)
+	for (int i=0; i < kds_dst_nitems; i++)
 	{
 		kern_data_store *kds = dtes->kds_dst_array[i];
 		size_t		sz1, sz2;
@@ -186,6 +253,38 @@ dpuClientWriteBack(dpuClient *dclient,
 	__dpuClientWriteBack(dclient, iov_array, iovcnt);
 }
 
+/*
+ * dpuClientWriteBackFallback
+ *
+ * It sends back the header portion of the source chunk with
+ * XpuCommandTag__CPUFallback, then the backend re-reads the blocks
+ * and runs the CPU fallback on the entire chunk.
+ */
+static void
+dpuClientWriteBackFallback(dpuClient *dclient,
+						   kern_data_store *kds_head)
+{
+	XpuCommand		resp;
+	struct iovec	iov[2];
+
+	assert(kds_head->format == KDS_FORMAT_BLOCK &&
+		   kds_head->block_nloaded == 0);
+	kds_head->length = kds_head->block_offset;
+
+	memset(&resp, 0, sizeof(resp));
+	resp.magic = XpuCommandMagicNumber;
+	resp.tag   = XpuCommandTag__CPUFallback;
+	resp.u.results.chunks_nitems = 1;
+	resp.u.results.chunks_offset = offsetof(XpuCommand, u.results.stats);
+	resp.length = resp.u.results.chunks_offset + kds_head->length;
+
+	iov[0].iov_base = &resp;
+	iov[0].iov_len  = resp.u.results.chunks_offset;
+	iov[1].iov_base = kds_head;
+	iov[1].iov_len  = kds_head->length;
+	__dpuClientWriteBack(dclient, iov, 2);
+}
+
 /*
  * dpuClientElog
  */
@@ -232,9 +331,63 @@ __dpuClientElog(dpuClient *dclient,
 	__dpuClientElog((dclient), ERRCODE_DEVICE_INTERNAL,	\
 					__FILE__, __LINE__, __FUNCTION__,	\
 					(fmt), ##__VA_ARGS__)
+
+/*
+ * dpuClientTopNAddResults
+ *
+ * It keeps the Top-N rows of kds_dst until XpuTaskFinal, if any.
+ * Once the buffer gets full, kds_dst is sent back as is.
+ */
+static bool
+dpuClientTopNAddResults(dpuClient *dclient,
+						dpuTaskExecState *dtes)
+{
+	bool	ok = true;
+
+	dtes->topn_kept = false;
+	if (!dclient->topn_buf)
+		return true;
+	pthreadMutexLock(&dclient->topn_lock);
+	if (!xpuTopNBufferIsFull(dclient->topn_buf))
+	{
+		for (int i=0; ok && i < dtes->kds_dst_nitems; i++)
+			ok = xpuTopNBufferAddResults(dclient->topn_buf,
+										 dtes->kds_dst_array[i]);
+		dtes->topn_kept = true;
+	}
+	pthreadMutexUnlock(&dclient->topn_lock);
+	if (!ok)
+		dpuClientElog(dclient, "out of memory on the Top-N buffer");
+	return ok;
+}
 /*
  * Get/Put Group-By Final Buffer
  */
+/*
+ * Hybrid GROUP BY
+ *
+ * Groups are partitioned by the upper bits of the hash value. Once the
+ * kds_final reaches dpuserv_groupby_mem_limit, the coldest partitions
+ * (least updated per group) are written out to the local temporary file,
+ * and further rows of these partitions are pre-aggregated on the small
+ * per-partition buffer, then flushed to the file on demand.
+ * At the final, spilled partitions are merged partition by partition.
+ */
+#define GROUPBY_SPILL_PART_BITS			5
+#define GROUPBY_SPILL_NPARTS			(1U << GROUPBY_SPILL_PART_BITS)
+#define GROUPBY_SPILL_PARTITION(hash)	\
+	((uint32_t)(hash) >> (32 - GROUPBY_SPILL_PART_BITS))
+#define GROUPBY_SPILL_BUFFER_SIZE		(16UL << 20)	/* 16MB */
+
+typedef struct
+{
+	int			fdesc;			/* unlinked temporary file */
+	size_t		file_sz;		/* length of the spilled hash-items */
+	kern_data_store *kds_buf;	/* pre-aggregation buffer (KDS_FORMAT_HASH) */
+	kern_data_store *kds_merged; /* merged results at the final (mmap) */
+	size_t		merged_sz;
+} groupby_spill_partition;
+
 struct groupby_final_buffer
 {
 	dlist_node	chain;
@@ -244,6 +397,10 @@ struct groupby_final_buffer
 	uint32_t	pgsql_client_hash;
 	pthread_rwlock_t kds_final_rwlock;
 	kern_data_store *kds_final;
+	/* hybrid GROUP BY */
+	uint32_t	spill_mask;		/* bitmap of the spilled partitions */
+	uint64_t	part_nupdates[GROUPBY_SPILL_NPARTS];
+	groupby_spill_partition *spill_parts[GROUPBY_SPILL_NPARTS];
 };
 typedef struct groupby_final_buffer		groupby_final_buffer;
 
@@ -316,6 +473,18 @@ found:
 	return true;
 }
 
+static void
+__releaseGroupBySpillPartition(groupby_spill_partition *sp)
+{
+	if (sp->kds_merged &&
+		munmap(sp->kds_merged, sp->merged_sz) != 0)
+		fprintf(stderr, "failed on munmap: %m\n");
+	if (sp->kds_buf)
+		free(sp->kds_buf);
+	close(sp->fdesc);
+	free(sp);
+}
+
 static void
 dpuServPutGroupByFinalBuffer(groupby_final_buffer *gf_buf)
 {
@@ -324,6 +493,11 @@ dpuServPutGroupByFinalBuffer(groupby_final_buffer *gf_buf)
 	if (--gf_buf->refcnt == 0)
 	{
 		dlist_delete(&gf_buf->chain);
+		for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+		{
+			if (gf_buf->spill_parts[k])
+				__releaseGroupBySpillPartition(gf_buf->spill_parts[k]);
+		}
 		free(gf_buf->kds_final);
 		free(gf_buf);
 	}
@@ -585,17 +759,37 @@ dpuservHandleOpenSession(dpuClient *dclient, XpuCommand *xcmd)
 		dpuClientElog(dclient, "unable to map DPU-serv session buffer");
 		return false;
 	}
+	if (session->topn_desc != 0)
+	{
+		dclient->topn_buf = xpuTopNBufferCreate(SESSION_TOPN_DESC(session));
+		if (!dclient->topn_buf)
+		{
+			dpuClientElog(dclient, "out of memory");
+			return false;
+		}
+	}
 	dclient->session = session;
 	
-	/* success status */
+	/* success status, with the accepted wire compression */
 	memset(&resp, 0, sizeof(resp));
 	resp.magic = XpuCommandMagicNumber;
 	resp.tag = XpuCommandTag__Success;
-	resp.length = offsetof(XpuCommand, u);
+	resp.length = offsetof(XpuCommand, u.reply) + sizeof(kern_session_reply);
+	if (xpuWireCompressionSupported(session->wire_compression))
+		resp.u.reply.wire_compression = session->wire_compression;
+	else
+		resp.u.reply.wire_compression = XPU_WIRE_COMPRESSION__NONE;
 
 	iov.iov_base = &resp;
 	iov.iov_len  = resp.length;
 	__dpuClientWriteBack(dclient, &iov, 1);
+
+	/* responses after the OpenSession may be compressed */
+	pthreadMutexLock(&dclient->mutex);
+	xpuWireCompressorInit(&dclient->wcomp,
+						  resp.u.reply.wire_compression,
+						  session->wire_compression_threshold);
+	pthreadMutexUnlock(&dclient->mutex);
 	return true;
 }
 
@@ -844,12 +1038,30 @@ __atomic_add_uint64(uint64_t *ptr, uint64_t ival)
 	return __atomic_fetch_add(ptr, ival, __ATOMIC_SEQ_CST);
 }
 
+static inline uint32_t
+__atomic_or_uint32(uint32_t *ptr, uint32_t mask)
+{
+	return __atomic_fetch_or(ptr, mask, __ATOMIC_SEQ_CST);
+}
+
 static inline int64_t
 __atomic_add_int64(int64_t *ptr, int64_t ival)
 {
 	return __atomic_fetch_add(ptr, ival, __ATOMIC_SEQ_CST);
 }
 
+static inline int64_t
+__atomic_and_int64(int64_t *ptr, int64_t ival)
+{
+	return __atomic_fetch_and(ptr, ival, __ATOMIC_SEQ_CST);
+}
+
+static inline int64_t
+__atomic_or_int64(int64_t *ptr, int64_t ival)
+{
+	return __atomic_fetch_or(ptr, ival, __ATOMIC_SEQ_CST);
+}
+
 static inline float8_t
 __atomic_add_fp64(float8_t *ptr, float8_t fval)
 {
@@ -1184,6 +1396,20 @@ __writeOutOneTuplePreAgg(kern_context *kcxt,
 				t_infomask |= HEAP_HASVARWIDTH;
 				break;
 
+			case KAGG_ACTION__PAVG_NUM:
+				nbytes = sizeof(kagg_state__pavg_num_packed);
+				if (buffer)
+				{
+					kagg_state__pavg_num_packed *r =
+						(kagg_state__pavg_num_packed *)buffer;
+					memset(r, 0, sizeof(kagg_state__pavg_num_packed));
+					r->scale = desc->arg_option;
+					r->dscale = desc->arg_option;
+					SET_VARSIZE(r, sizeof(kagg_state__pavg_num_packed));
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
 			case KAGG_ACTION__STDDEV:
 				nbytes = sizeof(kagg_state__stddev_packed);
 				if (buffer)
@@ -1204,6 +1430,58 @@ __writeOutOneTuplePreAgg(kern_context *kcxt,
 				t_infomask |= HEAP_HASVARWIDTH;
 				break;
 
+			case KAGG_ACTION__PMIN_BYTES:
+			case KAGG_ACTION__PMAX_BYTES:
+				nbytes = KAGG_PMINMAX_BYTES_STATE_LENGTH(desc->arg_option);
+				if (buffer)
+				{
+					kagg_state__pminmax_bytes_packed *r =
+						(kagg_state__pminmax_bytes_packed *)buffer;
+					memset(r, 0, offsetof(kagg_state__pminmax_bytes_packed, value));
+					r->prefix = (desc->action == KAGG_ACTION__PMIN_BYTES ? ULONG_MAX : 0);
+					SET_VARSIZE(r, nbytes);
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
+			case KAGG_ACTION__PBITAND:
+			case KAGG_ACTION__PBITOR:
+				nbytes = sizeof(kagg_state__pminmax_int64_packed);
+				if (buffer)
+				{
+					kagg_state__pminmax_int64_packed *r =
+						(kagg_state__pminmax_int64_packed *)buffer;
+					r->nitems = 0;
+					r->value = (desc->action == KAGG_ACTION__PBITAND ? ~0L : 0L);
+					SET_VARSIZE(r, sizeof(kagg_state__pminmax_int64_packed));
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
+			case KAGG_ACTION__HLL:
+				nbytes = VARHDRSZ + (1U << desc->arg_option);
+				if (buffer)
+				{
+					memset(buffer, 0, nbytes);
+					SET_VARSIZE(buffer, nbytes);
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
+			case KAGG_ACTION__QUANTILE:
+				nbytes = KAGG_QUANTILE_STATE_LENGTH(desc->arg_option);
+				if (buffer)
+				{
+					kagg_state__quantile_packed *r =
+						(kagg_state__quantile_packed *)buffer;
+					memset(r, 0, nbytes);
+					r->min_value = DBL_MAX;
+					r->max_value = -DBL_MAX;
+					SET_VARSIZE(r, nbytes);
+				}
+				t_infomask |= HEAP_HASVARWIDTH;
+				break;
+
 			default:
 				//error message
 				return -1;
@@ -1547,6 +1825,77 @@ __update_preagg__pavg_fp(kern_context *kcxt,
 	}
 }
 
+/*
+ * __update_preagg__pavg_num
+ */
+static inline void
+__update_preagg__pavg_num(kern_context *kcxt,
+						  char *buffer,
+						  kern_colmeta *cmeta,
+						  kern_aggregate_desc *desc)
+{
+	kagg_state__pavg_num_packed *r =
+		(kagg_state__pavg_num_packed *)buffer;
+	int				slot_id = desc->arg0_slot_id;
+	int				vclass = kcxt->kvars_class[slot_id];
+	kern_variable  *kvar = &kcxt->kvars_slot[slot_id];
+	xpu_numeric_t	num;
+	uint64_t		val[3];
+	uint32_t		unlocked;
+	int				dscale;
+
+	if (vclass == KVAR_CLASS__XPU_DATUM)
+	{
+		memcpy(&num, kvar->ptr, sizeof(xpu_numeric_t));
+		dscale = Max(num.weight, 0);
+	}
+	else if (vclass == KVAR_CLASS__VARLENA)
+	{
+		const char *errmsg = __xpu_numeric_from_varlena(&num, (const varlena *)kvar->ptr);
+
+		if (errmsg)
+		{
+			STROM_ELOG(kcxt, errmsg);
+			return;
+		}
+		dscale = __xpu_numeric_dscale_from_varlena((const varlena *)kvar->ptr);
+	}
+	else
+	{
+		assert(vclass == KVAR_CLASS__NULL);
+		return;
+	}
+	__atomic_add_uint32(&r->nitems, 1);
+	switch (num.kind)
+	{
+		case XPU_NUMERIC_KIND__VALID:
+			/* scale of the sum is updated with the sum itself */
+			__kagg_int192_from_int128(val, num.value);
+			for (;;)
+			{
+				unlocked = 0;
+				if (__atomic_cas_uint32(&r->lock, &unlocked, 1))
+					break;
+			}
+			if (!__kagg_pavg_num_update(r, val, num.weight, dscale))
+				__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__OVERFLOW);
+			__atomic_write_uint32(&r->lock, 0);
+			break;
+		case XPU_NUMERIC_KIND__NAN:
+			__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__NAN);
+			break;
+		case XPU_NUMERIC_KIND__POS_INF:
+			__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__POS_INF);
+			break;
+		case XPU_NUMERIC_KIND__NEG_INF:
+			__atomic_or_uint32(&r->attrs, KAGG_NUMERIC_ATTR__NEG_INF);
+			break;
+		default:
+			STROM_ELOG(kcxt, "unknown numeric kind");
+			break;
+	}
+}
+
 /*
  * __update_preagg__pstddev
  */
@@ -1605,6 +1954,162 @@ __update_preagg__pcovar(kern_context *kcxt,
 	}
 }
 
+/*
+ * __update_preagg__hll
+ */
+static inline void
+__update_preagg__hll(kern_context *kcxt,
+					 char *buffer,
+					 kern_colmeta *cmeta,
+					 kern_aggregate_desc *desc)
+{
+	int		slot_id = desc->arg0_slot_id;
+
+	if (kcxt->kvars_class[slot_id] == KVAR_CLASS__INLINE)
+	{
+		uint8_t	   *hll_regs = (uint8_t *)VARDATA(buffer);
+		uint64_t	hash = kcxt->kvars_slot[slot_id].u64;
+		uint32_t	index;
+		uint8_t		count;
+		uint8_t		curval;
+
+		count = pg_hll_register_position(hash, desc->arg_option, &index);
+		curval = __volatileRead(&hll_regs[index]);
+		while (curval < count)
+		{
+			if (__atomic_compare_exchange_n(&hll_regs[index],
+											&curval,
+											count,
+											false,
+											__ATOMIC_SEQ_CST,
+											__ATOMIC_SEQ_CST))
+				break;
+		}
+	}
+	else
+	{
+		assert(kcxt->kvars_class[slot_id] == KVAR_CLASS__NULL);
+	}
+}
+
+/*
+ * __update_preagg__quantile
+ */
+static inline void
+__update_preagg__quantile(kern_context *kcxt,
+						  char *buffer,
+						  kern_colmeta *cmeta,
+						  kern_aggregate_desc *desc)
+{
+	int		slot_id = desc->arg0_slot_id;
+
+	if (kcxt->kvars_class[slot_id] == KVAR_CLASS__INLINE)
+	{
+		kagg_state__quantile_packed *r =
+			(kagg_state__quantile_packed *)buffer;
+		float8_t	fval = kcxt->kvars_slot[slot_id].fp64;
+		uint32_t	index = pg_qsketch_bucket_index(fval, desc->arg_option);
+
+		__atomic_add_uint32(&r->nitems, 1);
+		__atomic_add_uint32(&r->counters[index], 1);
+		__atomic_min_fp64(&r->min_value, fval);
+		__atomic_max_fp64(&r->max_value, fval);
+	}
+	else
+	{
+		assert(kcxt->kvars_class[slot_id] == KVAR_CLASS__NULL);
+	}
+}
+
+/*
+ * __update_preagg__pminmax_bytes
+ */
+static inline void
+__update_preagg__pminmax_bytes(kern_context *kcxt,
+							   char *buffer,
+							   kern_colmeta *cmeta,
+							   kern_aggregate_desc *desc,
+							   bool is_min)
+{
+	kagg_state__pminmax_bytes_packed *r =
+		(kagg_state__pminmax_bytes_packed *)buffer;
+	const char *addr;
+	uint32_t	len;
+	uint64_t	prefix;
+	uint64_t	curr;
+	uint32_t	unlocked;
+
+	if (!__kagg_fetch_bytes_kvar(kcxt, desc->arg0_slot_id, &addr, &len))
+		return;
+	__atomic_add_uint32(&r->nitems, 1);
+	/* prefix of the state moves only to the winner side */
+	prefix = __kagg_bytes_prefix(addr, len);
+	curr = __volatileRead(&r->prefix);
+	if (is_min ? prefix > curr : prefix < curr)
+		return;
+	for (;;)
+	{
+		unlocked = 0;
+		if (__atomic_cas_uint32(&r->lock, &unlocked, 1))
+			break;
+	}
+	__kagg_pminmax_bytes_update(r, desc->arg_option,
+								addr, len, false, is_min);
+	__atomic_write_uint32(&r->lock, 0);
+}
+
+/*
+ * __update_preagg__pbitand
+ */
+static inline void
+__update_preagg__pbitand(kern_context *kcxt,
+						 char *buffer,
+						 kern_colmeta *cmeta,
+						 kern_aggregate_desc *desc)
+{
+	int		slot_id = desc->arg0_slot_id;
+
+	if (kcxt->kvars_class[slot_id] == KVAR_CLASS__INLINE)
+	{
+		kagg_state__pminmax_int64_packed *r =
+			(kagg_state__pminmax_int64_packed *)buffer;
+		int64_t		ival = kcxt->kvars_slot[slot_id].i64;
+
+		__atomic_add_uint32(&r->nitems, 1);
+		__atomic_and_int64(&r->value, ival);
+	}
+	else
+	{
+		assert(kcxt->kvars_class[slot_id] == KVAR_CLASS__NULL);
+	}
+}
+
+/*
+ * __update_preagg__pbitor
+ */
+static inline void
+__update_preagg__pbitor(kern_context *kcxt,
+						char *buffer,
+						kern_colmeta *cmeta,
+						kern_aggregate_desc *desc)
+{
+	int		slot_id = desc->arg0_slot_id;
+
+	if (kcxt->kvars_class[slot_id] == KVAR_CLASS__INLINE)
+	{
+		kagg_state__pminmax_int64_packed *r =
+			(kagg_state__pminmax_int64_packed *)buffer;
+		int64_t		ival = kcxt->kvars_slot[slot_id].i64;
+
+		__atomic_add_uint32(&r->nitems, 1);
+		__atomic_or_int64(&r->value, ival);
+	}
+	else
+	{
+		assert(kcxt->kvars_class[slot_id] == KVAR_CLASS__NULL);
+	}
+}
+
 /*
  * __updateOneTupleDpuPreAgg (for both of NoGroups and GroupBy)
  */
@@ -1678,12 +2183,33 @@ __updateOneTupleDpuPreAgg(kern_context *kcxt,
             case KAGG_ACTION__PAVG_FP:
                 __update_preagg__pavg_fp(kcxt, buffer, cmeta, desc);
                 break;
+            case KAGG_ACTION__PAVG_NUM:
+                __update_preagg__pavg_num(kcxt, buffer, cmeta, desc);
+                break;
             case KAGG_ACTION__STDDEV:
                 __update_preagg__pstddev(kcxt, buffer, cmeta, desc);
                 break;
             case KAGG_ACTION__COVAR:
                 __update_preagg__pcovar(kcxt, buffer, cmeta, desc);
                 break;
+            case KAGG_ACTION__HLL:
+                __update_preagg__hll(kcxt, buffer, cmeta, desc);
+                break;
+            case KAGG_ACTION__QUANTILE:
+                __update_preagg__quantile(kcxt, buffer, cmeta, desc);
+                break;
+            case KAGG_ACTION__PMIN_BYTES:
+                __update_preagg__pminmax_bytes(kcxt, buffer, cmeta, desc, true);
+                break;
+            case KAGG_ACTION__PMAX_BYTES:
+                __update_preagg__pminmax_bytes(kcxt, buffer, cmeta, desc, false);
+                break;
+            case KAGG_ACTION__PBITAND:
+                __update_preagg__pbitand(kcxt, buffer, cmeta, desc);
+                break;
+            case KAGG_ACTION__PBITOR:
+                __update_preagg__pbitor(kcxt, buffer, cmeta, desc);
+                break;
             default:
 				/*
 				 * No more partial aggregation exists after grouping-keys
@@ -1694,12 +2220,10 @@ __updateOneTupleDpuPreAgg(kern_context *kcxt,
 }
 
 /*
- * expandGroupByFinalBuffer
- *
- * NOTE: this function must be called under kds_final_rwlock WRITE-LOCK
+ * __expandGroupByFinalBufferRow - for KDS_FORMAT_ROW (no groups)
  */
 static bool
-expandGroupByFinalBuffer(groupby_final_buffer *gf_buf)
+__expandGroupByFinalBufferRow(groupby_final_buffer *gf_buf)
 {
 	kern_data_store *kds_old = gf_buf->kds_final;
 	kern_data_store *kds_new;
@@ -1729,15 +2253,339 @@ expandGroupByFinalBuffer(groupby_final_buffer *gf_buf)
 }
 
 /*
- * __handleDpuTaskExecNoGroupPreAgg
+ * __allocGroupByHashBuffer - an empty KDS_FORMAT_HASH with the same
+ * definition of @kds_head
  */
-static bool
-__handleDpuTaskExecNoGroupPreAgg(dpuClient *dclient,
-								 dpuTaskExecState *dtes,
-								 kern_context *kcxt)
+static kern_data_store *
+__allocGroupByHashBuffer(const kern_data_store *kds_head,
+						 size_t length, uint32_t hash_nslots)
 {
-	groupby_final_buffer *gf_buf = dclient->gf_buf;
-	kern_session_info  *session = dclient->session;
+	kern_data_store *kds;
+	size_t		head_sz = KDS_HEAD_LENGTH(kds_head);
+
+	kds = malloc(length);
+	if (!kds)
+		return NULL;
+	memcpy(kds, kds_head, head_sz);
+	kds->format = KDS_FORMAT_HASH;
+	kds->length = length;
+	kds->nitems = 0;
+	kds->usage = 0;
+	kds->hash_nslots = hash_nslots;
+	memset(KDS_GET_HASHSLOT_BASE(kds), 0, sizeof(uint32_t) * hash_nslots);
+	return kds;
+}
+
+/*
+ * __appendGroupByHashItem - single-threaded insertion of a hash-item
+ */
+static kern_hashitem *
+__appendGroupByHashItem(kern_data_store *kds, const kern_hashitem *hitem_src)
+{
+	kern_hashitem *hitem;
+	uint32_t   *hslot;
+	size_t		sz = offsetof(kern_hashitem, t.htup) + hitem_src->t.t_len;
+	size_t		usage = __kds_unpack(kds->usage) + MAXALIGN(sz);
+
+	if (KDS_HEAD_LENGTH(kds) +
+		MAXALIGN(sizeof(uint32_t) * (kds->hash_nslots +
+									 kds->nitems + 1)) + usage > kds->length)
+		return NULL;	/* no space */
+	hitem = (kern_hashitem *)((char *)kds + kds->length - usage);
+	memcpy(hitem, hitem_src, sz);
+	hitem->t.rowid = kds->nitems;
+	hslot = KDS_GET_HASHSLOT(kds, hitem->hash);
+	hitem->next = *hslot;
+	*hslot = __kds_packed(usage);
+	KDS_GET_ROWINDEX(kds)[kds->nitems++]
+		= __kds_packed(usage - offsetof(kern_hashitem, t));
+	kds->usage = __kds_packed(usage);
+
+	return hitem;
+}
+
+/* hash-item by kds_index */
+static inline kern_hashitem *
+__getGroupByHashItem(kern_data_store *kds, uint32_t kds_index)
+{
+	kern_tupitem   *tupitem = KDS_GET_TUPITEM(kds, kds_index);
+
+	return (kern_hashitem *)((char *)tupitem - offsetof(kern_hashitem, t));
+}
+
+/*
+ * __writeGroupBySpillFile
+ */
+static bool
+__writeGroupBySpillFile(groupby_spill_partition *sp,
+						const void *buffer, size_t nbytes)
+{
+	const char *pos = buffer;
+
+	while (nbytes > 0)
+	{
+		ssize_t	nwritten = write(sp->fdesc, pos, nbytes);
+
+		if (nwritten < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "failed on write(2) of the spill file: %m\n");
+			return false;
+		}
+		pos += nwritten;
+		nbytes -= nwritten;
+		sp->file_sz += nwritten;
+	}
+	return true;
+}
+
+/*
+ * __spillGroupByHashItems - writes out the hash-items of the partition
+ */
+static bool
+__spillGroupByHashItems(groupby_spill_partition *sp,
+						kern_data_store *kds, int part)
+{
+	for (uint32_t i=0; i < kds->nitems; i++)
+	{
+		kern_hashitem *hitem = __getGroupByHashItem(kds, i);
+
+		if (part >= 0 && GROUPBY_SPILL_PARTITION(hitem->hash) != part)
+			continue;
+		if (!__writeGroupBySpillFile(sp, hitem,
+									 MAXALIGN(offsetof(kern_hashitem, t.htup) +
+											  hitem->t.t_len)))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * __createGroupBySpillPartition
+ */
+static groupby_spill_partition *
+__createGroupBySpillPartition(const kern_data_store *kds_head)
+{
+	groupby_spill_partition *sp;
+	char		namebuf[PATH_MAX];
+
+	sp = calloc(1, sizeof(groupby_spill_partition));
+	if (!sp)
+		return NULL;
+	snprintf(namebuf, sizeof(namebuf),
+			 "%s/.pgstrom_spill_%u_XXXXXX",
+			 dpuserv_spill_directory, getpid());
+	sp->fdesc = mkstemp(namebuf);
+	if (sp->fdesc < 0)
+	{
+		fprintf(stderr, "failed on mkstemp('%s'): %m\n", namebuf);
+		free(sp);
+		return NULL;
+	}
+	unlink(namebuf);
+	sp->kds_buf = __allocGroupByHashBuffer(kds_head,
+										   GROUPBY_SPILL_BUFFER_SIZE,
+										   GROUPBY_SPILL_BUFFER_SIZE / 256);
+	if (!sp->kds_buf)
+	{
+		close(sp->fdesc);
+		free(sp);
+		return NULL;
+	}
+	return sp;
+}
+
+/*
+ * flushGroupBySpillBuffer
+ *
+ * NOTE: this function must be called under kds_final_rwlock WRITE-LOCK
+ */
+static bool
+flushGroupBySpillBuffer(groupby_final_buffer *gf_buf, int part)
+{
+	groupby_spill_partition *sp = gf_buf->spill_parts[part];
+	kern_data_store *kds = sp->kds_buf;
+
+	if (!__spillGroupByHashItems(sp, kds, -1))
+		return false;
+	kds->nitems = 0;
+	kds->usage = 0;
+	memset(KDS_GET_HASHSLOT_BASE(kds), 0, sizeof(uint32_t) * kds->hash_nslots);
+	return true;
+}
+
+/*
+ * __spillGroupByFinalPartitions
+ *
+ * It writes out the coldest partitions of kds_final to the temporary files
+ * until half of the buffer gets free, then rebuilds kds_final with the
+ * remaining groups. It is all-or-nothing; on failure, neither spill_mask
+ * nor kds_final is modified, so no groups are written out twice.
+ */
+static bool
+__spillGroupByFinalPartitions(groupby_final_buffer *gf_buf)
+{
+	kern_data_store *kds_old = gf_buf->kds_final;
+	kern_data_store *kds_new = NULL;
+	groupby_spill_partition *spill_parts[GROUPBY_SPILL_NPARTS];
+	uint64_t	part_ngroups[GROUPBY_SPILL_NPARTS];
+	size_t		part_usage[GROUPBY_SPILL_NPARTS];
+	size_t		usage = __kds_unpack(kds_old->usage);
+	uint32_t	victims = 0;
+
+	memset(spill_parts, 0, sizeof(spill_parts));
+	memset(part_ngroups, 0, sizeof(part_ngroups));
+	memset(part_usage, 0, sizeof(part_usage));
+	for (uint32_t i=0; i < kds_old->nitems; i++)
+	{
+		kern_hashitem *hitem = __getGroupByHashItem(kds_old, i);
+		int		part = GROUPBY_SPILL_PARTITION(hitem->hash);
+
+		part_ngroups[part]++;
+		part_usage[part] += MAXALIGN(offsetof(kern_hashitem, t.htup) +
+									 hitem->t.t_len);
+	}
+	/* choose the victim partitions; least updates per group first */
+	while (usage > kds_old->length / 2)
+	{
+		int		victim = -1;
+		double	victim_ratio = 0.0;
+
+		for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+		{
+			double	ratio;
+
+			if ((victims & (1U<<k)) != 0 || part_ngroups[k] == 0)
+				continue;
+			ratio = ((double)gf_buf->part_nupdates[k] /
+					 (double)part_ngroups[k]);
+			if (victim < 0 || ratio < victim_ratio)
+			{
+				victim = k;
+				victim_ratio = ratio;
+			}
+		}
+		if (victim < 0)
+			break;
+		victims |= (1U<<victim);
+		usage -= part_usage[victim];
+	}
+	if (victims == 0)
+		return false;
+	/* write out the victim partitions */
+	for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+	{
+		groupby_spill_partition *sp;
+
+		if ((victims & (1U<<k)) == 0)
+			continue;
+		sp = __createGroupBySpillPartition(kds_old);
+		if (!sp)
+			goto rollback;
+		spill_parts[k] = sp;
+		if (!__spillGroupByHashItems(sp, kds_old, k))
+			goto rollback;
+	}
+	/* rebuild kds_final with the resident partitions */
+	kds_new = __allocGroupByHashBuffer(kds_old,
+									   kds_old->length,
+									   kds_old->hash_nslots);
+	if (!kds_new)
+		goto rollback;
+	for (uint32_t i=0; i < kds_old->nitems; i++)
+	{
+		kern_hashitem *hitem = __getGroupByHashItem(kds_old, i);
+
+		if ((victims & (1U<<GROUPBY_SPILL_PARTITION(hitem->hash))) != 0)
+			continue;
+		if (!__appendGroupByHashItem(kds_new, hitem))
+			goto rollback;
+	}
+	/* all the victims are written out successfully */
+	for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+	{
+		if ((victims & (1U<<k)) == 0)
+			continue;
+		gf_buf->spill_parts[k] = spill_parts[k];
+		gf_buf->spill_mask |= (1U<<k);
+	}
+	gf_buf->kds_final = kds_new;
+	free(kds_old);
+
+	if (verbose)
+		fprintf(stderr, "GROUP BY spilled out partitions (mask=%08x)\n",
+				gf_buf->spill_mask);
+	return true;
+
+rollback:
+	for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+	{
+		if (spill_parts[k])
+			__releaseGroupBySpillPartition(spill_parts[k]);
+	}
+	if (kds_new)
+		free(kds_new);
+	return false;
+}
+
+/*
+ * expandGroupByFinalBuffer
+ *
+ * It expands kds_final, with larger hash-slots as the number of groups
+ * grows. Once it reaches dpuserv_groupby_mem_limit, it spills out the cold
+ * partitions instead.
+ *
+ * NOTE: this function must be called under kds_final_rwlock WRITE-LOCK
+ */
+static bool
+expandGroupByFinalBuffer(groupby_final_buffer *gf_buf)
+{
+	kern_data_store *kds_old = gf_buf->kds_final;
+	kern_data_store *kds_new;
+	size_t		length;
+	uint32_t	hash_nslots;
+
+	if (kds_old->format != KDS_FORMAT_HASH)
+		return __expandGroupByFinalBufferRow(gf_buf);
+
+	length = kds_old->length + Min(kds_old->length, 1UL<<30);
+	if (dpuserv_groupby_mem_limit > 0 &&
+		length > dpuserv_groupby_mem_limit &&
+		__spillGroupByFinalPartitions(gf_buf))
+		return true;
+	/* resize the hash-slots also, if too many groups per slot */
+	hash_nslots = kds_old->hash_nslots;
+	if (kds_old->nitems > hash_nslots)
+		hash_nslots = Min(2 * (size_t)kds_old->nitems, INT_MAX / sizeof(uint32_t));
+	kds_new = __allocGroupByHashBuffer(kds_old, length, hash_nslots);
+	if (!kds_new)
+		return false;
+	for (uint32_t i=0; i < kds_old->nitems; i++)
+	{
+		if (!__appendGroupByHashItem(kds_new, __getGroupByHashItem(kds_old, i)))
+		{
+			free(kds_new);
+			return false;
+		}
+	}
+	/* swap them */
+	gf_buf->kds_final = kds_new;
+	free(kds_old);
+
+	return true;
+}
+
+/*
+ * __handleDpuTaskExecNoGroupPreAgg
+ */
+static bool
+__handleDpuTaskExecNoGroupPreAgg(dpuClient *dclient,
+								 dpuTaskExecState *dtes,
+								 kern_context *kcxt)
+{
+	groupby_final_buffer *gf_buf = dclient->gf_buf;
+	kern_session_info  *session = dclient->session;
 	kern_expression	   *kexp_groupby_actions = SESSION_KEXP_GROUPBY_ACTIONS(session);
 	kern_expression	   *karg;
 	kern_data_store	   *kds_final;
@@ -1815,6 +2663,7 @@ __handleDpuTaskExecGroupByPreAgg(dpuClient *dclient,
 	kern_hashitem	   *hitem;
 	xpu_int4_t			hash;
 	bool				has_exclusive = false;
+	int					part;
 	int					i;
 
 	assert(kexp_groupby_keyhash != NULL &&
@@ -1836,6 +2685,8 @@ __handleDpuTaskExecGroupByPreAgg(dpuClient *dclient,
 	if (!EXEC_KERN_EXPRESSION(kcxt, kexp_groupby_keyhash, &hash))
 		return false;
 	assert(!XPU_DATUM_ISNULL(&hash));
+	part = GROUPBY_SPILL_PARTITION(hash.value);
+	__atomic_add_uint64(&gf_buf->part_nupdates[part], 1);
 
 	pthreadRWLockReadLock(&gf_buf->kds_final_rwlock);
 	do {
@@ -1843,7 +2694,11 @@ __handleDpuTaskExecGroupByPreAgg(dpuClient *dclient,
 		uint32_t	saved;
 		xpu_bool_t	status;
 
-		kds_final = gf_buf->kds_final;
+		/* spilled partition is pre-aggregated on the own buffer */
+		if ((gf_buf->spill_mask & (1U<<part)) != 0)
+			kds_final = gf_buf->spill_parts[part]->kds_buf;
+		else
+			kds_final = gf_buf->kds_final;
 		assert(kds_final->format == KDS_FORMAT_HASH);
 		hslot = KDS_GET_HASHSLOT(kds_final, hash.value);
 		for (hitem = KDS_HASH_FIRST_ITEM(kds_final, hslot, &saved);
@@ -1899,9 +2754,18 @@ __handleDpuTaskExecGroupByPreAgg(dpuClient *dclient,
 						pthreadRWLockWriteLock(&gf_buf->kds_final_rwlock);
 						has_exclusive = true;
 					}
+					else if (kds_final != gf_buf->kds_final)
+					{
+						/* flush the buffer of the spilled partition */
+						if (!flushGroupBySpillBuffer(gf_buf, part))
+						{
+							pthreadRWLockUnlock(&gf_buf->kds_final_rwlock);
+							return false;
+						}
+					}
 					else
 					{
-						/* expand the kds_final buffer */
+						/* expand (or spill out) the kds_final buffer */
 						if (!expandGroupByFinalBuffer(gf_buf))
 						{
 							pthreadRWLockUnlock(&gf_buf->kds_final_rwlock);
@@ -2097,6 +2961,26 @@ __handleDpuTaskExecHashJoin(dpuClient *dclient,
 	return true;
 }
 
+/*
+ * __dpuTaskExecRecheckBlock
+ */
+static bool
+__dpuTaskExecRecheckBlock(dpuTaskExecState *dtes, BlockNumber block_nr)
+{
+	if (dtes->recheck_nblocks >= dtes->recheck_nrooms)
+	{
+		uint32_t	nrooms = 2 * dtes->recheck_nrooms + 100;
+		BlockNumber *blocks = realloc(dtes->recheck_blocks,
+									  sizeof(BlockNumber) * nrooms);
+		if (!blocks)
+			return false;
+		dtes->recheck_blocks = blocks;
+		dtes->recheck_nrooms = nrooms;
+	}
+	dtes->recheck_blocks[dtes->recheck_nblocks++] = block_nr;
+	return true;
+}
+
 static bool
 __handleDpuScanExecBlock(dpuClient *dclient,
 						 dpuTaskExecState *dtes,
@@ -2120,6 +3004,38 @@ __handleDpuScanExecBlock(dpuClient *dclient,
 		PageHeaderData *page = KDS_BLOCK_PGPAGE(kds_src, block_index);
 		uint32_t		lp_nitems = PageGetMaxOffsetNumber(page);
 		uint32_t		lp_index;
+		bool			all_visible = true;
+
+		/*
+		 * If visibility of any tuples in this page cannot be determined
+		 * on the DPU, the entire page shall be rechecked by CPU.
+		 * The pages loaded by the backend are already checked by CPU.
+		 */
+		if (SESSION_XACT_SNAPSHOT(session) &&
+			block_index >= kds_src->block_nloaded &&
+			(page->pd_flags & PD_ALL_VISIBLE) == 0)
+		{
+			for (lp_index = 0; lp_index < lp_nitems; lp_index++)
+			{
+				ItemIdData *lpp = &page->pd_linp[lp_index];
+
+				if (ItemIdIsNormal(lpp) &&
+					kern_heaptuple_visibility(session,
+											  PageGetItem(page, lpp)) == XPU_MVCC__UNKNOWN)
+					break;
+			}
+			if (lp_index < lp_nitems)
+			{
+				if (!__dpuTaskExecRecheckBlock(dtes, KDS_BLOCK_BLCKNR(kds_src,
+																	  block_index)))
+				{
+					dpuClientElog(dclient, "out of memory");
+					return false;
+				}
+				continue;
+			}
+			all_visible = false;
+		}
 
 		for (lp_index = 0; lp_index < lp_nitems; lp_index++)
 		{
@@ -2130,6 +3046,9 @@ __handleDpuScanExecBlock(dpuClient *dclient,
 				continue;
 			htup = (HeapTupleHeaderData *) PageGetItem(page, lpp);
 			dtes->nitems_raw++;
+			if (!all_visible &&
+				kern_heaptuple_visibility(session, htup) != XPU_MVCC__VISIBLE)
+				continue;
 			kcxt_reset(kcxt);
 			if (ExecLoadVarsOuterRow(kcxt,
 									 kexp_load_vars,
@@ -2156,6 +3075,13 @@ __handleDpuScanExecBlock(dpuClient *dclient,
 						return false;
 				}
 			}
+			else if (kcxt->errcode == ERRCODE_CPU_FALLBACK &&
+					 session->xpucode_groupby_actions == 0)
+			{
+				/* the entire chunk shall be processed by CPU */
+				dtes->cpu_fallback = true;
+				return false;
+			}
 			else if (kcxt->errcode != ERRCODE_STROM_SUCCESS)
 			{
 				__dpuClientElog(dclient,
@@ -2268,6 +3194,7 @@ dpuservHandleDpuTaskExec(dpuClient *dclient, XpuCommand *xcmd)
 	memset(dtes, 0, sz);
 	dtes->kds_dst_head = kds_dst_head;
 	dtes->num_rels = num_rels;
+	dtes->chunk_id = xcmd->u.task.chunk_id;
 	if (session->xpucode_groupby_actions == 0)
 	{
 		assert(session->xpucode_projection != 0);
@@ -2296,7 +3223,12 @@ dpuservHandleDpuTaskExec(dpuClient *dclient, XpuCommand *xcmd)
 		if (kds_src)
 		{
 			if (__handleDpuScanExecBlock(dclient, dtes, kds_src))
-				dpuClientWriteBack(dclient, dtes);
+			{
+				if (dpuClientTopNAddResults(dclient, dtes))
+					dpuClientWriteBack(dclient, dtes);
+			}
+			else if (dtes->cpu_fallback)
+				dpuClientWriteBackFallback(dclient, kds_src_head);
 			free(base_addr);
 		}
 	}
@@ -2311,7 +3243,8 @@ dpuservHandleDpuTaskExec(dpuClient *dclient, XpuCommand *xcmd)
 									  &base_addr);
 		if (kds_src)
 		{
-			if (__handleDpuScanExecArrow(dclient, dtes, kds_src))
+			if (__handleDpuScanExecArrow(dclient, dtes, kds_src) &&
+				dpuClientTopNAddResults(dclient, dtes))
 				dpuClientWriteBack(dclient, dtes);
 			free(base_addr);
 		}
@@ -2328,6 +3261,385 @@ dpuservHandleDpuTaskExec(dpuClient *dclient, XpuCommand *xcmd)
 			free(dtes->kds_dst_array[i]);
 		free(dtes->kds_dst_array);
 	}
+	if (dtes->recheck_blocks)
+		free(dtes->recheck_blocks);
+}
+
+/*
+ * __deformPreAggTuple - pointers to the attributes, or NULL if null
+ */
+static void
+__deformPreAggTuple(kern_data_store *kds_final,
+					HeapTupleHeaderData *htup,
+					char **values)
+{
+	int			nattrs = (htup->t_infomask2 & HEAP_NATTS_MASK);
+	bool		heap_hasnull = ((htup->t_infomask & HEAP_HASNULL) != 0);
+	uint32_t	t_hoff;
+
+	t_hoff = offsetof(HeapTupleHeaderData, t_bits);
+	if (heap_hasnull)
+		t_hoff += BITMAPLEN(nattrs);
+	t_hoff = MAXALIGN(t_hoff);
+
+	for (int j=0; j < kds_final->ncols; j++)
+	{
+		kern_colmeta   *cmeta = &kds_final->colmeta[j];
+		char		   *addr;
+
+		if (j >= nattrs || (heap_hasnull && att_isnull(j, htup->t_bits)))
+		{
+			values[j] = NULL;
+			continue;
+		}
+		if (cmeta->attlen > 0)
+			t_hoff = TYPEALIGN(cmeta->attalign, t_hoff);
+		else if (!VARATT_NOT_PAD_BYTE((char *)htup + t_hoff))
+			t_hoff = TYPEALIGN(cmeta->attalign, t_hoff);
+		addr = ((char *)htup + t_hoff);
+		if (cmeta->attlen > 0)
+			t_hoff += cmeta->attlen;
+		else
+			t_hoff += VARSIZE_ANY(addr);
+		values[j] = addr;
+	}
+}
+
+/*
+ * __equalPreAggKeys
+ *
+ * It compares the grouping keys by the binary images. Keys that are equal
+ * but in different images (like 1.0 and 1.00 in numeric) are not merged
+ * here, but the final Agg node on the host merges them.
+ */
+static bool
+__equalPreAggKeys(kern_data_store *kds_final,
+				  kern_expression *kexp_groupby_actions,
+				  char **x_values, char **y_values)
+{
+	for (int j=0; j < kds_final->ncols; j++)
+	{
+		kern_aggregate_desc *desc = &kexp_groupby_actions->u.pagg.desc[j];
+		kern_colmeta   *cmeta = &kds_final->colmeta[j];
+		size_t			x_sz, y_sz;
+
+		if (desc->action != KAGG_ACTION__VREF)
+			continue;
+		if (!x_values[j] || !y_values[j])
+		{
+			if (x_values[j] || y_values[j])
+				return false;
+			continue;
+		}
+		if (cmeta->attlen > 0)
+			x_sz = y_sz = cmeta->attlen;
+		else
+		{
+			x_sz = VARSIZE_ANY(x_values[j]);
+			y_sz = VARSIZE_ANY(y_values[j]);
+		}
+		if (x_sz != y_sz || memcmp(x_values[j], y_values[j], x_sz) != 0)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * __mergeOneTupleDpuPreAgg - combines the partial aggregation states
+ */
+static void
+__mergeOneTupleDpuPreAgg(kern_data_store *kds_final,
+						 kern_expression *kexp_groupby_actions,
+						 char **d_values, char **s_values)
+{
+	for (int j=0; j < kds_final->ncols; j++)
+	{
+		kern_aggregate_desc *desc = &kexp_groupby_actions->u.pagg.desc[j];
+		char	   *d = d_values[j];
+		char	   *s = s_values[j];
+
+		if (!d || !s)
+			continue;
+		switch (desc->action)
+		{
+			case KAGG_ACTION__NROWS_ANY:
+			case KAGG_ACTION__NROWS_COND:
+			case KAGG_ACTION__PSUM_INT:
+				*((int64_t *)d) += *((int64_t *)s);
+				break;
+			case KAGG_ACTION__PSUM_FP:
+				*((float8_t *)d) += *((float8_t *)s);
+				break;
+			case KAGG_ACTION__PMIN_INT32:
+			case KAGG_ACTION__PMIN_INT64:
+			case KAGG_ACTION__PMAX_INT32:
+			case KAGG_ACTION__PMAX_INT64:
+				{
+					kagg_state__pminmax_int64_packed *x = (void *)d;
+					kagg_state__pminmax_int64_packed *y = (void *)s;
+
+					if (y->nitems == 0)
+						break;
+					if (x->nitems == 0 ||
+						(desc->action == KAGG_ACTION__PMIN_INT32 ||
+						 desc->action == KAGG_ACTION__PMIN_INT64
+						 ? y->value < x->value
+						 : y->value > x->value))
+						x->value = y->value;
+					x->nitems += y->nitems;
+				}
+				break;
+			case KAGG_ACTION__PMIN_FP64:
+			case KAGG_ACTION__PMAX_FP64:
+				{
+					kagg_state__pminmax_fp64_packed *x = (void *)d;
+					kagg_state__pminmax_fp64_packed *y = (void *)s;
+
+					if (y->nitems == 0)
+						break;
+					if (x->nitems == 0 ||
+						(desc->action == KAGG_ACTION__PMIN_FP64
+						 ? y->value < x->value
+						 : y->value > x->value))
+						x->value = y->value;
+					x->nitems += y->nitems;
+				}
+				break;
+			case KAGG_ACTION__PAVG_INT:
+				{
+					kagg_state__pavg_int_packed *x = (void *)d;
+					kagg_state__pavg_int_packed *y = (void *)s;
+
+					x->nitems += y->nitems;
+					x->sum += y->sum;
+				}
+				break;
+			case KAGG_ACTION__PAVG_FP:
+				{
+					kagg_state__pavg_fp_packed *x = (void *)d;
+					kagg_state__pavg_fp_packed *y = (void *)s;
+
+					x->nitems += y->nitems;
+					x->sum += y->sum;
+				}
+				break;
+			case KAGG_ACTION__PAVG_NUM:
+				{
+					kagg_state__pavg_num_packed *x = (void *)d;
+					kagg_state__pavg_num_packed *y = (void *)s;
+
+					if (!__kagg_pavg_num_update(x, y->sum, y->scale, y->dscale))
+						x->attrs |= KAGG_NUMERIC_ATTR__OVERFLOW;
+					x->nitems += y->nitems;
+					x->attrs |= y->attrs;
+				}
+				break;
+			case KAGG_ACTION__STDDEV:
+				{
+					kagg_state__stddev_packed *x = (void *)d;
+					kagg_state__stddev_packed *y = (void *)s;
+
+					x->nitems += y->nitems;
+					x->sum_x  += y->sum_x;
+					x->sum_x2 += y->sum_x2;
+				}
+				break;
+			case KAGG_ACTION__COVAR:
+				{
+					kagg_state__covar_packed *x = (void *)d;
+					kagg_state__covar_packed *y = (void *)s;
+
+					x->nitems += y->nitems;
+					x->sum_x  += y->sum_x;
+					x->sum_xx += y->sum_xx;
+					x->sum_y  += y->sum_y;
+					x->sum_yy += y->sum_yy;
+					x->sum_xy += y->sum_xy;
+				}
+				break;
+			case KAGG_ACTION__HLL:
+				{
+					uint8_t	   *x_regs = (uint8_t *)VARDATA(d);
+					uint8_t	   *y_regs = (uint8_t *)VARDATA(s);
+					uint32_t	nregs = VARSIZE(d) - VARHDRSZ;
+
+					for (uint32_t k=0; k < nregs; k++)
+						x_regs[k] = Max(x_regs[k], y_regs[k]);
+				}
+				break;
+			case KAGG_ACTION__QUANTILE:
+				{
+					kagg_state__quantile_packed *x = (void *)d;
+					kagg_state__quantile_packed *y = (void *)s;
+					uint32_t	nbuckets = pg_qsketch_nbuckets(desc->arg_option);
+
+					if (y->nitems == 0)
+						break;
+					if (x->nitems == 0)
+					{
+						x->min_value = y->min_value;
+						x->max_value = y->max_value;
+					}
+					else
+					{
+						x->min_value = Min(x->min_value, y->min_value);
+						x->max_value = Max(x->max_value, y->max_value);
+					}
+					for (uint32_t k=0; k < nbuckets; k++)
+						x->counters[k] += y->counters[k];
+					x->nitems += y->nitems;
+				}
+				break;
+			case KAGG_ACTION__PMIN_BYTES:
+			case KAGG_ACTION__PMAX_BYTES:
+				{
+					kagg_state__pminmax_bytes_packed *x = (void *)d;
+					kagg_state__pminmax_bytes_packed *y = (void *)s;
+
+					if ((y->attrs & KAGG_BYTES_ATTR__HAS_VALUE) != 0)
+						__kagg_pminmax_bytes_update(x, desc->arg_option,
+													y->value, y->length,
+													(y->attrs & KAGG_BYTES_ATTR__TRUNCATED) != 0,
+													desc->action == KAGG_ACTION__PMIN_BYTES);
+					x->nitems += y->nitems;
+				}
+				break;
+			case KAGG_ACTION__PBITAND:
+			case KAGG_ACTION__PBITOR:
+				{
+					kagg_state__pminmax_int64_packed *x = (void *)d;
+					kagg_state__pminmax_int64_packed *y = (void *)s;
+
+					if (y->nitems == 0)
+						break;
+					if (desc->action == KAGG_ACTION__PBITAND)
+						x->value &= y->value;
+					else
+						x->value |= y->value;
+					x->nitems += y->nitems;
+				}
+				break;
+			default:
+				/* grouping keys */
+				break;
+		}
+	}
+}
+
+/*
+ * mergeGroupBySpillPartition
+ *
+ * It merges the hash-items in the spill file, then writes back the results
+ * to the file as KDS_FORMAT_ROW, to be sent by mmap.
+ *
+ * NOTE: this function must be called under kds_final_rwlock WRITE-LOCK
+ */
+static bool
+mergeGroupBySpillPartition(groupby_final_buffer *gf_buf, int part,
+						   kern_expression *kexp_groupby_actions)
+{
+	groupby_spill_partition *sp = gf_buf->spill_parts[part];
+	kern_data_store *kds_head = gf_buf->kds_final;
+	kern_data_store *kds_merged = NULL;
+	char	   *mmap_addr;
+	char	  **d_values;
+	char	  **s_values;
+	uint32_t   *rowindex;
+	size_t		length;
+	size_t		pos;
+	size_t		sz1, sz2, sz3;
+	uint32_t	nitems = 0;
+	bool		retval = false;
+
+	if (!flushGroupBySpillBuffer(gf_buf, part))
+		return false;
+	free(sp->kds_buf);
+	sp->kds_buf = NULL;
+	if (sp->file_sz == 0)
+		return true;
+
+	mmap_addr = mmap(NULL, sp->file_sz, PROT_READ, MAP_SHARED, sp->fdesc, 0);
+	if (mmap_addr == MAP_FAILED)
+	{
+		fprintf(stderr, "failed on mmap of the spill file: %m\n");
+		return false;
+	}
+	for (pos = 0; pos < sp->file_sz; nitems++)
+	{
+		kern_hashitem *hitem = (kern_hashitem *)(mmap_addr + pos);
+
+		pos += MAXALIGN(offsetof(kern_hashitem, t.htup) + hitem->t.t_len);
+	}
+	/* merged results never exceed the spilled hash-items */
+	length = (KDS_HEAD_LENGTH(kds_head) +
+			  MAXALIGN(sizeof(uint32_t) * 2 * nitems) + sp->file_sz);
+	kds_merged = __allocGroupByHashBuffer(kds_head, length, nitems);
+	if (!kds_merged)
+		goto bailout;
+	d_values = alloca(sizeof(char *) * kds_head->ncols);
+	s_values = alloca(sizeof(char *) * kds_head->ncols);
+	for (pos = 0; pos < sp->file_sz; )
+	{
+		kern_hashitem *hitem = (kern_hashitem *)(mmap_addr + pos);
+		kern_hashitem *curr;
+		uint32_t	   *hslot = KDS_GET_HASHSLOT(kds_merged, hitem->hash);
+
+		pos += MAXALIGN(offsetof(kern_hashitem, t.htup) + hitem->t.t_len);
+		__deformPreAggTuple(kds_merged, &hitem->t.htup, s_values);
+		for (curr = KDS_HASH_NEXT_ITEM(kds_merged, *hslot);
+			 curr != NULL;
+			 curr = KDS_HASH_NEXT_ITEM(kds_merged, curr->next))
+		{
+			if (curr->hash != hitem->hash)
+				continue;
+			__deformPreAggTuple(kds_merged, &curr->t.htup, d_values);
+			if (__equalPreAggKeys(kds_merged, kexp_groupby_actions,
+								  d_values, s_values))
+				break;
+		}
+		if (curr)
+			__mergeOneTupleDpuPreAgg(kds_merged, kexp_groupby_actions,
+									 d_values, s_values);
+		else if (!__appendGroupByHashItem(kds_merged, hitem))
+			goto bailout;	/* should not happen */
+	}
+	munmap(mmap_addr, sp->file_sz);
+	mmap_addr = NULL;
+
+	/* write back the merged results as KDS_FORMAT_ROW */
+	rowindex = KDS_GET_ROWINDEX(kds_merged);
+	sz1 = KDS_HEAD_LENGTH(kds_merged);
+	sz2 = MAXALIGN(sizeof(uint32_t) * kds_merged->nitems);
+	sz3 = __kds_unpack(kds_merged->usage);
+	if (ftruncate(sp->fdesc, 0) != 0 ||
+		lseek(sp->fdesc, 0, SEEK_SET) != 0)
+	{
+		fprintf(stderr, "failed on truncation of the spill file: %m\n");
+		goto bailout;
+	}
+	sp->file_sz = 0;
+	kds_merged->format = KDS_FORMAT_ROW;
+	kds_merged->hash_nslots = 0;
+	kds_merged->length = sz1 + sz2 + sz3;
+	if (!__writeGroupBySpillFile(sp, kds_merged, sz1) ||
+		!__writeGroupBySpillFile(sp, rowindex, sz2) ||
+		!__writeGroupBySpillFile(sp, (char *)kds_merged + length - sz3, sz3))
+		goto bailout;
+	sp->kds_merged = mmap(NULL, sp->file_sz, PROT_READ, MAP_SHARED, sp->fdesc, 0);
+	if (sp->kds_merged == MAP_FAILED)
+	{
+		fprintf(stderr, "failed on mmap of the spill file: %m\n");
+		sp->kds_merged = NULL;
+		goto bailout;
+	}
+	sp->merged_sz = sp->file_sz;
+	retval = true;
+bailout:
+	if (mmap_addr)
+		munmap(mmap_addr, sp->file_sz);
+	if (kds_merged)
+		free(kds_merged);
+	return retval;
 }
 
 /*
@@ -2343,11 +3655,13 @@ dpuservHandleDpuTaskFinal(dpuClient *dclient, XpuCommand *xcmd)
 	struct iovec   *iov;
 	int				iovcnt = 0;
 	bool			gf_buf_locked = false;
+	kern_data_store *kds_topn = NULL;
 	size_t			resp_sz;
 
 	/* iovec allocation */
 	iovec_array = alloca(sizeof(struct iovec) *
-						 ((kmrels ? kmrels->num_rels : 0) + 8));
+						 ((kmrels ? kmrels->num_rels : 0) +
+						  GROUPBY_SPILL_NPARTS + 8));
 	/* Xcmd for the response */
 	memset(&resp, 0, sizeof(XpuCommand));
 	resp_sz = MAXALIGN(offsetof(XpuCommand, u.results.stats));
@@ -2395,12 +3709,26 @@ dpuservHandleDpuTaskFinal(dpuClient *dclient, XpuCommand *xcmd)
 	 */
 	if (xcmd->u.fin.final_plan_node && gf_buf)
 	{
+		kern_expression *kexp_groupby_actions
+			= SESSION_KEXP_GROUPBY_ACTIONS(dclient->session);
 		kern_data_store *kds_final;
 		size_t		sz1, sz2, sz3;
 
-		pthreadRWLockReadLock(&gf_buf->kds_final_rwlock);
+		pthreadRWLockWriteLock(&gf_buf->kds_final_rwlock);
 		gf_buf_locked = true;
 
+		/* merge the spilled partitions prior to the fixup of kds_final */
+		for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+		{
+			if ((gf_buf->spill_mask & (1U<<k)) == 0)
+				continue;
+			if (!mergeGroupBySpillPartition(gf_buf, k, kexp_groupby_actions))
+			{
+				pthreadRWLockUnlock(&gf_buf->kds_final_rwlock);
+				dpuClientElog(dclient, "failed on merge of the spilled GROUP BY partition");
+				return;
+			}
+		}
 		kds_final = gf_buf->kds_final;
 		if (kds_final->format == KDS_FORMAT_HASH)
 		{
@@ -2456,12 +3784,58 @@ dpuservHandleDpuTaskFinal(dpuClient *dclient, XpuCommand *xcmd)
 		resp.u.results.chunks_nitems = 1;
 		resp.u.results.chunks_offset = resp_sz;
 		resp_sz += kds_final->length;
+
+		/* merged results of the spilled partitions follow kds_final */
+		for (int k=0; k < GROUPBY_SPILL_NPARTS; k++)
+		{
+			groupby_spill_partition *sp = gf_buf->spill_parts[k];
+
+			if (!sp || !sp->kds_merged)
+				continue;
+			iov = &iovec_array[iovcnt++];
+			iov->iov_base = sp->kds_merged;
+			iov->iov_len  = sp->merged_sz;
+			resp.u.results.chunks_nitems++;
+			resp_sz += sp->merged_sz;
+		}
+	}
+
+	/*
+	 * Top-N results buffer, if any
+	 */
+	if (dclient->topn_buf)
+	{
+		bool	ok;
+
+		pthreadMutexLock(&dclient->topn_lock);
+		ok = xpuTopNBufferFinal(dclient->topn_buf, &kds_topn);
+		pthreadMutexUnlock(&dclient->topn_lock);
+		if (!ok)
+		{
+			if (gf_buf_locked)
+				pthreadRWLockUnlock(&gf_buf->kds_final_rwlock);
+			dpuClientElog(dclient, "out of memory on the Top-N buffer");
+			return;
+		}
+		if (kds_topn)
+		{
+			assert(resp.u.results.chunks_nitems == 0);
+			iov = &iovec_array[iovcnt++];
+			iov->iov_base = kds_topn;
+			iov->iov_len  = kds_topn->length;
+			resp.u.results.chunks_nitems = 1;
+			resp.u.results.chunks_offset = resp_sz;
+			resp_sz += kds_topn->length;
+		}
+		resp.u.results.final_plan_node = xcmd->u.fin.final_plan_node;
 	}
 	resp.length = resp_sz;
 	__dpuClientWriteBack(dclient, iovec_array, iovcnt);
 
 	if (gf_buf_locked)
 		pthreadRWLockUnlock(&gf_buf->kds_final_rwlock);
+	if (kds_topn)
+		free(kds_topn);
 }
 
 /*
@@ -2503,6 +3877,8 @@ putDpuClient(dpuClient *dclient, int count)
 			free(xcmd);
 		}
 		dpuServUnmapSessionBuffers(dclient);
+		if (dclient->topn_buf)
+			xpuTopNBufferRelease(dclient->topn_buf);
 		close(dclient->sockfd);
 		free(dclient);
 	}
@@ -2611,6 +3987,12 @@ __dpuServAttachCommand(void *__priv, XpuCommand *xcmd)
 	pthreadMutexUnlock(&dpu_command_mutex);
 }
 
+static void
+__dpuServFreeCommand(void *__priv, XpuCommand *xcmd)
+{
+	free(xcmd);
+}
+
 TEMPLATE_XPU_CONNECT_RECEIVE_COMMANDS(__dpuServ)
 
 static void *
@@ -2753,6 +4135,7 @@ dpuserv_main(struct sockaddr *addr, socklen_t addr_len)
 						__Elog("out of memory: %m");
 					dclient->refcnt = 1;
 					pthreadMutexInit(&dclient->mutex);
+					pthreadMutexInit(&dclient->topn_lock);
 					dclient->sockfd = client_fd;
 					if (peer.addr.sa_family == AF_INET)
 					{
@@ -2844,6 +4227,8 @@ main(int argc, char *argv[])
 		{"nworkers",   required_argument, 0, 'n'},
 		{"identifier", required_argument, 0, 'i'},
 		{"log",        required_argument, 0, 'l'},
+		{"spill-dir",  required_argument, 0, 's'},
+		{"groupby-mem-limit", required_argument, 0, 'm'},
 		{"verbose",    no_argument,       0, 'v'},
 		{"help",       no_argument,       0, 'h'},
 		{NULL, 0, 0, 0},
@@ -2861,7 +4246,7 @@ main(int argc, char *argv[])
 	/* parse command line options */
 	for (;;)
 	{
-		int		c = getopt_long(argc, argv, "a:p:d:n:i:l:vh",
+		int		c = getopt_long(argc, argv, "a:p:d:n:i:l:s:m:vh",
 								command_options, NULL);
 		char   *end;
 
@@ -2913,6 +4298,24 @@ main(int argc, char *argv[])
 					__Elog("-l|--log option was given twice");
 				dpuserv_logfile = optarg;
 				break;
+
+			case 's':
+				if (dpuserv_spill_directory)
+					__Elog("-s|--spill-dir option was given twice");
+				dpuserv_spill_directory = optarg;
+				break;
+
+			case 'm':
+				if (dpuserv_groupby_mem_limit >= 0)
+					__Elog("-m|--groupby-mem-limit option was given twice");
+				dpuserv_groupby_mem_limit = strtol(optarg, &end, 10);
+				if (*optarg == '\0' || *end != '\0')
+					__Elog("GROUP BY memory limit [%s] is not valid", optarg);
+				if (dpuserv_groupby_mem_limit < 1)
+					__Elog("GROUP BY memory limit %ldMB is out of range",
+						   dpuserv_groupby_mem_limit);
+				dpuserv_groupby_mem_limit <<= 20;
+				break;
 				
 			case 'v':
 				verbose = true;
@@ -2924,6 +4327,9 @@ main(int argc, char *argv[])
 					  "\t-d|--directory=DIR       tablespace base (default: .)\n"
 					  "\t-n|--nworkers=N_WORKERS  number of workers (default: auto)\n"
 					  "\t-i|--identifier=IDENT    security identifier\n"
+					  "\t-s|--spill-dir=DIR       GROUP BY spill directory (default: .)\n"
+					  "\t-m|--groupby-mem-limit=MB\n"
+					  "\t                         GROUP BY buffer size limit (default: 25% of RAM)\n"
 					  "\t-v|--verbose             verbose output\n"
 					  "\t-h|--help                shows this message\n",
 					  stderr);
@@ -2937,6 +4343,12 @@ main(int argc, char *argv[])
 		dpuserv_base_directory = ".";
 	if (dpuserv_num_workers < 0)
 		dpuserv_num_workers = Max(4 * sysconf(_SC_NPROCESSORS_ONLN), 20);
+	/* relative to the base directory, because of chdir() below */
+	if (!dpuserv_spill_directory)
+		dpuserv_spill_directory = ".";
+	if (dpuserv_groupby_mem_limit < 0)
+		dpuserv_groupby_mem_limit = (sysconf(_SC_PHYS_PAGES) *
+									 sysconf(_SC_PAGESIZE)) / 4;
 	if (dpuserv_logfile)
 	{
 		FILE   *stdlog;
@@ -25,6 +25,19 @@ double		pgstrom_dpu_operator_cost = DEFAULT_DPU_OPERATOR_COST;	/* GUC */
 double		pgstrom_dpu_seq_page_cost = DEFAULT_DPU_SEQ_PAGE_COST;	/* GUC */
 double		pgstrom_dpu_tuple_cost    = DEFAULT_DPU_TUPLE_COST;		/* GUC */
 bool		pgstrom_dpu_handle_cached_pages = false;	/* GUC */
+int			pgstrom_dpu_wire_compression = XPU_WIRE_COMPRESSION__NONE;	/* GUC */
+int			pgstrom_dpu_wire_compression_threshold_kb = 64;	/* GUC */
+
+static const struct config_enum_entry dpu_wire_compression_options[] = {
+	{"none",	XPU_WIRE_COMPRESSION__NONE,	false},
+#ifdef USE_LZ4
+	{"lz4",		XPU_WIRE_COMPRESSION__LZ4,	false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd",	XPU_WIRE_COMPRESSION__ZSTD,	false},
+#endif
+	{NULL, 0, false}
+};
 
 struct DpuStorageEntry
 {
@@ -327,7 +340,14 @@ DpuClientOpenSession(pgstromTaskState *pts,
 	}
 	snprintf(namebuf, sizeof(namebuf), "DPU-%u", ds_entry->endpoint_id);
 
-	__xpuClientOpenSession(pts, session, sockfd, namebuf, ds_entry->endpoint_id);
+	/*
+	 * The shared-memory ring is not used for DPU. It passes the memfd with
+	 * SCM_RIGHTS, so needs an AF_UNIX socket on the same host, however, DPU
+	 * endpoints are always TCP (see parse_dpu_endpoint_list), and dpuserv
+	 * usually runs on the SmartNIC side, across the PCIe bus.
+	 */
+	__xpuClientOpenSession(pts, session, sockfd, namebuf,
+						   ds_entry->endpoint_id, false);
 }
 
 /*
@@ -553,6 +573,26 @@ pgstrom_init_dpu_options(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* wire compression of the DPU sessions */
+	DefineCustomEnumVariable("pg_strom.dpu_wire_compression",
+							 "Compression method of XpuCommand on the network to DPUs",
+							 NULL,
+							 &pgstrom_dpu_wire_compression,
+							 XPU_WIRE_COMPRESSION__NONE,
+							 dpu_wire_compression_options,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.dpu_wire_compression_threshold",
+							"Min length of XpuCommand to be compressed on the network to DPUs",
+							NULL,
+							&pgstrom_dpu_wire_compression_threshold_kb,
+							64,
+							0,
+							1024 * 1024,	/* 1GB */
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 }
 
 /*
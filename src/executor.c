@@ -11,10 +11,17 @@
  */
 #include "pg_strom.h"
 #include "cuda_common.h"
+#include <linux/futex.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 
 /*
  * XpuConnection
  */
+#define XPU_FLOWCTL_NSLOTS			512
+#define XPU_FLOWCTL_MIN_SAMPLES		4
+#define XPU_FLOWCTL_EWMA_WEIGHT		0.25
+
 struct XpuConnection
 {
 	dlist_node		chain;	/* link to gpuserv_connection_slots */
@@ -30,7 +37,24 @@ struct XpuConnection
 	int				num_ready_cmds;
 	dlist_head		ready_cmds_list;	/* ready, but not fetched yet  */
 	dlist_head		active_cmds_list;	/* currently in-use */
+	xpuShmRing	   *shmring;		/* shared-memory ring, if local service */
+	xpuWireCompressor wcomp;		/* wire compression, if remote DPU */
 	kern_errorbuf	errorbuf;
+	/* statistics for the adaptive flow control */
+	uint32_t		nsamples;
+	double			ewma_latency_us;	/* send -> arrival */
+	double			ewma_interval_us;	/* arrival interval on busy device */
+	double			ewma_qwait_us;		/* arrival -> pickup by the backend */
+	double			ewma_result_sz;		/* length of the response */
+	uint64_t		last_arrival_us;
+	bool			last_arrival_busy;	/* device was still busy at the last
+										 * arrival */
+	uint32_t		send_ts_head;
+	uint32_t		send_ts_count;
+	uint64_t		send_ts[XPU_FLOWCTL_NSLOTS];	/* send time of running cmds */
+	uint32_t		ready_ts_head;
+	uint32_t		ready_ts_count;
+	uint64_t		ready_ts[XPU_FLOWCTL_NSLOTS];	/* arrival time of ready cmds */
 };
 
 /* see xact.c */
@@ -39,6 +63,646 @@ extern TransactionId   *ParallelCurrentXids;
 
 /* static variables */
 static dlist_head		xpu_connections_list;
+static int			pgstrom_virtual_tuple_threshold;	/* GUC */
+static int			pgstrom_xpu_shmring_size_kb;		/* GUC */
+static int			pgstrom_xpu_inflight_mem_limit_kb;	/* GUC */
+static bool			pgstrom_xpu_mvcc_checks;			/* GUC */
+static int			pgstrom_xpu_mvcc_clog_xids;			/* GUC */
+static int			pgstrom_xpu_async_prefetch;			/* GUC */
+
+/* ----------------------------------------------------------------
+ *
+ * Shared-memory ring transport
+ *
+ * If xPU service runs on the same host (GPU-Service), the backend creates
+ * a memfd segment that contains two rings (one for requests, one for the
+ * responses) and two eventfds as doorbell, then passes them to the service
+ * using SCM_RIGHTS at the head of the connection.
+ * Once the ring is set up, XpuCommands are written onto the ring and the
+ * peer side picks them up by offset, so the socket is used only for the
+ * handshake and the commands too large for the ring.
+ * Producer waits for the free space of the ring using futex.
+ *
+ * ----------------------------------------------------------------
+ */
+#define XPU_SHMRING_MAGIC			0x52494e47U		/* 'RING' */
+#define XPU_SHMRING_ITEM__SKIP		0x0001
+#define XPU_SHMRING_ITEM__RELEASED	0x0002
+#define XPU_SHMRING_WAIT_TIMEOUT	100				/* ms */
+
+typedef struct
+{
+	uint32_t		magic;
+	uint32_t		nfds;		/* 0 (no ring) or 3 (memfd + 2 eventfds) */
+	uint64_t		ring_size;	/* length of the individual rings */
+} xpuShmRingHandshake;
+
+typedef struct
+{
+	pg_atomic_uint64 wpos;		/* bytes written by the producer */
+	pg_atomic_uint64 rpos;		/* bytes fetched by the consumer */
+	pg_atomic_uint64 fpos;		/* bytes released by the consumer */
+	pg_atomic_uint32 futex;		/* sequence number to wake up the producer */
+	uint32_t		__padding;
+} xpuShmRingCtl;
+
+typedef struct
+{
+	uint32_t		magic;
+	uint32_t		__padding;
+	uint64_t		ring_size;
+	xpuShmRingCtl	ctl[2];		/* [0] backend -> service,
+								 * [1] service -> backend */
+} xpuShmRingHead;
+
+typedef struct
+{
+	uint64_t		length;		/* length of this item, including header */
+	pg_atomic_uint32 flags;		/* mask of XPU_SHMRING_ITEM__* */
+	uint32_t		__padding;
+	char			data[FLEXIBLE_ARRAY_MEMBER];	/* XpuCommand */
+} xpuShmRingItem;
+
+#define XPU_SHMRING_ALIGN(LEN)		TYPEALIGN(16,(LEN))
+
+struct xpuShmRing
+{
+	int				memfd;
+	int				efd_send;	/* doorbell to the peer */
+	int				efd_recv;	/* doorbell from the peer */
+	xpuShmRingHead *head;
+	size_t			mmap_sz;
+	uint64_t		ring_size;
+	xpuShmRingCtl  *send_ctl;
+	char		   *send_base;
+	xpuShmRingCtl  *recv_ctl;
+	char		   *recv_base;
+	pthread_mutex_t	release_lock;
+};
+
+static inline void
+__xpuShmRingFutexWait(pg_atomic_uint32 *futex, uint32_t seq)
+{
+	struct timespec	ts;
+
+	ts.tv_sec  = XPU_SHMRING_WAIT_TIMEOUT / 1000;
+	ts.tv_nsec = (XPU_SHMRING_WAIT_TIMEOUT % 1000) * 1000000L;
+	syscall(SYS_futex, &futex->value, FUTEX_WAIT, seq, &ts, NULL, 0);
+}
+
+static inline void
+__xpuShmRingFutexWake(pg_atomic_uint32 *futex)
+{
+	pg_atomic_fetch_add_u32(futex, 1);
+	syscall(SYS_futex, &futex->value, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static xpuShmRing *
+__xpuShmRingMap(int memfd, int efd_send, int efd_recv,
+				uint64_t ring_size, bool is_backend)
+{
+	xpuShmRing *ring;
+	size_t		head_sz = PAGE_ALIGN(sizeof(xpuShmRingHead));
+	void	   *addr;
+
+	ring = calloc(1, sizeof(xpuShmRing));
+	if (!ring)
+		return NULL;
+	ring->mmap_sz = head_sz + 2 * ring_size;
+	addr = mmap(NULL, ring->mmap_sz,
+				PROT_READ | PROT_WRITE,
+				MAP_SHARED,
+				memfd, 0);
+	if (addr == MAP_FAILED)
+	{
+		free(ring);
+		return NULL;
+	}
+	ring->memfd = memfd;
+	ring->efd_send = efd_send;
+	ring->efd_recv = efd_recv;
+	ring->head = (xpuShmRingHead *)addr;
+	ring->ring_size = ring_size;
+	if (is_backend)
+	{
+		ring->send_ctl  = &ring->head->ctl[0];
+		ring->send_base = (char *)addr + head_sz;
+		ring->recv_ctl  = &ring->head->ctl[1];
+		ring->recv_base = (char *)addr + head_sz + ring_size;
+	}
+	else
+	{
+		ring->send_ctl  = &ring->head->ctl[1];
+		ring->send_base = (char *)addr + head_sz + ring_size;
+		ring->recv_ctl  = &ring->head->ctl[0];
+		ring->recv_base = (char *)addr + head_sz;
+	}
+	pthreadMutexInit(&ring->release_lock);
+	return ring;
+}
+
+/*
+ * xpuShmRingCreate
+ *
+ * It sends the handshake message at the head of the connection to the local
+ * xPU service, with a new shared-memory ring if ring_size > 0.
+ * It returns false with errno on errors.
+ */
+bool
+xpuShmRingCreate(pgsocket sockfd, size_t ring_size, xpuShmRing **p_shmring)
+{
+	xpuShmRingHandshake hs;
+	xpuShmRing	   *ring = NULL;
+	int				fdesc[3] = {-1, -1, -1};
+	union {
+		struct cmsghdr	cmsg;
+		char			buf[CMSG_SPACE(sizeof(fdesc))];
+	}				cmsg_buf;
+	struct msghdr	msg;
+	struct iovec	iov;
+	int				errno_saved;
+
+	memset(&hs, 0, sizeof(hs));
+	hs.magic = XPU_SHMRING_MAGIC;
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &hs;
+	iov.iov_len  = sizeof(hs);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	ring_size = XPU_SHMRING_ALIGN(ring_size);
+	if (ring_size > 0)
+	{
+		size_t		head_sz = PAGE_ALIGN(sizeof(xpuShmRingHead));
+		struct cmsghdr *cmsg;
+
+		fdesc[0] = memfd_create("pg_strom_xpu_shmring", MFD_CLOEXEC);
+		if (fdesc[0] < 0)
+			goto error;
+		if (ftruncate(fdesc[0], head_sz + 2 * ring_size) != 0)
+			goto error;
+		fdesc[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fdesc[1] < 0)
+			goto error;
+		fdesc[2] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fdesc[2] < 0)
+			goto error;
+		/* fdesc[1] rings the service, fdesc[2] rings the backend */
+		ring = __xpuShmRingMap(fdesc[0], fdesc[1], fdesc[2], ring_size, true);
+		if (!ring)
+			goto error;
+		ring->head->magic = XPU_SHMRING_MAGIC;
+		ring->head->ring_size = ring_size;
+		for (int i=0; i < 2; i++)
+		{
+			xpuShmRingCtl *ctl = &ring->head->ctl[i];
+
+			pg_atomic_init_u64(&ctl->wpos, 0);
+			pg_atomic_init_u64(&ctl->rpos, 0);
+			pg_atomic_init_u64(&ctl->fpos, 0);
+			pg_atomic_init_u32(&ctl->futex, 0);
+		}
+		hs.nfds = 3;
+		hs.ring_size = ring_size;
+
+		memset(&cmsg_buf, 0, sizeof(cmsg_buf));
+		msg.msg_control = cmsg_buf.buf;
+		msg.msg_controllen = sizeof(cmsg_buf.buf);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(fdesc));
+		memcpy(CMSG_DATA(cmsg), fdesc, sizeof(fdesc));
+	}
+
+	for (;;)
+	{
+		if (sendmsg(sockfd, &msg, 0) == sizeof(hs))
+			break;
+		if (errno != EINTR)
+			goto error;
+	}
+	*p_shmring = ring;
+	return true;
+
+error:
+	errno_saved = errno;
+	if (ring)
+		xpuShmRingClose(ring);
+	else
+	{
+		for (int i=0; i < 3; i++)
+		{
+			if (fdesc[i] >= 0)
+				close(fdesc[i]);
+		}
+	}
+	errno = errno_saved;
+	return false;
+}
+
+/*
+ * xpuShmRingAccept
+ *
+ * It receives the handshake message at the head of the connection, then
+ * maps the shared-memory ring if any. *p_shmring is NULL if backend does not
+ * use the ring.
+ */
+bool
+xpuShmRingAccept(pgsocket sockfd, xpuShmRing **p_shmring, const char *elabel)
+{
+	xpuShmRingHandshake hs;
+	xpuShmRing	   *ring;
+	int				fdesc[3] = {-1, -1, -1};
+	union {
+		struct cmsghdr	cmsg;
+		char			buf[CMSG_SPACE(sizeof(fdesc))];
+	}				cmsg_buf;
+	struct cmsghdr *cmsg;
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct stat		stat_buf;
+	ssize_t			nbytes;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &hs;
+	iov.iov_len  = sizeof(hs);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsg_buf.buf;
+	msg.msg_controllen = sizeof(cmsg_buf.buf);
+	do {
+		nbytes = recvmsg(sockfd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+	} while (nbytes < 0 && errno == EINTR);
+	if (nbytes != sizeof(hs))
+	{
+		fprintf(stderr, "[%s] failed on recvmsg(2) of the handshake: %m\n", elabel);
+		return false;
+	}
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+			cmsg->cmsg_type == SCM_RIGHTS &&
+			cmsg->cmsg_len == CMSG_LEN(sizeof(fdesc)))
+			memcpy(fdesc, CMSG_DATA(cmsg), sizeof(fdesc));
+	}
+	if (hs.magic != XPU_SHMRING_MAGIC ||
+		(hs.nfds != 0 && hs.nfds != 3) ||
+		(hs.nfds == 3 && (fdesc[0] < 0 || fdesc[1] < 0 || fdesc[2] < 0)))
+	{
+		fprintf(stderr, "[%s] corrupted handshake message\n", elabel);
+		goto error;
+	}
+	if (hs.nfds == 0)
+	{
+		*p_shmring = NULL;
+		return true;
+	}
+	if (fstat(fdesc[0], &stat_buf) != 0 ||
+		stat_buf.st_size != PAGE_ALIGN(sizeof(xpuShmRingHead)) + 2 * hs.ring_size)
+	{
+		fprintf(stderr, "[%s] shared-memory ring has unexpected length\n", elabel);
+		goto error;
+	}
+	ring = __xpuShmRingMap(fdesc[0], fdesc[2], fdesc[1], hs.ring_size, false);
+	if (!ring)
+	{
+		fprintf(stderr, "[%s] failed on mmap of the shared-memory ring: %m\n", elabel);
+		goto error;
+	}
+	if (ring->head->magic != XPU_SHMRING_MAGIC ||
+		ring->head->ring_size != hs.ring_size)
+	{
+		fprintf(stderr, "[%s] shared-memory ring is corrupted\n", elabel);
+		xpuShmRingClose(ring);
+		return false;
+	}
+	*p_shmring = ring;
+	return true;
+
+error:
+	for (int i=0; i < 3; i++)
+	{
+		if (fdesc[i] >= 0)
+			close(fdesc[i]);
+	}
+	return false;
+}
+
+/*
+ * xpuShmRingEventFd - returns the doorbell to be polled by the consumer
+ */
+int
+xpuShmRingEventFd(xpuShmRing *ring)
+{
+	return ring->efd_recv;
+}
+
+static inline size_t
+__xpuShmRingMessageLength(const struct iovec *iov, int iovcnt)
+{
+	size_t		total = 0;
+
+	for (int i=0; i < iovcnt; i++)
+		total += iov[i].iov_len;
+	return XPU_SHMRING_ALIGN(offsetof(xpuShmRingItem, data) + total);
+}
+
+/*
+ * __xpuShmRingHasSpace
+ *
+ * It checks whether the message of @len can be written without waiting.
+ * If the message is too large for the ring, it checks whether the peer
+ * already fetched all the messages on the ring.
+ */
+static bool
+__xpuShmRingHasSpace(xpuShmRing *ring, size_t len)
+{
+	xpuShmRingCtl  *ctl = ring->send_ctl;
+	uint64_t		wpos = pg_atomic_read_u64(&ctl->wpos);
+	uint64_t		offset = wpos % ring->ring_size;
+	uint64_t		skip = 0;
+
+	if (len > ring->ring_size / 2)
+		return (pg_atomic_read_u64(&ctl->rpos) == wpos);
+	if (offset + len > ring->ring_size)
+		skip = ring->ring_size - offset;
+	return (wpos + skip + len - pg_atomic_read_u64(&ctl->fpos) <= ring->ring_size);
+}
+
+static void
+__xpuShmRingWrite(xpuShmRing *ring,
+				  const struct iovec *iov, int iovcnt, size_t len)
+{
+	xpuShmRingCtl  *ctl = ring->send_ctl;
+	xpuShmRingItem *item;
+	uint64_t		wpos = pg_atomic_read_u64(&ctl->wpos);
+	uint64_t		offset = wpos % ring->ring_size;
+	uint64_t		skip = 0;
+	char		   *pos;
+
+	if (offset + len > ring->ring_size)
+		skip = ring->ring_size - offset;
+	/* dummy item to wrap around */
+	if (skip > 0)
+	{
+		item = (xpuShmRingItem *)(ring->send_base + offset);
+		item->length = skip;
+		pg_atomic_init_u32(&item->flags, XPU_SHMRING_ITEM__SKIP);
+		offset = 0;
+	}
+	item = (xpuShmRingItem *)(ring->send_base + offset);
+	item->length = len;
+	pg_atomic_init_u32(&item->flags, 0);
+	pos = item->data;
+	for (int i=0; i < iovcnt; i++)
+	{
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	pg_write_barrier();
+	pg_atomic_write_u64(&ctl->wpos, wpos + skip + len);
+	/* ring the doorbell */
+	{
+		uint64_t	ev = 1;
+
+		while (write(ring->efd_send, &ev, sizeof(ev)) < 0 && errno == EINTR);
+	}
+}
+
+/*
+ * xpuShmRingWaitSpace
+ *
+ * It waits until the message can be written by xpuShmRingTrySend() without
+ * waiting; that means enough free space on the ring, or all the messages
+ * on the ring are fetched if the message is larger than half of the ring.
+ * Caller should not hold the lock that serializes the senders, because
+ * it may take long time. It returns false if check_alive() told the peer
+ * is gone.
+ */
+bool
+xpuShmRingWaitSpace(xpuShmRing *ring,
+					const struct iovec *iov, int iovcnt,
+					bool (*check_alive)(void *arg), void *arg)
+{
+	xpuShmRingCtl  *ctl = ring->send_ctl;
+	size_t			len = __xpuShmRingMessageLength(iov, iovcnt);
+
+	for (;;)
+	{
+		uint32_t	seq = pg_atomic_read_u32(&ctl->futex);
+
+		if (__xpuShmRingHasSpace(ring, len))
+			return true;
+		__xpuShmRingFutexWait(&ctl->futex, seq);
+		if (!check_alive(arg))
+			return false;
+	}
+}
+
+/*
+ * xpuShmRingTrySend
+ *
+ * It writes out the iovec onto the ring without waiting. It returns 1 on
+ * success, 0 if the message is larger than half of the ring and all the
+ * messages on the ring are already fetched (caller has to send it by the
+ * socket), or -1 if it needs to wait by xpuShmRingWaitSpace().
+ * Only one thread can send messages at the same time.
+ */
+int
+xpuShmRingTrySend(xpuShmRing *ring, const struct iovec *iov, int iovcnt)
+{
+	size_t		len = __xpuShmRingMessageLength(iov, iovcnt);
+
+	if (!__xpuShmRingHasSpace(ring, len))
+		return -1;
+	if (len > ring->ring_size / 2)
+		return 0;
+	__xpuShmRingWrite(ring, iov, iovcnt, len);
+	return 1;
+}
+
+/*
+ * xpuShmRingSend
+ *
+ * It writes out the iovec onto the ring. It returns 1 on success, 0 if the
+ * message is larger than half of the ring (caller has to send it by the
+ * socket after xpuShmRingDrain), or -1 if check_alive() told the peer is
+ * gone. Only one thread can send messages at the same time.
+ */
+int
+xpuShmRingSend(xpuShmRing *ring,
+			   const struct iovec *iov, int iovcnt,
+			   bool (*check_alive)(void *arg), void *arg)
+{
+	size_t		len = __xpuShmRingMessageLength(iov, iovcnt);
+
+	if (len > ring->ring_size / 2)
+		return 0;
+	if (!xpuShmRingWaitSpace(ring, iov, iovcnt, check_alive, arg))
+		return -1;
+	__xpuShmRingWrite(ring, iov, iovcnt, len);
+	return 1;
+}
+
+/*
+ * xpuShmRingDrain
+ *
+ * It waits for the peer to fetch all the messages on the ring, to keep
+ * the order of the messages to be sent by the socket.
+ */
+bool
+xpuShmRingDrain(xpuShmRing *ring,
+				bool (*check_alive)(void *arg), void *arg)
+{
+	xpuShmRingCtl  *ctl = ring->send_ctl;
+
+	for (;;)
+	{
+		uint32_t	seq = pg_atomic_read_u32(&ctl->futex);
+
+		if (pg_atomic_read_u64(&ctl->rpos) == pg_atomic_read_u64(&ctl->wpos))
+			return true;
+		__xpuShmRingFutexWait(&ctl->futex, seq);
+		if (!check_alive(arg))
+			return false;
+	}
+}
+
+/*
+ * __xpuShmRingSweep - advance fpos over the released items
+ */
+static void
+__xpuShmRingSweep(xpuShmRing *ring)
+{
+	xpuShmRingCtl  *ctl = ring->recv_ctl;
+	uint64_t		fpos;
+	uint64_t		rpos;
+
+	pthreadMutexLock(&ring->release_lock);
+	fpos = pg_atomic_read_u64(&ctl->fpos);
+	rpos = pg_atomic_read_u64(&ctl->rpos);
+	while (fpos < rpos)
+	{
+		xpuShmRingItem *item = (xpuShmRingItem *)
+			(ring->recv_base + fpos % ring->ring_size);
+
+		if ((pg_atomic_read_u32(&item->flags) & XPU_SHMRING_ITEM__RELEASED) == 0)
+			break;
+		fpos += item->length;
+	}
+	pg_atomic_write_u64(&ctl->fpos, fpos);
+	pthreadMutexUnlock(&ring->release_lock);
+	__xpuShmRingFutexWake(&ctl->futex);
+}
+
+/*
+ * xpuShmRingReceive
+ *
+ * It picks up the XpuCommands on the ring. If alloc_f is given, XpuCommand
+ * is copied to the buffer allocated by alloc_f, and the ring item is released
+ * immediately. Elsewhere, attach_f receives the XpuCommand on the ring as is,
+ * then it shall be released by xpuShmRingRelease().
+ */
+int
+xpuShmRingReceive(xpuShmRing *ring,
+				  void *(*alloc_f)(void *priv, size_t sz),
+				  void  (*attach_f)(void *priv, XpuCommand *xcmd),
+				  void *priv,
+				  const char *error_label)
+{
+	xpuShmRingCtl  *ctl = ring->recv_ctl;
+	uint64_t		rpos;
+	uint64_t		wpos;
+	uint64_t		ev;
+	int				count = 0;
+
+	/* reset the doorbell */
+	while (read(ring->efd_recv, &ev, sizeof(ev)) < 0 && errno == EINTR);
+
+	rpos = pg_atomic_read_u64(&ctl->rpos);
+	wpos = pg_atomic_read_u64(&ctl->wpos);
+	pg_read_barrier();
+	while (rpos < wpos)
+	{
+		xpuShmRingItem *item = (xpuShmRingItem *)
+			(ring->recv_base + rpos % ring->ring_size);
+		XpuCommand	   *xcmd = (XpuCommand *)item->data;
+		uint64_t		len = item->length;
+
+		if ((pg_atomic_read_u32(&item->flags) & XPU_SHMRING_ITEM__SKIP) != 0)
+		{
+			pg_atomic_fetch_or_u32(&item->flags, XPU_SHMRING_ITEM__RELEASED);
+			xcmd = NULL;
+		}
+		else if (xcmd->magic != XpuCommandMagicNumber ||
+				 offsetof(xpuShmRingItem, data) + xcmd->length > len)
+		{
+			fprintf(stderr, "[%s] corrupted XpuCommand on the shared-memory ring\n",
+					error_label);
+			return -1;
+		}
+		else if (alloc_f)
+		{
+			XpuCommand *temp = alloc_f(priv, xcmd->length);
+
+			if (!temp)
+			{
+				fprintf(stderr, "[%s] out of memory (sz=%lu)\n",
+						error_label, (unsigned long)xcmd->length);
+				return -1;
+			}
+			memcpy(temp, xcmd, xcmd->length);
+			pg_atomic_fetch_or_u32(&item->flags, XPU_SHMRING_ITEM__RELEASED);
+			xcmd = temp;
+		}
+		rpos += len;
+		pg_atomic_write_u64(&ctl->rpos, rpos);
+		if (xcmd)
+		{
+			attach_f(priv, xcmd);
+			count++;
+		}
+	}
+	__xpuShmRingSweep(ring);
+
+	return count;
+}
+
+/*
+ * xpuShmRingRelease
+ *
+ * It releases the XpuCommand on the ring. It returns false if the supplied
+ * XpuCommand is not on the ring.
+ */
+bool
+xpuShmRingRelease(xpuShmRing *ring, XpuCommand *xcmd)
+{
+	xpuShmRingItem *item;
+
+	if (!ring ||
+		(char *)xcmd <  ring->recv_base ||
+		(char *)xcmd >= ring->recv_base + ring->ring_size)
+		return false;
+	item = (xpuShmRingItem *)((char *)xcmd - offsetof(xpuShmRingItem, data));
+	pg_atomic_fetch_or_u32(&item->flags, XPU_SHMRING_ITEM__RELEASED);
+	__xpuShmRingSweep(ring);
+
+	return true;
+}
+
+/*
+ * xpuShmRingClose
+ */
+void
+xpuShmRingClose(xpuShmRing *ring)
+{
+	munmap(ring->head, ring->mmap_sz);
+	close(ring->memfd);
+	close(ring->efd_send);
+	close(ring->efd_recv);
+	free(ring);
+}
 
 /*
  * Worker thread to receive response messages
@@ -49,6 +713,130 @@ __xpuConnectAllocCommand(void *__priv, size_t sz)
 	return malloc(sz);
 }
 
+static void
+__xpuConnectFreeCommand(XpuConnection *conn, XpuCommand *xcmd)
+{
+	if (!xpuShmRingRelease(conn->shmring, xcmd))
+		free(xcmd);
+}
+
+/*
+ * Routines for the adaptive flow control
+ *
+ * The backend keeps the number of in-flight commands per connection
+ * according to the Little's law; the latency of commands divided by the
+ * interval of arrivals on the busy device.
+ * These statistics are updated under the conn->mutex.
+ */
+static inline uint64_t
+__xpuConnectCurrentTimeUs(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000UL + (uint64_t)ts.tv_nsec / 1000UL;
+}
+
+static inline void
+__xpuConnectUpdateEWMA(double *ewma, double sample, bool first)
+{
+	if (first)
+		*ewma = sample;
+	else
+		*ewma += XPU_FLOWCTL_EWMA_WEIGHT * (sample - *ewma);
+}
+
+static void
+__xpuConnectPushSendTime(XpuConnection *conn)
+{
+	if (conn->send_ts_count < XPU_FLOWCTL_NSLOTS)
+	{
+		uint32_t	index = ((conn->send_ts_head +
+							  conn->send_ts_count++) % XPU_FLOWCTL_NSLOTS);
+		conn->send_ts[index] = __xpuConnectCurrentTimeUs();
+	}
+}
+
+static void
+__xpuConnectUpdateArrivalStats(XpuConnection *conn, XpuCommand *xcmd)
+{
+	uint64_t	now = __xpuConnectCurrentTimeUs();
+	bool		first = (conn->nsamples == 0);
+
+	if (conn->send_ts_count > 0)
+	{
+		uint64_t	sent = conn->send_ts[conn->send_ts_head];
+
+		conn->send_ts_head = (conn->send_ts_head + 1) % XPU_FLOWCTL_NSLOTS;
+		conn->send_ts_count--;
+		__xpuConnectUpdateEWMA(&conn->ewma_latency_us,
+							   (double)(now - sent), first);
+	}
+	/*
+	 * The interval of arrivals tells us the service time of the device,
+	 * only if the device was busy during the interval.
+	 */
+	if (conn->last_arrival_busy)
+		__xpuConnectUpdateEWMA(&conn->ewma_interval_us,
+							   (double)(now - conn->last_arrival_us),
+							   conn->ewma_interval_us == 0.0);
+	conn->last_arrival_us = now;
+	conn->last_arrival_busy = (conn->num_running_cmds > 0);
+	__xpuConnectUpdateEWMA(&conn->ewma_result_sz,
+						   (double)xcmd->length, first);
+	conn->nsamples++;
+}
+
+static void
+__xpuConnectPushReadyCommand(XpuConnection *conn, XpuCommand *xcmd)
+{
+	dlist_push_tail(&conn->ready_cmds_list, &xcmd->chain);
+	if (conn->num_ready_cmds < XPU_FLOWCTL_NSLOTS)
+	{
+		uint32_t	index = ((conn->ready_ts_head +
+							  conn->num_ready_cmds) % XPU_FLOWCTL_NSLOTS);
+		conn->ready_ts[index] = __xpuConnectCurrentTimeUs();
+	}
+	conn->num_ready_cmds++;
+}
+
+/*
+ * __xpuConnectInflightWindow
+ *
+ * It returns the number of commands to be in-flight on the device.
+ */
+static int
+__xpuConnectInflightWindow(XpuConnection *conn, int max_async_tasks)
+{
+	double		window;
+
+	/* run full-throttle until enough statistics are collected */
+	if (conn->nsamples < XPU_FLOWCTL_MIN_SAMPLES ||
+		conn->ewma_interval_us <= 0.0)
+		return max_async_tasks;
+	window = ceil(conn->ewma_latency_us / conn->ewma_interval_us) + 1.0;
+	/*
+	 * If results wait for the backend longer than the device takes to
+	 * process a command, the backend is the bottleneck, so more in-flight
+	 * commands only consume the memory.
+	 */
+	if (conn->ewma_qwait_us > conn->ewma_latency_us)
+		window = ceil(window / 2.0);
+	/* restrict the total length of results to be held */
+	if (pgstrom_xpu_inflight_mem_limit_kb > 0 &&
+		conn->ewma_result_sz > 0.0)
+	{
+		double	limit = (double)pgstrom_xpu_inflight_mem_limit_kb * 1024.0;
+
+		window = Min(window, Max(floor(limit / conn->ewma_result_sz), 1.0));
+	}
+	if (window < 1.0)
+		return 1;
+	if (window > (double)max_async_tasks)
+		return max_async_tasks;
+	return (int)window;
+}
+
 static void
 __xpuConnectAttachCommand(void *__priv, XpuCommand *xcmd)
 {
@@ -58,6 +846,7 @@ __xpuConnectAttachCommand(void *__priv, XpuCommand *xcmd)
 	pthreadMutexLock(&conn->mutex);
 	Assert(conn->num_running_cmds > 0);
 	conn->num_running_cmds--;
+	__xpuConnectUpdateArrivalStats(conn, xcmd);
 	if (xcmd->tag == XpuCommandTag__Error)
 	{
 		if (conn->errorbuf.errcode == ERRCODE_STROM_SUCCESS)
@@ -65,14 +854,13 @@ __xpuConnectAttachCommand(void *__priv, XpuCommand *xcmd)
 			Assert(xcmd->u.error.errcode != ERRCODE_STROM_SUCCESS);
 			memcpy(&conn->errorbuf, &xcmd->u.error, sizeof(kern_errorbuf));
 		}
-		free(xcmd);
+		__xpuConnectFreeCommand(conn, xcmd);
 	}
 	else
 	{
 		Assert(xcmd->tag == XpuCommandTag__Success ||
 			   xcmd->tag == XpuCommandTag__CPUFallback);
-		dlist_push_tail(&conn->ready_cmds_list, &xcmd->chain);
-		conn->num_ready_cmds++;
+		__xpuConnectPushReadyCommand(conn, xcmd);
 	}
 	SetLatch(MyLatch);
 	pthreadMutexUnlock(&conn->mutex);
@@ -86,17 +874,25 @@ __xpuConnectSessionWorker(void *__priv)
 
 	for (;;)
 	{
-		struct pollfd pfd;
+		struct pollfd pfd[2];
 		int		sockfd;
+		int		nfds = 1;
 		int		nevents;
 
 		sockfd = conn->sockfd;
 		if (sockfd < 0)
 			break;
-		pfd.fd = sockfd;
-		pfd.events = POLLIN;
-		pfd.revents = 0;
-		nevents = poll(&pfd, 1, -1);
+		pfd[0].fd = sockfd;
+		pfd[0].events = POLLIN;
+		pfd[0].revents = 0;
+		if (conn->shmring)
+		{
+			pfd[1].fd = xpuShmRingEventFd(conn->shmring);
+			pfd[1].events = POLLIN;
+			pfd[1].revents = 0;
+			nfds++;
+		}
+		nevents = poll(pfd, nfds, -1);
 		if (nevents < 0)
 		{
 			if (errno == EINTR)
@@ -107,8 +903,7 @@ __xpuConnectSessionWorker(void *__priv)
 		}
 		else if (nevents > 0)
 		{
-			Assert(nevents == 1);
-			if (pfd.revents & ~POLLIN)
+			if (pfd[0].revents & ~POLLIN)
 			{
 				pthreadMutexLock(&conn->mutex);
 				conn->terminated = 1;
@@ -116,13 +911,27 @@ __xpuConnectSessionWorker(void *__priv)
 				pthreadMutexUnlock(&conn->mutex);
 				return NULL;
 			}
-			else if (pfd.revents & POLLIN)
+			/*
+			 * NOTE: socket must be processed prior to the ring, because
+			 * the service sends a message by the socket only after all
+			 * the preceding messages on the ring are fetched.
+			 */
+			if (pfd[0].revents & POLLIN)
 			{
 				if (__xpuConnectReceiveCommands(conn->sockfd,
 												conn,
 												conn->devname) < 0)
 					break;
 			}
+			if (nfds > 1 && (pfd[1].revents & POLLIN) != 0)
+			{
+				if (xpuShmRingReceive(conn->shmring,
+									  NULL,
+									  __xpuConnectAttachCommand,
+									  conn,
+									  conn->devname) < 0)
+					break;
+			}
 		}
 	}
 	pthreadMutexLock(&conn->mutex);
@@ -134,35 +943,15 @@ __xpuConnectSessionWorker(void *__priv)
 }
 
 /*
- * xpuClientSendCommand
+ * __xpuClientCheckAlive
  */
-void
-xpuClientSendCommand(XpuConnection *conn, const XpuCommand *xcmd)
+static bool
+__xpuClientCheckAlive(void *__priv)
 {
-	int			sockfd = conn->sockfd;
-	const char *buf = (const char *)xcmd;
-	size_t		len = xcmd->length;
-	ssize_t		nbytes;
+	XpuConnection  *conn = __priv;
 
-	pthreadMutexLock(&conn->mutex);
-	conn->num_running_cmds++;
-	pthreadMutexUnlock(&conn->mutex);
-
-	while (len > 0)
-	{
-		nbytes = write(sockfd, buf, len);
-		if (nbytes > 0)
-		{
-			buf += nbytes;
-			len -= nbytes;
-		}
-		else if (nbytes == 0)
-			elog(ERROR, "unable to send xPU command to the service");
-		else if (errno == EINTR)
-			CHECK_FOR_INTERRUPTS();
-		else
-			elog(ERROR, "failed on write(2): %m");
-	}
+	CHECK_FOR_INTERRUPTS();
+	return (conn->terminated == 0);
 }
 
 /*
@@ -173,12 +962,46 @@ xpuClientSendCommandIOV(XpuConnection *conn, struct iovec *iov, int iovcnt)
 {
 	int			sockfd = conn->sockfd;
 	ssize_t		nbytes;
+	size_t		zbufsz;
+	char	   *zbuf = NULL;
+	XpuCommand *zcmd = NULL;
+	struct iovec ziov;
+	uint64_t	tv1 = 0;
 
 	Assert(iovcnt > 0);
 	pthreadMutexLock(&conn->mutex);
 	conn->num_running_cmds++;
+	__xpuConnectPushSendTime(conn);
 	pthreadMutexUnlock(&conn->mutex);
 
+	/* compress the command, if wire compression is enabled */
+	zbufsz = xpuWireCompressBufsz(&conn->wcomp, iov, iovcnt);
+	if (zbufsz > 0)
+	{
+		zbuf = MemoryContextAllocHuge(CurrentMemoryContext, zbufsz);
+		zcmd = xpuWireCompressIOV(&conn->wcomp, iov, iovcnt, zbuf, zbufsz);
+		if (zcmd)
+		{
+			ziov.iov_base = zcmd;
+			ziov.iov_len  = zcmd->length;
+			iov = &ziov;
+			iovcnt = 1;
+			tv1 = __xpuWireClockUsec();
+		}
+	}
+
+	if (conn->shmring)
+	{
+		int		rv = xpuShmRingSend(conn->shmring, iov, iovcnt,
+									__xpuClientCheckAlive, conn);
+		if (rv > 0)
+			return;
+		/* too large for the ring, so send it by the socket */
+		if (rv < 0 || !xpuShmRingDrain(conn->shmring,
+									   __xpuClientCheckAlive, conn))
+			elog(ERROR, "unable to send xPU command to the service");
+	}
+
 	while (iovcnt > 0)
 	{
 		nbytes = writev(sockfd, iov, iovcnt);
@@ -206,6 +1029,24 @@ xpuClientSendCommandIOV(XpuConnection *conn, struct iovec *iov, int iovcnt)
 		else
 			elog(ERROR, "failed on writev(2): %m");
 	}
+	if (zcmd)
+		xpuWireCompressFeedback(&conn->wcomp, zcmd,
+								__xpuWireClockUsec() - tv1);
+	if (zbuf)
+		pfree(zbuf);
+}
+
+/*
+ * xpuClientSendCommand
+ */
+void
+xpuClientSendCommand(XpuConnection *conn, const XpuCommand *xcmd)
+{
+	struct iovec	iov;
+
+	iov.iov_base = (void *)xcmd;
+	iov.iov_len  = xcmd->length;
+	xpuClientSendCommandIOV(conn, &iov, 1);
 }
 
 /*
@@ -219,7 +1060,100 @@ xpuClientPutResponse(XpuCommand *xcmd)
 	pthreadMutexLock(&conn->mutex);
 	dlist_delete(&xcmd->chain);
 	pthreadMutexUnlock(&conn->mutex);
-	free(xcmd);
+	__xpuConnectFreeCommand(conn, xcmd);
+}
+
+/*
+ * xpuClientPushResponse
+ *
+ * It enqueues a response that was built without xPU round-trip (e.g, from
+ * the result cache), as if it came from the device. 'resp' must be
+ * allocated by malloc(3), because xpuClientPutResponse() releases it.
+ */
+void
+xpuClientPushResponse(XpuConnection *conn, XpuCommand *resp)
+{
+	resp->priv = conn;
+	pthreadMutexLock(&conn->mutex);
+	__xpuConnectPushReadyCommand(conn, resp);
+	pthreadMutexUnlock(&conn->mutex);
+}
+
+/*
+ * xpuClientNumRunningCommands
+ *
+ * It returns the number of commands in-flight on the device.
+ */
+int
+xpuClientNumRunningCommands(XpuConnection *conn)
+{
+	int			count;
+
+	pthreadMutexLock(&conn->mutex);
+	count = conn->num_running_cmds;
+	pthreadMutexUnlock(&conn->mutex);
+
+	return count;
+}
+
+/*
+ * xpuClientResetSession
+ *
+ * It waits for completion of the commands in-flight, then releases the
+ * responses not consumed yet, to reuse the session for the next scan.
+ * It returns false if the session is not reusable.
+ */
+bool
+xpuClientResetSession(XpuConnection *conn)
+{
+	dlist_head	free_list;
+	dlist_node *dnode;
+	XpuCommand *xcmd;
+	bool		retval;
+	int			ev;
+
+	dlist_init(&free_list);
+	pthreadMutexLock(&conn->mutex);
+	while (conn->num_running_cmds > 0 &&
+		   conn->errorbuf.errcode == ERRCODE_STROM_SUCCESS)
+	{
+		ResetLatch(MyLatch);
+		pthreadMutexUnlock(&conn->mutex);
+
+		CHECK_FOR_INTERRUPTS();
+		ev = WaitLatch(MyLatch,
+					   WL_LATCH_SET |
+					   WL_TIMEOUT |
+					   WL_POSTMASTER_DEATH,
+					   1000L,
+					   PG_WAIT_EXTENSION);
+		if (ev & WL_POSTMASTER_DEATH)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("Unexpected Postmaster dead")));
+		pthreadMutexLock(&conn->mutex);
+	}
+	while (!dlist_is_empty(&conn->ready_cmds_list))
+	{
+		dnode = dlist_pop_head_node(&conn->ready_cmds_list);
+		dlist_push_tail(&free_list, dnode);
+	}
+	conn->num_ready_cmds = 0;
+	while (!dlist_is_empty(&conn->active_cmds_list))
+	{
+		dnode = dlist_pop_head_node(&conn->active_cmds_list);
+		dlist_push_tail(&free_list, dnode);
+	}
+	retval = (conn->errorbuf.errcode == ERRCODE_STROM_SUCCESS);
+	pthreadMutexUnlock(&conn->mutex);
+
+	while (!dlist_is_empty(&free_list))
+	{
+		dnode = dlist_pop_head_node(&free_list);
+		xcmd = dlist_container(XpuCommand, chain, dnode);
+		__xpuConnectFreeCommand(conn, xcmd);
+	}
+	return retval;
 }
 
 /*
@@ -242,14 +1176,16 @@ xpuClientCloseSession(XpuConnection *conn)
 	{
 		dnode = dlist_pop_head_node(&conn->ready_cmds_list);
 		xcmd = dlist_container(XpuCommand, chain, dnode);
-		free(xcmd);
+		__xpuConnectFreeCommand(conn, xcmd);
 	}
 	while (!dlist_is_empty(&conn->active_cmds_list))
 	{
 		dnode = dlist_pop_head_node(&conn->active_cmds_list);
 		xcmd = dlist_container(XpuCommand, chain, dnode);
-		free(xcmd);
+		__xpuConnectFreeCommand(conn, xcmd);
 	}
+	if (conn->shmring)
+		xpuShmRingClose(conn->shmring);
 	dlist_delete(&conn->chain);
 	free(conn);
 }
@@ -405,6 +1341,88 @@ __build_session_xact_state(StringInfo buf)
 	return __appendBinaryStringInfo(buf, buffer, bufsz);
 }
 
+/*
+ * __build_session_xact_snapshot
+ *
+ * It serializes the MVCC snapshot and a subset of the commit log for
+ * the recent transactions, to check visibility of the tuples on the pages
+ * not all-visible on the xPU devices.
+ */
+static uint32_t
+__build_session_xact_snapshot(StringInfo buf, Snapshot snapshot)
+{
+	kern_session_snapshot *snap;
+	uint32_t	xcnt = snapshot->xcnt;
+	uint32_t	clog_nitems = pgstrom_xpu_mvcc_clog_xids;
+	uint32_t	head_sz;
+	uint32_t	clog_sz;
+	uint32_t	offset;
+	uint32_t	nlocked;
+	uint8_t	   *clog;
+	TransactionId oldest_clog_xid;
+
+	if (!snapshot->suboverflowed)
+		xcnt += snapshot->subxcnt;
+	head_sz = MAXALIGN(offsetof(kern_session_snapshot, xip[xcnt]));
+
+	/* commit log older than oldestClogXid might be already truncated */
+	LWLockAcquire(XactTruncationLock, LW_SHARED);
+#if PG_VERSION_NUM >= 170000
+	oldest_clog_xid = TransamVariables->oldestClogXid;
+#else
+	oldest_clog_xid = ShmemVariableCache->oldestClogXid;
+#endif
+	if (clog_nitems > snapshot->xmax - oldest_clog_xid)
+		clog_nitems = snapshot->xmax - oldest_clog_xid;
+	clog_sz = MAXALIGN((clog_nitems + 3) / 4);
+	/*
+	 * The commit log newer than xmin of the snapshot is never truncated
+	 * because the snapshot holds back the horizon, so the lock is held
+	 * only while the older transactions are checked.
+	 */
+	nlocked = Min(clog_nitems, snapshot->xmax - snapshot->xmin);
+	nlocked = clog_nitems - nlocked;
+
+	snap = palloc0(head_sz + clog_sz);
+	snap->xmin = snapshot->xmin;
+	snap->xmax = snapshot->xmax;
+	snap->suboverflowed = snapshot->suboverflowed;
+	snap->clog_base = snapshot->xmax - clog_nitems;
+	snap->clog_nitems = clog_nitems;
+	snap->clog_offset = head_sz;
+	snap->xcnt = xcnt;
+	memcpy(snap->xip, snapshot->xip, sizeof(TransactionId) * snapshot->xcnt);
+	if (!snapshot->suboverflowed)
+		memcpy(snap->xip + snapshot->xcnt, snapshot->subxip,
+			   sizeof(TransactionId) * snapshot->subxcnt);
+	clog = (uint8_t *)snap + head_sz;
+	for (uint32_t i=0; i < clog_nitems; i++)
+	{
+		TransactionId xid = snap->clog_base + i;
+		int			status;
+
+		if (i == nlocked)
+			LWLockRelease(XactTruncationLock);
+		if (!TransactionIdIsNormal(xid) ||
+			TransactionIdIsCurrentTransactionId(xid))
+			status = XPU_MVCC__UNKNOWN;
+		else if (XidInMVCCSnapshot(xid, snapshot))
+			status = XPU_MVCC__INVISIBLE;
+		else if (TransactionIdDidCommit(xid))
+			status = XPU_MVCC__VISIBLE;
+		else
+			status = XPU_MVCC__INVISIBLE;	/* aborted or crashed */
+		clog[i >> 2] |= (status << ((i & 3) << 1));
+	}
+	if (nlocked == clog_nitems)
+		LWLockRelease(XactTruncationLock);
+
+	offset = __appendBinaryStringInfo(buf, snap, head_sz + clog_sz);
+	pfree(snap);
+
+	return offset;
+}
+
 static uint32_t
 __build_session_timezone(StringInfo buf)
 {
@@ -433,6 +1451,35 @@ __build_session_encode(StringInfo buf)
 	return __appendBinaryStringInfo(buf, &encode, sizeof(xpu_encode_info));
 }
 
+static uint32_t
+__build_session_topn_desc(pgstromPlanInfo *pp_info, StringInfo buf)
+{
+	kern_topn_desc *topn;
+	uint32_t	nkeys = list_length(pp_info->topn_keys);
+	size_t		sz = offsetof(kern_topn_desc, keys[nkeys]);
+	ListCell   *lc1, *lc2;
+	int			i = 0;
+
+	Assert(nkeys == list_length(pp_info->topn_flags));
+	topn = alloca(sz);
+	memset(topn, 0, sz);
+	topn->buffer_limit = (uint64_t)pgstrom_window_topk_buffer_size_kb << 10;
+	topn->nrows = pp_info->topn_nrows;
+	topn->nkeys = nkeys;
+	topn->with_ties = pp_info->topn_with_ties;
+	forboth (lc1, pp_info->topn_keys,
+			 lc2, pp_info->topn_flags)
+	{
+		topn->keys[i].attnum = lfirst_int(lc1);
+		topn->keys[i].flags  = lfirst_int(lc2);
+		/* partition keys are located at the head */
+		if ((topn->keys[i].flags & KERN_TOPN_FLAG__PARTITION) != 0)
+			topn->nparts++;
+		i++;
+	}
+	return __appendBinaryStringInfo(buf, topn, sz);
+}
+
 const XpuCommand *
 pgstromBuildSessionInfo(pgstromTaskState *pts,
 						uint32_t join_inner_handle,
@@ -447,6 +1494,8 @@ pgstromBuildSessionInfo(pgstromTaskState *pts,
 	uint32_t		kvars_nslots;
 	uint32_t		kvars_ndims;
 	uint32_t		session_sz;
+	uint32_t		tz_head;
+	uint64_t		session_hash;
 	kern_session_info *session;
 	ListCell	   *lc1, *lc2;
 	XpuCommand	   *xcmd;
@@ -568,6 +1617,16 @@ pgstromBuildSessionInfo(pgstromTaskState *pts,
 		kds_temp->hash_nslots = hash_nslots;
 		session->groupby_kds_final = __appendBinaryStringInfo(&buf, kds_temp, sz);
 	}
+	/* top-N results buffer */
+	if (pp_info->topn_nrows > 0 && pp_info->topn_keys != NIL)
+		session->topn_desc = __build_session_topn_desc(pp_info, &buf);
+	/* wire compression, if remote DPU session */
+	if ((pts->xpu_task_flags & DEVKIND__NVIDIA_DPU) != 0)
+	{
+		session->wire_compression = pgstrom_dpu_wire_compression;
+		session->wire_compression_threshold
+			= (uint32_t)pgstrom_dpu_wire_compression_threshold_kb << 10;
+	}
 	/* other database session information */
 	kvars_nslots = list_length(pp_info->kvars_depth);
 	Assert(kvars_nslots == list_length(pp_info->kvars_resno) &&
@@ -601,13 +1660,31 @@ pgstromBuildSessionInfo(pgstromTaskState *pts,
 	session->xpu_task_flags = pts->xpu_task_flags;
 	session->hostEpochTimestamp = SetEpochTimestamp();
 	session->xactStartTimestamp = GetCurrentTransactionStartTimestamp();
+	/*
+	 * session_hash identifies the xpucode and parameters of this session,
+	 * regardless of the transaction; it is a part of the result cache key.
+	 */
+	session_hash = hash_bytes_extended((const unsigned char *)buf.data + session_sz,
+									   buf.len - session_sz,
+									   pts->css.ss.ss_currentRelation
+									   ? RelationGetRelid(pts->css.ss.ss_currentRelation)
+									   : InvalidOid);
 	session->session_xact_state = __build_session_xact_state(&buf);
+	if (pts->xpu_mvcc_checks)
+		session->session_xact_snapshot
+			= __build_session_xact_snapshot(&buf, pts->css.ss.ps.state->es_snapshot);
+	tz_head = buf.len;
 	session->session_timezone = __build_session_timezone(&buf);
 	session->session_encode = __build_session_encode(&buf);
 	session->pgsql_port_number = PostPortNumber;
 	session->pgsql_plan_node_id = pts->css.ss.ps.plan->plan_node_id;
 	session->join_inner_handle = join_inner_handle;
 	memcpy(buf.data, session, session_sz);
+	pts->session_hash = hash_combine64(session_hash,
+									   hash_bytes_extended((const unsigned char *)
+														   buf.data + tz_head,
+														   buf.len - tz_head,
+														   session->xpu_task_flags));
 
 	/* setup XpuCommand */
 	xcmd = palloc(offsetof(XpuCommand, u.session) + buf.len);
@@ -686,6 +1763,7 @@ pgstromTaskStateResetScan(pgstromTaskState *pts)
 	
 	pg_atomic_write_u32(&ps_state->parallel_task_control, 0);
 	pg_atomic_write_u32(&ps_state->__rjoin_exit_count, 0);
+	pg_atomic_write_u32(&ps_state->heap_scan_nprocs, 0);
 	pts->rjoin_exit_count = &ps_state->__rjoin_exit_count;
 	pts->rjoin_devs_count = (pg_atomic_uint32 *)
 		((char *)ps_state + MAXALIGN(offsetof(pgstromSharedState,
@@ -732,6 +1810,15 @@ __pickupNextXpuCommand(XpuConnection *conn)
 	dnode = dlist_pop_head_node(&conn->ready_cmds_list);
 	xcmd = dlist_container(XpuCommand, chain, dnode);
 	dlist_push_tail(&conn->active_cmds_list, &xcmd->chain);
+	if (conn->num_ready_cmds <= XPU_FLOWCTL_NSLOTS)
+	{
+		uint64_t	arrival = conn->ready_ts[conn->ready_ts_head];
+
+		__xpuConnectUpdateEWMA(&conn->ewma_qwait_us,
+							   (double)(__xpuConnectCurrentTimeUs() - arrival),
+							   conn->ewma_qwait_us == 0.0);
+	}
+	conn->ready_ts_head = (conn->ready_ts_head + 1) % XPU_FLOWCTL_NSLOTS;
 	conn->num_ready_cmds--;
 
 	return xcmd;
@@ -784,8 +1871,13 @@ __waitAndFetchNextXpuCommand(pgstromTaskState *pts, bool try_final_callback)
 				kern_final_task	kfin;
 
 				pts->final_done = true;
+				/*
+				 * Top-N buffer of the xPU service is per connection, so
+				 * every process has to collect them at the end of scan.
+				 */
 				if (try_final_callback &&
-					pgstromTaskStateEndScan(pts, &kfin) &&
+					(pgstromTaskStateEndScan(pts, &kfin) ||
+					 pts->pp_info->topn_nrows > 0) &&
 					pts->cb_final_chunk != NULL)
 				{
 					xcmd = pts->cb_final_chunk(pts, &kfin, xcmd_iov, &xcmd_iovcnt);
@@ -827,6 +1919,7 @@ __fetchNextXpuCommand(pgstromTaskState *pts)
 	int				xcmd_iovcnt;
 	int				ev;
 	int				max_async_tasks = pgstrom_max_async_tasks();
+	int				window;
 
 	while (!pts->scan_done)
 	{
@@ -848,21 +1941,23 @@ __fetchNextXpuCommand(pgstromTaskState *pts)
 							 conn->errorbuf.funcname)));
 		}
 
+		window = __xpuConnectInflightWindow(conn, max_async_tasks);
 		if ((conn->num_running_cmds + conn->num_ready_cmds) < max_async_tasks &&
-			(dlist_is_empty(&conn->ready_cmds_list) ||
-			 conn->num_running_cmds < max_async_tasks / 2))
+			conn->num_running_cmds < window)
 		{
 			/*
 			 * xPU service still has margin to enqueue new commands.
-			 * If we have no ready commands or number of running commands
-			 * are less than pg_strom.max_async_tasks/2, we try to load
-			 * the next chunk and enqueue this command.
+			 * If number of running commands are less than the in-flight
+			 * window adjusted by the flow control, we try to load the
+			 * next chunk and enqueue this command.
 			 */
 			pthreadMutexUnlock(&conn->mutex);
 			xcmd = pts->cb_next_chunk(pts, xcmd_iov, &xcmd_iovcnt);
 			if (!xcmd)
 			{
-				Assert(pts->scan_done);
+				/* the chunk might be answered without xPU */
+				if (!pts->scan_done)
+					continue;
 				break;
 			}
 			xpuClientSendCommandIOV(conn, xcmd_iov, xcmd_iovcnt);
@@ -874,12 +1969,13 @@ __fetchNextXpuCommand(pgstromTaskState *pts)
 			__updateStatsXpuCommand(pts, xcmd);
 			return xcmd;
 		}
-		else if (conn->num_running_cmds > 0)
+		else
 		{
 			/*
 			 * This block means we already runs enough number of concurrent
 			 * tasks, but none of them are already finished.
-			 * So, let's wait for the response.
+			 * So, let's wait for the response; the worker thread sets
+			 * the latch on arrival of the response.
 			 */
 			ResetLatch(MyLatch);
 			pthreadMutexUnlock(&conn->mutex);
@@ -895,14 +1991,6 @@ __fetchNextXpuCommand(pgstromTaskState *pts)
 						(errcode(ERRCODE_ADMIN_SHUTDOWN),
 						 errmsg("Unexpected Postmaster dead")));
 		}
-		else
-		{
-			/*
-			 * Unfortunately, we touched the threshold. Take a short wait
-			 */
-			pthreadMutexUnlock(&conn->mutex);
-			pg_usleep(20000L);		/* 20ms */
-		}
 	}
 	return __waitAndFetchNextXpuCommand(pts, true);
 }
@@ -941,6 +2029,69 @@ pgstromScanNextTuple(pgstromTaskState *pts)
 	}
 }
 
+/*
+ * pgstromScanNextVirtualTuple
+ *
+ * It stores the kern_virtual_tuple returned by the device on the virtual
+ * tuple-slot as is, without heap_deform_tuple().
+ */
+static TupleTableSlot *
+pgstromScanNextVirtualTuple(pgstromTaskState *pts)
+{
+	TupleTableSlot *slot = pts->css.ss.ss_ScanTupleSlot;
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+
+	for (;;)
+	{
+		kern_data_store *kds = pts->curr_kds;
+		int64_t		index = pts->curr_index++;
+
+		if (index < kds->nitems)
+		{
+			kern_tupitem   *tupitem = KDS_GET_TUPITEM(kds, index);
+			kern_virtual_tuple *kvtup = (kern_virtual_tuple *)&tupitem->htup;
+			int			j;
+
+			ExecClearTuple(slot);
+			for (j=0; j < kvtup->nattrs; j++)
+			{
+				Form_pg_attribute attr = TupleDescAttr(tupdesc, j);
+
+				if (KVTUP_ISNULL(kvtup, j))
+				{
+					slot->tts_values[j] = 0;
+					slot->tts_isnull[j] = true;
+				}
+				else
+				{
+					if (attr->attbyval)
+						slot->tts_values[j] = fetch_att(&kvtup->values[j], true,
+														attr->attlen);
+					else
+						slot->tts_values[j] = PointerGetDatum((char *)kvtup +
+															  kvtup->values[j]);
+					slot->tts_isnull[j] = false;
+				}
+			}
+			/* attributes not in the device projection */
+			for (; j < tupdesc->natts; j++)
+			{
+				slot->tts_values[j] = 0;
+				slot->tts_isnull[j] = true;
+			}
+			slot->tts_tid = kvtup->t_ctid;
+			return ExecStoreVirtualTuple(slot);
+		}
+		if (++pts->curr_chunk < pts->curr_resp->u.results.chunks_nitems)
+		{
+			pts->curr_kds = (kern_data_store *)((char *)kds + kds->length);
+			pts->curr_index = 0;
+			continue;
+		}
+		return NULL;
+	}
+}
+
 /*
  * pgstromExecFinalChunk
  */
@@ -996,8 +2147,7 @@ pgstromExecFinalChunkDummy(pgstromTaskState *pts,
 
 		/* attach dummy xcmd at the tail of ready list */
 		pthreadMutexLock(&conn->mutex);
-		dlist_push_tail(&conn->ready_cmds_list, &xcmd->chain);
-		conn->num_ready_cmds++;
+		__xpuConnectPushReadyCommand(conn, xcmd);
 		SetLatch(MyLatch);
 		pthreadMutexUnlock(&conn->mutex);
 	}
@@ -1043,6 +2193,7 @@ __setupTaskStateRequestBuffer(pgstromTaskState *pts,
 		xcmd->u.task.kds_dst_offset = off;
 		kds  = (kern_data_store *)((char *)xcmd + off);
 		off += setup_kern_data_store(kds, tdesc_dst, 0, KDS_FORMAT_ROW);
+		kds->virtual_tuple = pts->virtual_tuple;
 	}
 	if (tdesc_src)
 	{
@@ -1059,6 +2210,201 @@ __setupTaskStateRequestBuffer(pgstromTaskState *pts,
 	pts->xcmd_buf.len = off;
 }
 
+/*
+ * Asynchronous start of the xPU tasks
+ *
+ * PostgreSQL v15 supports asynchronous execution only on ForeignScan, so
+ * Append pulls the CustomScan children one after another. Instead, the
+ * task states in a query are kept on the pending list at the executor
+ * startup, then the next few tasks are started ahead once a task is
+ * polled first. The list is released with the per-query memory context.
+ */
+typedef struct
+{
+	dlist_node	chain;
+	EState	   *estate;
+	List	   *pts_list;		/* pgstromTaskState not polled yet */
+	const Plan **append_parents; /* Append parent, indexed by plan_node_id */
+	int			num_append_parents;
+	MemoryContextCallback mcb;
+} pgstromAsyncPendingTasks;
+
+static dlist_head	pgstrom_async_pending_list;
+
+static void
+__pgstromAsyncPendingCleanup(void *arg)
+{
+	pgstromAsyncPendingTasks *pending = arg;
+
+	dlist_delete(&pending->chain);
+}
+
+static pgstromAsyncPendingTasks *
+__pgstromAsyncLookupPending(EState *estate)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &pgstrom_async_pending_list)
+	{
+		pgstromAsyncPendingTasks *pending
+			= dlist_container(pgstromAsyncPendingTasks, chain, iter.cur);
+		if (pending->estate == estate)
+			return pending;
+	}
+	return NULL;
+}
+
+/*
+ * __pgstromAsyncCollectAppendParents
+ *
+ * It records the Append node for each of its direct children, unless it is
+ * located under Gather or Gather Merge. Sub-plans are not walked, because
+ * they may not be executed at all.
+ */
+static void
+__pgstromAsyncCollectAppendParents(pgstromAsyncPendingTasks *pending,
+								   const Plan *plan, const Plan *parent)
+{
+	ListCell   *lc;
+
+	if (!plan)
+		return;
+	if (parent)
+	{
+		int		plan_id = plan->plan_node_id;
+
+		if (plan_id >= pending->num_append_parents)
+		{
+			int		nrooms = Max(2 * pending->num_append_parents, plan_id + 32);
+
+			if (!pending->append_parents)
+				pending->append_parents = palloc0(sizeof(Plan *) * nrooms);
+			else
+			{
+				pending->append_parents = repalloc(pending->append_parents,
+												   sizeof(Plan *) * nrooms);
+				memset(pending->append_parents + pending->num_append_parents, 0,
+					   sizeof(Plan *) * (nrooms - pending->num_append_parents));
+			}
+			pending->num_append_parents = nrooms;
+		}
+		pending->append_parents[plan_id] = parent;
+	}
+	switch (nodeTag(plan))
+	{
+		case T_Gather:
+		case T_GatherMerge:
+			/* parallel-aware scan may be shared with the workers */
+			return;
+		case T_Append:
+			foreach (lc, ((const Append *)plan)->appendplans)
+				__pgstromAsyncCollectAppendParents(pending, lfirst(lc), plan);
+			return;
+		case T_MergeAppend:
+			foreach (lc, ((const MergeAppend *)plan)->mergeplans)
+				__pgstromAsyncCollectAppendParents(pending, lfirst(lc), NULL);
+			return;
+		case T_SubqueryScan:
+			__pgstromAsyncCollectAppendParents(pending,
+											   ((const SubqueryScan *)plan)->subplan,
+											   NULL);
+			return;
+		case T_CustomScan:
+			foreach (lc, ((const CustomScan *)plan)->custom_plans)
+				__pgstromAsyncCollectAppendParents(pending, lfirst(lc), NULL);
+			break;
+		default:
+			break;
+	}
+	__pgstromAsyncCollectAppendParents(pending, plan->lefttree, NULL);
+	__pgstromAsyncCollectAppendParents(pending, plan->righttree, NULL);
+}
+
+/*
+ * __pgstromAsyncGetPending
+ *
+ * It returns the pending list of the query, or creates a new one. The plan
+ * tree is walked only once here, to resolve the Append parents of the tasks.
+ */
+static pgstromAsyncPendingTasks *
+__pgstromAsyncGetPending(EState *estate)
+{
+	pgstromAsyncPendingTasks *pending = __pgstromAsyncLookupPending(estate);
+	MemoryContext	oldcxt;
+
+	if (!pending)
+	{
+		oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+		pending = palloc0(sizeof(pgstromAsyncPendingTasks));
+		pending->estate = estate;
+		__pgstromAsyncCollectAppendParents(pending,
+										   estate->es_plannedstmt->planTree,
+										   NULL);
+		pending->mcb.func = __pgstromAsyncPendingCleanup;
+		pending->mcb.arg = pending;
+		MemoryContextRegisterResetCallback(estate->es_query_cxt,
+										   &pending->mcb);
+		dlist_push_tail(&pgstrom_async_pending_list, &pending->chain);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	return pending;
+}
+
+static void
+__pgstromAsyncRegisterTask(pgstromTaskState *pts, EState *estate)
+{
+	pgstromAsyncPendingTasks *pending;
+	const Plan	   *plan = pts->css.ss.ps.plan;
+	const Plan	   *parent;
+	MemoryContext	oldcxt;
+	ListCell	   *lc;
+
+	if (pgstrom_xpu_async_prefetch <= 0)
+		return;
+	/*
+	 * Only the simple scan can be started ahead; the inner relations of
+	 * JOIN and the executor parameters may not be ready at that time.
+	 */
+	if (pts->num_rels > 0)
+		return;
+	/*
+	 * Parallel-aware scan must not be started before the DSM segment is
+	 * set up, because the shared state is replaced by the one on the DSM.
+	 */
+	if (plan->parallel_aware || IsParallelWorker())
+		return;
+	foreach (lc, pts->pp_info->used_params)
+	{
+		Param	   *param = lfirst(lc);
+
+		if (param->paramkind == PARAM_EXEC)
+			return;
+	}
+	/* only the children of Append are started ahead */
+	pending = __pgstromAsyncGetPending(estate);
+	if (plan->plan_node_id >= pending->num_append_parents)
+		return;
+	parent = pending->append_parents[plan->plan_node_id];
+	if (!parent)
+		return;
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	pending->pts_list = lappend(pending->pts_list, pts);
+	MemoryContextSwitchTo(oldcxt);
+	pts->async_pending = true;
+	pts->async_parent = parent;
+}
+
+static void
+__pgstromAsyncUnregisterTask(pgstromTaskState *pts)
+{
+	pgstromAsyncPendingTasks *pending
+		= __pgstromAsyncLookupPending(pts->css.ss.ps.state);
+
+	if (pending)
+		pending->pts_list = list_delete_ptr(pending->pts_list, pts);
+	pts->async_pending = false;
+}
+
 /*
  * pgstromExecInitTaskState
  */
@@ -1074,6 +2420,7 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 	TupleDesc	fallback_tdesc;
 	int			depth_index = 0;
 	bool		has_right_outer = false;
+	TupleTableSlot *(*next_tuple)(pgstromTaskState *pts);
 	ListCell   *lc;
 
 	/* sanity checks */
@@ -1131,12 +2478,22 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 	 * of ExecCleanTypeFromTL; that leads incorrect projection.
 	 * So, we try to remove junk attributes from the scan-descriptor.
 	 *
-	 * And, device projection returns a tuple in heap-format, so we
+	 * And, device projection usually returns a tuple in heap-format, so we
 	 * prefer TTSOpsHeapTuple, instead of the TTSOpsVirtual.
+	 * Only if the projection is wide enough, the device returns tuples in
+	 * the pre-deformed format (kern_virtual_tuple) to skip the deforming
+	 * cost on the host side. PreAgg is out of scope because its final
+	 * buffer is kept on the device side.
 	 */
 	tupdesc_dst = ExecCleanTypeFromTL(cscan->custom_scan_tlist);
+	if (pgstrom_virtual_tuple_threshold > 0 &&
+		tupdesc_dst->natts >= pgstrom_virtual_tuple_threshold &&
+		(pts->xpu_task_flags & DEVTASK__PREAGG) == 0)
+		pts->virtual_tuple = true;
 	ExecInitScanTupleSlot(estate, &pts->css.ss, tupdesc_dst,
-						  &TTSOpsHeapTuple);
+						  pts->virtual_tuple
+						  ? &TTSOpsVirtual
+						  : &TTSOpsHeapTuple);
 	ExecAssignScanProjectionInfoWithVarno(&pts->css.ss, INDEX_VAR);
 
 	/*
@@ -1243,10 +2600,13 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 	/*
 	 * Setup request buffer
 	 */
+	next_tuple = (pts->virtual_tuple
+				  ? pgstromScanNextVirtualTuple
+				  : pgstromScanNextTuple);
 	if (pts->arrow_state)		/* Apache Arrow */
 	{
 		pts->cb_next_chunk = pgstromScanChunkArrowFdw;
-		pts->cb_next_tuple = pgstromScanNextTuple;
+		pts->cb_next_tuple = next_tuple;
 	    __setupTaskStateRequestBuffer(pts,
 									  NULL,
 									  tupdesc_dst,
@@ -1255,7 +2615,7 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 	else if (pts->gcache_desc)		/* GPU-Cache */
 	{
 		pts->cb_next_chunk = pgstromScanChunkGpuCache;
-		pts->cb_next_tuple = pgstromScanNextTuple;
+		pts->cb_next_tuple = next_tuple;
 		__setupTaskStateRequestBuffer(pts,
 									  NULL,
 									  tupdesc_dst,
@@ -1264,17 +2624,31 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 	else if (!bms_is_empty(pts->optimal_gpus) ||	/* GPU-Direct SQL */
 			 pts->ds_entry)							/* DPU Storage */
 	{
+		Snapshot	snapshot = estate->es_snapshot;
+
 		pts->cb_next_chunk = pgstromRelScanChunkDirect;
-		pts->cb_next_tuple = pgstromScanNextTuple;
+		pts->cb_next_tuple = next_tuple;
 		__setupTaskStateRequestBuffer(pts,
 									  tupdesc_src,
 									  tupdesc_dst,
 									  KDS_FORMAT_BLOCK);
+		/*
+		 * xPU can check MVCC visibility of the pages not all-visible,
+		 * then the pages we cannot determine are rechecked by CPU.
+		 * GpuPreAgg is not supported right now, because CPU fallback
+		 * is not implemented yet. Serializable isolation level also
+		 * needs predicate locks on the tuples, so not supported.
+		 */
+		pts->xpu_mvcc_checks = (pgstrom_xpu_mvcc_checks &&
+								(pts->xpu_task_flags & DEVTASK__PREAGG) == 0 &&
+								IsMVCCSnapshot(snapshot) &&
+								!snapshot->takenDuringRecovery &&
+								!IsolationIsSerializable());
 	}
 	else						/* Slow normal heap storage */
 	{
 		pts->cb_next_chunk = pgstromRelScanChunkNormal;
-		pts->cb_next_tuple = pgstromScanNextTuple;
+		pts->cb_next_tuple = next_tuple;
 		__setupTaskStateRequestBuffer(pts,
 									  tupdesc_src,
 									  tupdesc_dst,
@@ -1286,11 +2660,13 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 	 */
 	if ((pts->xpu_task_flags & DEVTASK__SCAN) != 0)
 	{
+		if (pts->pp_info->topn_nrows > 0)
+			pts->cb_final_chunk = pgstromExecFinalChunk;
 		pts->cb_cpu_fallback = ExecFallbackCpuScan;
 	}
 	else if ((pts->xpu_task_flags & DEVTASK__JOIN) != 0)
 	{
-		if (has_right_outer)
+		if (has_right_outer || pts->pp_info->topn_nrows > 0)
 			pts->cb_final_chunk = pgstromExecFinalChunk;
 		else
 			pts->cb_final_chunk = pgstromExecFinalChunkDummy;
@@ -1305,6 +2681,8 @@ pgstromExecInitTaskState(CustomScanState *node, EState *estate, int eflags)
 		elog(ERROR, "Bug? unknown DEVTASK");
 	/* other fields init */
 	pts->curr_vm_buffer = InvalidBuffer;
+	/* register the task to be started ahead, if possible */
+	__pgstromAsyncRegisterTask(pts, estate);
 }
 
 /*
@@ -1336,6 +2714,10 @@ pgstromExecScanAccess(pgstromTaskState *pts)
 					ExecFallbackCpuJoinOuterJoinMap(pts, resp);
 				if (resp->u.results.final_plan_node)
 					ExecFallbackCpuJoinRightOuter(pts);
+				if (resp->u.results.recheck_nblocks > 0)
+					pgstromRelScanRecheckBlocks(pts, resp);
+				if (pts->arrow_state && resp->u.results.chunk_id > 0)
+					pgstromArrowFdwResultCacheStore(pts, resp);
 				if (resp->u.results.chunks_nitems == 0)
 					goto next_chunks;
 				pts->curr_kds = (kern_data_store *)
@@ -1345,8 +2727,14 @@ pgstromExecScanAccess(pgstromTaskState *pts)
 				break;
 
 			case XpuCommandTag__CPUFallback:
-				//run CPU fallback
-				break;
+				/* run CPU fallback on the entire chunk */
+				pgstromRelScanFallbackChunk(pts, resp);
+				xpuClientPutResponse(resp);
+				pts->curr_resp = NULL;
+				slot = pgstromFetchFallbackTuple(pts);
+				if (slot)
+					return slot;
+				goto next_chunks;
 
 			default:
 				elog(ERROR, "unknown response tag: %u", resp->tag);
@@ -1417,6 +2805,77 @@ __pgstromExecTaskOpenConnection(pgstromTaskState *pts)
 	return true;
 }
 
+/*
+ * __pgstromAsyncStartTask
+ *
+ * It opens the session of the task state not polled yet, then sends the
+ * commands up to the in-flight window without waiting for the responses.
+ */
+static void
+__pgstromAsyncStartTask(pgstromTaskState *pts)
+{
+	XpuConnection  *conn;
+	XpuCommand	   *xcmd;
+	struct iovec	xcmd_iov[10];
+	int				xcmd_iovcnt;
+	int				max_async_tasks = pgstrom_max_async_tasks();
+	bool			has_margin;
+
+	if (!__pgstromExecTaskOpenConnection(pts))
+	{
+		/* other workers already finished the scan */
+		pts->scan_done = pts->final_done = true;
+		return;
+	}
+	conn = pts->conn;
+	while (!pts->scan_done)
+	{
+		pthreadMutexLock(&conn->mutex);
+		has_margin = ((conn->num_running_cmds +
+					   conn->num_ready_cmds) < max_async_tasks &&
+					  conn->num_running_cmds < __xpuConnectInflightWindow(conn, max_async_tasks));
+		pthreadMutexUnlock(&conn->mutex);
+		if (!has_margin)
+			break;
+		xcmd = pts->cb_next_chunk(pts, xcmd_iov, &xcmd_iovcnt);
+		if (xcmd)
+			xpuClientSendCommandIOV(conn, xcmd_iov, xcmd_iovcnt);
+	}
+}
+
+/*
+ * __pgstromAsyncStartSiblings
+ *
+ * It removes the task state on its first poll from the pending list, then
+ * starts the next pg_strom.xpu_async_prefetch tasks in the same query ahead.
+ * For example, the child scans of Append over many partitions run on the
+ * xPU devices concurrently, even though Append pulls them one after another.
+ */
+static void
+__pgstromAsyncStartSiblings(pgstromTaskState *pts)
+{
+	pgstromAsyncPendingTasks *pending = __pgstromAsyncLookupPending(pts->css.ss.ps.state);
+	ListCell   *lc;
+	int			count = 0;
+
+	pts->async_pending = false;
+	if (!pending)
+		return;
+	pending->pts_list = list_delete_ptr(pending->pts_list, pts);
+	foreach (lc, pending->pts_list)
+	{
+		pgstromTaskState *temp = lfirst(lc);
+
+		/* only siblings under the same Append */
+		if (temp->async_parent != pts->async_parent)
+			continue;
+		if (count++ >= pgstrom_xpu_async_prefetch)
+			break;
+		if (!temp->conn && !temp->scan_done)
+			__pgstromAsyncStartTask(temp);
+	}
+}
+
 /*
  * pgstromExecTaskState
  */
@@ -1431,6 +2890,8 @@ pgstromExecTaskState(CustomScanState *node)
 			return NULL;
 		Assert(pts->conn);
 	}
+	if (pts->async_pending)
+		__pgstromAsyncStartSiblings(pts);
 	return ExecScan(&pts->css.ss,
 					(ExecScanAccessMtd) pgstromExecScanAccess,
 					(ExecScanRecheckMtd) pgstromExecScanReCheck);
@@ -1446,6 +2907,8 @@ pgstromExecEndTaskState(CustomScanState *node)
 	pgstromSharedState *ps_state = pts->ps_state;
 	ListCell   *lc;
 
+	if (pts->async_pending)
+		__pgstromAsyncUnregisterTask(pts);
 	if (pts->curr_vm_buffer != InvalidBuffer)
 		ReleaseBuffer(pts->curr_vm_buffer);
 	if (pts->conn)
@@ -1478,6 +2941,35 @@ pgstromExecEndTaskState(CustomScanState *node)
 		ExecEndNode((PlanState *) lfirst(lc));
 }
 
+/*
+ * __pgstromSessionIsReusable
+ *
+ * The session on the xPU service can be reused on rescan, if the xpucode
+ * parameters and the inner buffer are not changed. GpuPreAgg's final buffer
+ * and the outer-join-map are accumulated per session, so they need a new
+ * session for each scan.
+ */
+static bool
+__pgstromSessionIsReusable(pgstromTaskState *pts, bool inner_changed)
+{
+	Bitmapset  *chgParam = pts->css.ss.ps.chgParam;
+	ListCell   *lc;
+
+	if (!pts->conn || inner_changed)
+		return false;
+	if ((pts->xpu_task_flags & DEVTASK__PREAGG) != 0)
+		return false;
+	foreach (lc, pts->pp_info->used_params)
+	{
+		Param	   *param = lfirst(lc);
+
+		if (param->paramkind == PARAM_EXEC &&
+			bms_is_member(param->paramid, chgParam))
+			return false;
+	}
+	return true;
+}
+
 /*
  * pgstromExecResetTaskState
  */
@@ -1485,17 +2977,63 @@ void
 pgstromExecResetTaskState(CustomScanState *node)
 {
 	pgstromTaskState *pts = (pgstromTaskState *) node;
+	bool		inner_changed = false;
+	bool		reuse_session;
+	ListCell   *lc;
 
-	if (pts->conn)
+	/*
+	 * Inner relations have to be preloaded again, if they are affected by
+	 * the changed parameters, or outer-join-map has to be cleared.
+	 */
+	foreach (lc, pts->css.custom_ps)
+	{
+		PlanState  *ps = lfirst(lc);
+
+		if (node->ss.ps.chgParam != NULL)
+			UpdateChangedParamSet(ps, node->ss.ps.chgParam);
+		if (ps->chgParam != NULL)
+			inner_changed = true;
+	}
+	for (int i=0; i < pts->num_rels; i++)
+	{
+		JoinType	join_type = pts->inners[i].join_type;
+
+		if (join_type == JOIN_RIGHT || join_type == JOIN_FULL)
+			inner_changed = true;
+	}
+
+	reuse_session = __pgstromSessionIsReusable(pts, inner_changed);
+	if (reuse_session && !xpuClientResetSession(pts->conn))
+		reuse_session = false;
+	if (pts->conn && !reuse_session)
 	{
 		xpuClientCloseSession(pts->conn);
 		pts->conn = NULL;
 	}
+	/* all the responses are already released */
+	pts->curr_resp = NULL;
+	pts->curr_kds = NULL;
+	pts->curr_chunk = 0;
+	pts->curr_index = 0;
+	pts->scan_done = false;
+	pts->final_done = false;
+	pts->curr_block_num = 0;
+	pts->curr_block_tail = 0;
+	pts->fallback_index = 0;
+	pts->fallback_nitems = 0;
+	pts->fallback_usage = 0;
+	if (pts->css.ss.ss_currentScanDesc)
+		table_rescan(pts->css.ss.ss_currentScanDesc, NULL);
 	pgstromTaskStateResetScan(pts);
+	if (inner_changed && pts->num_rels > 0)
+		GpuJoinInnerReset(pts);
 	if (pts->br_state)
 		pgstromBrinIndexExecReset(pts);
 	if (pts->arrow_state)
 		pgstromArrowFdwExecReset(pts->arrow_state);
+	/* kept session begins the next scan immediately */
+	if (reuse_session && !pgstromTaskStateBeginScan(pts))
+		pts->scan_done = pts->final_done = true;
 }
 
 /*
@@ -1890,6 +3428,53 @@ pgstromExplainTaskState(CustomScanState *node,
 		}
 	}
 
+	/*
+	 * Top-N pushdown
+	 */
+	if (pp_info->topn_nrows > 0)
+	{
+		ListCell   *lc1, *lc2;
+		bool		has_partition = false;
+		bool		is_first = true;
+
+		resetStringInfo(&buf);
+		forboth (lc1, pp_info->topn_keys,
+				 lc2, pp_info->topn_flags)
+		{
+			TargetEntry *tle = list_nth(cscan->custom_scan_tlist, lfirst_int(lc1));
+			int		flags = lfirst_int(lc2);
+
+			str = deparse_expression((Node *)tle->expr, dcontext, false, true);
+			if ((flags & KERN_TOPN_FLAG__PARTITION) != 0)
+			{
+				appendStringInfoString(&buf, !has_partition ? "PARTITION BY " : ", ");
+				appendStringInfoString(&buf, str);
+				has_partition = true;
+				continue;
+			}
+			if (is_first && has_partition)
+				appendStringInfoString(&buf, " ORDER BY ");
+			else if (!is_first)
+				appendStringInfoString(&buf, ", ");
+			appendStringInfoString(&buf, str);
+			is_first = false;
+			if ((flags & KERN_TOPN_FLAG__DESC) != 0)
+			{
+				appendStringInfoString(&buf, " DESC");
+				if ((flags & KERN_TOPN_FLAG__NULLS_FIRST) == 0)
+					appendStringInfoString(&buf, " NULLS LAST");
+			}
+			else if ((flags & KERN_TOPN_FLAG__NULLS_FIRST) != 0)
+				appendStringInfoString(&buf, " NULLS FIRST");
+		}
+		appendStringInfo(&buf, " [limit: %u%s%s]",
+						 pp_info->topn_nrows,
+						 has_partition ? " per partition" : "",
+						 pp_info->topn_with_ties ? ", with ties" : "");
+		snprintf(label, sizeof(label), "%s Top-N", xpu_label);
+		ExplainPropertyText(label, buf.data, es);
+	}
+
 	/*
 	 * Storage related info
 	 */
@@ -1957,6 +3542,14 @@ pgstromExplainTaskState(CustomScanState *node,
 	/* State of BRIN-index */
 	if (pts->br_state)
 		pgstromBrinIndexExplain(pts, dcontext, es);
+	/* State of CPU fallback */
+	if (es->analyze && ps_state)
+	{
+		uint32		count = pg_atomic_read_u32(&ps_state->fallback_nchunks);
+
+		if (count > 0)
+			ExplainPropertyInteger("CPU Fallback Chunks", NULL, count, es);
+	}
 
 	/*
 	 * Dump the XPU code (only if verbose)
@@ -2030,16 +3623,36 @@ __xpuClientOpenSession(pgstromTaskState *pts,
 					   const XpuCommand *session,
 					   pgsocket sockfd,
 					   const char *devname,
-					   int dev_index)
+					   int dev_index,
+					   bool local_service)
 {
 	XpuConnection  *conn;
 	XpuCommand	   *resp;
+	xpuShmRing	   *shmring = NULL;
 	int				rv;
 
 	Assert(!pts->conn);
+	/*
+	 * The local xPU service expects the handshake message at the head of
+	 * the connection, to set up the shared-memory ring transport.
+	 */
+	if (local_service &&
+		!xpuShmRingCreate(sockfd,
+						  (size_t)pgstrom_xpu_shmring_size_kb << 10,
+						  &shmring))
+	{
+		int		errno_saved = errno;
+
+		close(sockfd);
+		errno = errno_saved;
+		elog(ERROR, "failed on setup of the shared-memory ring for %s: %m",
+			 devname);
+	}
 	conn = calloc(1, sizeof(XpuConnection));
 	if (!conn)
 	{
+		if (shmring)
+			xpuShmRingClose(shmring);
 		close(sockfd);
 		elog(ERROR, "out of memory");
 	}
@@ -2053,6 +3666,7 @@ __xpuClientOpenSession(pgstromTaskState *pts,
 	conn->num_ready_cmds = 0;
 	dlist_init(&conn->ready_cmds_list);
 	dlist_init(&conn->active_cmds_list);
+	conn->shmring = shmring;
 	dlist_push_tail(&xpu_connections_list, &conn->chain);
 	pts->conn = conn;
 
@@ -2079,6 +3693,11 @@ __xpuClientOpenSession(pgstromTaskState *pts,
 			 resp->u.error.filename,
 			 resp->u.error.lineno,
 			 resp->u.error.funcname);
+	/* the remote DPU may accept the wire compression */
+	if (resp->length >= offsetof(XpuCommand, u.reply) + sizeof(kern_session_reply))
+		xpuWireCompressorInit(&conn->wcomp,
+							  resp->u.reply.wire_compression,
+							  session->u.session.wire_compression_threshold);
 	xpuClientPutResponse(resp);
 }
 
@@ -2088,6 +3707,65 @@ __xpuClientOpenSession(pgstromTaskState *pts,
 void
 pgstrom_init_executor(void)
 {
+	DefineCustomIntVariable("pg_strom.virtual_tuple_threshold",
+							"Min number of attributes to return the device results in pre-deformed format (0 = disabled)",
+							NULL,
+							&pgstrom_virtual_tuple_threshold,
+							16,
+							0,
+							MaxTupleAttributeNumber,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.xpu_inflight_mem_limit",
+							"Limit of the total length of in-flight xPU results per connection (0 = unlimited)",
+							NULL,
+							&pgstrom_xpu_inflight_mem_limit_kb,
+							1024 * 1024,	/* 1GB */
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	DefineCustomBoolVariable("pg_strom.xpu_mvcc_checks",
+							 "Enables MVCC visibility checks on xPU for the pages not all-visible",
+							 NULL,
+							 &pgstrom_xpu_mvcc_checks,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.xpu_mvcc_clog_xids",
+							"Number of the recent transactions whose commit status is sent to xPU",
+							NULL,
+							&pgstrom_xpu_mvcc_clog_xids,
+							65536,
+							0,
+							16 * 1024 * 1024,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.xpu_async_prefetch",
+							"Number of the sibling xPU tasks to be started ahead of the poll (0 = disabled)",
+							NULL,
+							&pgstrom_xpu_async_prefetch,
+							0,
+							0,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.xpu_shmring_size",
+							"Size of the shared-memory ring to communicate with the local xPU service (0 = disabled)",
+							NULL,
+							&pgstrom_xpu_shmring_size_kb,
+							32 * 1024,		/* 32MB */
+							0,
+							1024 * 1024,	/* 1GB */
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	dlist_init(&xpu_connections_list);
+	dlist_init(&pgstrom_async_pending_list);
 	RegisterResourceReleaseCallback(xpuclientCleanupConnections, NULL);
 }
@@ -15,6 +15,11 @@
 
 /* static variables */
 static set_join_pathlist_hook_type	set_join_pathlist_next = NULL;
+static create_upper_paths_hook_type	create_upper_paths_next = NULL;
+static bool					pgstrom_enable_topn_pushdown = true;	/* GUC */
+static int					pgstrom_topn_pushdown_max_nrows = 10000;	/* GUC */
+static bool					pgstrom_enable_window_topk = true;	/* GUC */
+int							pgstrom_window_topk_buffer_size_kb;	/* GUC */
 
 static CustomPathMethods	gpujoin_path_methods;
 static CustomScanMethods	gpujoin_plan_methods;
@@ -87,6 +92,11 @@ form_pgstrom_plan_info(CustomScan *cscan, pgstromPlanInfo *pp_info)
 	privs = lappend(privs, pp_info->fallback_tlist);
 	privs = lappend(privs, pp_info->groupby_actions);
 	privs = lappend(privs, pp_info->groupby_keys);
+	/* top-N parameters */
+	privs = lappend(privs, makeInteger(pp_info->topn_nrows));
+	privs = lappend(privs, pp_info->topn_keys);
+	privs = lappend(privs, pp_info->topn_flags);
+	privs = lappend(privs, makeBoolean(pp_info->topn_with_ties));
 	/* inner relations */
 	privs = lappend(privs, makeInteger(pp_info->num_rels));
 	for (int i=0; i < pp_info->num_rels; i++)
@@ -185,6 +195,11 @@ deform_pgstrom_plan_info(CustomScan *cscan)
 	pp_data.fallback_tlist = list_nth(privs, pindex++);
 	pp_data.groupby_actions = list_nth(privs, pindex++);
 	pp_data.groupby_keys = list_nth(privs, pindex++);
+	/* top-N parameters */
+	pp_data.topn_nrows = intVal(list_nth(privs, pindex++));
+	pp_data.topn_keys = list_nth(privs, pindex++);
+	pp_data.topn_flags = list_nth(privs, pindex++);
+	pp_data.topn_with_ties = boolVal(list_nth(privs, pindex++));
 	/* inner relations */
 	pp_data.num_rels = intVal(list_nth(privs, pindex++));
 	pp_info = palloc0(offsetof(pgstromPlanInfo, inners[pp_data.num_rels]));
@@ -249,6 +264,9 @@ copy_pgstrom_plan_info(const pgstromPlanInfo *pp_orig)
 	pp_dest->fallback_tlist   = copyObject(pp_dest->fallback_tlist);
 	pp_dest->groupby_actions  = list_copy(pp_dest->groupby_actions);
 	pp_dest->groupby_keys     = list_copy(pp_dest->groupby_keys);
+	pp_dest->topn_exprs       = copyObject(pp_dest->topn_exprs);
+	pp_dest->topn_keys        = list_copy(pp_dest->topn_keys);
+	pp_dest->topn_flags       = list_copy(pp_dest->topn_flags);
 	for (int j=0; j < pp_orig->num_rels; j++)
 	{
 		pgstromPlanInnerInfo *pp_inner = &pp_dest->inners[j];
@@ -1431,6 +1449,7 @@ PlanXpuJoinPathCommon(PlannerInfo *root,
 													NIL,
 													input_rels_tlist);
 		pp_info->kexp_projection = codegen_build_projection(&context);
+		pgstrom_build_topn_keys(pp_info, context.tlist_dev);
 	}
 	pull_varattnos((Node *)context.tlist_dev,
 				   pp_info->scan_relid,
@@ -2204,6 +2223,45 @@ GpuJoinInnerPreload(pgstromTaskState *pts)
 	return ps_state->preload_shmem_handle;
 }
 
+/*
+ * GpuJoinInnerReset
+ *
+ * It releases the inner buffer to be preloaded again on the next scan,
+ * because the inner relations may return different results.
+ */
+void
+GpuJoinInnerReset(pgstromTaskState *pts)
+{
+	pgstromSharedState *ps_state = pts->ps_state;
+	ListCell   *lc;
+
+	foreach (lc, pts->css.custom_ps)
+	{
+		PlanState  *ps = lfirst(lc);
+
+		/* if chgParam is not null, ExecProcNode() rescans the sub-plan */
+		if (ps->chgParam == NULL)
+			ExecReScan(ps);
+	}
+	if (pts->h_kmrels)
+	{
+		__munmapShmem(pts->h_kmrels);
+		pts->h_kmrels = NULL;
+	}
+	if (ps_state->preload_shmem_handle != 0)
+		__shmemDrop(ps_state->preload_shmem_handle);
+	ps_state->preload_shmem_handle = __shmemCreate(pts->ds_entry);
+	ps_state->preload_shmem_length = 0;
+	ps_state->preload_phase = INNER_PHASE__SCAN_RELATIONS;
+	ps_state->preload_nr_scanning = 0;
+	ps_state->preload_nr_setup = 0;
+	for (int i=0; i < pts->num_rels; i++)
+	{
+		pg_atomic_write_u64(&ps_state->inners[i].inner_nitems, 0);
+		pg_atomic_write_u64(&ps_state->inners[i].inner_usage, 0);
+	}
+}
+
 /*
  * CPU Fallback for JOIN
  */
@@ -2552,6 +2610,648 @@ ExecFallbackCpuJoinOuterJoinMap(pgstromTaskState *pts, XpuCommand *resp)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *
+ * Top-N (ORDER BY ... LIMIT) pushdown
+ *
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * __lookupTopNKeyKind - returns KERN_TOPN_KEY__*, or 0 if not supported
+ */
+static int
+__lookupTopNKeyKind(Oid type_oid)
+{
+	switch (type_oid)
+	{
+		case INT2OID:
+			return KERN_TOPN_KEY__INT16;
+		case INT4OID:
+		case DATEOID:
+			return KERN_TOPN_KEY__INT32;
+		case INT8OID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return KERN_TOPN_KEY__INT64;
+		case FLOAT4OID:
+			return KERN_TOPN_KEY__FP32;
+		case FLOAT8OID:
+			return KERN_TOPN_KEY__FP64;
+		default:
+			break;
+	}
+	return 0;
+}
+
+/*
+ * __buildTopNSortKeys
+ *
+ * It checks whether the ORDER BY clause is consists of the sort keys
+ * that xPU service can compare by the built-in ordering of the type.
+ */
+static bool
+__buildTopNSortKeys(List *sortClause,
+					List *targetList,
+					List **p_topn_exprs,
+					List **p_topn_flags)
+{
+	List	   *topn_exprs = NIL;
+	List	   *topn_flags = NIL;
+	ListCell   *lc;
+
+	foreach (lc, sortClause)
+	{
+		SortGroupClause *sgc = lfirst(lc);
+		Expr	   *expr = (Expr *)get_sortgroupclause_expr(sgc, targetList);
+		Oid			type_oid = exprType((Node *)expr);
+		TypeCacheEntry *tcache;
+		Oid			opfamily;
+		Oid			opcintype;
+		int16		strategy;
+		int			flags;
+
+		flags = __lookupTopNKeyKind(type_oid);
+		if (flags == 0)
+			return false;
+		tcache = lookup_type_cache(type_oid, TYPECACHE_BTREE_OPFAMILY);
+		if (!get_ordering_op_properties(sgc->sortop,
+										&opfamily,
+										&opcintype,
+										&strategy) ||
+			opfamily != tcache->btree_opf)
+			return false;
+		if (strategy == BTGreaterStrategyNumber)
+			flags |= KERN_TOPN_FLAG__DESC;
+		else if (strategy != BTLessStrategyNumber)
+			return false;
+		if (sgc->nulls_first)
+			flags |= KERN_TOPN_FLAG__NULLS_FIRST;
+		topn_exprs = lappend(topn_exprs, expr);
+		topn_flags = lappend_int(topn_flags, flags);
+	}
+	*p_topn_exprs = topn_exprs;
+	*p_topn_flags = topn_flags;
+	return (topn_exprs != NIL);
+}
+
+/*
+ * __buildTopNCustomPath
+ *
+ * It makes a copy of the xPU-Scan/Join path (or ProjectionPath on top of
+ * them) that keeps only the Top-N rows on the xPU service side.
+ * If partitioned, Top-N rows are kept for each of @num_parts partitions.
+ */
+static Path *
+__buildTopNCustomPath(PlannerInfo *root,
+					  Path *input_path,
+					  uint32_t topn_nrows,
+					  List *topn_exprs,
+					  List *topn_flags,
+					  bool topn_with_ties,
+					  double num_parts)
+{
+	ProjectionPath *ppath = NULL;
+	CustomPath	   *cpath;
+	pgstromPlanInfo *pp_orig;
+	pgstromPlanInfo *pp_info;
+	double			nrows;
+	double			ratio;
+
+	if (IsA(input_path, ProjectionPath))
+	{
+		ppath = (ProjectionPath *)input_path;
+		input_path = ppath->subpath;
+	}
+	if ((pp_orig = try_fetch_xpuscan_planinfo(input_path)) == NULL &&
+		(pp_orig = try_fetch_xpujoin_planinfo(input_path)) == NULL)
+		return NULL;
+	/* host qualifiers and RIGHT/FULL OUTER JOIN produce rows later */
+	if (pp_orig->host_quals != NIL)
+		return NULL;
+	for (int i=0; i < pp_orig->num_rels; i++)
+	{
+		JoinType	join_type = pp_orig->inners[i].join_type;
+
+		if (join_type == JOIN_RIGHT || join_type == JOIN_FULL)
+			return NULL;
+	}
+	pp_info = copy_pgstrom_plan_info(pp_orig);
+	pp_info->topn_nrows = topn_nrows;
+	pp_info->topn_exprs = topn_exprs;
+	pp_info->topn_flags = topn_flags;
+	pp_info->topn_with_ties = topn_with_ties;
+
+	cpath = makeNode(CustomPath);
+	memcpy(cpath, input_path, sizeof(CustomPath));
+	cpath->custom_private = list_make1(pp_info);
+	/* only Top-N rows are written back to the host */
+	nrows = Min((double)topn_nrows * num_parts, cpath->path.rows);
+	ratio = (cpath->path.rows > 0.0 ? nrows / cpath->path.rows : 1.0);
+	cpath->path.total_cost -= pp_info->final_cost * (1.0 - ratio);
+	pp_info->final_cost *= ratio;
+	cpath->path.rows = nrows;
+
+	if (ppath)
+		return (Path *)create_projection_path(root,
+											  ppath->path.parent,
+											  &cpath->path,
+											  ppath->path.pathtarget);
+	return &cpath->path;
+}
+
+/*
+ * __lookupWindowTopKRunCondition
+ *
+ * It checks the run condition of the monotonic window function, like
+ * "row_number() OVER (...) <= K", and returns the K, or 0 if not supported.
+ */
+static uint32_t
+__lookupWindowTopKRunCondition(Oid opno, bool wfunc_left, Expr *arg)
+{
+	Const	   *con = (Const *)arg;
+	char	   *opname;
+	int64		ival;
+
+	if (!IsA(con, Const) || con->constisnull)
+		return 0;
+	switch (con->consttype)
+	{
+		case INT2OID:
+			ival = DatumGetInt16(con->constvalue);
+			break;
+		case INT4OID:
+			ival = DatumGetInt32(con->constvalue);
+			break;
+		case INT8OID:
+			ival = DatumGetInt64(con->constvalue);
+			break;
+		default:
+			return 0;
+	}
+	opname = get_opname(opno);
+	if (!opname)
+		return 0;
+	if (strcmp(opname, "=") == 0 ||
+		strcmp(opname, wfunc_left ? "<=" : ">=") == 0)
+		;
+	else if (strcmp(opname, wfunc_left ? "<" : ">") == 0)
+		ival--;
+	else
+		return 0;
+	if (ival < 1 || ival > pgstrom_topn_pushdown_max_nrows)
+		return 0;
+	return (uint32_t)ival;
+}
+
+/*
+ * __buildWindowTopKPath
+ *
+ * It rebuilds the WindowAgg path on top of the xPU-Scan/Join path that
+ * keeps only the Top-K rows for each partition. Sort, IncrementalSort,
+ * Projection and Gather nodes between them are rebuilt as well.
+ */
+static Path *
+__buildWindowTopKPath(PlannerInfo *root,
+					  Path *path,
+					  List *windowFuncs,
+					  uint32_t topn_nrows,
+					  List *topn_exprs,
+					  List *topn_flags,
+					  bool topn_with_ties,
+					  double num_parts)
+{
+	Path	   *subpath;
+
+	switch (nodeTag(path))
+	{
+		case T_WindowAggPath:
+			{
+				WindowAggPath *wpath = (WindowAggPath *)path;
+
+				subpath = __buildWindowTopKPath(root, wpath->subpath,
+												windowFuncs,
+												topn_nrows,
+												topn_exprs,
+												topn_flags,
+												topn_with_ties,
+												num_parts);
+				if (!subpath)
+					return NULL;
+				return (Path *)create_windowagg_path(root,
+													 path->parent,
+													 subpath,
+													 path->pathtarget,
+													 windowFuncs,
+#if PG_VERSION_NUM >= 170000
+													 wpath->runCondition,
+#endif
+													 wpath->winclause,
+													 wpath->qual,
+													 wpath->topwindow);
+			}
+		case T_SortPath:
+			subpath = __buildWindowTopKPath(root, ((SortPath *)path)->subpath,
+											windowFuncs,
+											topn_nrows,
+											topn_exprs,
+											topn_flags,
+											topn_with_ties,
+											num_parts);
+			if (!subpath)
+				return NULL;
+			return (Path *)create_sort_path(root,
+											path->parent,
+											subpath,
+											path->pathkeys,
+											-1.0);
+		case T_IncrementalSortPath:
+			{
+				IncrementalSortPath *ipath = (IncrementalSortPath *)path;
+
+				subpath = __buildWindowTopKPath(root, ipath->spath.subpath,
+												windowFuncs,
+												topn_nrows,
+												topn_exprs,
+												topn_flags,
+												topn_with_ties,
+												num_parts);
+				if (!subpath)
+					return NULL;
+				return (Path *)create_incremental_sort_path(root,
+															path->parent,
+															subpath,
+															path->pathkeys,
+															ipath->nPresortedCols,
+															-1.0);
+			}
+		case T_GatherPath:
+			{
+				double	total_rows;
+
+				/* every worker keeps its own Top-K rows */
+				subpath = __buildTopNCustomPath(root, ((GatherPath *)path)->subpath,
+												topn_nrows,
+												topn_exprs,
+												topn_flags,
+												topn_with_ties,
+												num_parts);
+				if (!subpath)
+					return NULL;
+				total_rows = subpath->rows * Max(subpath->parallel_workers, 1);
+				return (Path *)create_gather_path(root,
+												  path->parent,
+												  subpath,
+												  path->pathtarget,
+												  NULL,
+												  &total_rows);
+			}
+		default:
+			break;
+	}
+	/* Projection on the xPU-Scan/Join path is handled here */
+	return __buildTopNCustomPath(root, path,
+								 topn_nrows,
+								 topn_exprs,
+								 topn_flags,
+								 topn_with_ties,
+								 num_parts);
+}
+
+/*
+ * XpuWindowTopKAddCustomPath
+ *
+ * When the outer query filters the result of row_number() or rank() by
+ * a constant, like "WHERE rn <= K", the run condition is attached to the
+ * WindowClause. Then, the xPU service keeps only the Top-K rows for each
+ * partition (PARTITION BY) in the order of ORDER BY, and the WindowAgg
+ * on the host side computes the ranks again on the reduced rows.
+ * Because rank() assigns the same rank to the peer rows, all the rows
+ * tied with the K-th row are kept also.
+ */
+static void
+XpuWindowTopKAddCustomPath(PlannerInfo *root,
+						   RelOptInfo *input_rel,
+						   RelOptInfo *window_rel)
+{
+	Query	   *parse = root->parse;
+	WindowClause *wc;
+	WindowFuncLists *wflists;
+	List	   *windowFuncs;
+	List	   *part_exprs = NIL;
+	List	   *topn_exprs = NIL;
+	List	   *topn_flags = NIL;
+	List	   *sort_exprs;
+	List	   *sort_flags;
+	List	   *pathlist;
+	uint32_t	topn_nrows = 0;
+	bool		topn_with_ties = false;
+	double		num_parts = 1.0;
+	ListCell   *lc;
+
+	if (!pgstrom_enable_window_topk ||
+		list_length(parse->windowClause) != 1 ||
+		parse->rowMarks != NIL ||
+		parse->hasTargetSRFs)
+		return;
+	wc = linitial(parse->windowClause);
+	/* only row_number() and rank() are supported */
+	wflists = find_window_functions((Node *)parse->targetList, wc->winref);
+	windowFuncs = wflists->windowFuncs[wc->winref];
+	if (windowFuncs == NIL ||
+		list_length(windowFuncs) != wflists->numWindowFuncs)
+		return;
+	foreach (lc, windowFuncs)
+	{
+		WindowFunc *wfunc = lfirst(lc);
+
+		if (wfunc->winfnoid == F_RANK_)
+			topn_with_ties = true;
+		else if (wfunc->winfnoid != F_ROW_NUMBER)
+			return;
+#if PG_VERSION_NUM >= 170000
+		foreach_node (WindowFuncRunCondition, wfuncrc, wfunc->runCondition)
+		{
+			uint32_t	nrows = __lookupWindowTopKRunCondition(wfuncrc->opno,
+															   wfuncrc->wfunc_left,
+															   wfuncrc->arg);
+			if (nrows > 0 && (topn_nrows == 0 || nrows < topn_nrows))
+				topn_nrows = nrows;
+		}
+#endif
+	}
+#if PG_VERSION_NUM < 170000
+	foreach (lc, wc->runCondition)
+	{
+		OpExpr	   *op = lfirst(lc);
+		bool		wfunc_left;
+		uint32_t	nrows;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+		wfunc_left = IsA(linitial(op->args), WindowFunc);
+		nrows = __lookupWindowTopKRunCondition(op->opno,
+											   wfunc_left,
+											   wfunc_left
+											   ? lsecond(op->args)
+											   : linitial(op->args));
+		if (nrows > 0 && (topn_nrows == 0 || nrows < topn_nrows))
+			topn_nrows = nrows;
+	}
+#endif
+	if (topn_nrows == 0)
+		return;
+	/* partition keys are compared by the binary image */
+	foreach (lc, wc->partitionClause)
+	{
+		SortGroupClause *sgc = lfirst(lc);
+		Expr   *expr = (Expr *)get_sortgroupclause_expr(sgc, parse->targetList);
+
+		part_exprs = lappend(part_exprs, expr);
+		topn_exprs = lappend(topn_exprs, expr);
+		topn_flags = lappend_int(topn_flags, KERN_TOPN_FLAG__PARTITION);
+	}
+	if (!__buildTopNSortKeys(wc->orderClause,
+							 parse->targetList,
+							 &sort_exprs,
+							 &sort_flags))
+		return;
+	topn_exprs = list_concat(topn_exprs, sort_exprs);
+	topn_flags = list_concat(topn_flags, sort_flags);
+	if (part_exprs != NIL)
+		num_parts = estimate_num_groups(root, part_exprs,
+										input_rel->rows,
+										NULL, NULL);
+
+	/* WindowAgg paths are already built by the core */
+	pathlist = list_copy(window_rel->pathlist);
+	foreach (lc, pathlist)
+	{
+		Path   *path = __buildWindowTopKPath(root, lfirst(lc),
+											 windowFuncs,
+											 topn_nrows,
+											 topn_exprs,
+											 topn_flags,
+											 topn_with_ties,
+											 num_parts);
+		if (path)
+			add_path(window_rel, path);
+	}
+	list_free(pathlist);
+}
+
+/*
+ * XpuTopNAddCustomPath
+ */
+static void
+XpuTopNAddCustomPath(PlannerInfo *root,
+					 UpperRelationKind stage,
+					 RelOptInfo *input_rel,
+					 RelOptInfo *output_rel,
+					 void *extra)
+{
+	Query	   *parse = root->parse;
+	List	   *topn_exprs;
+	List	   *topn_flags;
+	uint32_t	topn_nrows;
+	ListCell   *lc;
+
+	if (create_upper_paths_next)
+		create_upper_paths_next(root,
+								stage,
+								input_rel,
+								output_rel,
+								extra);
+	if (!pgstrom_enabled ||
+		!pgstrom_enable_topn_pushdown)
+		return;
+	if (stage == UPPERREL_WINDOW)
+	{
+		XpuWindowTopKAddCustomPath(root, input_rel, output_rel);
+		return;
+	}
+	if (stage != UPPERREL_ORDERED)
+		return;
+	if (root->limit_tuples < 1.0 ||
+		root->limit_tuples > (double)pgstrom_topn_pushdown_max_nrows ||
+		parse->rowMarks != NIL ||
+		parse->hasTargetSRFs ||
+		parse->limitOption == LIMIT_OPTION_WITH_TIES ||
+		parse->sortClause == NIL)
+		return;
+	if (!__buildTopNSortKeys(parse->sortClause,
+							 parse->targetList,
+							 &topn_exprs,
+							 &topn_flags))
+		return;
+	topn_nrows = (uint32_t)root->limit_tuples;
+
+	foreach (lc, input_rel->pathlist)
+	{
+		Path   *path = __buildTopNCustomPath(root, lfirst(lc),
+											 topn_nrows,
+											 topn_exprs,
+											 topn_flags,
+											 false,
+											 1.0);
+		if (!path)
+			continue;
+		path = (Path *)create_sort_path(root,
+										output_rel,
+										path,
+										root->sort_pathkeys,
+										root->limit_tuples);
+		if (path->pathtarget != output_rel->reltarget)
+			path = apply_projection_to_path(root,
+											output_rel,
+											path,
+											output_rel->reltarget);
+		add_path(output_rel, path);
+	}
+
+	/* Gather Merge on the Top-N rows of the parallel workers */
+	if (output_rel->consider_parallel)
+	{
+		foreach (lc, input_rel->partial_pathlist)
+		{
+			Path   *path = __buildTopNCustomPath(root, lfirst(lc),
+												 topn_nrows,
+												 topn_exprs,
+												 topn_flags,
+												 false,
+												 1.0);
+			double	total_groups;
+
+			if (!path)
+				continue;
+			path = (Path *)create_sort_path(root,
+											output_rel,
+											path,
+											root->sort_pathkeys,
+											root->limit_tuples);
+			total_groups = path->rows * path->parallel_workers;
+			path = (Path *)create_gather_merge_path(root,
+													output_rel,
+													path,
+													path->pathtarget,
+													root->sort_pathkeys,
+													NULL,
+													&total_groups);
+			if (path->pathtarget != output_rel->reltarget)
+				path = apply_projection_to_path(root,
+												output_rel,
+												path,
+												output_rel->reltarget);
+			add_path(output_rel, path);
+		}
+	}
+}
+
+/*
+ * pgstrom_build_topn_keys
+ *
+ * It resolves the sort keys of Top-N to the attribute index of kds_dst,
+ * that is the non-junk entries of tlist_dev. If any sort key is not
+ * projected, Top-N pushdown is given up, and Sort node works as usual.
+ */
+void
+pgstrom_build_topn_keys(pgstromPlanInfo *pp_info, List *tlist_dev)
+{
+	List	   *topn_keys = NIL;
+	ListCell   *lc1, *lc2;
+
+	if (pp_info->topn_nrows == 0)
+		return;
+	foreach (lc1, pp_info->topn_exprs)
+	{
+		Expr   *expr = lfirst(lc1);
+		int		attnum = -1;
+
+		foreach (lc2, tlist_dev)
+		{
+			TargetEntry *tle = lfirst(lc2);
+
+			if (tle->resjunk)
+				break;
+			if (equal(tle->expr, expr))
+			{
+				attnum = foreach_current_index(lc2);
+				break;
+			}
+		}
+		if (attnum < 0)
+		{
+			elog(DEBUG2, "Top-N sort key is not in the device projection: %s",
+				 nodeToString(expr));
+			pp_info->topn_nrows = 0;
+			pp_info->topn_exprs = NIL;
+			pp_info->topn_flags = NIL;
+			pp_info->topn_with_ties = false;
+			return;
+		}
+		topn_keys = lappend_int(topn_keys, attnum);
+	}
+	pp_info->topn_keys = topn_keys;
+}
+
+/*
+ * __pgstrom_init_topn_pushdown
+ */
+static void
+__pgstrom_init_topn_pushdown(void)
+{
+	static bool	__topn_pushdown_initialized = false;
+
+	if (__topn_pushdown_initialized)
+		return;
+	/* turn on/off Top-N pushdown */
+	DefineCustomBoolVariable("pg_strom.enable_topn_pushdown",
+							 "Enables the Top-N (ORDER BY ... LIMIT) pushdown to xPU",
+							 NULL,
+							 &pgstrom_enable_topn_pushdown,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* max number of rows for Top-N pushdown */
+	DefineCustomIntVariable("pg_strom.topn_pushdown_max_nrows",
+							"Max number of rows for the Top-N pushdown",
+							NULL,
+							&pgstrom_topn_pushdown_max_nrows,
+							10000,
+							1,
+							1000000,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* turn on/off per-partition Top-K of window functions */
+	DefineCustomBoolVariable("pg_strom.enable_window_topk",
+							 "Enables the per-partition Top-K pushdown of row_number() and rank()",
+							 NULL,
+							 &pgstrom_enable_window_topk,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* max buffer size of Top-N rows per session (0 = unlimited) */
+	DefineCustomIntVariable("pg_strom.window_topk_buffer_size",
+							"Max size of the rows kept by Top-N/Top-K pushdown per session (0 = unlimited)",
+							NULL,
+							&pgstrom_window_topk_buffer_size_kb,
+							128 * 1024,		/* 128MB */
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	/* hook registration */
+	create_upper_paths_next = create_upper_paths_hook;
+	create_upper_paths_hook = XpuTopNAddCustomPath;
+
+	__topn_pushdown_initialized = true;
+}
+
 /*
  * pgstrom_init_gpu_join
  */
@@ -2615,6 +3315,8 @@ pgstrom_init_gpu_join(void)
 		set_join_pathlist_next = set_join_pathlist_hook;
 		set_join_pathlist_hook = XpuJoinAddCustomPath;
 	}
+	/* Top-N pushdown */
+	__pgstrom_init_topn_pushdown();
 }
 
 
@@ -2681,4 +3383,6 @@ pgstrom_init_dpu_join(void)
 		set_join_pathlist_next = set_join_pathlist_hook;
 		set_join_pathlist_hook = XpuJoinAddCustomPath;
 	}
+	/* Top-N pushdown */
+	__pgstrom_init_topn_pushdown();
 }
@@ -24,7 +24,12 @@ static bool					pgstrom_enable_partitionwise_dpupreagg = false;
 static bool					pgstrom_enable_gpupreagg = false;
 static bool					pgstrom_enable_partitionwise_gpupreagg = false;
 static bool					pgstrom_enable_numeric_aggfuncs;
+static bool					pgstrom_enable_hll_count_distinct;
 int							pgstrom_hll_register_bits;
+static bool					pgstrom_enable_quantile_sketch;
+int							pgstrom_quantile_sketch_bits;
+static bool					pgstrom_enable_eager_preagg;
+static int					pgstrom_minmax_varlena_buffer_size;
 
 /*
  * List of supported aggregate functions
@@ -194,6 +199,90 @@ static aggfunc_catalog_t	aggfunc_catalog_array[] = {
 	 "s:pmax(timestamptz)",
 	 KAGG_ACTION__PMAX_INT64, false
 	},
+	/*
+	 * MIN(X)/MAX(X) of variable-length types; see pminmax_bytes_packed
+	 */
+	{"min(text)",
+	 "s:min_text(bytea)",
+	 "s:pmin(text)",
+	 KAGG_ACTION__PMIN_BYTES, false
+	},
+	{"max(text)",
+	 "s:max_text(bytea)",
+	 "s:pmax(text)",
+	 KAGG_ACTION__PMAX_BYTES, false
+	},
+	{"min(bytea)",
+	 "s:min_bytea(bytea)",
+	 "s:pmin(bytea)",
+	 KAGG_ACTION__PMIN_BYTES, false
+	},
+	{"max(bytea)",
+	 "s:max_bytea(bytea)",
+	 "s:pmax(bytea)",
+	 KAGG_ACTION__PMAX_BYTES, false
+	},
+	{"min(uuid)",
+	 "s:min_uuid(bytea)",
+	 "s:pmin(uuid)",
+	 KAGG_ACTION__PMIN_BYTES, false
+	},
+	{"max(uuid)",
+	 "s:max_uuid(bytea)",
+	 "s:pmax(uuid)",
+	 KAGG_ACTION__PMAX_BYTES, false
+	},
+	/*
+	 * BOOL_AND(X) = MIN(PMIN(X::int4)), BOOL_OR(X) = MAX(PMAX(X::int4))
+	 */
+	{"bool_and(bool)",
+	 "s:bool_and(bytea)",
+	 "s:pmin(int4)",
+	 KAGG_ACTION__PMIN_INT32, false
+	},
+	{"every(bool)",
+	 "s:bool_and(bytea)",
+	 "s:pmin(int4)",
+	 KAGG_ACTION__PMIN_INT32, false
+	},
+	{"bool_or(bool)",
+	 "s:bool_or(bytea)",
+	 "s:pmax(int4)",
+	 KAGG_ACTION__PMAX_INT32, false
+	},
+	/*
+	 * BIT_AND(X) = BIT_AND(PBIT_AND(X)), BIT_OR(X) = BIT_OR(PBIT_OR(X))
+	 */
+	{"bit_and(int2)",
+	 "s:bit_and_i2(bytea)",
+	 "s:pbit_and(int8)",
+	 KAGG_ACTION__PBITAND, false
+	},
+	{"bit_and(int4)",
+	 "s:bit_and_i4(bytea)",
+	 "s:pbit_and(int8)",
+	 KAGG_ACTION__PBITAND, false
+	},
+	{"bit_and(int8)",
+	 "s:bit_and_i8(bytea)",
+	 "s:pbit_and(int8)",
+	 KAGG_ACTION__PBITAND, false
+	},
+	{"bit_or(int2)",
+	 "s:bit_or_i2(bytea)",
+	 "s:pbit_or(int8)",
+	 KAGG_ACTION__PBITOR, false
+	},
+	{"bit_or(int4)",
+	 "s:bit_or_i4(bytea)",
+	 "s:pbit_or(int8)",
+	 KAGG_ACTION__PBITOR, false
+	},
+	{"bit_or(int8)",
+	 "s:bit_or_i8(bytea)",
+	 "s:pbit_or(int8)",
+	 KAGG_ACTION__PBITOR, false
+	},
 	/*
 	 * SUM(X) = SUM(PSUM(X))
 	 */
@@ -232,10 +321,11 @@ static aggfunc_catalog_t	aggfunc_catalog_array[] = {
 	 "s:psum(float8)",
 	 KAGG_ACTION__PSUM_FP, false
 	},
+	/* SUM(numeric) is exact using 128bit scaled integer */
 	{"sum(numeric)",
-	 "s:sum_num(float8)",
-	 "s:psum(float8)",
-	 KAGG_ACTION__PSUM_FP, true
+	 "s:sum_numeric(bytea)",
+	 "s:pavg(numeric)",
+	 KAGG_ACTION__PAVG_NUM, false
 	},
 	{"sum(money)",
 	 "s:sum_cash(int8)",
@@ -281,9 +371,9 @@ static aggfunc_catalog_t	aggfunc_catalog_array[] = {
 	 KAGG_ACTION__PAVG_FP, false
 	},
 	{"avg(numeric)",
-	 "s:avg_num(bytea)",
-	 "s:pavg(float8)",
-	 KAGG_ACTION__PAVG_FP, true
+	 "s:avg_numeric(bytea)",
+	 "s:pavg(numeric)",
+	 KAGG_ACTION__PAVG_NUM, false
 	},
 	/*
 	 * STDDEV(X) = EX_STDDEV_SAMP(NROWS(),PSUM(X),PSUM(X*X))
@@ -614,6 +704,82 @@ static aggfunc_catalog_t	aggfunc_catalog_array[] = {
 	 "s:pcovar(float8,float8)",
 	 KAGG_ACTION__COVAR, false
 	},
+	/*
+	 * HLL_COUNT(X) = HLL_COMBINE(HLL_SKETCH_NEW(HLL_HASH(X),BITS))
+	 *
+	 * It is an approximate COUNT(DISTINCT X) by HyperLogLog; the registers
+	 * are updated on the device, then merged by the final aggregation.
+	 */
+	{"s:hll_count(int1)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(int2)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(int4)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(int8)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(numeric)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(date)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(time)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(timetz)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(timestamp)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(timestamptz)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(bpchar)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(text)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(bytea)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
+	{"s:hll_count(uuid)",
+	 "s:hll_combine(bytea)",
+	 "s:hll_sketch_new(int8,int4)",
+	 KAGG_ACTION__HLL, false
+	},
 	{ NULL, NULL, NULL, -1, false },
 };
 
@@ -732,8 +898,13 @@ __aggfunc_resolve_partial_func(aggfunc_catalog_entry *entry,
 		case KAGG_ACTION__PMAX_INT32:
 		case KAGG_ACTION__PMAX_INT64:
 		case KAGG_ACTION__PMAX_FP64:
+		case KAGG_ACTION__PMIN_BYTES:
+		case KAGG_ACTION__PMAX_BYTES:
+		case KAGG_ACTION__PBITAND:
+		case KAGG_ACTION__PBITOR:
 		case KAGG_ACTION__PAVG_INT:
 		case KAGG_ACTION__PAVG_FP:
+		case KAGG_ACTION__PAVG_NUM:
 		case KAGG_ACTION__STDDEV:
 			type_oid = BYTEAOID;
 			break;
@@ -741,6 +912,10 @@ __aggfunc_resolve_partial_func(aggfunc_catalog_entry *entry,
 			func_nargs = 2;
 			type_oid = BYTEAOID;
 			break;
+		case KAGG_ACTION__HLL:
+			func_nargs = 2;		/* hash and number of register bits */
+			type_oid = BYTEAOID;
+			break;
 		default:
 			elog(ERROR, "Catalog corruption? unknown action: %d", partfn_action);
 			break;
@@ -819,13 +994,17 @@ aggfunc_catalog_lookup_by_oid(Oid aggfn_oid)
 			if (!HeapTupleIsValid(htup))
 				elog(ERROR, "cache lookup failed for function %u", aggfn_oid);
 			proc = (Form_pg_proc) GETSTRUCT(htup);
-			if (proc->pronamespace == PG_CATALOG_NAMESPACE &&
+			if ((proc->pronamespace == PG_CATALOG_NAMESPACE ||
+				 proc->pronamespace == get_namespace_oid("pgstrom", true)) &&
 				proc->pronargs <= 2)
 			{
 				char	buf[3*NAMEDATALEN+100];
 				int		off;
 
-				off = sprintf(buf, "%s(", NameStr(proc->proname));
+				/* PG-Strom's own aggregate functions have 's:' prefix */
+				off = sprintf(buf, "%s%s(",
+							  proc->pronamespace == PG_CATALOG_NAMESPACE ? "" : "s:",
+							  NameStr(proc->proname));
 				for (int j=0; j < proc->pronargs; j++)
 				{
 					Oid		type_oid = proc->proargtypes.values[j];
@@ -884,6 +1063,9 @@ typedef struct
 	double			num_groups;
 	bool			try_parallel;
 	PathTarget	   *target_upper;
+	List		   *groupClause;	/* GROUP BY or DISTINCT clause */
+	List		   *final_keys;		/* grouping-keys at the final Agg */
+	List		   *eager_keys;		/* partial keys, if eager pre-aggregation */
 	PathTarget	   *target_partial;
 	PathTarget	   *target_final;
 	AggClauseCosts	final_clause_costs;
@@ -894,6 +1076,9 @@ typedef struct
 	const CustomPathMethods *custom_path_methods;
 } xpugroupby_build_path_context;
 
+static Node *replace_expression_by_altfunc(Node *node,
+										  xpugroupby_build_path_context *con);
+
 /*
  * make_expr_typecast - constructor of type cast
  */
@@ -949,6 +1134,422 @@ make_expr_typecast(Expr *expr, Oid target_type)
 	return expr;
 }
 
+/*
+ * pgstrom_numeric_expr_scale
+ *
+ * It returns the number of fractional digits of the numeric expression,
+ * or -1 if unknown. Exact SUM/AVG(numeric) on the device starts with this
+ * scale, to avoid rescaling of the sum for each group.
+ */
+int
+pgstrom_numeric_expr_scale(Expr *expr)
+{
+	Oid			type_oid = exprType((Node *)expr);
+	int32		typmod;
+	Oid			func_oid;
+	List	   *func_args;
+	int			s1, s2;
+
+	if (type_oid == INT2OID ||
+		type_oid == INT4OID ||
+		type_oid == INT8OID)
+		return 0;
+	if (type_oid != NUMERICOID)
+		return -1;
+	/* numeric(precision,scale) */
+	typmod = exprTypmod((Node *)expr);
+	if (typmod >= (int32) VARHDRSZ)
+		return Max(((((typmod - VARHDRSZ) & 0x7ff) ^ 1024) - 1024), 0);
+
+	if (IsA(expr, Const))
+	{
+		Const  *con = (Const *)expr;
+
+		if (con->constisnull)
+			return 0;
+		return DatumGetInt32(DirectFunctionCall1(numeric_scale,
+												 con->constvalue));
+	}
+	else if (IsA(expr, RelabelType))
+	{
+		return pgstrom_numeric_expr_scale(((RelabelType *)expr)->arg);
+	}
+	else if (IsA(expr, FuncExpr))
+	{
+		func_oid  = ((FuncExpr *)expr)->funcid;
+		func_args = ((FuncExpr *)expr)->args;
+	}
+	else if (IsA(expr, OpExpr))
+	{
+		func_oid  = get_opcode(((OpExpr *)expr)->opno);
+		func_args = ((OpExpr *)expr)->args;
+	}
+	else
+		return -1;
+
+	switch (func_oid)
+	{
+		case F_NUMERIC_INT2:
+		case F_NUMERIC_INT4:
+		case F_NUMERIC_INT8:
+			return 0;
+		case F_NUMERIC_UMINUS:
+		case F_NUMERIC_UPLUS:
+		case F_NUMERIC_ABS:
+		case F_ABS_NUMERIC:
+			return pgstrom_numeric_expr_scale(linitial(func_args));
+		case F_NUMERIC_ADD:
+		case F_NUMERIC_SUB:
+			s1 = pgstrom_numeric_expr_scale(linitial(func_args));
+			s2 = pgstrom_numeric_expr_scale(lsecond(func_args));
+			if (s1 < 0 || s2 < 0)
+				return -1;
+			return Max(s1, s2);
+		case F_NUMERIC_MUL:
+			s1 = pgstrom_numeric_expr_scale(linitial(func_args));
+			s2 = pgstrom_numeric_expr_scale(lsecond(func_args));
+			if (s1 < 0 || s2 < 0)
+				return -1;
+			return s1 + s2;
+		default:
+			break;
+	}
+	return -1;
+}
+
+/*
+ * pgstrom_minmax_bytes_capacity
+ *
+ * It returns the capacity of MIN/MAX state of the variable-length values.
+ * The declared length of varchar(n) and uuid are always enough, elsewhere
+ * pg_strom.minmax_varlena_buffer_size is applied if configured, or -1.
+ */
+int
+pgstrom_minmax_bytes_capacity(Expr *expr)
+{
+	Oid			type_oid;
+	int32		typmod;
+
+	while (IsA(expr, RelabelType))
+		expr = ((RelabelType *)expr)->arg;
+	type_oid = exprType((Node *)expr);
+	if (type_oid == UUIDOID)
+		return UUID_LEN;
+	typmod = exprTypmod((Node *)expr);
+	if (type_oid == VARCHAROID && typmod > (int32) VARHDRSZ)
+	{
+		int64	len = ((int64)(typmod - VARHDRSZ) *
+					   (int64)pg_database_encoding_max_length());
+
+		if (len <= KAGG_PMINMAX_BYTES_MAX_CAPACITY)
+			return len;
+	}
+	if (pgstrom_minmax_varlena_buffer_size > 0)
+		return pgstrom_minmax_varlena_buffer_size;
+	return -1;
+}
+
+/*
+ * __minmax_bytes_never_compressed
+ *
+ * The device cannot compare the compressed or external datum, and GpuPreAgg
+ * has no CPU fallback, so MIN/MAX of variable-length values are pushed down
+ * only if the argument is never compressed; uuid or columns of Arrow_fdw.
+ * Note that attstorage = PLAIN does not prove it, because the storage mode
+ * can be changed by ALTER TABLE without rewrite of the existing tuples.
+ */
+static bool
+__minmax_bytes_never_compressed(PlannerInfo *root, Expr *expr)
+{
+	Var		   *var;
+
+	while (IsA(expr, RelabelType))
+		expr = ((RelabelType *)expr)->arg;
+	if (exprType((Node *)expr) == UUIDOID)
+		return true;
+	if (!IsA(expr, Var))
+		return false;
+	var = (Var *)expr;
+	if (var->varlevelsup != 0 ||
+		var->varattno <= 0 ||
+		var->varno <= 0 ||
+		var->varno >= root->simple_rel_array_size ||
+		!root->simple_rel_array[var->varno])
+		return false;
+	return baseRelIsArrowFdw(root->simple_rel_array[var->varno]);
+}
+
+/*
+ * lookup_hll_count_distinct
+ *
+ * It returns pgstrom.hll_count(X) that is an alternative of COUNT(DISTINCT X),
+ * if pg_strom.enable_hll_count_distinct is turned on.
+ */
+static Oid
+lookup_hll_count_distinct(Aggref *aggref)
+{
+	TargetEntry *tle;
+	Oid			namespace_oid;
+	Oid			type_oid;
+
+	if (!pgstrom_enable_hll_count_distinct ||
+		aggref->aggfnoid != F_COUNT_ANY ||
+		aggref->aggorder != NIL ||
+		list_length(aggref->args) != 1)
+		return InvalidOid;
+	namespace_oid = get_namespace_oid("pgstrom", true);
+	if (!OidIsValid(namespace_oid))
+		return InvalidOid;
+	tle = linitial(aggref->args);
+	type_oid = exprType((Node *)tle->expr);
+	if (type_oid == VARCHAROID)
+		type_oid = TEXTOID;		/* binary compatible */
+	return GetSysCacheOid3(PROCNAMEARGSNSP,
+						   Anum_pg_proc_oid,
+						   CStringGetDatum("hll_count"),
+						   PointerGetDatum(buildoidvector(&type_oid, 1)),
+						   ObjectIdGetDatum(namespace_oid));
+}
+
+/*
+ * make_hll_hash_expr
+ *
+ * It wraps up the argument of HLL_COUNT(X) by HLL_HASH(X); that is
+ * evaluated on the device and its result is put on the HLL registers.
+ */
+static Expr *
+make_hll_hash_expr(Expr *expr, Oid aggfn_oid)
+{
+	Oid		   *argtypes;
+	int			nargs;
+	char	   *signature;
+	Oid			func_oid;
+
+	get_func_signature(aggfn_oid, &argtypes, &nargs);
+	if (nargs != 1)
+		elog(ERROR, "Catalog corruption? unexpected HLL aggregate: %s",
+			 format_procedure(aggfn_oid));
+	expr = make_expr_typecast(expr, argtypes[0]);
+	signature = psprintf("s:hll_hash(%s)", get_type_name(argtypes[0], false));
+	func_oid = __aggfunc_resolve_func_signature(signature);
+
+	return (Expr *)makeFuncExpr(func_oid,
+								INT8OID,
+								list_make1(expr),
+								InvalidOid,
+								exprCollation((Node *)expr),
+								COERCE_EXPLICIT_CALL);
+}
+
+/*
+ * make_alternative_final_aggref
+ *
+ * It makes a final aggregate function that consumes the result of the
+ * partial function; a pair of them replaces the original Aggref.
+ */
+static Aggref *
+make_alternative_final_aggref(xpugroupby_build_path_context *con,
+							  Aggref *aggref,
+							  Oid func_oid,
+							  Oid final_rettype,
+							  Expr *partfn)
+{
+	Aggref	   *aggref_alt;
+	HeapTuple	htup;
+	Form_pg_aggregate agg;
+
+	htup = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(func_oid));
+	if (!HeapTupleIsValid(htup))
+		elog(ERROR, "cache lookup failed for pg_aggregate %u", func_oid);
+	agg = (Form_pg_aggregate) GETSTRUCT(htup);
+
+	aggref_alt = makeNode(Aggref);
+	aggref_alt->aggfnoid      = func_oid;
+	aggref_alt->aggtype       = final_rettype;
+	aggref_alt->aggcollid     = aggref->aggcollid;
+	aggref_alt->inputcollid   = aggref->inputcollid;
+	aggref_alt->aggtranstype  = agg->aggtranstype;
+	aggref_alt->aggargtypes   = list_make1_oid(exprType((Node *)partfn));
+	aggref_alt->aggdirectargs = NIL;	/* see sanity checks */
+	aggref_alt->args          = list_make1(makeTargetEntry(partfn, 1, NULL, false));
+	aggref_alt->aggorder      = NIL;  /* see sanity check */
+	aggref_alt->aggdistinct   = NIL;  /* see sanity check */
+	aggref_alt->aggfilter     = NULL; /* processed in partial-function */
+	aggref_alt->aggstar       = false;
+	aggref_alt->aggvariadic   = false;
+	aggref_alt->aggkind       = AGGKIND_NORMAL;   /* see sanity check */
+	aggref_alt->agglevelsup   = 0;
+	aggref_alt->aggsplit      = AGGSPLIT_SIMPLE;
+	aggref_alt->aggno         = aggref->aggno;
+	aggref_alt->aggtransno    = aggref->aggno;
+	aggref_alt->location      = aggref->location;
+	/*
+	 * MEMO: nodeAgg.c creates AggStatePerTransData for each aggtransno (that is
+	 * unique ID of transition state in the Agg). This is a kind of optimization
+	 * for the case when multiple aggregate function has identical transition state.
+	 * However, its impact is not large for GpuPreAgg because most of reduction
+	 * works are already executed at the xPU device side.
+	 * So, we simply assign aggref->aggno (unique ID within the Agg node) to
+	 * construct transition state for each alternative aggregate function.
+	 *
+	 * See the issue #614 to reproduce the problem in the future version.
+	 */
+
+	/*
+	 * Update the cost factor
+	 */
+	if (OidIsValid(agg->aggtransfn))
+		add_function_cost(con->root,
+						  agg->aggtransfn,
+						  NULL,
+						  &con->final_clause_costs.transCost);
+	if (OidIsValid(agg->aggfinalfn))
+		add_function_cost(con->root,
+						  agg->aggfinalfn,
+						  NULL,
+						  &con->final_clause_costs.finalCost);
+	ReleaseSysCache(htup);
+
+	return aggref_alt;
+}
+
+/*
+ * make_alternative_quantile
+ *
+ * It makes an alternative expression of percentile_cont/percentile_disc
+ * if pg_strom.enable_quantile_sketch is turned on. PQUANTILE(X) builds
+ * a quantile sketch on the device, then QUANTILE_COMBINE() merges them
+ * and QUANTILE_CONT/QUANTILE_DISC estimates the percentile.
+ */
+static Node *
+make_alternative_quantile(xpugroupby_build_path_context *con, Aggref *aggref)
+{
+	PathTarget *target_partial = con->target_partial;
+	pgstromPlanInfo *pp_info = con->pp_info;
+	SortGroupClause *sortcl;
+	TargetEntry *tle;
+	const char *extract_signature;
+	Oid			extract_rettype;
+	Oid			func_oid;
+	Oid			opfamily;
+	Oid			opcintype;
+	int16		strategy;
+	Expr	   *expr;
+	Expr	   *bits;
+	Expr	   *partfn;
+	Node	   *fraction;
+	Aggref	   *aggref_alt;
+
+	if (!pgstrom_enable_quantile_sketch ||
+		aggref->aggdistinct != NIL ||
+		list_length(aggref->aggdirectargs) != 1 ||
+		list_length(aggref->aggorder) != 1 ||
+		list_length(aggref->args) != 1)
+		return NULL;
+	switch (aggref->aggfnoid)
+	{
+		case F_PERCENTILE_CONT_FLOAT8_FLOAT8:
+			extract_signature = "s:quantile_cont(bytea,float8)";
+			extract_rettype = FLOAT8OID;
+			break;
+		case F_PERCENTILE_CONT__FLOAT8_FLOAT8:
+			extract_signature = "s:quantile_cont(bytea,_float8)";
+			extract_rettype = FLOAT8ARRAYOID;
+			break;
+		case F_PERCENTILE_DISC_FLOAT8_ANYELEMENT:
+			extract_signature = "s:quantile_disc(bytea,float8)";
+			extract_rettype = FLOAT8OID;
+			break;
+		case F_PERCENTILE_DISC__FLOAT8_ANYELEMENT:
+			extract_signature = "s:quantile_disc(bytea,_float8)";
+			extract_rettype = FLOAT8ARRAYOID;
+			break;
+		default:
+			return NULL;
+	}
+	/*
+	 * percentile_disc returns the value in the input data type, so we cast
+	 * the estimated value to the type, if simple numeric type.
+	 */
+	if (aggref->aggtype != extract_rettype)
+	{
+		if (extract_rettype != FLOAT8OID ||
+			(aggref->aggtype != INT2OID &&
+			 aggref->aggtype != INT4OID &&
+			 aggref->aggtype != INT8OID &&
+			 aggref->aggtype != FLOAT4OID &&
+			 aggref->aggtype != NUMERICOID))
+			return NULL;
+	}
+	/* sketch is built in ascending order */
+	sortcl = linitial(aggref->aggorder);
+	if (!get_ordering_op_properties(sortcl->sortop,
+									&opfamily,
+									&opcintype,
+									&strategy) ||
+		strategy != BTLessStrategyNumber)
+		return NULL;
+
+	/*
+	 * Build partial-aggregate function
+	 */
+	tle = linitial(aggref->args);
+	expr = make_expr_typecast(tle->expr, FLOAT8OID);
+	if (!pgstrom_xpu_expression(expr,
+								pp_info->xpu_task_flags,
+								con->input_rels_tlist,
+								NULL))
+	{
+		elog(DEBUG2, "Partial aggregate argument is not executable: %s",
+			 nodeToString(expr));
+		return NULL;
+	}
+	func_oid = __aggfunc_resolve_func_signature("s:pquantile(float8,int4)");
+	/* the number of sketch bits is fixed at the planner */
+	bits = (Expr *)makeConst(INT4OID,
+							 -1,
+							 InvalidOid,
+							 sizeof(int32),
+							 Int32GetDatum(pgstrom_quantile_sketch_bits),
+							 false,
+							 true);
+	partfn = (Expr *)makeFuncExpr(func_oid,
+								  BYTEAOID,
+								  list_make2(expr, bits),
+								  InvalidOid,
+								  InvalidOid,
+								  COERCE_EXPLICIT_CALL);
+	/* see add_new_column_to_pathtarget */
+	if (!list_member(target_partial->exprs, partfn))
+	{
+		add_column_to_pathtarget(target_partial, partfn, 0);
+		pp_info->groupby_actions = lappend_int(pp_info->groupby_actions,
+											   KAGG_ACTION__QUANTILE);
+	}
+
+	/*
+	 * Build final-aggregate function, then estimate the percentile
+	 * according to the direct argument (that references only constants
+	 * or grouping-keys).
+	 */
+	fraction = replace_expression_by_altfunc(linitial(aggref->aggdirectargs), con);
+	func_oid = __aggfunc_resolve_func_signature("s:quantile_combine(bytea)");
+	aggref_alt = make_alternative_final_aggref(con, aggref,
+											   func_oid,
+											   BYTEAOID,
+											   partfn);
+	func_oid = __aggfunc_resolve_func_signature(extract_signature);
+	expr = (Expr *)makeFuncExpr(func_oid,
+								extract_rettype,
+								list_make2(aggref_alt, fraction),
+								InvalidOid,
+								InvalidOid,
+								COERCE_EXPLICIT_CALL);
+	if (aggref->aggtype != extract_rettype)
+		expr = make_expr_typecast(expr, aggref->aggtype);
+	return (Node *)expr;
+}
+
 /*
  * make_alternative_aggref
  *
@@ -963,23 +1564,26 @@ make_alternative_aggref(xpugroupby_build_path_context *con, Aggref *aggref)
 	pgstromPlanInfo *pp_info = con->pp_info;
 	List	   *partfn_args = NIL;
 	Expr	   *partfn;
-	Aggref	   *aggref_alt;
-	Oid			func_oid;
 	HeapTuple	htup;
 	Form_pg_proc proc;
-	Form_pg_aggregate agg;
+	Oid			aggfn_oid = aggref->aggfnoid;
 	ListCell   *lc;
 	int			j;
 
-	if (aggref->aggorder != NIL || aggref->aggdistinct != NIL)
+	if (AGGKIND_IS_ORDERED_SET(aggref->aggkind))
 	{
-		elog(DEBUG2, "Aggregate with ORDER BY/DISTINCT is not supported: %s",
-			 nodeToString(aggref));
-		return NULL;
+		Node   *altfn = make_alternative_quantile(con, aggref);
+
+		if (!altfn)
+			elog(DEBUG2, "ORDERED SET Aggregation is not supported: %s",
+				 nodeToString(aggref));
+		return altfn;
 	}
-	if (AGGKIND_IS_ORDERED_SET(aggref->aggkind))
+	if (aggref->aggdistinct != NIL)
+		aggfn_oid = lookup_hll_count_distinct(aggref);
+	if (aggref->aggorder != NIL || !OidIsValid(aggfn_oid))
 	{
-		elog(DEBUG2, "ORDERED SET Aggregation is not supported: %s",
+		elog(DEBUG2, "Aggregate with ORDER BY/DISTINCT is not supported: %s",
 			 nodeToString(aggref));
 		return NULL;
 	}
@@ -987,16 +1591,44 @@ make_alternative_aggref(xpugroupby_build_path_context *con, Aggref *aggref)
 	/*
 	 * Lookup properties of aggregate function
 	 */
-	aggfn_cat = aggfunc_catalog_lookup_by_oid(aggref->aggfnoid);
+	aggfn_cat = aggfunc_catalog_lookup_by_oid(aggfn_oid);
 	if (!aggfn_cat)
 	{
 		elog(DEBUG2, "Aggregate function '%s' is not device executable",
-			 format_procedure(aggref->aggfnoid));
+			 format_procedure(aggfn_oid));
 		return NULL;
 	}
 	/* sanity checks */
 	Assert(aggref->aggkind == AGGKIND_NORMAL &&
 		   !aggref->aggvariadic);
+	/* device compares the text bytewise, so C collation only */
+	if ((aggfn_cat->partial_func_action == KAGG_ACTION__PMIN_BYTES ||
+		 aggfn_cat->partial_func_action == KAGG_ACTION__PMAX_BYTES) &&
+		OidIsValid(aggref->inputcollid) &&
+		!lc_collate_is_c(aggref->inputcollid))
+	{
+		elog(DEBUG2, "MIN/MAX is not device executable on collation '%s'",
+			 get_collation_name(aggref->inputcollid));
+		return NULL;
+	}
+	if (aggfn_cat->partial_func_action == KAGG_ACTION__PMIN_BYTES ||
+		aggfn_cat->partial_func_action == KAGG_ACTION__PMAX_BYTES)
+	{
+		TargetEntry *tle = linitial(aggref->args);
+
+		if (pgstrom_minmax_bytes_capacity(tle->expr) < 0)
+		{
+			elog(DEBUG2, "MIN/MAX buffer may be shorter than the result: %s",
+				 nodeToString(tle->expr));
+			return NULL;
+		}
+		if (!__minmax_bytes_never_compressed(con->root, tle->expr))
+		{
+			elog(DEBUG2, "MIN/MAX argument may be compressed or external: %s",
+				 nodeToString(tle->expr));
+			return NULL;
+		}
+	}
 
 	/*
 	 * Build partial-aggregate function
@@ -1006,7 +1638,9 @@ make_alternative_aggref(xpugroupby_build_path_context *con, Aggref *aggref)
 		elog(ERROR, "cache lookup failed for function %u",
 			 aggfn_cat->partial_func_oid);
 	proc = (Form_pg_proc) GETSTRUCT(htup);
-	Assert(list_length(aggref->args) == proc->pronargs);
+	Assert(list_length(aggref->args) ==
+		   (aggfn_cat->partial_func_action == KAGG_ACTION__HLL
+			? proc->pronargs - 1 : proc->pronargs));
 	j = 0;
 	foreach (lc, aggref->args)
 	{
@@ -1015,6 +1649,11 @@ make_alternative_aggref(xpugroupby_build_path_context *con, Aggref *aggref)
 		Oid		type_oid = exprType((Node *)expr);
 		Oid		dest_oid = proc->proargtypes.values[j++];
 
+		if (aggfn_cat->partial_func_action == KAGG_ACTION__HLL)
+		{
+			expr = make_hll_hash_expr(expr, aggfn_oid);
+			type_oid = exprType((Node *)expr);
+		}
 		if (type_oid != dest_oid)
 			expr = make_expr_typecast(expr, dest_oid);
 		if (!pgstrom_xpu_expression(expr,
@@ -1029,6 +1668,16 @@ make_alternative_aggref(xpugroupby_build_path_context *con, Aggref *aggref)
 		partfn_args = lappend(partfn_args, expr);
 	}
 	ReleaseSysCache(htup);
+	/* the number of HLL register bits is fixed at the planner */
+	if (aggfn_cat->partial_func_action == KAGG_ACTION__HLL)
+		partfn_args = lappend(partfn_args,
+							  makeConst(INT4OID,
+										-1,
+										InvalidOid,
+										sizeof(int32),
+										Int32GetDatum(pgstrom_hll_register_bits),
+										false,
+										true));
 
 	partfn = (Expr *)makeFuncExpr(aggfn_cat->partial_func_oid,
 								  aggfn_cat->partial_func_rettype,
@@ -1047,66 +1696,15 @@ make_alternative_aggref(xpugroupby_build_path_context *con, Aggref *aggref)
 	/*
 	 * Build final-aggregate function
 	 */
-	func_oid = aggfn_cat->final_func_oid;
-	htup = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(func_oid));
-	if (!HeapTupleIsValid(htup))
-		elog(ERROR, "cache lookup failed for pg_aggregate %u", func_oid);
-	agg = (Form_pg_aggregate) GETSTRUCT(htup);
-
-	aggref_alt = makeNode(Aggref);
-	aggref_alt->aggfnoid      = func_oid;
-	aggref_alt->aggtype       = aggref->aggtype;
-	aggref_alt->aggcollid     = aggref->aggcollid;
-	aggref_alt->inputcollid   = aggref->inputcollid;
-	aggref_alt->aggtranstype  = agg->aggtranstype;
-	aggref_alt->aggargtypes   = list_make1_oid(exprType((Node *)partfn));
-	aggref_alt->aggdirectargs = NIL;	/* see sanity checks */
-	aggref_alt->args          = list_make1(makeTargetEntry(partfn, 1, NULL, false));
-	aggref_alt->aggorder      = NIL;  /* see sanity check */
-	aggref_alt->aggdistinct   = NIL;  /* see sanity check */
-	aggref_alt->aggfilter     = NULL; /* processed in partial-function */
-	aggref_alt->aggstar       = false;
-	aggref_alt->aggvariadic   = false;
-	aggref_alt->aggkind       = AGGKIND_NORMAL;   /* see sanity check */
-	aggref_alt->agglevelsup   = 0;
-	aggref_alt->aggsplit      = AGGSPLIT_SIMPLE;
-	aggref_alt->aggno         = aggref->aggno;
-	aggref_alt->aggtransno    = aggref->aggno;
-	aggref_alt->location      = aggref->location;
-	/*
-	 * MEMO: nodeAgg.c creates AggStatePerTransData for each aggtransno (that is
-	 * unique ID of transition state in the Agg). This is a kind of optimization
-	 * for the case when multiple aggregate function has identical transition state.
-	 * However, its impact is not large for GpuPreAgg because most of reduction
-	 * works are already executed at the xPU device side.
-	 * So, we simply assign aggref->aggno (unique ID within the Agg node) to
-	 * construct transition state for each alternative aggregate function.
-	 *
-	 * See the issue #614 to reproduce the problem in the future version.
-	 */
-
-	/*
-	 * Update the cost factor
-	 */
-	if (OidIsValid(agg->aggtransfn))
-		add_function_cost(con->root,
-						  agg->aggtransfn,
-						  NULL,
-						  &con->final_clause_costs.transCost);
-	if (OidIsValid(agg->aggfinalfn))
-		add_function_cost(con->root,
-						  agg->aggfinalfn,
-						  NULL,
-						  &con->final_clause_costs.finalCost);
-	ReleaseSysCache(htup);
-
-	return (Node *)aggref_alt;
+	return (Node *)make_alternative_final_aggref(con, aggref,
+												 aggfn_cat->final_func_oid,
+												 aggref->aggtype,
+												 partfn);
 }
 
 static Node *
 replace_expression_by_altfunc(Node *node, xpugroupby_build_path_context *con)
 {
-	pgstromPlanInfo *pp_info = con->pp_info;
 	Node	   *aggfn;
 	ListCell   *lc;
 
@@ -1120,8 +1718,11 @@ replace_expression_by_altfunc(Node *node, xpugroupby_build_path_context *con)
 			con->device_executable = false;
 		return aggfn;
 	}
+	/* GROUPING() is evaluated by the final Agg */
+	if (IsA(node, GroupingFunc))
+		return copyObject(node);
 	/* grouping key? */
-	foreach (lc, pp_info->groupby_keys)
+	foreach (lc, con->final_keys)
 	{
 		Expr   *key = lfirst(lc);
 
@@ -1134,6 +1735,48 @@ replace_expression_by_altfunc(Node *node, xpugroupby_build_path_context *con)
 	return expression_tree_mutator(node, replace_expression_by_altfunc, con);
 }
 
+/*
+ * __xpugroupby_check_groupkey
+ *
+ * checks whether the grouping-key is hashable and comparable on the device
+ */
+static bool
+__xpugroupby_check_groupkey(xpugroupby_build_path_context *con, Expr *key)
+{
+	pgstromPlanInfo *pp_info = con->pp_info;
+	devtype_info *dtype;
+	Oid			type_oid = exprType((Node *)key);
+	Oid			coll_oid;
+
+	dtype = pgstrom_devtype_lookup(type_oid);
+	if (!dtype || !dtype->type_hashfunc)
+	{
+		elog(DEBUG2, "GROUP BY contains unsupported type (%s): %s",
+			 format_type_be(type_oid),
+			 nodeToString(key));
+		return false;
+	}
+	coll_oid = exprCollation((Node *)key);
+	if (devtype_lookup_equal_func(dtype, coll_oid) == NULL)
+	{
+		elog(DEBUG2, "GROUP BY contains unsupported device type (%s): %s",
+			 format_type_be(type_oid),
+			 nodeToString(key));
+		return false;
+	}
+	/* grouping-key must be device executable. */
+	if (!pgstrom_xpu_expression(key,
+								pp_info->xpu_task_flags,
+								con->input_rels_tlist,
+								NULL))
+	{
+		elog(DEBUG2, "Grouping-key must be device executable: %s",
+			 nodeToString(key));
+		return false;
+	}
+	return true;
+}
+
 static bool
 xpugroupby_build_path_target(xpugroupby_build_path_context *con)
 {
@@ -1155,45 +1798,25 @@ xpugroupby_build_path_target(xpugroupby_build_path_context *con)
 		Expr   *expr = lfirst(lc1);
 		Index	sortgroupref = get_pathtarget_sortgroupref(target_upper, i++);
 
-		if (sortgroupref && parse->groupClause &&
+		if (sortgroupref && con->groupClause &&
 			get_sortgroupref_clause_noerr(sortgroupref,
-										  parse->groupClause) != NULL)
+										  con->groupClause) != NULL)
 		{
 			/* Grouping Key */
-			devtype_info *dtype;
-			Oid		type_oid = exprType((Node *)expr);
-			Oid		coll_oid;
-
-			dtype = pgstrom_devtype_lookup(type_oid);
-			if (!dtype || !dtype->type_hashfunc)
-			{
-				elog(DEBUG2, "GROUP BY contains unsupported type (%s): %s",
-					 format_type_be(type_oid),
-					 nodeToString(expr));
-				return false;
-			}
-			coll_oid = exprCollation((Node *)expr);
-			if (devtype_lookup_equal_func(dtype, coll_oid) == NULL)
-			{
-				elog(DEBUG2, "GROUP BY contains unsupported device type (%s): %s",
-					 format_type_be(type_oid),
-					 nodeToString(expr));
-				return false;
-			}
-			/* grouping-key must be device executable. */
-			if (!pgstrom_xpu_expression(expr,
-										pp_info->xpu_task_flags,
-										con->input_rels_tlist,
-										NULL))
+			add_column_to_pathtarget(con->target_final, expr, sortgroupref);
+			con->final_keys = lappend(con->final_keys, expr);
+			/*
+			 * In the eager mode, the final Agg above the join groups the rows
+			 * by the original keys, but xPU groups the rows by eager_keys.
+			 */
+			if (con->eager_keys == NIL)
 			{
-				elog(DEBUG2, "Grouping-key must be device executable: %s",
-					 nodeToString(expr));
-				return false;
+				if (!__xpugroupby_check_groupkey(con, expr))
+					return false;
+				/* to be attached to target-partial later */
+				pp_info->groupby_keys = lappend(pp_info->groupby_keys, expr);
+				groupby_keys_refno = lappend_int(groupby_keys_refno, sortgroupref);
 			}
-			add_column_to_pathtarget(con->target_final, expr, sortgroupref);
-			/* to be attached to target-partial later */
-			pp_info->groupby_keys = lappend(pp_info->groupby_keys, expr);
-			groupby_keys_refno = lappend_int(groupby_keys_refno, sortgroupref);
 		}
 		else if (IsA(expr, Aggref))
 		{
@@ -1214,6 +1837,15 @@ xpugroupby_build_path_target(xpugroupby_build_path_context *con)
 			}
 			add_column_to_pathtarget(con->target_final, altfn, 0);
 		}
+		else if (IsA(expr, GroupingFunc))
+		{
+			/*
+			 * GROUPING() references only grouping-keys, and the final Agg
+			 * with grouping-sets evaluates it as usual.
+			 */
+			add_column_to_pathtarget(con->target_final,
+									 copyObject(expr), sortgroupref);
+		}
 		else
 		{
 			elog(DEBUG2, "unexpected expression on the upper-tlist: %s",
@@ -1221,6 +1853,19 @@ xpugroupby_build_path_target(xpugroupby_build_path_context *con)
 			return false;
 		}
 	}
+	/*
+	 * Partial grouping-keys of the eager pre-aggregation are not referenced
+	 * by the GROUP BY clause, so they have no sortgroupref.
+	 */
+	foreach (lc1, con->eager_keys)
+	{
+		Expr   *key = lfirst(lc1);
+
+		if (!__xpugroupby_check_groupkey(con, key))
+			return false;
+		pp_info->groupby_keys = lappend(pp_info->groupby_keys, key);
+		groupby_keys_refno = lappend_int(groupby_keys_refno, 0);
+	}
 	/*
 	 * Due to data alignment on the tuple on the kds_final, grouping-keys must
 	 * be located after the aggregate functions.
@@ -1231,7 +1876,7 @@ xpugroupby_build_path_target(xpugroupby_build_path_context *con)
 		Expr   *key = lfirst(lc1);
 		Index	keyref = lfirst_int(lc2);
 
-		Assert(keyref > 0);
+		Assert(keyref > 0 || con->eager_keys != NIL);
 		add_column_to_pathtarget(con->target_partial, key, keyref);
 		pp_info->groupby_actions = lappend_int(pp_info->groupby_actions,
 											   KAGG_ACTION__VREF);
@@ -1267,7 +1912,6 @@ xpugroupby_build_path_target(xpugroupby_build_path_context *con)
 static Path *
 prepend_partial_groupby_custompath(xpugroupby_build_path_context *con)
 {
-	Query	   *parse = con->root->parse;
 	CustomPath *cpath = makeNode(CustomPath);
 	PathTarget *target_partial = con->target_partial;
 	pgstromPlanInfo *pp_info = con->pp_info;
@@ -1305,7 +1949,7 @@ prepend_partial_groupby_custompath(xpugroupby_build_path_context *con)
 	startup_cost = (PP_INFO_STARTUP_COST(pp_info) +
 					PP_INFO_RUN_COST(pp_info));
 	/* Cost estimation for grouping */
-	num_group_keys = list_length(parse->groupClause);
+	num_group_keys = list_length(pp_info->groupby_keys);
 	startup_cost += (xpu_operator_cost *
 					 num_group_keys *
 					 input_nrows);
@@ -1333,6 +1977,61 @@ prepend_partial_groupby_custompath(xpugroupby_build_path_context *con)
 	return &cpath->path;
 }
 
+/*
+ * try_add_final_groupingsets_paths
+ *
+ * The partial path groups the rows by the finest grouping (all the columns
+ * in the grouping-sets), then the final Agg rolls them up for each grouping
+ * set. Rollups and strategy are borrowed from the GroupingSetsPath built by
+ * the core planner, because these are constructed by its static routines.
+ */
+static void
+try_add_final_groupingsets_paths(xpugroupby_build_path_context *con,
+								 Path *part_path)
+{
+	PlannerInfo *root = con->root;
+	List	   *gset_paths = NIL;
+	ListCell   *lc;
+
+	foreach (lc, con->group_rel->pathlist)
+	{
+		Path   *path = lfirst(lc);
+
+		if (IsA(path, GroupingSetsPath))
+			gset_paths = lappend(gset_paths, path);
+	}
+
+	foreach (lc, gset_paths)
+	{
+		GroupingSetsPath *gspath = lfirst(lc);
+		Path	   *sub_path = part_path;
+		Path	   *agg_path;
+		Path	   *dummy_path;
+
+		/* the first sorted rollup expects the input ordered */
+		if (gspath->aggstrategy != AGG_HASHED &&
+			root->group_pathkeys != NIL)
+		{
+			sub_path = (Path *)create_sort_path(root,
+												con->group_rel,
+												part_path,
+												root->group_pathkeys,
+												-1.0);
+		}
+		agg_path = (Path *)create_groupingsets_path(root,
+													con->group_rel,
+													sub_path,
+													(List *)con->havingQual,
+													gspath->aggstrategy,
+													gspath->rollups,
+													&con->final_clause_costs);
+		agg_path->pathtarget = con->target_final;
+		dummy_path = pgstrom_create_dummy_path(root, agg_path);
+		add_path(con->group_rel, dummy_path);
+	}
+	list_free(gset_paths);
+}
+
 /*
  * try_add_final_groupby_paths
  */
@@ -1345,7 +2044,9 @@ try_add_final_groupby_paths(xpugroupby_build_path_context *con,
 	Path	   *dummy_path;
 	double		hashTableSz;
 
-	if (!parse->groupClause)
+	if (parse->groupingSets)
+		try_add_final_groupingsets_paths(con, part_path);
+	else if (!con->groupClause)
 	{
 		agg_path = (Path *)create_agg_path(con->root,
 										   con->group_rel,
@@ -1353,7 +2054,7 @@ try_add_final_groupby_paths(xpugroupby_build_path_context *con,
 										   con->target_final,
 										   AGG_PLAIN,
 										   AGGSPLIT_SIMPLE,
-										   parse->groupClause,
+										   NIL,
 										   (List *)con->havingQual,
 										   &con->final_clause_costs,
 										   con->num_groups);
@@ -1362,7 +2063,7 @@ try_add_final_groupby_paths(xpugroupby_build_path_context *con,
 	}
 	else
 	{
-		Assert(grouping_is_hashable(parse->groupClause));
+		Assert(grouping_is_hashable(con->groupClause));
 		hashTableSz = estimate_hashagg_tablesize(con->root,
 												 part_path,
 												 &con->final_clause_costs,
@@ -1375,7 +2076,7 @@ try_add_final_groupby_paths(xpugroupby_build_path_context *con,
 											   con->target_final,
 											   AGG_HASHED,
 											   AGGSPLIT_SIMPLE,
-											   parse->groupClause,
+											   con->groupClause,
 											   (List *)con->havingQual,
 											   &con->final_clause_costs,
 											   con->num_groups);
@@ -1387,12 +2088,13 @@ try_add_final_groupby_paths(xpugroupby_build_path_context *con,
 
 static void
 __xpupreagg_add_custompath(PlannerInfo *root,
+						   UpperRelationKind stage,
 						   RelOptInfo *group_rel,
 						   RelOptInfo *input_rel,
 						   pgstromPlanInfo *pp_info,
 						   ParamPathInfo *param_info,
 						   List *inner_paths_list,
-						   void *extra,
+						   List *groupClause,
 						   bool try_parallel,
 						   double num_groups,
 						   const CustomPathMethods *custom_path_methods)
@@ -1418,7 +2120,8 @@ __xpupreagg_add_custompath(PlannerInfo *root,
 	con.param_info     = param_info;
 	con.num_groups     = num_groups;
 	con.try_parallel   = try_parallel;
-	con.target_upper   = root->upper_targets[UPPERREL_GROUP_AGG];
+	con.target_upper   = root->upper_targets[stage];
+	con.groupClause    = groupClause;
 	con.target_partial = create_empty_pathtarget();
 	con.target_final   = create_empty_pathtarget();
 	con.pp_info        = pp_info;
@@ -1456,19 +2159,421 @@ __xpupreagg_add_custompath(PlannerInfo *root,
 	try_add_final_groupby_paths(&con, part_path);
 }
 
+/*
+ * __eager_key_has_equal_image
+ *
+ * It checks whether the equality of the type is also the image equality,
+ * by BTEQUALIMAGE_PROC of the default btree operator class. The device
+ * groups the rows by the equality of the type, so a partial group of
+ * numeric 1.0 and 1.00, or float8 -0 and +0, is represented by one of the
+ * values; it is valid only if nobody can distinguish them.
+ */
+static bool
+__eager_key_has_equal_image(Var *var)
+{
+	Oid			opclass = GetDefaultOpClass(var->vartype, BTREE_AM_OID);
+	Oid			opfamily;
+	Oid			opcintype;
+	Oid			procOid;
+
+	if (!OidIsValid(opclass))
+		return false;
+	opfamily = get_opclass_family(opclass);
+	opcintype = get_opclass_input_type(opclass);
+	procOid = get_opfamily_proc(opfamily, opcintype, opcintype,
+								BTEQUALIMAGE_PROC);
+	if (!OidIsValid(procOid))
+		return false;
+	return DatumGetBool(OidFunctionCall1Coll(procOid,
+											 var->varcollid,
+											 ObjectIdGetDatum(opcintype)));
+}
+
+/*
+ * __eager_key_is_valid
+ *
+ * The partial grouping-key is valid, if its type has equal-image, or it is
+ * referenced only as a bare grouping-key or an argument of the equality
+ * join-clauses; these never distinguish the values in a partial group.
+ */
+static bool
+__eager_key_is_valid(Var *var, List *groupExprs, List *restrictlist)
+{
+	List	   *others = NIL;
+	ListCell   *lc;
+
+	if (__eager_key_has_equal_image(var))
+		return true;
+	foreach (lc, groupExprs)
+	{
+		Node   *expr = lfirst(lc);
+
+		if (!IsA(expr, Var))
+			others = lappend(others, expr);
+	}
+	foreach (lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+		OpExpr	   *op = (OpExpr *)rinfo->clause;
+
+		if (rinfo->can_join &&
+			OidIsValid(rinfo->hashjoinoperator) &&
+			IsA(op, OpExpr) &&
+			list_length(op->args) == 2)
+		{
+			Node   *l_arg = linitial(op->args);
+			Node   *r_arg = lsecond(op->args);
+
+			/* binary compatible cast does not distinguish the values */
+			while (IsA(l_arg, RelabelType))
+				l_arg = (Node *)((RelabelType *)l_arg)->arg;
+			while (IsA(r_arg, RelabelType))
+				r_arg = (Node *)((RelabelType *)r_arg)->arg;
+			if (!IsA(l_arg, Var))
+				others = lappend(others, l_arg);
+			if (!IsA(r_arg, Var))
+				others = lappend(others, r_arg);
+		}
+		else
+			others = lappend(others, rinfo->clause);
+	}
+	foreach (lc, pull_var_clause((Node *)others, PVC_INCLUDE_PLACEHOLDERS))
+	{
+		Var	   *curr = lfirst(lc);
+
+		if (IsA(curr, Var) &&
+			curr->varno == var->varno &&
+			curr->varattno == var->varattno)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * __xpupreagg_try_eager_custompath
+ *
+ * When GROUP BY is located on the join of a large (fact) relation and
+ * a (dimension) relation, the fact relation can be partially aggregated
+ * by the columns referenced by the join-clauses and the grouping-keys,
+ * prior to the join. Then, the reduced partial results are joined with
+ * the dimension relation, and the final Agg merges the partial states.
+ * It is valid as long as all the partial states are combinable, because
+ * all the rows in a partial group have identical join-keys, so they are
+ * joined (or duplicated) as a unit.
+ */
+static void
+__xpupreagg_try_eager_custompath(PlannerInfo *root,
+								 RelOptInfo *group_rel,
+								 RelOptInfo *input_rel,
+								 List *groupClause,
+								 List *groupTlist,
+								 uint32_t xpu_task_flags,
+								 const CustomPathMethods *custom_path_methods)
+{
+	xpugroupby_build_path_context con;
+	pgstromPlanInfo *pp_info;
+	ParamPathInfo *param_info = NULL;
+	List	   *inner_paths_list = NIL;
+	JoinPath   *jpath = NULL;
+	RelOptInfo *fact_rel;
+	RelOptInfo *dim_rel;
+	RelOptInfo *joinrel;
+	PathTarget *join_target;
+	List	   *groupExprs = NIL;
+	List	   *restrictlist;
+	List	   *hashclauses = NIL;
+	List	   *eager_keys = NIL;
+	List	   *dim_vars = NIL;
+	List	   *vars;
+	Path	   *part_path;
+	Path	   *inner_path;
+	Path	   *join_path;
+	SpecialJoinInfo sjinfo;
+	JoinPathExtraData jextra;
+	JoinCostWorkspace workspace;
+	double		partial_groups;
+	ListCell   *lc;
+
+	if (!IS_JOIN_REL(input_rel) || !bms_is_empty(input_rel->lateral_relids))
+		return;
+	/*
+	 * Semi-join may be implemented as an inner-join on the unique-ified
+	 * relation; it is not valid once the dimension side is re-planned.
+	 */
+	foreach (lc, root->join_info_list)
+	{
+		SpecialJoinInfo *sj = lfirst(lc);
+
+		if ((sj->jointype == JOIN_SEMI || sj->jointype == JOIN_ANTI) &&
+			bms_overlap(sj->syn_righthand, input_rel->relids))
+			return;
+	}
+	/* pick up an inner-join of two relations */
+	foreach (lc, input_rel->pathlist)
+	{
+		Path   *path = lfirst(lc);
+
+		if ((path->pathtype == T_NestLoop ||
+			 path->pathtype == T_HashJoin ||
+			 path->pathtype == T_MergeJoin) &&
+			path->param_info == NULL &&
+			((JoinPath *)path)->jointype == JOIN_INNER &&
+			!IsA(((JoinPath *)path)->outerjoinpath, UniquePath) &&
+			!IsA(((JoinPath *)path)->innerjoinpath, UniquePath))
+		{
+			jpath = (JoinPath *)path;
+			break;
+		}
+	}
+	if (!jpath)
+		return;
+	fact_rel = jpath->outerjoinpath->parent;
+	dim_rel  = jpath->innerjoinpath->parent;
+	if (!IS_SIMPLE_REL(fact_rel) ||
+		(IS_SIMPLE_REL(dim_rel) && dim_rel->rows > fact_rel->rows))
+	{
+		RelOptInfo *temp = fact_rel;
+
+		fact_rel = dim_rel;
+		dim_rel = temp;
+	}
+	if (!IS_SIMPLE_REL(fact_rel))
+		return;
+	restrictlist = jpath->joinrestrictinfo;
+	foreach (lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+
+		if (rinfo->pseudoconstant)
+			return;
+	}
+
+	/*
+	 * Partial grouping-keys are the columns of the fact relation referenced
+	 * by the join-clauses or the grouping-keys.
+	 */
+	if (groupClause)
+		groupExprs = get_sortgrouplist_exprs(groupClause, groupTlist);
+	vars = pull_var_clause((Node *)groupExprs,
+						   PVC_INCLUDE_PLACEHOLDERS);
+	foreach (lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+
+		vars = list_concat(vars, pull_var_clause((Node *)rinfo->clause,
+												 PVC_INCLUDE_PLACEHOLDERS));
+	}
+	foreach (lc, vars)
+	{
+		Var	   *var = lfirst(lc);
+
+		if (!IsA(var, Var))
+		{
+			elog(DEBUG2, "eager pre-aggregation: unsupported key (%s)",
+				 nodeToString(var));
+			return;
+		}
+		if (bms_is_member(var->varno, fact_rel->relids))
+		{
+			if (!__eager_key_is_valid(var, groupExprs, restrictlist))
+			{
+				elog(DEBUG2, "eager pre-aggregation: key %s may distinguish equal values",
+					 nodeToString(var));
+				return;
+			}
+			eager_keys = list_append_unique(eager_keys, var);
+		}
+		else if (bms_is_member(var->varno, dim_rel->relids))
+			dim_vars = list_append_unique(dim_vars, var);
+		else
+			return;
+	}
+	if (eager_keys == NIL)
+		return;
+
+	/*
+	 * hash-clauses to join the partial results with the dimension; the
+	 * RestrictInfo is shared with the other paths, so outer_is_left is
+	 * set on the private copy.
+	 */
+	foreach (lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+		bool		outer_is_left;
+
+		if (!rinfo->can_join || !OidIsValid(rinfo->hashjoinoperator))
+			continue;
+		if (bms_is_subset(rinfo->left_relids, fact_rel->relids) &&
+			bms_is_subset(rinfo->right_relids, dim_rel->relids))
+			outer_is_left = true;
+		else if (bms_is_subset(rinfo->left_relids, dim_rel->relids) &&
+				 bms_is_subset(rinfo->right_relids, fact_rel->relids))
+			outer_is_left = false;
+		else
+			continue;
+		rinfo = (RestrictInfo *)pmemdup(rinfo, sizeof(RestrictInfo));
+		rinfo->outer_is_left = outer_is_left;
+		hashclauses = lappend(hashclauses, rinfo);
+	}
+	if (hashclauses == NIL)
+		return;
+
+	pp_info = buildOuterJoinPlanInfo(root,
+									 fact_rel,
+									 xpu_task_flags,
+									 false,
+									 &param_info,
+									 &inner_paths_list);
+	if (!pp_info || param_info != NULL)
+		return;
+	partial_groups = estimate_num_groups(root, eager_keys,
+										 PP_INFO_NUM_ROWS(pp_info),
+										 NULL, NULL);
+	/* obviously, no reduction by the eager pre-aggregation */
+	if (partial_groups > 0.5 * PP_INFO_NUM_ROWS(pp_info))
+	{
+		elog(DEBUG2, "eager pre-aggregation: too many groups (%.0f of %.0f)",
+			 partial_groups, PP_INFO_NUM_ROWS(pp_info));
+		return;
+	}
+
+	/* setup context */
+	memset(&con, 0, sizeof(con));
+	con.device_executable = true;
+	con.root           = root;
+	con.group_rel      = group_rel;
+	con.input_rel      = fact_rel;
+	con.param_info     = NULL;
+	con.num_groups     = partial_groups;
+	con.try_parallel   = false;
+	con.target_upper   = root->upper_targets[UPPERREL_GROUP_AGG];
+	con.groupClause    = groupClause;
+	con.eager_keys     = eager_keys;
+	con.target_partial = create_empty_pathtarget();
+	con.target_final   = create_empty_pathtarget();
+	con.pp_info        = pp_info;
+	con.input_rels_tlist = list_make1(makeInteger(pp_info->scan_relid));
+	con.inner_paths_list = NIL;
+	con.custom_path_methods = custom_path_methods;
+	/*
+	 * construction of the target-list for each level; aggregate functions
+	 * that reference the dimension relation are not device executable here.
+	 */
+	if (!xpugroupby_build_path_target(&con))
+		return;
+	part_path = prepend_partial_groupby_custompath(&con);
+
+	/* join of the partial results and the dimension relation */
+	join_target = create_empty_pathtarget();
+	foreach (lc, con.target_partial->exprs)
+		add_column_to_pathtarget(join_target, lfirst(lc), 0);
+	foreach (lc, dim_vars)
+		add_column_to_pathtarget(join_target, lfirst(lc), 0);
+	set_pathtarget_cost_width(root, join_target);
+
+	/*
+	 * The joinrel is not registered to the planner, because the original
+	 * joinrel with the same relids already exists.
+	 */
+	joinrel = makeNode(RelOptInfo);
+	joinrel->reloptkind = RELOPT_JOINREL;
+	joinrel->relids = bms_copy(input_rel->relids);
+	joinrel->rows = clamp_row_est(input_rel->rows * partial_groups /
+								  Max(fact_rel->rows, 1.0));
+	joinrel->consider_startup = (root->tuple_fraction > 0);
+	joinrel->consider_param_startup = false;
+	joinrel->consider_parallel = false;
+	joinrel->reltarget = join_target;
+	joinrel->rtekind = RTE_JOIN;
+	joinrel->serverid = input_rel->serverid;
+	joinrel->userid = input_rel->userid;
+	joinrel->useridiscurrent = input_rel->useridiscurrent;
+	joinrel->top_parent_relids = NULL;
+
+	memset(&sjinfo, 0, sizeof(SpecialJoinInfo));
+	NodeSetTag(&sjinfo, T_SpecialJoinInfo);
+	sjinfo.min_lefthand  = fact_rel->relids;
+	sjinfo.min_righthand = dim_rel->relids;
+	sjinfo.syn_lefthand  = fact_rel->relids;
+	sjinfo.syn_righthand = dim_rel->relids;
+	sjinfo.jointype      = JOIN_INNER;
+
+	memset(&jextra, 0, sizeof(JoinPathExtraData));
+	jextra.restrictlist = restrictlist;
+	jextra.inner_unique = false;
+	jextra.sjinfo       = &sjinfo;
+
+	inner_path = dim_rel->cheapest_total_path;
+	if (!inner_path || inner_path->param_info != NULL)
+		return;
+	initial_cost_hashjoin(root, &workspace, JOIN_INNER, hashclauses,
+						  part_path, inner_path, &jextra, false);
+	join_path = (Path *)create_hashjoin_path(root,
+											 joinrel,
+											 JOIN_INNER,
+											 &workspace,
+											 &jextra,
+											 part_path,
+											 inner_path,
+											 false,
+											 restrictlist,
+											 NULL,
+											 hashclauses);
+	/* final Agg; add_path() chooses it only if cheaper */
+	con.num_groups = 1.0;
+	if (groupClause)
+		con.num_groups = estimate_num_groups(root, groupExprs,
+											 joinrel->rows,
+											 NULL, NULL);
+	try_add_final_groupby_paths(&con, join_path);
+}
+
 static void
 __xpuPreAggAddCustomPathCommon(PlannerInfo *root,
 							   RelOptInfo *input_rel,
 							   RelOptInfo *group_rel,
+							   UpperRelationKind stage,
 							   void *extra,
 							   uint32_t xpu_task_flags,
 							   const CustomPathMethods *custom_path_methods)
 {
 	Query	   *parse = root->parse;
+	List	   *groupClause;
+	List	   *groupTlist;
 
-	/* quick bailout if not supported */
-	if (parse->groupingSets != NIL ||
-		!grouping_is_hashable(parse->groupClause))
+	if (stage == UPPERREL_DISTINCT)
+	{
+		/*
+		 * SELECT DISTINCT is a GROUP BY without aggregate functions, if it
+		 * deduplicates the scan/join results as is.
+		 */
+		if (parse->hasAggs ||
+			parse->groupClause != NIL ||
+			parse->groupingSets != NIL ||
+			parse->havingQual != NULL ||
+			parse->hasWindowFuncs ||
+			parse->hasTargetSRFs ||
+			parse->hasDistinctOn)
+		{
+			elog(DEBUG2, "SELECT DISTINCT is not supported form");
+			return;
+		}
+		groupClause = parse->distinctClause;
+		groupTlist = parse->targetList;
+	}
+	else
+	{
+		groupClause = parse->groupClause;
+		groupTlist = ((GroupPathExtraData *)extra)->targetList;
+	}
+
+	/*
+	 * quick bailout if not supported
+	 *
+	 * GROUPING SETS, ROLLUP and CUBE are supported by the partial grouping
+	 * with all the keys, then rolled up at the final stage.
+	 */
+	if (!grouping_is_hashable(groupClause))
 	{
 		elog(DEBUG2, "GROUP BY clause is not supported form");
 		return;
@@ -1490,33 +2595,44 @@ __xpuPreAggAddCustomPathCommon(PlannerInfo *root,
 		{
 			double		num_groups = 1.0;
 
-			/* fetch num groups if GROUP BY exist  */
-			if (parse->groupClause)
+			/* fetch num groups if GROUP BY (or DISTINCT) exist  */
+			if (groupClause)
 			{
-				GroupPathExtraData *gp_extra = extra;
 				List   *groupExprs;
 				double	input_nrows = PP_INFO_NUM_ROWS(pp_info);
 
 				/* see get_number_of_groups() */
-				groupExprs = get_sortgrouplist_exprs(parse->groupClause,
-													 gp_extra->targetList);
+				groupExprs = get_sortgrouplist_exprs(groupClause,
+													 groupTlist);
 				num_groups = estimate_num_groups(root, groupExprs,
 												 input_nrows,
 												 NULL, NULL);
 			}
 			__xpupreagg_add_custompath(root,
+									   stage,
 									   group_rel,
 									   input_rel,
 									   pp_info,
 									   param_info,
 									   inner_paths_list,
-									   extra,
+									   groupClause,
 									   (try_parallel > 0),
 									   num_groups,
 									   custom_path_methods);
 
 		}
 	}
+	/* GROUP BY on the join, with eager pre-aggregation of the fact table */
+	if (stage == UPPERREL_GROUP_AGG &&
+		pgstrom_enable_eager_preagg &&
+		parse->groupingSets == NIL)
+		__xpupreagg_try_eager_custompath(root,
+										 group_rel,
+										 input_rel,
+										 groupClause,
+										 groupTlist,
+										 xpu_task_flags,
+										 custom_path_methods);
 }
 
 /*
@@ -1535,7 +2651,8 @@ XpuPreAggAddCustomPath(PlannerInfo *root,
 								input_rel,
 								group_rel,
 								extra);
-	if (stage != UPPERREL_GROUP_AGG)
+	if (stage != UPPERREL_GROUP_AGG &&
+		stage != UPPERREL_DISTINCT)
 		return;
 	if (pgstrom_enabled)
 	{
@@ -1543,6 +2660,7 @@ XpuPreAggAddCustomPath(PlannerInfo *root,
 			__xpuPreAggAddCustomPathCommon(root,
 										   input_rel,
 										   group_rel,
+										   stage,
 										   extra,
 										   TASK_KIND__GPUPREAGG,
 										   &gpupreagg_path_methods);
@@ -1550,6 +2668,7 @@ XpuPreAggAddCustomPath(PlannerInfo *root,
 			__xpuPreAggAddCustomPathCommon(root,
 										   input_rel,
 										   group_rel,
+										   stage,
 										   extra,
 										   TASK_KIND__DPUPREAGG,
 										   &dpupreagg_path_methods);
@@ -1698,6 +2817,15 @@ pgstrom_init_gpu_preagg(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.enable_hll_count_distinct */
+	DefineCustomBoolVariable("pg_strom.enable_hll_count_distinct",
+							 "Enables to replace COUNT(DISTINCT) by the approximate HLL_COUNT()",
+							 NULL,
+							 &pgstrom_enable_hll_count_distinct,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* pg_strom.hll_registers_bits */
 	DefineCustomIntVariable("pg_strom.hll_registers_bits",
 							"Accuracy of HyperLogLog COUNT(distinct ...) estimation",
@@ -1709,6 +2837,46 @@ pgstrom_init_gpu_preagg(void)
 							PGC_USERSET,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
+	/* pg_strom.enable_quantile_sketch */
+	DefineCustomBoolVariable("pg_strom.enable_quantile_sketch",
+							 "Enables to replace percentile_cont/percentile_disc by the approximate quantile sketch",
+							 NULL,
+							 &pgstrom_enable_quantile_sketch,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.quantile_sketch_bits */
+	DefineCustomIntVariable("pg_strom.quantile_sketch_bits",
+							"Accuracy of the quantile sketch for percentile estimation",
+							NULL,
+							&pgstrom_quantile_sketch_bits,
+							4,
+							1,
+							6,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.minmax_varlena_buffer_size */
+	DefineCustomIntVariable("pg_strom.minmax_varlena_buffer_size",
+							"Buffer size of MIN/MAX for text and bytea on the device (0 = only if the max length is obvious)",
+							NULL,
+							&pgstrom_minmax_varlena_buffer_size,
+							0,
+							0,
+							KAGG_PMINMAX_BYTES_MAX_CAPACITY,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_BYTE,
+							NULL, NULL, NULL);
+	/* pg_strom.enable_eager_preagg */
+	DefineCustomBoolVariable("pg_strom.enable_eager_preagg",
+							 "Enables partial aggregation of the fact table prior to the join",
+							 NULL,
+							 &pgstrom_enable_eager_preagg,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 
 	/* initialization of path method table */
 	memset(&gpupreagg_path_methods, 0, sizeof(CustomPathMethods));
@@ -716,6 +716,7 @@ PlanXpuScanPathCommon(PlannerInfo *root,
 												 pp_info->scan_needs_ctid,
 												 input_rels_tlist);
 	pp_info->kexp_projection = codegen_build_projection(&context);
+	pgstrom_build_topn_keys(pp_info, context.tlist_dev);
 	pp_info->kexp_scan_kvars_load = codegen_build_scan_loadvars(&context);
 	pp_info->kvars_depth = context.kvars_depth;
 	pp_info->kvars_resno = context.kvars_resno;
@@ -851,7 +852,6 @@ ExecFallbackCpuScan(pgstromTaskState *pts,
 {
 	TupleTableSlot *scan_slot = pts->base_slot;
 	bool			should_free = false;
-	static int count = 0;
 
 	ExecForceStoreHeapTuple(tuple, scan_slot, false);
 
@@ -876,10 +876,6 @@ ExecFallbackCpuScan(pgstromTaskState *pts,
 	pgstromStoreFallbackTuple(pts, tuple);
 	if (should_free)
 		pfree(tuple);
-
-	if (count++ < 100)
-		elog(INFO, "fallback called (usage: %zu, nitems: %zu, index: %zu)",
-			 pts->fallback_usage, pts->fallback_nitems, pts->fallback_index);
 }
 
 /*
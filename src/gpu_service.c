@@ -60,6 +60,9 @@ struct gpuClient
 	pg_atomic_uint32 refcnt;	/* odd number, if error status */
 	pthread_mutex_t	mutex;		/* mutex to write the socket */
 	int				sockfd;		/* connection to PG backend */
+	xpuShmRing	   *shmring;	/* shared-memory ring, if any */
+	xpuTopNBuffer  *topn_buf;	/* Top-N results buffer, if any */
+	pthread_mutex_t	topn_lock;	/* lock of topn_buf */
 	pthread_t		worker;		/* receiver thread */
 };
 
@@ -975,7 +978,7 @@ __gpuServiceAttachCommand(void *__priv, XpuCommand *xcmd)
 }
 
 static void
-__gpuServiceFreeCommand(XpuCommand *xcmd)
+__gpuServiceFreeCommand(void *__priv, XpuCommand *xcmd)
 {
 	gpuServXpuCommandPacked *packed = (gpuServXpuCommandPacked *)
 		((char *)xcmd - offsetof(gpuServXpuCommandPacked, xcmd));
@@ -1002,13 +1005,17 @@ gpuClientPut(gpuClient *gclient, bool exit_monitor_thread)
 
 		if (gclient->sockfd >= 0)
 			close(gclient->sockfd);
+		if (gclient->shmring)
+			xpuShmRingClose(gclient->shmring);
 		if (gclient->gq_buf)
 			putGpuQueryBuffer(gclient->gq_buf);
+		if (gclient->topn_buf)
+			xpuTopNBufferRelease(gclient->topn_buf);
 		if (gclient->session)
 		{
 			XpuCommand	   *xcmd = (XpuCommand *)((char *)gclient->session -
 												  offsetof(XpuCommand, u.session));
-			__gpuServiceFreeCommand(xcmd);
+			__gpuServiceFreeCommand(gclient, xcmd);
 		}
 		free(gclient);
 	}
@@ -1017,10 +1024,51 @@ gpuClientPut(gpuClient *gclient, bool exit_monitor_thread)
 /*
  * gpuClientWriteBack
  */
+static bool
+__gpuClientCheckAlive(void *__priv)
+{
+	gpuClient  *gclient = (gpuClient *)__priv;
+
+	return ((pg_atomic_read_u32(&gclient->refcnt) & 1) == 1 &&
+			!gpuServiceGoingTerminate());
+}
+
 static void
 __gpuClientWriteBack(gpuClient *gclient, struct iovec *iov, int iovcnt)
 {
-	pthreadMutexLock(&gclient->mutex);
+	xpuShmRing *shmring = gclient->shmring;
+
+	for (;;)
+	{
+		bool	alive = true;
+		int		rv;
+
+		/* wait for the free space of the ring without gclient->mutex */
+		if (shmring)
+			alive = xpuShmRingWaitSpace(shmring, iov, iovcnt,
+										__gpuClientCheckAlive, gclient);
+		pthreadMutexLock(&gclient->mutex);
+		if (gclient->sockfd < 0 || !shmring)
+			break;
+		if (!alive)
+		{
+			/* peer looks gone, so clean up this gpuClient */
+			pg_atomic_fetch_and_u32(&gclient->refcnt, ~1U);
+			close(gclient->sockfd);
+			gclient->sockfd = -1;
+			break;
+		}
+		rv = xpuShmRingTrySend(shmring, iov, iovcnt);
+		if (rv > 0)
+		{
+			iovcnt = 0;		/* done */
+			break;
+		}
+		if (rv == 0)
+			break;			/* too large for the ring, so send it by the socket */
+		/* other threads consumed the free space, so wait again */
+		pthreadMutexUnlock(&gclient->mutex);
+	}
 	if (gclient->sockfd >= 0)
 	{
 		ssize_t		nbytes;
@@ -1412,6 +1460,15 @@ gpuservHandleOpenSession(gpuClient *gclient, XpuCommand *xcmd)
 			return false;
 		}
 	}
+	if (session->topn_desc != 0)
+	{
+		gclient->topn_buf = xpuTopNBufferCreate(SESSION_TOPN_DESC(session));
+		if (!gclient->topn_buf)
+		{
+			gpuClientELog(gclient, "out of memory");
+			return false;
+		}
+	}
 	gclient->session = session;
 
 	/* success status */
@@ -1532,6 +1589,7 @@ gpuservHandleGpuTaskExec(gpuClient *gclient, XpuCommand *xcmd)
 	int				kds_dst_nrooms = 0;
 	int				kds_dst_nitems = 0;
 	int				num_inner_rels = 0;
+	bool			topn_kept = false;
 	CUfunction		f_kern_gpuscan;
 	void		   *gc_lmap = NULL;
 	gpuMemChunk	   *s_chunk = NULL;		/* for kds_src */
@@ -1822,15 +1880,51 @@ resume_kernel:
 				pthreadRWLockUnlock(&gq_buf->m_kds_final_rwlock);
 			goto resume_kernel;
 		}
-		/* send back status and kds_dst */
+		/* send back status, blocks to be rechecked, and kds_dst */
 		resp_sz = MAXALIGN(offsetof(XpuCommand,
 									u.results.stats[num_inner_rels]));
-		resp = alloca(resp_sz);
-		memset(resp, 0, resp_sz);
+		sz = MAXALIGN(sizeof(BlockNumber) * kgtask->recheck_nblocks);
+		resp = alloca(resp_sz + sz);
+		memset(resp, 0, resp_sz + sz);
 		resp->magic = XpuCommandMagicNumber;
 		resp->tag   = XpuCommandTag__Success;
-		resp->u.results.chunks_nitems = kds_dst_nitems;
+		if (kgtask->recheck_nblocks > 0)
+		{
+			resp->u.results.recheck_offset = resp_sz;
+			resp->u.results.recheck_nblocks = kgtask->recheck_nblocks;
+			memcpy((char *)resp + resp_sz,
+				   kgtask->recheck_blocks,
+				   sizeof(BlockNumber) * kgtask->recheck_nblocks);
+			resp_sz += sz;
+		}
+		/*
+		 * Top-N rows are kept until XpuTaskFinal, unless the buffer is
+		 * already full; results are sent back as is in this case.
+		 */
+		if (gclient->topn_buf)
+		{
+			bool	ok = true;
+
+			pthreadMutexLock(&gclient->topn_lock);
+			if (xpuTopNBufferIsFull(gclient->topn_buf))
+				topn_kept = false;
+			else
+			{
+				for (int i=0; ok && i < kds_dst_nitems; i++)
+					ok = xpuTopNBufferAddResults(gclient->topn_buf,
+												 kds_dst_array[i]);
+				topn_kept = true;
+			}
+			pthreadMutexUnlock(&gclient->topn_lock);
+			if (!ok)
+			{
+				gpuClientELog(gclient, "out of memory on the Top-N buffer");
+				goto bailout;
+			}
+		}
+		resp->u.results.chunks_nitems = (topn_kept ? 0 : kds_dst_nitems);
 		resp->u.results.chunks_offset = resp_sz;
+		resp->u.results.chunk_id = xcmd->u.task.chunk_id;
 		resp->u.results.nitems_raw = kgtask->nitems_raw;
 		resp->u.results.nitems_in  = kgtask->nitems_in;
 		resp->u.results.nitems_out = kgtask->nitems_out;
@@ -1842,13 +1936,27 @@ resume_kernel:
 		}
 		gpuClientWriteBack(gclient,
 						   resp, resp_sz,
-						   kds_dst_nitems, kds_dst_array);
+						   resp->u.results.chunks_nitems, kds_dst_array);
 	}
 	else if (kgtask->kerror.errcode == ERRCODE_CPU_FALLBACK &&
-			 (session->xpu_task_flags & DEVTASK__MASK) != DEVTASK__PREAGG)
+			 (session->xpu_task_flags & DEVTASK__MASK) != DEVTASK__PREAGG &&
+			 kds_src != NULL)
 	{
 		XpuCommand	resp;
-		
+
+		/*
+		 * Only the portion of kds_src that exists on the host buffer is
+		 * sent back. Blocks loaded by GPU-Direct are not a part of the
+		 * xcmd, so the backend re-reads them from the storage.
+		 */
+		if (s_chunk)
+		{
+			if (kds_src->format == KDS_FORMAT_BLOCK)
+				kds_src->length = (kds_src->block_offset +
+								   BLCKSZ * kds_src->block_nloaded);
+			else
+				kds_src->length = KDS_HEAD_LENGTH(kds_src);
+		}
 		/* send back kds_src with XpuCommandTag__CPUFallback */
 		memset(&resp, 0, sizeof(resp));
 		resp.magic = XpuCommandMagicNumber;
@@ -1932,6 +2040,7 @@ gpuservHandleGpuTaskFinal(gpuClient *gclient, XpuCommand *xcmd)
 	gpuQueryBuffer *gq_buf = gclient->gq_buf;
 	XpuCommand		resp;
 	kern_data_store	*kds_final = NULL;
+	kern_data_store	*kds_topn = NULL;
 
 	memset(&resp, 0, sizeof(XpuCommand));
 	resp.magic = XpuCommandMagicNumber;
@@ -1978,11 +2087,36 @@ gpuservHandleGpuTaskFinal(gpuClient *gclient, XpuCommand *xcmd)
 			resp.u.results.final_plan_node = true;
 		}
 	}
+	/*
+	 * Is the Top-N results buffer written back?
+	 */
+	if (gclient->topn_buf)
+	{
+		bool	ok;
+
+		pthreadMutexLock(&gclient->topn_lock);
+		ok = xpuTopNBufferFinal(gclient->topn_buf, &kds_topn);
+		pthreadMutexUnlock(&gclient->topn_lock);
+		if (!ok)
+		{
+			gpuClientELog(gclient, "out of memory on the Top-N buffer");
+			return;
+		}
+		if (kds_topn)
+		{
+			assert(!kds_final);
+			kds_final = kds_topn;
+			resp.u.results.chunks_nitems = 1;
+		}
+		resp.u.results.final_plan_node = kfin->final_plan_node;
+	}
 	//fprintf(stderr, "gpuservHandleGpuTaskFinal: kfin => {final_this_device=%d final_plan_node=%d} resp => {final_this_device=%d final_plan_node=%d}\n", kfin->final_this_device, kfin->final_plan_node, resp.u.results.final_this_device, resp.u.results.final_plan_node);
 	gpuClientWriteBack(gclient, &resp,
 					   resp.u.results.chunks_offset,
 					   resp.u.results.chunks_nitems,
 					   &kds_final);
+	if (kds_topn)
+		free(kds_topn);
 }
 
 /*
@@ -2055,7 +2189,7 @@ gpuservGpuWorkerMain(void *__arg)
 			}
 
 			if (xcmd)
-				__gpuServiceFreeCommand(xcmd);
+				__gpuServiceFreeCommand(gclient, xcmd);
 			gpuClientPut(gclient, false);
 			pthreadMutexLock(&gcontext->lock);
 		}
@@ -2103,15 +2237,27 @@ gpuservMonitorClient(void *__priv)
 	GpuWorkerCurrentContext = gcontext;
 	pg_memory_barrier();
 
+	/* handshake to set up the shared-memory ring, if any */
+	if (!xpuShmRingAccept(sockfd, &gclient->shmring, elabel))
+		goto out;
+
 	for (;;)
 	{
-		struct pollfd  pfd;
+		struct pollfd  pfd[2];
+		int		nfds = 1;
 		int		nevents;
 
-		pfd.fd = sockfd;
-		pfd.events = POLLIN;
-		pfd.revents = 0;
-		nevents = poll(&pfd, 1, -1);
+		pfd[0].fd = sockfd;
+		pfd[0].events = POLLIN;
+		pfd[0].revents = 0;
+		if (gclient->shmring)
+		{
+			pfd[1].fd = xpuShmRingEventFd(gclient->shmring);
+			pfd[1].events = POLLIN;
+			pfd[1].revents = 0;
+			nfds++;
+		}
+		nevents = poll(pfd, nfds, -1);
 		if (nevents < 0)
 		{
 			if (errno == EINTR)
@@ -2121,17 +2267,25 @@ gpuservMonitorClient(void *__priv)
 		}
 		if (nevents == 0)
 			continue;
-		Assert(nevents == 1);
-		if (pfd.revents == POLLIN)
+		/* socket first, to keep the order of the commands */
+		if (pfd[0].revents == POLLIN)
 		{
 			if (__gpuServiceReceiveCommands(sockfd, gclient, elabel) < 0)
 				break;
 		}
-		else if (pfd.revents & ~POLLIN)
+		else if (pfd[0].revents & ~POLLIN)
 		{
 			__GpuServDebug("[%s] peer socket closed.", elabel);
 			break;
 		}
+		if (nfds > 1 && (pfd[1].revents & POLLIN) != 0)
+		{
+			if (xpuShmRingReceive(gclient->shmring,
+								  __gpuServiceAllocCommand,
+								  __gpuServiceAttachCommand,
+								  gclient, elabel) < 0)
+				break;
+		}
 	}
 out:
 	gpuClientPut(gclient, true);
@@ -2168,6 +2322,7 @@ gpuservAcceptClient(gpuContext *gcontext)
 	gclient->gcontext = gcontext;
 	pg_atomic_init_u32(&gclient->refcnt, 1);
 	pthreadMutexInit(&gclient->mutex);
+	pthreadMutexInit(&gclient->topn_lock);
 	gclient->sockfd = sockfd;
 
 	if ((errcode = pthread_create(&gclient->worker, NULL,
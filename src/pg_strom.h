@@ -22,11 +22,13 @@
 #include "access/brin.h"
 #include "access/heapam.h"
 #include "access/genam.h"
+#include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/syncscan.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "access/transam.h"
 #include "access/visibilitymap.h"
 #include "access/xact.h"
 #include "catalog/binary_upgrade.h"
@@ -115,6 +117,7 @@
 #include "utils/resowner.h"
 #include "utils/ruleutils.h"
 #include "utils/selfuncs.h"
+#include "utils/snapmgr.h"
 #include "utils/spccache.h"
 #include "utils/syscache.h"
 #include "utils/timestamp.h"
@@ -226,6 +229,7 @@ typedef struct devfunc_info
 } devfunc_info;
 
 typedef struct XpuConnection	XpuConnection;
+typedef struct xpuShmRing		xpuShmRing;
 typedef struct GpuCacheDesc		GpuCacheDesc;
 typedef struct DpuStorageEntry	DpuStorageEntry;
 typedef struct ArrowFdwState	ArrowFdwState;
@@ -308,6 +312,12 @@ typedef struct
 	/* group-by parameters */
 	List	   *groupby_actions;	/* list of KAGG_ACTION__* on the kds_final */
 	List	   *groupby_keys;		/* resno of grouping keys, if GROUP BY exists */
+	/* top-N parameters */
+	uint32_t	topn_nrows;			/* LIMIT of ORDER BY, if Top-N pushdown */
+	List	   *topn_exprs;			/* sort key expressions (planner only) */
+	List	   *topn_keys;			/* kds_dst attribute index of the sort keys */
+	List	   *topn_flags;			/* KERN_TOPN_KEY__* | KERN_TOPN_FLAG__* */
+	bool		topn_with_ties;		/* keeps rows tied with the last one */
 	/* inner relations */
 	int			num_rels;
 	pgstromPlanInnerInfo inners[FLEXIBLE_ARRAY_MEMBER];
@@ -355,12 +365,17 @@ typedef struct
 	pg_atomic_uint32	arrow_rbatch_index;
 	pg_atomic_uint32	arrow_rbatch_nload;	/* # of loaded record-batches */
 	pg_atomic_uint32	arrow_rbatch_nskip;	/* # of skipped record-batches */
+	pg_atomic_uint32	arrow_rbatch_nhits;	/* # of record-batches answered
+											 * by the result cache */
 	/* for gpu-cache */
 	pg_atomic_uint32	__gcache_fetch_count_data;
 	/* for gpu/dpu-direct */
 	pg_atomic_uint32	heap_normal_nblocks;
 	pg_atomic_uint32	heap_direct_nblocks;
 	pg_atomic_uint32	heap_fallback_nblocks;
+	pg_atomic_uint32	heap_scan_nprocs;	/* # of processes in the scan */
+	/* for CPU fallback */
+	pg_atomic_uint32	fallback_nchunks;	/* # of chunks fallen back */
 	/* for brin-index */
 	pg_atomic_uint32	brin_index_fetched;
 	pg_atomic_uint32	brin_index_skipped;
@@ -424,11 +439,13 @@ struct pgstromTaskState
 	pgstromSharedState *ps_state;		/* on the shared-memory segment */
 	pgstromPlanInfo	   *pp_info;
 	ArrowFdwState	   *arrow_state;
+	uint64_t			session_hash;	/* hash of xpucode and parameters */
 	BrinIndexState	   *br_state;
 	GpuCacheDesc	   *gcache_desc;
 	pg_atomic_uint32   *gcache_fetch_count;
 	kern_multirels	   *h_kmrels;		/* host inner buffer (if JOIN) */
 	const char		   *kds_pathname;	/* pathname to be used for KDS setup */
+	bool				virtual_tuple;	/* device returns kern_virtual_tuple */
 	/* current chunk (already processed by the device) */
 	XpuCommand		   *curr_resp;
 	HeapTupleData		curr_htup;
@@ -437,6 +454,8 @@ struct pgstromTaskState
 	int64_t				curr_index;
 	bool				scan_done;
 	bool				final_done;
+	bool				async_pending;	/* registered to start ahead */
+	const Plan		   *async_parent;	/* Append that owns this task */
 	/*
 	 * control variables to fire the end-of-task event
 	 * for RIGHT OUTER JOIN and PRE-AGG
@@ -459,6 +478,8 @@ struct pgstromTaskState
 	/* request command buffer (+ status for table scan) */
 	TBMIterateResult   *curr_tbm;
 	Buffer				curr_vm_buffer;		/* for visibility-map */
+	bool				xpu_mvcc_checks;	/* xPU checks MVCC visibility of
+											 * the pages not all-visible */
 	BlockNumber			curr_block_num;		/* for KDS_FORMAT_BLOCK */
 	BlockNumber			curr_block_tail;	/* for KDS_FORMAT_BLOCK */
 	StringInfoData		xcmd_buf;
@@ -641,6 +662,10 @@ extern XpuCommand *pgstromRelScanChunkDirect(pgstromTaskState *pts,
 extern XpuCommand *pgstromRelScanChunkNormal(pgstromTaskState *pts,
 											 struct iovec *xcmd_iov,
 											 int *xcmd_iovcnt);
+extern void		pgstromRelScanRecheckBlocks(pgstromTaskState *pts,
+											XpuCommand *resp);
+extern void		pgstromRelScanFallbackChunk(pgstromTaskState *pts,
+											XpuCommand *resp);
 extern void		pgstromStoreFallbackTuple(pgstromTaskState *pts, HeapTuple tuple);
 extern TupleTableSlot *pgstromFetchFallbackTuple(pgstromTaskState *pts);
 extern void		pgstrom_init_relscan(void);
@@ -658,7 +683,30 @@ extern void		__xpuClientOpenSession(pgstromTaskState *pts,
 									   const XpuCommand *session,
 									   pgsocket sockfd,
 									   const char *devname,
-									   int dev_index);
+									   int dev_index,
+									   bool local_service);
+extern bool		xpuShmRingCreate(pgsocket sockfd, size_t ring_size,
+								 xpuShmRing **p_shmring);
+extern bool		xpuShmRingAccept(pgsocket sockfd, xpuShmRing **p_shmring,
+								 const char *elabel);
+extern int		xpuShmRingEventFd(xpuShmRing *ring);
+extern int		xpuShmRingSend(xpuShmRing *ring,
+							   const struct iovec *iov, int iovcnt,
+							   bool (*check_alive)(void *arg), void *arg);
+extern bool		xpuShmRingWaitSpace(xpuShmRing *ring,
+									const struct iovec *iov, int iovcnt,
+									bool (*check_alive)(void *arg), void *arg);
+extern int		xpuShmRingTrySend(xpuShmRing *ring,
+								  const struct iovec *iov, int iovcnt);
+extern bool		xpuShmRingDrain(xpuShmRing *ring,
+								bool (*check_alive)(void *arg), void *arg);
+extern int		xpuShmRingReceive(xpuShmRing *ring,
+								  void *(*alloc_f)(void *priv, size_t sz),
+								  void  (*attach_f)(void *priv, XpuCommand *xcmd),
+								  void *priv,
+								  const char *error_label);
+extern bool		xpuShmRingRelease(xpuShmRing *ring, XpuCommand *xcmd);
+extern void		xpuShmRingClose(xpuShmRing *ring);
 extern int
 xpuConnectReceiveCommands(pgsocket sockfd,
 						  void *(*alloc_f)(void *priv, size_t sz),
@@ -668,6 +716,9 @@ xpuConnectReceiveCommands(pgsocket sockfd,
 extern void		xpuClientCloseSession(XpuConnection *conn);
 extern void		xpuClientSendCommand(XpuConnection *conn, const XpuCommand *xcmd);
 extern void		xpuClientPutResponse(XpuCommand *xcmd);
+extern void		xpuClientPushResponse(XpuConnection *conn, XpuCommand *resp);
+extern int		xpuClientNumRunningCommands(XpuConnection *conn);
+extern bool		xpuClientResetSession(XpuConnection *conn);
 extern const XpuCommand *pgstromBuildSessionInfo(pgstromTaskState *pts,
 												 uint32_t join_inner_handle,
 												 TupleDesc tdesc_final);
@@ -807,12 +858,16 @@ extern CustomScan *PlanXpuJoinPathCommon(PlannerInfo *root,
 										 pgstromPlanInfo *pp_info,
 										 const CustomScanMethods *methods);
 extern uint32_t	GpuJoinInnerPreload(pgstromTaskState *pts);
+extern void		GpuJoinInnerReset(pgstromTaskState *pts);
 extern void		ExecFallbackCpuJoin(pgstromTaskState *pts,
 									kern_data_store *kds,
 									HeapTuple tuple);
 extern void		ExecFallbackCpuJoinRightOuter(pgstromTaskState *pts);
 extern void		ExecFallbackCpuJoinOuterJoinMap(pgstromTaskState *pts,
 												XpuCommand *resp);
+extern int		pgstrom_window_topk_buffer_size_kb;
+extern void		pgstrom_build_topn_keys(pgstromPlanInfo *pp_info,
+										List *tlist_dev);
 extern void		pgstrom_init_gpu_join(void);
 extern void		pgstrom_init_dpu_join(void);
 
@@ -820,6 +875,9 @@ extern void		pgstrom_init_dpu_join(void);
  * gpu_preagg.c
  */
 extern int		pgstrom_hll_register_bits;
+extern int		pgstrom_quantile_sketch_bits;
+extern int		pgstrom_numeric_expr_scale(Expr *expr);
+extern int		pgstrom_minmax_bytes_capacity(Expr *expr);
 extern void		xpupreagg_add_custompath(PlannerInfo *root,
 										 RelOptInfo *input_rel,
 										 RelOptInfo *group_rel,
@@ -847,6 +905,8 @@ extern bool		pgstromArrowFdwExecInit(pgstromTaskState *pts,
 extern XpuCommand *pgstromScanChunkArrowFdw(pgstromTaskState *pts,
 											struct iovec *xcmd_iov,
 											int *xcmd_iovcnt);
+extern void		pgstromArrowFdwResultCacheStore(pgstromTaskState *pts,
+												XpuCommand *resp);
 extern void		pgstromArrowFdwExecEnd(ArrowFdwState *arrow_state);
 extern void		pgstromArrowFdwExecReset(ArrowFdwState *arrow_state);
 extern void		pgstromArrowFdwInitDSM(ArrowFdwState *arrow_state,
@@ -872,6 +932,8 @@ extern double	pgstrom_dpu_operator_cost;
 extern double	pgstrom_dpu_seq_page_cost;
 extern double	pgstrom_dpu_tuple_cost;
 extern bool		pgstrom_dpu_handle_cached_pages;
+extern int		pgstrom_dpu_wire_compression;
+extern int		pgstrom_dpu_wire_compression_threshold_kb;
 extern double	pgstrom_dpu_operator_ratio(void);
 
 extern const DpuStorageEntry *GetOptimalDpuForFile(const char *filename,
@@ -368,13 +368,13 @@ pgstromStoreFallbackTuple(pgstromTaskState *pts, HeapTuple htuple)
 	sz = MAXALIGN(offsetof(kern_tupitem, htup) + htuple->t_len);
 	while (pts->fallback_usage + sz > pts->fallback_bufsz)
 	{
-		pts->fallback_bufsz *= 2 + BLCKSZ;
+		pts->fallback_bufsz = 2 * pts->fallback_bufsz + BLCKSZ;
 		pts->fallback_buffer = repalloc_huge(pts->fallback_buffer,
 											 pts->fallback_bufsz);
 	}
 	while (pts->fallback_nitems >= pts->fallback_nrooms)
 	{
-		pts->fallback_nrooms *= 2 + 100;
+		pts->fallback_nrooms = 2 * pts->fallback_nrooms + 100;
 		pts->fallback_tuples = repalloc_huge(pts->fallback_tuples,
 											 sizeof(off_t) * pts->fallback_nrooms);
 	}
@@ -478,6 +478,120 @@ __relScanDirectFallbackBlock(pgstromTaskState *pts,
 	pg_atomic_fetch_add_u32(&ps_state->heap_fallback_nblocks, 1);
 }
 
+/*
+ * pgstromRelScanRecheckBlocks
+ *
+ * It runs CPU fallback on the blocks that xPU could not determine MVCC
+ * visibility of the tuples.
+ */
+void
+pgstromRelScanRecheckBlocks(pgstromTaskState *pts, XpuCommand *resp)
+{
+	kern_data_store *kds = __XCMD_GET_KDS_SRC(&pts->xcmd_buf);
+	BlockNumber	   *blocks = (BlockNumber *)
+		((char *)resp + resp->u.results.recheck_offset);
+
+	Assert(pts->xpu_mvcc_checks);
+	for (int i=0; i < resp->u.results.recheck_nblocks; i++)
+		__relScanDirectFallbackBlock(pts, kds, blocks[i]);
+}
+
+/*
+ * pgstromRelScanFallbackChunk
+ *
+ * It runs CPU fallback on the entire chunk that xPU returned with
+ * XpuCommandTag__CPUFallback, then the tuples are kept on the fallback
+ * buffer until pgstromFetchFallbackTuple() picks them up.
+ */
+void
+pgstromRelScanFallbackChunk(pgstromTaskState *pts, XpuCommand *resp)
+{
+	pgstromSharedState *ps_state = pts->ps_state;
+	Relation	relation = pts->css.ss.ss_currentRelation;
+	kern_data_store *kds;
+
+	if (resp->u.results.chunks_nitems == 0)
+		return;
+	kds = (kern_data_store *)((char *)resp + resp->u.results.chunks_offset);
+	pg_atomic_fetch_add_u32(&ps_state->fallback_nchunks, 1);
+	if (kds->format == KDS_FORMAT_ROW)
+	{
+		for (uint32_t i=0; i < kds->nitems; i++)
+		{
+			kern_tupitem   *titem = KDS_GET_TUPITEM(kds, i);
+			HeapTupleData	htup;
+
+			htup.t_len = titem->t_len;
+			htup.t_self = titem->htup.t_ctid;
+			htup.t_tableOid = RelationGetRelid(relation);
+			htup.t_data = &titem->htup;
+			pts->cb_cpu_fallback(pts, kds, &htup);
+		}
+	}
+	else if (kds->format == KDS_FORMAT_BLOCK)
+	{
+		/*
+		 * The pages loaded by the backend are already in the chunk, and
+		 * invisible tuples are invalidated by __relScanDirectCachedBlock().
+		 * Elsewhere, pages were loaded by GPU-Direct, so we re-read them.
+		 */
+		for (uint32_t i=0; i < kds->block_nloaded; i++)
+		{
+			BlockNumber	block_num = KDS_BLOCK_BLCKNR(kds, i);
+			Page		page = (Page) KDS_BLOCK_PGPAGE(kds, i);
+			int			lines = PageGetMaxOffsetNumber(page);
+			OffsetNumber lineoff;
+			ItemId		lpp;
+
+			for (lineoff = FirstOffsetNumber, lpp = PageGetItemId(page, lineoff);
+				 lineoff <= lines;
+				 lineoff++, lpp++)
+			{
+				HeapTupleData htup;
+
+				if (!ItemIdIsNormal(lpp))
+					continue;
+				htup.t_tableOid = RelationGetRelid(relation);
+				htup.t_data = (HeapTupleHeader) PageGetItem(page, lpp);
+				htup.t_len = ItemIdGetLength(lpp);
+				ItemPointerSet(&htup.t_self, block_num, lineoff);
+				pts->cb_cpu_fallback(pts, kds, &htup);
+			}
+		}
+		for (uint32_t i=kds->block_nloaded; i < kds->nitems; i++)
+			__relScanDirectFallbackBlock(pts, kds, KDS_BLOCK_BLCKNR(kds, i));
+	}
+	else
+	{
+		elog(ERROR, "CPU fallback is not supported on KDS format '%c'",
+			 kds->format);
+	}
+}
+
+/*
+ * __relScanBlockIsBuffered
+ *
+ * It checks whether the block exists on the shared buffer.
+ */
+static bool
+__relScanBlockIsBuffered(RelFileNodeBackend *smgr_rnode, BlockNumber block_num)
+{
+	BufferTag	bufTag;
+	uint32		bufHash;
+	LWLock	   *bufLock;
+	int			buf_id;
+
+	INIT_BUFFERTAG(bufTag, smgr_rnode->node, MAIN_FORKNUM, block_num);
+	bufHash = BufTableHashCode(&bufTag);
+	bufLock = BufMappingPartitionLock(bufHash);
+
+	LWLockAcquire(bufLock, LW_SHARED);
+	buf_id = BufTableLookup(&bufTag, bufHash);
+	LWLockRelease(bufLock);
+
+	return (buf_id >= 0);
+}
+
 static void
 __relScanDirectCachedBlock(pgstromTaskState *pts, BlockNumber block_num)
 {
@@ -572,6 +686,51 @@ __relScanDirectCachedBlock(pgstromTaskState *pts, BlockNumber block_num)
 	kds->block_nloaded++;
 }
 
+/*
+ * __relScanParallelClaimSize
+ *
+ * It determines the number of blocks to be claimed from the shared block
+ * counter. Each process usually claims blocks for the entire chunk, however,
+ * once the rest of the relation becomes small, it claims a smaller range
+ * according to the number of processes in the scan and the commands still
+ * in-flight on its own xPU connection, then sends the chunk without waiting
+ * for more blocks. So, the remaining ranges are picked up by the processes
+ * that have less outstanding work, instead of the last few chunks being
+ * held by a straggler.
+ */
+static BlockNumber
+__relScanParallelClaimSize(pgstromTaskState *pts,
+						   ParallelBlockTableScanDesc pb_scan,
+						   BlockNumber num_blocks,
+						   uint32_t kds_nrooms,
+						   bool *p_tail_claimed)
+{
+	pgstromSharedState *ps_state = pts->ps_state;
+	uint32_t	nprocs = pg_atomic_read_u32(&ps_state->heap_scan_nprocs);
+	uint64_t	nallocated = pg_atomic_read_u64(&pb_scan->phs_nallocated);
+	uint64_t	nremains;
+	uint64_t	nclaims;
+	int			ninflight;
+
+	if (nprocs <= 1 || nallocated >= pb_scan->phs_nblocks)
+		return num_blocks;
+	nremains = pb_scan->phs_nblocks - nallocated;
+	/*
+	 * Every process can still claim twice the full chunks; no need to
+	 * shrink the range.
+	 */
+	if (nremains >= 2 * (uint64_t)nprocs * kds_nrooms)
+		return num_blocks;
+	ninflight = (pts->conn ? xpuClientNumRunningCommands(pts->conn) : 0);
+	nclaims = nremains / (2 * nprocs * (1 + ninflight));
+	/* too small chunk makes no sense for xPU, so 1/16 of chunk at least */
+	nclaims = Max(nclaims, Max(kds_nrooms / 16, 1));
+	if (nclaims >= num_blocks)
+		return num_blocks;
+	*p_tail_claimed = true;
+	return nclaims;
+}
+
 XpuCommand *
 pgstromRelScanChunkDirect(pgstromTaskState *pts,
 						  struct iovec *xcmd_iov, int *xcmd_iovcnt)
@@ -592,6 +751,7 @@ pgstromRelScanChunkDirect(pgstromTaskState *pts,
 	uint32_t		kds_src_pathname = 0;
 	uint32_t		kds_src_iovec = 0;
 	uint32_t		kds_nrooms;
+	bool			tail_claimed = false;
 
 	kds = __XCMD_GET_KDS_SRC(&pts->xcmd_buf);
 	kds_nrooms = (PGSTROM_CHUNK_SIZE -
@@ -623,40 +783,26 @@ pgstromRelScanChunkDirect(pgstromTaskState *pts,
 			 * buffer, it makes no sense to handle this page on the
 			 * DPU device.
 			 */
-			if (pts->ds_entry && !pgstrom_dpu_handle_cached_pages)
+			if (pts->ds_entry && !pgstrom_dpu_handle_cached_pages &&
+				__relScanBlockIsBuffered(smgr_rnode, block_num))
 			{
-				BufferTag	bufTag;
-				uint32		bufHash;
-				LWLock	   *bufLock;
-				int			buf_id;
-
-				INIT_BUFFERTAG(bufTag, smgr_rnode->node, MAIN_FORKNUM, block_num);
-				bufHash = BufTableHashCode(&bufTag);
-				bufLock = BufMappingPartitionLock(bufHash);
-
-				/* check whether the block exists on the shared buffer? */
-				LWLockAcquire(bufLock, LW_SHARED);
-				buf_id = BufTableLookup(&bufTag, bufHash);
-				if (buf_id >= 0)
-				{
-					LWLockRelease(bufLock);
-					__relScanDirectFallbackBlock(pts, kds, block_num);
-					pts->curr_block_num++;
-					continue;
-				}
-				LWLockRelease(bufLock);
+				__relScanDirectFallbackBlock(pts, kds, block_num);
+				pts->curr_block_num++;
+				continue;
 			}
 			
 			/*
-			 * MEMO: right now, we allow GPU Direct SQL for the all-visible
-			 * pages only, due to the restrictions about MVCC checks.
-			 * However, it is too strict for the purpose. If we would have
-			 * a mechanism to perform MVCC checks without commit logs.
-			 * In other words, if all the tuples in a certain page have
-			 * HEAP_XMIN_* or HEAP_XMAX_* flags correctly, we can have MVCC
-			 * logic in the device code.
+			 * MEMO: xPU Direct SQL is allowed for the all-visible pages.
+			 * If xPU checks MVCC visibility using the hint bits, snapshot
+			 * and the commit log subset, it is also allowed for the pages
+			 * not all-visible, unless it is not loaded to the shared buffer.
+			 * Cached page may be dirty, so its storage image may be older.
+			 * The pages xPU cannot determine visibility of the tuples are
+			 * rechecked by CPU later. (see pgstromRelScanRecheckBlocks)
 			 */
-			if (VM_ALL_VISIBLE(relation, block_num, &pts->curr_vm_buffer))
+			if (VM_ALL_VISIBLE(relation, block_num, &pts->curr_vm_buffer) ||
+				(pts->xpu_mvcc_checks &&
+				 !__relScanBlockIsBuffered(smgr_rnode, block_num)))
 			{
 				/*
 				 * We don't allow xPU Direct SQL across multiple heap
@@ -765,7 +911,15 @@ pgstromRelScanChunkDirect(pgstromTaskState *pts,
 				h_scan->rs_startblock = pb_scan->phs_startblock;
 				SpinLockRelease(&pb_scan->phs_mutex);
 				h_scan->rs_inited = true;
+				pg_atomic_fetch_add_u32(&ps_state->heap_scan_nprocs, 1);
+			}
+			if (kds->nitems > 0 && tail_claimed)
+			{
+				/* send the chunk immediately, see __relScanParallelClaimSize */
+				break;
 			}
+			num_blocks = __relScanParallelClaimSize(pts, pb_scan, num_blocks,
+													kds_nrooms, &tail_claimed);
 			pts->curr_block_num = pg_atomic_fetch_add_u64(&pb_scan->phs_nallocated,
 														  num_blocks);
 			if (pts->curr_block_num >= h_scan->rs_nblocks)
@@ -2544,6 +2544,18 @@ CREATE FUNCTION pgstrom.pmin(timestamptz)
   RETURNS bytea
   AS 'MODULE_PATHNAME','pgstrom_partial_minmax_int64'
   LANGUAGE C STRICT PARALLEL SAFE;
+CREATE FUNCTION pgstrom.pmin(text)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_bytes'
+  LANGUAGE C STRICT PARALLEL SAFE;
+CREATE FUNCTION pgstrom.pmin(bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_bytes'
+  LANGUAGE C STRICT PARALLEL SAFE;
+CREATE FUNCTION pgstrom.pmin(uuid)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_uuid'
+  LANGUAGE C STRICT PARALLEL SAFE;
 
 --
 -- PMAX(X)
@@ -2596,6 +2608,18 @@ CREATE FUNCTION pgstrom.pmax(timestamptz)
   RETURNS bytea
   AS 'MODULE_PATHNAME','pgstrom_partial_minmax_int64'
   LANGUAGE C STRICT PARALLEL SAFE;
+CREATE FUNCTION pgstrom.pmax(text)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_bytes'
+  LANGUAGE C STRICT PARALLEL SAFE;
+CREATE FUNCTION pgstrom.pmax(bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_bytes'
+  LANGUAGE C STRICT PARALLEL SAFE;
+CREATE FUNCTION pgstrom.pmax(uuid)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_uuid'
+  LANGUAGE C STRICT PARALLEL SAFE;
 
 ---
 --- Final MIN(X)/MAX(X) functions
@@ -2620,6 +2644,16 @@ CREATE FUNCTION pgstrom.fmax_trans_fp64(bytea,bytea)
   AS 'MODULE_PATHNAME','pgstrom_fmax_trans_fp64'
   LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
+CREATE FUNCTION pgstrom.fmin_trans_bytes(bytea,bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_fmin_trans_bytes'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fmax_trans_bytes(bytea,bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_fmax_trans_bytes'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
 
 CREATE FUNCTION pgstrom.fminmax_final_int8(bytea)
   RETURNS int1
@@ -2679,6 +2713,21 @@ CREATE FUNCTION pgstrom.fminmax_final_timestamptz(bytea)
   AS 'MODULE_PATHNAME','pgstrom_fminmax_final_int64'
   LANGUAGE C STRICT PARALLEL SAFE;
 
+CREATE FUNCTION pgstrom.fminmax_final_text(bytea)
+  RETURNS text
+  AS 'MODULE_PATHNAME','pgstrom_fminmax_final_bytes'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fminmax_final_bytea(bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_fminmax_final_bytes'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fminmax_final_uuid(bytea)
+  RETURNS uuid
+  AS 'MODULE_PATHNAME','pgstrom_fminmax_final_uuid'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
 -- alternative MIN(X) for each supported type
 CREATE AGGREGATE pgstrom.min_i1(bytea)
 (
@@ -2784,6 +2833,30 @@ CREATE AGGREGATE pgstrom.min_tstz(bytea)
   parallel = safe
 );
 
+CREATE AGGREGATE pgstrom.min_text(bytea)
+(
+  sfunc = pgstrom.fmin_trans_bytes,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_text,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.min_bytea(bytea)
+(
+  sfunc = pgstrom.fmin_trans_bytes,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_bytea,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.min_uuid(bytea)
+(
+  sfunc = pgstrom.fmin_trans_bytes,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_uuid,
+  parallel = safe
+);
+
 -- alternative MAX(X) for each supported type
 CREATE AGGREGATE pgstrom.max_i1(bytea)
 (
@@ -2889,6 +2962,125 @@ CREATE AGGREGATE pgstrom.max_tstz(bytea)
   parallel = safe
 );
 
+CREATE AGGREGATE pgstrom.max_text(bytea)
+(
+  sfunc = pgstrom.fmax_trans_bytes,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_text,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.max_bytea(bytea)
+(
+  sfunc = pgstrom.fmax_trans_bytes,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_bytea,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.max_uuid(bytea)
+(
+  sfunc = pgstrom.fmax_trans_bytes,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_uuid,
+  parallel = safe
+);
+
+---
+--- BOOL_AND(X)/BOOL_OR(X)
+---
+CREATE FUNCTION pgstrom.fminmax_final_bool(bytea)
+  RETURNS bool
+  AS 'MODULE_PATHNAME','pgstrom_fminmax_final_bool'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.bool_and(bytea)
+(
+  sfunc = pgstrom.fmin_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_bool,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.bool_or(bytea)
+(
+  sfunc = pgstrom.fmax_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_bool,
+  parallel = safe
+);
+
+---
+--- BIT_AND(X)/BIT_OR(X)
+---
+CREATE FUNCTION pgstrom.pbit_and(int8)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_int64'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.pbit_or(int8)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_minmax_int64'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fbitand_trans_int64(bytea,bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_fbitand_trans_int64'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fbitor_trans_int64(bytea,bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_fbitor_trans_int64'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.bit_and_i2(bytea)
+(
+  sfunc = pgstrom.fbitand_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_int16,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.bit_and_i4(bytea)
+(
+  sfunc = pgstrom.fbitand_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_int32,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.bit_and_i8(bytea)
+(
+  sfunc = pgstrom.fbitand_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_int64,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.bit_or_i2(bytea)
+(
+  sfunc = pgstrom.fbitor_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_int16,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.bit_or_i4(bytea)
+(
+  sfunc = pgstrom.fbitor_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_int32,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.bit_or_i8(bytea)
+(
+  sfunc = pgstrom.fbitor_trans_int64,
+  stype = bytea,
+  finalfunc = pgstrom.fminmax_final_int64,
+  parallel = safe
+);
+
 ---
 --- SUM(X)
 ---
@@ -2977,6 +3169,11 @@ CREATE FUNCTION pgstrom.pavg(float8)
   AS 'MODULE_PATHNAME','pgstrom_partial_avg_fp'
   LANGUAGE C STRICT PARALLEL SAFE;
 
+CREATE FUNCTION pgstrom.pavg(numeric)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_partial_avg_num'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
 CREATE FUNCTION pgstrom.favg_trans_int(bytea, bytea)
   RETURNS bytea
   AS 'MODULE_PATHNAME','pgstrom_favg_trans_int'
@@ -2987,6 +3184,11 @@ CREATE FUNCTION pgstrom.favg_trans_fp(bytea, bytea)
   AS 'MODULE_PATHNAME','pgstrom_favg_trans_fp'
   LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
+CREATE FUNCTION pgstrom.favg_trans_num(bytea, bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_favg_trans_num'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
 CREATE FUNCTION pgstrom.favg_final_int(bytea)
   RETURNS numeric
   AS 'MODULE_PATHNAME','pgstrom_favg_final_int'
@@ -2997,6 +3199,16 @@ CREATE FUNCTION pgstrom.favg_final_fp(bytea)
   AS 'MODULE_PATHNAME','pgstrom_favg_final_fp'
   LANGUAGE C STRICT PARALLEL SAFE;
 
+CREATE FUNCTION pgstrom.favg_final_num(bytea)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME','pgstrom_favg_final_num'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fsum_final_num(bytea)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME','pgstrom_fsum_final_num'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
 CREATE AGGREGATE pgstrom.avg_int(bytea)
 (
   sfunc = pgstrom.favg_trans_int,
@@ -3013,6 +3225,22 @@ CREATE AGGREGATE pgstrom.avg_fp(bytea)
   parallel = safe
 );
 
+CREATE AGGREGATE pgstrom.avg_numeric(bytea)
+(
+  sfunc = pgstrom.favg_trans_num,
+  stype = bytea,
+  finalfunc = pgstrom.favg_final_num,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.sum_numeric(bytea)
+(
+  sfunc = pgstrom.favg_trans_num,
+  stype = bytea,
+  finalfunc = pgstrom.fsum_final_num,
+  parallel = safe
+);
+
 ---
 --- STDDEV/VARIANCE
 ---
@@ -3286,6 +3514,345 @@ CREATE AGGREGATE pgstrom.regr_syy(bytea)
   parallel = safe
 );
 
+---
+--- HyperLogLog COUNT(DISTINCT X)
+---
+CREATE FUNCTION pgstrom.hll_hash(int1)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_int1'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(int2)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_int2'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(int4)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_int4'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(int8)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_int8'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(numeric)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_numeric'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(date)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_date'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(time)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_time'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(timetz)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_timetz'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(timestamp)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_timestamp'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(timestamptz)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_timestamptz'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(bpchar)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_bpchar'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(text)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_varlena'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(bytea)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_varlena'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_hash(uuid)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_hash_uuid'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, int1)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_int1'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, int2)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_int2'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, int4)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_int4'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, int8)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_int8'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, numeric)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_numeric'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, date)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_date'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, time)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_time'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, timetz)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_timetz'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, timestamp)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_timestamp'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, timestamptz)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_timestamptz'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, bpchar)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_bpchar'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, text)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_varlena'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_varlena'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_update(bytea, uuid)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_update_uuid'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_new(int8,int4)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_new'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_merge(bytea, bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_merge'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_count_final(bytea)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_hll_count_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_sketch_histogram(bytea)
+  RETURNS int4[]
+  AS 'MODULE_PATHNAME','pgstrom_hll_sketch_histogram'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.hll_count(int1)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(int2)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(int4)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(int8)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(numeric)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(date)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(time)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(timetz)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(timestamp)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(timestamptz)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(bpchar)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(text)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(bytea)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_count(uuid)
+(
+  sfunc = pgstrom.hll_sketch_update,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.hll_combine(bytea)
+(
+  sfunc = pgstrom.hll_sketch_merge,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_sketch_merge,
+  parallel = safe
+);
+
+---
+--- PERCENTILE_CONT(X) / PERCENTILE_DISC(X) by quantile sketch
+---
+CREATE FUNCTION pgstrom.pquantile(float8,int4)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME', 'pgstrom_partial_quantile'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.quantile_merge(bytea,bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME', 'pgstrom_quantile_merge'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.quantile_cont(bytea,float8)
+  RETURNS float8
+  AS 'MODULE_PATHNAME', 'pgstrom_quantile_cont'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.quantile_cont(bytea,float8[])
+  RETURNS float8[]
+  AS 'MODULE_PATHNAME', 'pgstrom_quantile_cont_multi'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.quantile_disc(bytea,float8)
+  RETURNS float8
+  AS 'MODULE_PATHNAME', 'pgstrom_quantile_disc'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.quantile_disc(bytea,float8[])
+  RETURNS float8[]
+  AS 'MODULE_PATHNAME', 'pgstrom_quantile_disc_multi'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.quantile_combine(bytea)
+(
+  sfunc = pgstrom.quantile_merge,
+  stype = bytea,
+  combinefunc = pgstrom.quantile_merge,
+  parallel = safe
+);
+
 -- ==================================================================
 --
 -- PG-Strom regression test support functions
@@ -361,6 +361,7 @@ PG_SIMPLE_TYPECAST_TEMPLATE(int2,float8,rint, __FLOAT8_FITS_IN_INT2)
 #define __FLOAT8_FITS_IN_INT4(X)	(!isnan(X) &&						\
 									 rint(X) >= (double)INT_MIN &&			\
 									 rint(X) <= (double)INT_MAX)
+PG_SIMPLE_TYPECAST_TEMPLATE(int4,bool,(int32_t),__TYPECAST_NOCHECK)
 PG_SIMPLE_TYPECAST_TEMPLATE(int4,int1,(int32_t),__TYPECAST_NOCHECK)
 PG_SIMPLE_TYPECAST_TEMPLATE(int4,int2,(int32_t),__TYPECAST_NOCHECK)
 PG_SIMPLE_TYPECAST_TEMPLATE(int4,int8,(int32_t),__INTEGER_FITS_IN_INT4)
@@ -1740,6 +1740,184 @@ pgfn_ScalarArrayOp(XPU_PGFUNCTION_ARGS)
  *
  * ----------------------------------------------------------------
  */
+/*
+ * __kern_form_datum
+ *
+ * It writes out a datum of the projection slot onto the buffer (if not NULL),
+ * then returns the length of the datum, or -1 on errors.
+ */
+STATIC_FUNCTION(int)
+__kern_form_datum(kern_context *kcxt,
+				  const kern_colmeta *cmeta,
+				  const kern_variable *kvar,
+				  int vclass,
+				  char *buffer,
+				  uint16_t *p_infomask)
+{
+	int		nbytes;
+
+	if (vclass == KVAR_CLASS__XPU_DATUM)
+	{
+		const xpu_datum_t *xdatum = (const xpu_datum_t *)kvar->ptr;
+
+		assert(xdatum->expr_ops != NULL);
+		nbytes = xdatum->expr_ops->xpu_datum_write(kcxt, buffer, xdatum);
+		if (nbytes < 0)
+			return -1;
+	}
+	else if (cmeta->attlen > 0)
+	{
+		if (vclass == KVAR_CLASS__INLINE)
+		{
+			assert(cmeta->attlen <= sizeof(kern_variable));
+			if (buffer)
+				memcpy(buffer, kvar, cmeta->attlen);
+		}
+		else if (vclass >= 0)
+		{
+			int		sz = Min(vclass, cmeta->attlen);
+
+			if (buffer)
+			{
+				if (sz > 0)
+					memcpy(buffer, kvar->ptr, sz);
+				if (sz < cmeta->attlen)
+					memset(buffer + sz, 0, cmeta->attlen - sz);
+			}
+		}
+		else
+		{
+			STROM_ELOG(kcxt, "Bug? unexpected kvar-class for fixed-length datum");
+			return -1;
+		}
+		nbytes = cmeta->attlen;
+	}
+	else if (cmeta->attlen == -1)
+	{
+		if (vclass >= 0)
+		{
+			nbytes = VARHDRSZ + vclass;
+			if (buffer)
+			{
+				if (vclass > 0)
+					memcpy(buffer+VARHDRSZ, kvar->ptr, vclass);
+				SET_VARSIZE(buffer, nbytes);
+			}
+		}
+		else if (vclass == KVAR_CLASS__VARLENA)
+		{
+			nbytes = VARSIZE_ANY(kvar->ptr);
+			if (buffer)
+				memcpy(buffer, kvar->ptr, nbytes);
+			if (VARATT_IS_EXTERNAL(kvar->ptr))
+				*p_infomask |= HEAP_HASEXTERNAL;
+		}
+		else
+		{
+			STROM_ELOG(kcxt, "Bug? unexpected kvar-class for varlena datum");
+			return -1;
+		}
+		*p_infomask |= HEAP_HASVARWIDTH;
+	}
+	else
+	{
+		STROM_ELOG(kcxt, "Bug? unsupported attribute-length");
+		return -1;
+	}
+	return nbytes;
+}
+
+/*
+ * kern_form_virtual_tuple
+ *
+ * It writes out the projection result in kern_virtual_tuple format; that
+ * allows the host to store the result on a virtual tuple-slot without
+ * deforming. Inline attributes are written on the values[] array as is.
+ */
+STATIC_FUNCTION(int)
+kern_form_virtual_tuple(kern_context *kcxt,
+						const kern_expression *kproj,
+						const kern_data_store *kds_dst,
+						kern_virtual_tuple *kvtup)
+{
+	uint32_t	t_next;
+	uint32_t	t_usage;
+	uint16_t	t_infomask = 0;		/* unused */
+	int			nattrs = kproj->u.proj.nattrs;
+
+	if (kds_dst->ncols < nattrs)
+		nattrs = kds_dst->ncols;
+	t_usage = (offsetof(kern_virtual_tuple, values) +
+			   sizeof(uint64_t) * nattrs +
+			   BITMAPLEN(nattrs));
+	if (kvtup)
+	{
+		memset(kvtup, 0, t_usage);
+		kvtup->nattrs = nattrs;
+	}
+	/* walk on the columns */
+	for (int j=0; j < nattrs; j++)
+	{
+		const kern_colmeta *cmeta = &kds_dst->colmeta[j];
+		const kern_projection_desc *pdesc = &kproj->u.proj.desc[j];
+		const kern_variable *kvar = &kcxt->kvars_slot[pdesc->slot_id];
+		int			vclass = kcxt->kvars_class[pdesc->slot_id];
+		int			nbytes;
+		char	   *buffer = NULL;
+
+		assert(pdesc->slot_id < kcxt->kvars_nslots);
+		if (vclass == KVAR_CLASS__NULL)
+			continue;
+		if (cmeta->attbyval)
+		{
+			assert(cmeta->attlen > 0 && cmeta->attlen <= sizeof(uint64_t));
+			if (kvtup)
+				buffer = (char *)&kvtup->values[j];
+			if (__kern_form_datum(kcxt, cmeta, kvar, vclass,
+								  buffer, &t_infomask) < 0)
+				return -1;
+		}
+		else
+		{
+			t_next = TYPEALIGN(cmeta->attalign, t_usage);
+			if (kvtup)
+			{
+				if (t_next > t_usage)
+					memset((char *)kvtup + t_usage, 0, t_next - t_usage);
+				buffer = (char *)kvtup + t_next;
+				kvtup->values[j] = t_next;
+			}
+			nbytes = __kern_form_datum(kcxt, cmeta, kvar, vclass,
+									   buffer, &t_infomask);
+			if (nbytes < 0)
+				return -1;
+			t_usage = t_next + nbytes;
+		}
+		/* set not-null bit */
+		if (kvtup)
+			KVTUP_NULLMAP(kvtup)[j>>3] |= (1<<(j & 7));
+	}
+	if (kvtup)
+	{
+		int		ctid_slot = kproj->u.proj.ctid_slot;
+
+		/* assign ctid, if any */
+		if (ctid_slot >= 0 &&
+			ctid_slot < kcxt->kvars_nslots &&
+			kcxt->kvars_class[ctid_slot] == sizeof(ItemPointerData))
+		{
+			memcpy(&kvtup->t_ctid,
+				   kcxt->kvars_slot[ctid_slot].ptr,
+				   sizeof(ItemPointerData));
+		}
+		else
+		{
+			ItemPointerSetInvalid(&kvtup->t_ctid);
+		}
+	}
+	return t_usage;
+}
+
 PUBLIC_FUNCTION(int)
 kern_form_heaptuple(kern_context *kcxt,
 					const kern_expression *kproj,
@@ -1752,6 +1930,9 @@ kern_form_heaptuple(kern_context *kcxt,
 	bool		t_hasnull = false;
 	int			nattrs = kproj->u.proj.nattrs;
 
+	if (kds_dst && kds_dst->virtual_tuple)
+		return kern_form_virtual_tuple(kcxt, kproj, kds_dst,
+									   (kern_virtual_tuple *)htup);
 	if (kds_dst && kds_dst->ncols < nattrs)
 		nattrs = kds_dst->ncols;
 	/* has any NULL attributes? */
@@ -1806,75 +1987,10 @@ kern_form_heaptuple(kern_context *kcxt,
 				memset((char *)htup + t_hoff, 0, t_next - t_hoff);
 			buffer = (char *)htup + t_next;
 		}
-
-		if (vclass == KVAR_CLASS__XPU_DATUM)
-		{
-			const xpu_datum_t *xdatum = (const xpu_datum_t *)kvar->ptr;
-
-			assert(xdatum->expr_ops != NULL);
-			nbytes = xdatum->expr_ops->xpu_datum_write(kcxt, buffer, xdatum);
-			if (nbytes < 0)
-				return -1;
-		}
-		else if (cmeta->attlen > 0)
-		{
-			if (vclass == KVAR_CLASS__INLINE)
-			{
-				assert(cmeta->attlen <= sizeof(kern_variable));
-				if (buffer)
-					memcpy(buffer, kvar, cmeta->attlen);
-			}
-			else if (vclass >= 0)
-			{
-				int		sz = Min(vclass, cmeta->attlen);
-
-				if (buffer)
-				{
-					if (sz > 0)
-						memcpy(buffer, kvar->ptr, sz);
-					if (sz < cmeta->attlen)
-						memset(buffer + sz, 0, cmeta->attlen - sz);
-				}
-			}
-			else
-			{
-				STROM_ELOG(kcxt, "Bug? unexpected kvar-class for fixed-length datum");
-				return -1;
-			}
-			nbytes = cmeta->attlen;
-		}
-		else if (cmeta->attlen == -1)
-		{
-			if (vclass >= 0)
-			{
-				nbytes = VARHDRSZ + vclass;
-				if (buffer)
-				{
-					if (vclass > 0)
-						memcpy(buffer+VARHDRSZ, kvar->ptr, vclass);
-					SET_VARSIZE(buffer, nbytes);
-				}
-			}
-			else if (vclass == KVAR_CLASS__VARLENA)
-			{
-				nbytes = VARSIZE_ANY(kvar->ptr);
-				if (buffer)
-					memcpy(buffer, kvar->ptr, nbytes);
-				if (VARATT_IS_EXTERNAL(kvar->ptr))
-					t_infomask |= HEAP_HASEXTERNAL;
-			}
-			else
-			{
-				STROM_ELOG(kcxt, "Bug? unexpected kvar-class for varlena datum");
-				return -1;
-			}
-			t_infomask |= HEAP_HASVARWIDTH;
-		}
-		else
-		{
-			STROM_ELOG(kcxt, "Bug? unsupported attribute-length");
+		nbytes = __kern_form_datum(kcxt, cmeta, kvar, vclass,
+								   buffer, &t_infomask);
+		if (nbytes < 0)
 			return -1;
-		}
 		/* set not-null bit, if valid */
 		if (htup && t_hasnull)
 			htup->t_bits[j>>3] |= (1<<(j & 7));
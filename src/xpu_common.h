@@ -19,6 +19,16 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
+#ifndef __CUDACC__
+#include <stdlib.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+#endif
 
 /*
  * Functions with qualifiers
@@ -546,6 +556,8 @@ struct kern_data_store {
 	char			format;		/* one of KDS_FORMAT_* above */
 	bool			has_varlena; /* true, if any varlena attribute */
 	bool			tdhasoid;	/* copy of TupleDesc.tdhasoid */
+	bool			virtual_tuple; /* KDS_FORMAT_ROW contains kern_virtual_tuple
+									* instead of the heap-tuple image */
 	Oid				tdtypeid;	/* copy of TupleDesc.tdtypeid */
 	int32_t			tdtypmod;	/* copy of TupleDesc.tdtypmod */
 	Oid				table_oid;	/* OID of the table (only if GpuScan) */
@@ -772,6 +784,14 @@ typedef struct HeapTupleHeaderData
 #define HEAP_UPDATED			0x2000	/* this is UPDATEd version of row */
 #define HEAP_MOVED_OFF			0x4000	/* unused in xPU */
 #define HEAP_MOVED_IN			0x8000	/* unused in xPU */
+#define HEAP_MOVED				(HEAP_MOVED_OFF | HEAP_MOVED_IN)
+#define HEAP_XMIN_FROZEN		(HEAP_XMIN_COMMITTED | HEAP_XMIN_INVALID)
+#define HEAP_XMAX_SHR_LOCK		(HEAP_XMAX_EXCL_LOCK | HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_LOCK_MASK			(HEAP_XMAX_SHR_LOCK | HEAP_XMAX_EXCL_LOCK | \
+								 HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_XMAX_IS_LOCKED_ONLY(infomask)								\
+	(((infomask) & HEAP_XMAX_LOCK_ONLY) ||								\
+	 ((infomask) & (HEAP_XMAX_IS_MULTI | HEAP_LOCK_MASK)) == HEAP_XMAX_EXCL_LOCK)
 
 /*
  * information stored in t_infomask2:
@@ -851,6 +871,7 @@ typedef uint32_t		TransactionId;
 #define FrozenTransactionId			((TransactionId) 2)
 #define FirstNormalTransactionId	((TransactionId) 3)
 #define MaxTransactionId			((TransactionId) 0xffffffff)
+#define TransactionIdIsNormal(xid)	((xid) >= FirstNormalTransactionId)
 
 typedef struct
 {
@@ -1014,6 +1035,30 @@ struct kern_tupitem
 };
 typedef struct kern_tupitem		kern_tupitem;
 
+/*
+ * kern_virtual_tuple - pre-deformed result tuple
+ *
+ * If kds->virtual_tuple is set, kern_tupitem of KDS_FORMAT_ROW carries
+ * the image below, instead of HeapTupleHeaderData, so that the host can
+ * build a virtual tuple-slot without heap_deform_tuple().
+ * values[] contains the raw image of inline (attbyval) attributes, or the
+ * offset from the head of kern_virtual_tuple for by-reference attributes.
+ * The not-null bitmap (BITMAPLEN(nattrs) bytes) follows values[nattrs],
+ * then the payload of by-reference attributes.
+ */
+struct kern_virtual_tuple
+{
+	ItemPointerData	t_ctid;		/* ctid of the source row, if any */
+	uint16_t		nattrs;		/* number of attributes */
+	uint64_t		values[1];	/* inline datum or offset of the datum */
+};
+typedef struct kern_virtual_tuple	kern_virtual_tuple;
+
+#define KVTUP_NULLMAP(kvtup)								\
+	((uint8_t *)&(kvtup)->values[(kvtup)->nattrs])
+#define KVTUP_ISNULL(kvtup,j)								\
+	((KVTUP_NULLMAP(kvtup)[(j)>>3] & (1<<((j) & 7))) == 0)
+
 /*
  * kern_hashitem - individual items for KDS_FORMAT_HASH
  */
@@ -1805,15 +1850,22 @@ typedef struct
 #define KAGG_ACTION__PMIN_INT32		302		/* <int4>,<int8> - min value */
 #define KAGG_ACTION__PMIN_INT64		303		/* <int4>,<int8> - min value */
 #define KAGG_ACTION__PMIN_FP64		304		/* <int4>,<float8> - min value */
+#define KAGG_ACTION__PMIN_BYTES		305		/* <bytea> - min value (memcmp order) */
 #define KAGG_ACTION__PMAX_INT32		402		/* <int4>,<int8> - max value */
 #define KAGG_ACTION__PMAX_INT64		403		/* <int4>,<int8> - max value */
 #define KAGG_ACTION__PMAX_FP64		404		/* <int4>,<float8> - max value */
+#define KAGG_ACTION__PMAX_BYTES		405		/* <bytea> - max value (memcmp order) */
 #define KAGG_ACTION__PSUM_INT		501		/* <int8> - sum of values */
 #define KAGG_ACTION__PSUM_FP		503		/* <float8> - sum of values */
 #define KAGG_ACTION__PAVG_INT		601		/* <int4>,<int8> - NROWS+PSUM */
 #define KAGG_ACTION__PAVG_FP		602		/* <int4>,<float8> - NROWS+PSUM */
+#define KAGG_ACTION__PAVG_NUM		603		/* <int4>,<int128> - NROWS+PSUM (exact) */
 #define KAGG_ACTION__STDDEV			701		/* <int4>,<float8>,<float8> - stddev */
 #define KAGG_ACTION__COVAR			801		/* <int4>,<float8>x5 - covariance */
+#define KAGG_ACTION__HLL			901		/* <bytea> - HyperLogLog registers */
+#define KAGG_ACTION__QUANTILE		1001	/* <bytea> - quantile sketch */
+#define KAGG_ACTION__PBITAND		1101	/* <int4>,<int8> - bitwise AND */
+#define KAGG_ACTION__PBITOR			1102	/* <int4>,<int8> - bitwise OR */
 
 typedef struct
 {
@@ -1843,6 +1895,134 @@ typedef struct
 	float8_t	sum;
 } kagg_state__pavg_fp_packed;
 
+/*
+ * sum of numeric values as 192bit integer scaled by 10^scale; the scale is
+ * tracked per group, and grows when a value with more fractional digits
+ * arrives, so the sum and scale are updated under the spinlock.
+ * The device values are normalized (no trailing zeros), so the largest
+ * display scale of the inputs is also tracked, for the result to have the
+ * same display scale as PostgreSQL's SUM/AVG.
+ */
+typedef struct
+{
+	int32_t		vl_len_;
+	uint32_t	nitems;
+	uint32_t	attrs;			/* KAGG_NUMERIC_ATTR__* */
+	uint32_t	lock;			/* spinlock to update the sum */
+	int32_t		scale;			/* number of fractional digits of the sum */
+	int32_t		dscale;			/* largest display scale of the inputs */
+	uint64_t	sum[3];			/* 192bit signed integer; lowest word first */
+} kagg_state__pavg_num_packed;
+
+#define KAGG_NUMERIC_ATTR__NAN		0x0001
+#define KAGG_NUMERIC_ATTR__POS_INF	0x0002
+#define KAGG_NUMERIC_ATTR__NEG_INF	0x0004
+#define KAGG_NUMERIC_ATTR__OVERFLOW	0x0008
+
+INLINE_FUNCTION(void)
+__kagg_int192_from_int128(uint64_t *x, int128_t ival)
+{
+	x[0] = (uint64_t)ival;
+	x[1] = (uint64_t)(ival >> 64);
+	x[2] = (ival < 0 ? ~0UL : 0UL);
+}
+
+INLINE_FUNCTION(bool)
+__kagg_int192_is_zero(const uint64_t *x)
+{
+	return (x[0] == 0 && x[1] == 0 && x[2] == 0);
+}
+
+/* x += y; returns false on overflow */
+INLINE_FUNCTION(bool)
+__kagg_int192_add(uint64_t *x, const uint64_t *y)
+{
+	bool		x_neg = ((int64_t)x[2] < 0);
+	bool		y_neg = ((int64_t)y[2] < 0);
+	uint64_t	carry = 0;
+
+	for (int i=0; i < 3; i++)
+	{
+		uint64_t	a = x[i];
+		uint64_t	b = y[i];
+		uint64_t	s = a + b;
+		uint64_t	c = (s < a);
+
+		x[i] = s + carry;
+		carry = (c | (x[i] < s));
+	}
+	return (x_neg != y_neg || ((int64_t)x[2] < 0) == x_neg);
+}
+
+/* x *= 10; returns false on overflow */
+INLINE_FUNCTION(bool)
+__kagg_int192_mul10(uint64_t *x)
+{
+	uint64_t	x2[3];
+	uint64_t	x8[3];
+
+	for (int i=0; i < 3; i++)
+		x2[i] = x[i];
+	if (!__kagg_int192_add(x2, x2))
+		return false;
+	for (int i=0; i < 3; i++)
+		x8[i] = x2[i];
+	if (!__kagg_int192_add(x8, x8) ||
+		!__kagg_int192_add(x8, x8) ||
+		!__kagg_int192_add(x8, x2))
+		return false;
+	for (int i=0; i < 3; i++)
+		x[i] = x8[i];
+	return true;
+}
+
+/*
+ * __kagg_pavg_num_update
+ *
+ * It adds the 192bit integer scaled by 10^scale to the sum of the state,
+ * and the display scale of the value(s). The sum is rescaled first if the
+ * value has more fractional digits.
+ * Caller must hold the lock of the state (if concurrent), and increment
+ * the nitems by itself. It returns false on overflow, then the caller
+ * sets KAGG_NUMERIC_ATTR__OVERFLOW.
+ */
+INLINE_FUNCTION(bool)
+__kagg_pavg_num_update(kagg_state__pavg_num_packed *r,
+					   const uint64_t *ival, int scale, int dscale)
+{
+	uint64_t	sum[3];
+	uint64_t	val[3];
+	int			curr_scale = r->scale;
+
+	if (r->dscale < dscale)
+		r->dscale = dscale;
+	if (__kagg_int192_is_zero(ival))
+		return true;
+	for (int i=0; i < 3; i++)
+	{
+		sum[i] = r->sum[i];
+		val[i] = ival[i];
+	}
+	if (__kagg_int192_is_zero(sum))
+		curr_scale = Max(curr_scale, scale);
+	for (; curr_scale < scale; curr_scale++)
+	{
+		if (!__kagg_int192_mul10(sum))
+			return false;
+	}
+	for (; scale < curr_scale; scale++)
+	{
+		if (!__kagg_int192_mul10(val))
+			return false;
+	}
+	if (!__kagg_int192_add(sum, val))
+		return false;
+	for (int i=0; i < 3; i++)
+		r->sum[i] = sum[i];
+	r->scale = curr_scale;
+	return true;
+}
+
 typedef struct
 {
 	int32_t		vl_len_;
@@ -1862,12 +2042,149 @@ typedef struct
 	float8_t	sum_xy;
 } kagg_state__covar_packed;
 
+typedef struct
+{
+	int32_t		vl_len_;
+	uint32_t	nitems;
+	float8_t	min_value;
+	float8_t	max_value;
+	uint32_t	counters[1];	/* variable length; see pg_qsketch_nbuckets */
+} kagg_state__quantile_packed;
+
+#define KAGG_QUANTILE_STATE_LENGTH(qsketch_bits)					\
+	(offsetof(kagg_state__quantile_packed, counters) +				\
+	 sizeof(uint32_t) * pg_qsketch_nbuckets(qsketch_bits))
+
+/*
+ * min/max of variable-length values in binary (memcmp) order; text in "C"
+ * collation, bytea and uuid. The state has a fixed capacity of the value
+ * buffer, and the upper 8 bytes of the current value in @prefix allows to
+ * skip most of candidates without the lock. If the winner is longer than
+ * the capacity, its prefix is kept with KAGG_BYTES_ATTR__TRUNCATED; it is
+ * still exact unless another truncated value has the identical prefix,
+ * then the final function raises an error.
+ */
+typedef struct
+{
+	int32_t		vl_len_;
+	uint32_t	nitems;
+	uint64_t	prefix;			/* big-endian upper 8 bytes of the value */
+	uint32_t	lock;			/* spinlock to update the value */
+	uint16_t	attrs;			/* KAGG_BYTES_ATTR__* */
+	uint16_t	length;			/* length of the value */
+	char		value[1];		/* variable length; see arg_option */
+} kagg_state__pminmax_bytes_packed;
+
+#define KAGG_BYTES_ATTR__HAS_VALUE	0x0001
+#define KAGG_BYTES_ATTR__TRUNCATED	0x0002
+#define KAGG_PMINMAX_BYTES_STATE_LENGTH(capacity)					\
+	(offsetof(kagg_state__pminmax_bytes_packed, value) + (capacity))
+#define KAGG_PMINMAX_BYTES_MAX_CAPACITY		2000
+
+INLINE_FUNCTION(uint64_t)
+__kagg_bytes_prefix(const char *addr, uint32_t len)
+{
+	uint64_t	prefix = 0;
+
+	for (int i=0; i < sizeof(uint64_t); i++)
+		prefix = (prefix << 8) | (i < len ? (uint8_t)addr[i] : 0);
+	return prefix;
+}
+
+/*
+ * __kagg_pminmax_bytes_update
+ *
+ * It replaces the value of the state by the candidate if it wins.
+ * Caller must hold the lock of the state (if concurrent), and increment
+ * the nitems by itself.
+ */
+INLINE_FUNCTION(void)
+__kagg_pminmax_bytes_update(volatile kagg_state__pminmax_bytes_packed *r,
+							uint32_t capacity,
+							const char *addr, uint32_t len,
+							bool truncated, bool is_min)
+{
+	if (len > capacity)
+	{
+		len = capacity;
+		truncated = true;
+	}
+	if ((r->attrs & KAGG_BYTES_ATTR__HAS_VALUE) != 0)
+	{
+		bool		curr_truncated = ((r->attrs & KAGG_BYTES_ATTR__TRUNCATED) != 0);
+		uint32_t	curr_len = r->length;
+		int			comp = 0;
+
+		for (uint32_t i=0; i < Min(len, curr_len) && comp == 0; i++)
+			comp = (int)((uint8_t)addr[i]) - (int)((uint8_t)r->value[i]);
+		if (comp == 0)
+		{
+			/*
+			 * A truncated value is longer than any untruncated ones, so
+			 * it is larger if the common part is identical.
+			 */
+			if (!truncated && !curr_truncated)
+				comp = (len < curr_len ? -1 : (len > curr_len ? 1 : 0));
+			else if (truncated && !curr_truncated)
+				comp = 1;
+			else if (!truncated && curr_truncated)
+				comp = -1;
+			else
+				return;		/* ambiguous; the state is kept truncated */
+		}
+		if (is_min ? comp >= 0 : comp <= 0)
+			return;
+	}
+	for (uint32_t i=0; i < len; i++)
+		r->value[i] = addr[i];
+	r->length = len;
+	r->attrs = (KAGG_BYTES_ATTR__HAS_VALUE |
+				(truncated ? KAGG_BYTES_ATTR__TRUNCATED : 0));
+	r->prefix = __kagg_bytes_prefix(addr, len);
+}
+
+/*
+ * __kagg_fetch_bytes_kvar - pointer and length of text, bytea or uuid
+ */
+INLINE_FUNCTION(bool)
+__kagg_fetch_bytes_kvar(kern_context *kcxt, int slot_id,
+						const char **p_addr, uint32_t *p_len)
+{
+	int			vclass = kcxt->kvars_class[slot_id];
+	const char *addr = (const char *)kcxt->kvars_slot[slot_id].ptr;
+
+	if (vclass >= 0)
+	{
+		*p_addr = addr;
+		*p_len  = vclass;
+		return true;
+	}
+	if (vclass == KVAR_CLASS__VARLENA)
+	{
+		if (VARATT_IS_EXTERNAL(addr) || VARATT_IS_COMPRESSED(addr))
+		{
+			/* planner ensures the argument is never compressed */
+			STROM_ELOG(kcxt, "min/max of compressed or external datum");
+			return false;
+		}
+		*p_addr = VARDATA_ANY(addr);
+		*p_len  = VARSIZE_ANY_EXHDR(addr);
+		return true;
+	}
+	assert(vclass == KVAR_CLASS__NULL);
+	return false;
+}
+
 struct kern_aggregate_desc
 {
 	uint16_t	action;			/* any of KAGG_ACTION__* */
 	int16_t		arg0_slot_id;	/* -1, if not used */
 	int16_t		arg1_slot_id;	/* -1, if not used */
-	int16_t		__reserved__;
+	int16_t		arg_option;		/* action specific option; number of the
+								 * register bits for KAGG_ACTION__HLL,
+								 * mantissa bits for KAGG_ACTION__QUANTILE,
+								 * initial scale for KAGG_ACTION__PAVG_NUM, or
+								 * capacity for KAGG_ACTION__PMIN/PMAX_BYTES */
 };
 typedef struct kern_aggregate_desc	kern_aggregate_desc;
 
@@ -2029,6 +2346,7 @@ typedef struct
 #define XpuCommandTag__XpuTaskExec			110
 #define XpuCommandTag__XpuTaskExecGpuCache	111
 #define XpuCommandTag__XpuTaskFinal			119
+#define XpuCommandTag__Compressed			200
 #define XpuCommandMagicNumber				0xdeadbeafU
 
 /*
@@ -2066,6 +2384,8 @@ typedef struct kern_session_info
 	int64_t		hostEpochTimestamp;	/* = SetEpochTimestamp() */
 	uint64_t	xactStartTimestamp;	/* timestamp when transaction start */
 	uint32_t	session_xact_state;	/* offset to SerializedTransactionState */
+	uint32_t	session_xact_snapshot; /* offset to kern_session_snapshot, if
+									 * xPU checks MVCC visibility */
 	uint32_t	session_timezone;	/* offset to pg_tz */
 	uint32_t	session_encode;		/* offset to xpu_encode_info;
 									 * !! function pointer must be set by server */
@@ -2077,16 +2397,63 @@ typedef struct kern_session_info
 	/* group-by final buffer */
 	uint32_t	groupby_kds_final;	/* header portion of kds_final */
 
+	/* top-N results buffer */
+	uint32_t	topn_desc;			/* offset to kern_topn_desc, if any */
+
+	/* wire compression (only remote DPU sessions) */
+	uint32_t	wire_compression;	/* one of XPU_WIRE_COMPRESSION__* */
+	uint32_t	wire_compression_threshold;	/* min length to be compressed */
+
 	/* executor parameter buffer */
 	uint32_t	nparams;	/* number of parameters */
 	uint32_t	poffset[1];	/* offset of params */
 } kern_session_info;
 
+/*
+ * kern_topn_desc - Top-N (ORDER BY ... LIMIT) pushdown
+ *
+ * If session->topn_desc is valid, the xPU service keeps only the best
+ * @nrows rows of the results in the sort order below, then returns them
+ * at the XpuTaskFinal, instead of returning all the rows per task.
+ * If @nparts > 0, the first @nparts keys are partition keys (PARTITION BY
+ * of the window functions), then the best @nrows rows are kept for each
+ * partition. If @with_ties, rows tied with the last one are kept also,
+ * like rank() of the window functions.
+ * Once the rows kept exceed @buffer_limit, results of the following tasks
+ * are returned as is (without pruning), but it is still a superset of the
+ * Top-N rows.
+ */
+#define KERN_TOPN_KEY__INT16		0x0001
+#define KERN_TOPN_KEY__INT32		0x0002
+#define KERN_TOPN_KEY__INT64		0x0003
+#define KERN_TOPN_KEY__FP32			0x0004
+#define KERN_TOPN_KEY__FP64			0x0005
+#define KERN_TOPN_KEY__MASK			0x00ff
+#define KERN_TOPN_FLAG__DESC		0x0100	/* descending order */
+#define KERN_TOPN_FLAG__NULLS_FIRST	0x0200	/* NULLs come first */
+#define KERN_TOPN_FLAG__PARTITION	0x0400	/* partition key, not sort key */
+
+typedef struct {
+	int16_t		attnum;		/* attribute index of kds_dst (0-origin) */
+	uint16_t	flags;		/* KERN_TOPN_KEY__* and KERN_TOPN_FLAG__* */
+} kern_topn_key;
+
+typedef struct {
+	uint64_t	buffer_limit;	/* max bytes of the rows kept, or 0 */
+	uint32_t	nrows;		/* number of rows to be kept (per partition) */
+	uint16_t	nkeys;		/* number of keys */
+	uint16_t	nparts;		/* number of partition keys at the head of keys[] */
+	bool		with_ties;	/* keeps rows tied with the last one also */
+	kern_topn_key keys[1];
+} kern_topn_desc;
+
 typedef struct {
 	uint32_t	kds_src_pathname;	/* offset to const char *pathname */
 	uint32_t	kds_src_iovec;		/* offset to strom_io_vector */
 	uint32_t	kds_src_offset;		/* offset to kds_src */
 	uint32_t	kds_dst_offset;		/* offset to kds_dst */
+	uint32_t	chunk_id;			/* identifier of the chunk (if any), to be
+									 * echoed back in kern_exec_results */
 	char		data[1]				__MAXALIGNED__;
 } kern_exec_task;
 
@@ -2096,11 +2463,38 @@ typedef struct {
 	char		data[1]				__MAXALIGNED__;
 } kern_final_task;
 
+typedef struct {
+	uint32_t	wire_compression;	/* compression method accepted by the
+									 * server, if any */
+} kern_session_reply;
+
+/*
+ * Wire compression of XpuCommand
+ *
+ * If the remote DPU session accepted the wire compression at OpenSession,
+ * XpuCommand larger than the threshold is sent as XpuCommandTag__Compressed;
+ * that wraps the original XpuCommand compressed.
+ */
+#define XPU_WIRE_COMPRESSION__NONE		0
+#define XPU_WIRE_COMPRESSION__LZ4		1
+#define XPU_WIRE_COMPRESSION__ZSTD		2
+
+typedef struct {
+	uint32_t	method;				/* one of XPU_WIRE_COMPRESSION__* */
+	uint32_t	__padding;
+	uint64_t	rawsz;				/* length of the original XpuCommand */
+	char		data[1];			/* compressed XpuCommand */
+} kern_compressed_command;
+
 typedef struct {
 	uint32_t	chunks_offset;		/* offset of kds_dst array */
 	uint32_t	chunks_nitems;		/* number of kds_dst items */
 	uint32_t	ojmap_offset;		/* offset of outer-join-map */
 	uint32_t	ojmap_length;		/* length of outer-join-map */
+	uint32_t	recheck_offset;		/* offset of BlockNumber array to be
+									 * rechecked by CPU, due to MVCC */
+	uint32_t	recheck_nblocks;	/* number of blocks to be rechecked */
+	uint32_t	chunk_id;			/* copy of kern_exec_task.chunk_id */
 	kern_final_task kfin;			/* copy from XpuTaskFinal if any */
 	bool		final_plan_node;
 	bool		final_this_device;
@@ -2140,6 +2534,8 @@ typedef struct
 		kern_exec_task		task;
 		kern_final_task		fin;
 		kern_exec_results	results;
+		kern_session_reply	reply;
+		kern_compressed_command compressed;
 	} u;
 } XpuCommand;
 
@@ -2345,6 +2741,142 @@ SESSION_XACT_STATE(kern_session_info *session)
 	return (SerializedTransactionState *)((char *)session + session->session_xact_state);
 }
 
+/*
+ * kern_session_snapshot
+ *
+ * MVCC snapshot of the query, and a subset of the commit log for the
+ * recent transactions, to check visibility of the tuples on the pages
+ * that are not all-visible. The commit log subset covers the transactions
+ * in [clog_base, clog_base + clog_nitems), with 2bits per transaction.
+ * Tuples we cannot determine its visibility by the hint bits and the
+ * snapshot are rechecked by CPU, per page.
+ */
+#define XPU_MVCC__UNKNOWN		0
+#define XPU_MVCC__VISIBLE		1	/* committed, and visible to the snapshot */
+#define XPU_MVCC__INVISIBLE		2	/* aborted, or in-progress */
+
+typedef struct
+{
+	TransactionId	xmin;			/* all XID < xmin are visible */
+	TransactionId	xmax;			/* all XID >= xmax are invisible */
+	bool			suboverflowed;	/* subxip[] is not included in xip[] */
+	TransactionId	clog_base;		/* first XID of the commit log subset */
+	uint32_t		clog_nitems;	/* number of XIDs in the commit log subset */
+	uint32_t		clog_offset;	/* offset to the commit log subset */
+	uint32_t		xcnt;			/* number of in-progress XIDs */
+	TransactionId	xip[1];			/* in-progress XIDs, including subxip[] */
+} kern_session_snapshot;
+
+INLINE_FUNCTION(kern_session_snapshot *)
+SESSION_XACT_SNAPSHOT(kern_session_info *session)
+{
+	if (session->session_xact_snapshot == 0)
+		return NULL;
+	return (kern_session_snapshot *)((char *)session + session->session_xact_snapshot);
+}
+
+/*
+ * __xpu_xid_visibility
+ *
+ * It checks whether the transaction is committed and visible to the snapshot.
+ * 'hint_committed' means the transaction is already known as committed.
+ */
+INLINE_FUNCTION(int)
+__xpu_xid_visibility(kern_session_info *session,
+					 kern_session_snapshot *snap,
+					 TransactionId xid, bool hint_committed)
+{
+	SerializedTransactionState *xstate = SESSION_XACT_STATE(session);
+	uint32_t	index;
+
+	if (!TransactionIdIsNormal(xid))
+		return (xid == InvalidTransactionId
+				? XPU_MVCC__INVISIBLE
+				: XPU_MVCC__VISIBLE);
+	/* own transaction needs command-id checks on CPU */
+	if (xstate)
+	{
+		for (int i=0; i < xstate->nParallelCurrentXids; i++)
+		{
+			if (xid == xstate->parallelCurrentXids[i])
+				return XPU_MVCC__UNKNOWN;
+		}
+	}
+	/* commit log subset */
+	index = xid - snap->clog_base;
+	if (index < snap->clog_nitems)
+	{
+		const uint8_t *clog = (const uint8_t *)snap + snap->clog_offset;
+
+		return (clog[index >> 2] >> ((index & 3) << 1)) & 3;
+	}
+	/* not started yet at the snapshot */
+	if ((int32_t)(xid - snap->xmax) >= 0)
+		return XPU_MVCC__INVISIBLE;
+	if ((int32_t)(xid - snap->xmin) >= 0)
+	{
+		for (uint32_t i=0; i < snap->xcnt; i++)
+		{
+			if (xid == snap->xip[i])
+				return XPU_MVCC__INVISIBLE;
+		}
+		if (snap->suboverflowed)
+			return XPU_MVCC__UNKNOWN;
+	}
+	return (hint_committed ? XPU_MVCC__VISIBLE : XPU_MVCC__UNKNOWN);
+}
+
+/*
+ * kern_heaptuple_visibility
+ *
+ * A device version of HeapTupleSatisfiesMVCC, that depends on the hint bits,
+ * the snapshot and the commit log subset. It returns XPU_MVCC__UNKNOWN if
+ * the tuple must be checked by CPU.
+ */
+INLINE_FUNCTION(int)
+kern_heaptuple_visibility(kern_session_info *session,
+						  const HeapTupleHeaderData *htup)
+{
+	kern_session_snapshot *snap = SESSION_XACT_SNAPSHOT(session);
+	uint16_t	infomask = htup->t_infomask;
+	int			status;
+
+	if (!snap)
+		return XPU_MVCC__VISIBLE;
+	if ((infomask & HEAP_MOVED) != 0)
+		return XPU_MVCC__UNKNOWN;
+	/* checks for xmin */
+	if ((infomask & HEAP_XMIN_FROZEN) != HEAP_XMIN_FROZEN)
+	{
+		if ((infomask & HEAP_XMIN_INVALID) != 0)
+			return XPU_MVCC__INVISIBLE;
+		status = __xpu_xid_visibility(session, snap,
+									  htup->t_choice.t_heap.t_xmin,
+									  (infomask & HEAP_XMIN_COMMITTED) != 0);
+		if (status != XPU_MVCC__VISIBLE)
+			return status;
+	}
+	/* checks for xmax */
+	if ((infomask & HEAP_XMAX_INVALID) != 0 ||
+		HEAP_XMAX_IS_LOCKED_ONLY(infomask))
+		return XPU_MVCC__VISIBLE;
+	if ((infomask & HEAP_XMAX_IS_MULTI) != 0)
+		return XPU_MVCC__UNKNOWN;
+	status = __xpu_xid_visibility(session, snap,
+								  htup->t_choice.t_heap.t_xmax,
+								  (infomask & HEAP_XMAX_COMMITTED) != 0);
+	switch (status)
+	{
+		case XPU_MVCC__VISIBLE:
+			return XPU_MVCC__INVISIBLE;	/* deleted */
+		case XPU_MVCC__INVISIBLE:
+			return XPU_MVCC__VISIBLE;	/* deleter is aborted or in-progress */
+		default:
+			break;
+	}
+	return XPU_MVCC__UNKNOWN;
+}
+
 INLINE_FUNCTION(struct pg_tz *)
 SESSION_TIMEZONE(kern_session_info *session)
 {
@@ -2361,6 +2893,912 @@ SESSION_ENCODE(kern_session_info *session)
 	return (struct xpu_encode_info *)((char *)session + session->session_encode);
 }
 
+INLINE_FUNCTION(kern_topn_desc *)
+SESSION_TOPN_DESC(kern_session_info *session)
+{
+	if (session->topn_desc == 0)
+		return NULL;
+	return (kern_topn_desc *)((char *)session + session->topn_desc);
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Wire compression of XpuCommand (host code only)
+ *
+ * The sender compresses XpuCommand larger than the threshold, then wraps
+ * it by XpuCommandTag__Compressed. The compression level is adjusted
+ * according to the balance between the time consumed by compression and
+ * the time consumed by transmission; it prefers the lighter compression
+ * if CPU is the bottleneck, and stronger compression if network is.
+ *
+ * ----------------------------------------------------------------
+ */
+#ifndef __CUDACC__
+#define XPU_WIRE_COMPRESSION_LEVEL_MIN		1
+#define XPU_WIRE_COMPRESSION_LEVEL_MAX		9
+#define XPU_WIRE_COMPRESSION_LEVEL_INIT		3
+/* smaller message is usually absorbed by the socket buffer */
+#define XPU_WIRE_COMPRESSION_SAMPLE_MINSZ	(256UL << 10)
+
+typedef struct
+{
+	uint32_t	method;		/* one of XPU_WIRE_COMPRESSION__* */
+	uint32_t	threshold;	/* min length of XpuCommand to be compressed */
+	int			level;		/* current compression level (1...9) */
+	uint64_t	comp_usec;	/* time consumed by the last compression */
+} xpuWireCompressor;
+
+INLINE_FUNCTION(uint64_t)
+__xpuWireClockUsec(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000UL + (uint64_t)ts.tv_nsec / 1000UL;
+}
+
+INLINE_FUNCTION(bool)
+xpuWireCompressionSupported(uint32_t method)
+{
+	switch (method)
+	{
+#ifdef USE_LZ4
+		case XPU_WIRE_COMPRESSION__LZ4:
+			return true;
+#endif
+#ifdef USE_ZSTD
+		case XPU_WIRE_COMPRESSION__ZSTD:
+			return true;
+#endif
+		default:
+			break;
+	}
+	return false;
+}
+
+INLINE_FUNCTION(void)
+xpuWireCompressorInit(xpuWireCompressor *wcomp,
+					  uint32_t method, uint32_t threshold)
+{
+	if (!xpuWireCompressionSupported(method))
+		method = XPU_WIRE_COMPRESSION__NONE;
+	wcomp->method    = method;
+	wcomp->threshold = Max(threshold, offsetof(XpuCommand, u));
+	wcomp->level     = XPU_WIRE_COMPRESSION_LEVEL_INIT;
+	wcomp->comp_usec = 0;
+}
+
+/*
+ * xpuWireCompressBufsz
+ *
+ * It returns the required length of the working buffer for
+ * xpuWireCompressIOV(), or 0 if the message should be sent as is.
+ */
+INLINE_FUNCTION(size_t)
+xpuWireCompressBufsz(xpuWireCompressor *wcomp,
+					 const struct iovec *iov, int iovcnt)
+{
+	size_t		rawsz = 0;
+	size_t		bound;
+
+	if (wcomp->method == XPU_WIRE_COMPRESSION__NONE)
+		return 0;
+	for (int i=0; i < iovcnt; i++)
+		rawsz += iov[i].iov_len;
+	if (rawsz < wcomp->threshold)
+		return 0;
+	switch (wcomp->method)
+	{
+#ifdef USE_LZ4
+		case XPU_WIRE_COMPRESSION__LZ4:
+			if (rawsz > LZ4_MAX_INPUT_SIZE)
+				return 0;
+			bound = LZ4_compressBound(rawsz);
+			break;
+#endif
+#ifdef USE_ZSTD
+		case XPU_WIRE_COMPRESSION__ZSTD:
+			bound = ZSTD_compressBound(rawsz);
+			break;
+#endif
+		default:
+			return 0;
+	}
+	/* compressed command, and contiguous copy of the raw command */
+	return (TYPEALIGN(16, offsetof(XpuCommand, u.compressed.data) + bound) +
+			(iovcnt > 1 ? rawsz : 0));
+}
+
+/*
+ * xpuWireCompressIOV
+ *
+ * It compresses the XpuCommand given as iovec onto the 'buffer' with
+ * the length of xpuWireCompressBufsz(). It returns NULL if compression
+ * was not worthwhile; the caller should send the original one then.
+ */
+INLINE_FUNCTION(XpuCommand *)
+xpuWireCompressIOV(xpuWireCompressor *wcomp,
+				   const struct iovec *iov, int iovcnt,
+				   void *buffer, size_t bufsz)
+{
+	XpuCommand *zcmd = (XpuCommand *)buffer;
+	const char *src;
+	size_t		rawsz = 0;
+	size_t		zsz = 0;
+	size_t		zcap;
+	uint64_t	tv1 = __xpuWireClockUsec();
+
+	for (int i=0; i < iovcnt; i++)
+		rawsz += iov[i].iov_len;
+	if (iovcnt == 1)
+	{
+		src  = (const char *)iov[0].iov_base;
+		zcap = bufsz - offsetof(XpuCommand, u.compressed.data);
+	}
+	else
+	{
+		char   *pos;
+
+		zcap = bufsz - rawsz;
+		pos  = (char *)buffer + zcap;
+		for (int i=0; i < iovcnt; i++)
+		{
+			memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+			pos += iov[i].iov_len;
+		}
+		src  = (char *)buffer + zcap;
+		zcap = TYPEALIGN_DOWN(16, zcap) - offsetof(XpuCommand, u.compressed.data);
+	}
+
+	switch (wcomp->method)
+	{
+#ifdef USE_LZ4
+		case XPU_WIRE_COMPRESSION__LZ4:
+			{
+				/* LZ4 has acceleration factor, instead of level */
+				int		nbytes = LZ4_compress_fast(src,
+												   zcmd->u.compressed.data,
+												   rawsz, zcap,
+												   XPU_WIRE_COMPRESSION_LEVEL_MAX + 1 - wcomp->level);
+				if (nbytes <= 0)
+					return NULL;
+				zsz = nbytes;
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case XPU_WIRE_COMPRESSION__ZSTD:
+			zsz = ZSTD_compress(zcmd->u.compressed.data, zcap,
+								src, rawsz, wcomp->level);
+			if (ZSTD_isError(zsz))
+				return NULL;
+			break;
+#endif
+		default:
+			return NULL;
+	}
+	wcomp->comp_usec = __xpuWireClockUsec() - tv1;
+	/* not worthwhile if compression ratio is poor */
+	if (zsz >= rawsz - rawsz / 10)
+	{
+		if (wcomp->level > XPU_WIRE_COMPRESSION_LEVEL_MIN)
+			wcomp->level--;
+		return NULL;
+	}
+	memset(zcmd, 0, offsetof(XpuCommand, u.compressed.data));
+	zcmd->magic  = XpuCommandMagicNumber;
+	zcmd->tag    = XpuCommandTag__Compressed;
+	zcmd->length = offsetof(XpuCommand, u.compressed.data) + zsz;
+	zcmd->u.compressed.method = wcomp->method;
+	zcmd->u.compressed.rawsz  = rawsz;
+
+	return zcmd;
+}
+
+/*
+ * xpuWireCompressFeedback
+ *
+ * It adjusts the compression level according to the time consumed by
+ * transmission of the last compressed command.
+ */
+INLINE_FUNCTION(void)
+xpuWireCompressFeedback(xpuWireCompressor *wcomp,
+						XpuCommand *zcmd, uint64_t send_usec)
+{
+	if (zcmd->length < XPU_WIRE_COMPRESSION_SAMPLE_MINSZ)
+		return;
+	if (wcomp->comp_usec > send_usec)
+	{
+		/* CPU is the bottleneck */
+		if (wcomp->level > XPU_WIRE_COMPRESSION_LEVEL_MIN)
+			wcomp->level--;
+	}
+	else if (2 * wcomp->comp_usec < send_usec)
+	{
+		/* network is the bottleneck */
+		if (wcomp->level < XPU_WIRE_COMPRESSION_LEVEL_MAX)
+			wcomp->level++;
+	}
+}
+
+/*
+ * xpuWireDecompress
+ *
+ * It decompresses the XpuCommandTag__Compressed onto the 'xcmd' with
+ * the length of zcmd->u.compressed.rawsz.
+ */
+INLINE_FUNCTION(bool)
+xpuWireDecompress(const XpuCommand *zcmd, XpuCommand *xcmd)
+{
+	size_t		zsz = zcmd->length - offsetof(XpuCommand, u.compressed.data);
+	size_t		rawsz = zcmd->u.compressed.rawsz;
+
+	switch (zcmd->u.compressed.method)
+	{
+#ifdef USE_LZ4
+		case XPU_WIRE_COMPRESSION__LZ4:
+			if (LZ4_decompress_safe(zcmd->u.compressed.data,
+									(char *)xcmd,
+									zsz, rawsz) != (int)rawsz)
+				return false;
+			break;
+#endif
+#ifdef USE_ZSTD
+		case XPU_WIRE_COMPRESSION__ZSTD:
+			if (ZSTD_decompress(xcmd, rawsz,
+								zcmd->u.compressed.data, zsz) != rawsz)
+				return false;
+			break;
+#endif
+		default:
+			return false;
+	}
+	return (xcmd->magic  == XpuCommandMagicNumber &&
+			xcmd->length == rawsz);
+}
+#endif	/* !__CUDACC__ */
+
+/* ----------------------------------------------------------------
+ *
+ * Top-N results buffer (host code only)
+ *
+ * The xPU service accumulates the result rows of the tasks in a session
+ * on the bounded binary heap; heap[0] is the row to be evicted first,
+ * thus a new row is kept only if it is prior to heap[0] in the sort
+ * order. If kern_topn_desc has partition keys (per-group Top-K of the
+ * window functions), every partition has its own heap on the hash table.
+ * If with_ties, rows tied with heap[0] are also kept on the ties array.
+ * The caller must serialize the operations on the same buffer.
+ *
+ * ----------------------------------------------------------------
+ */
+#ifndef __CUDACC__
+typedef struct xpuTopNPartition
+{
+	struct xpuTopNPartition *next;	/* next partition on the hash slot */
+	uint32_t	hash;			/* hash value of the partition keys */
+	uint32_t	nitems;			/* number of rows on the heap */
+	uint32_t	nalloc;			/* allocated length of the heap */
+	uint32_t	nties;			/* number of rows tied with heap[0] */
+	uint32_t	ties_nalloc;	/* allocated length of the ties */
+	kern_tupitem **heap;		/* array of up to topn->nrows items */
+	kern_tupitem **ties;		/* rows tied with heap[0], if with_ties */
+} xpuTopNPartition;
+
+typedef struct
+{
+	const kern_topn_desc *topn;	/* Top-N definition in the session */
+	kern_data_store *kds_head;	/* header portion of the result KDS */
+	uint64_t	usage;			/* approximate bytes of the rows kept */
+	uint32_t	nparts;			/* number of partitions */
+	uint32_t	nslots;			/* number of hash slots */
+	xpuTopNPartition **slots;	/* hash slots of the partitions */
+} xpuTopNBuffer;
+
+INLINE_FUNCTION(xpuTopNBuffer *)
+xpuTopNBufferCreate(const kern_topn_desc *topn)
+{
+	xpuTopNBuffer  *tbuf = (xpuTopNBuffer *)calloc(1, sizeof(xpuTopNBuffer));
+
+	if (!tbuf)
+		return NULL;
+	tbuf->nslots = (topn->nparts > 0 ? 1024 : 1);
+	tbuf->slots = (xpuTopNPartition **)calloc(tbuf->nslots,
+											  sizeof(xpuTopNPartition *));
+	if (!tbuf->slots)
+	{
+		free(tbuf);
+		return NULL;
+	}
+	tbuf->topn = topn;
+	return tbuf;
+}
+
+/* releases all the partitions and rows kept */
+INLINE_FUNCTION(void)
+__xpuTopNBufferReset(xpuTopNBuffer *tbuf)
+{
+	for (uint32_t k=0; k < tbuf->nslots; k++)
+	{
+		xpuTopNPartition *tpart;
+
+		while ((tpart = tbuf->slots[k]) != NULL)
+		{
+			tbuf->slots[k] = tpart->next;
+			while (tpart->nitems > 0)
+				free(tpart->heap[--tpart->nitems]);
+			while (tpart->nties > 0)
+				free(tpart->ties[--tpart->nties]);
+			if (tpart->heap)
+				free(tpart->heap);
+			if (tpart->ties)
+				free(tpart->ties);
+			free(tpart);
+		}
+	}
+	tbuf->nparts = 0;
+	tbuf->usage = 0;
+}
+
+/*
+ * xpuTopNBufferIsFull
+ *
+ * It returns true if the buffer already exceeds the limit. The caller
+ * has to check it per task, then return the results of the task as is,
+ * instead of xpuTopNBufferAddResults().
+ */
+INLINE_FUNCTION(bool)
+xpuTopNBufferIsFull(const xpuTopNBuffer *tbuf)
+{
+	return (tbuf->topn->buffer_limit > 0 &&
+			tbuf->usage >= tbuf->topn->buffer_limit);
+}
+
+/* releases the row kept */
+INLINE_FUNCTION(void)
+__xpuTopNReleaseItem(xpuTopNBuffer *tbuf, kern_tupitem *titem)
+{
+	tbuf->usage -= (offsetof(kern_tupitem, htup) + titem->t_len);
+	free(titem);
+}
+
+INLINE_FUNCTION(void)
+xpuTopNBufferRelease(xpuTopNBuffer *tbuf)
+{
+	__xpuTopNBufferReset(tbuf);
+	if (tbuf->kds_head)
+		free(tbuf->kds_head);
+	free(tbuf->slots);
+	free(tbuf);
+}
+
+/*
+ * __xpuTopNFetchAttr - returns the address of the attribute, or NULL
+ */
+INLINE_FUNCTION(const char *)
+__xpuTopNFetchAttr(const kern_data_store *kds,
+				   const kern_tupitem *tupitem, int attnum)
+{
+	if (kds->virtual_tuple)
+	{
+		const kern_virtual_tuple *kvtup = (const kern_virtual_tuple *)&tupitem->htup;
+
+		if (attnum >= kvtup->nattrs || KVTUP_ISNULL(kvtup, attnum))
+			return NULL;
+		if (kds->colmeta[attnum].attbyval)
+			return (const char *)&kvtup->values[attnum];
+		return (const char *)kvtup + kvtup->values[attnum];
+	}
+	else
+	{
+		const HeapTupleHeaderData *htup = &tupitem->htup;
+		bool		hasnull = ((htup->t_infomask & HEAP_HASNULL) != 0);
+		int			natts = (htup->t_infomask2 & HEAP_NATTS_MASK);
+		const char *pos = (const char *)htup + htup->t_hoff;
+
+		if (attnum >= natts)
+			return NULL;
+		for (int j=0; j <= attnum; j++)
+		{
+			const kern_colmeta *cmeta = &kds->colmeta[j];
+
+			if (hasnull && att_isnull(j, htup->t_bits))
+			{
+				if (j == attnum)
+					return NULL;
+				continue;
+			}
+			if (cmeta->attlen > 0 || !VARATT_NOT_PAD_BYTE(pos))
+				pos = (const char *)TYPEALIGN(cmeta->attalign, pos);
+			if (j == attnum)
+				return pos;
+			if (cmeta->attlen > 0)
+				pos += cmeta->attlen;
+			else if (cmeta->attlen == -1)
+				pos += VARSIZE_ANY(pos);
+			else
+				pos += strlen(pos) + 1;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * __xpuTopNFetchPartKey - returns the image of the partition key, or NULL
+ */
+INLINE_FUNCTION(const char *)
+__xpuTopNFetchPartKey(const kern_data_store *kds,
+					  const kern_tupitem *tupitem, int attnum,
+					  uint32_t *p_len)
+{
+	const kern_colmeta *cmeta = &kds->colmeta[attnum];
+	const char *addr = __xpuTopNFetchAttr(kds, tupitem, attnum);
+
+	if (!addr)
+		return NULL;
+	if (cmeta->attlen > 0)
+		*p_len = cmeta->attlen;
+	else if (cmeta->attlen == -1)
+	{
+		*p_len = VARSIZE_ANY_EXHDR(addr);
+		addr = VARDATA_ANY(addr);
+	}
+	else
+		*p_len = strlen(addr);
+	return addr;
+}
+
+/*
+ * __xpuTopNHashPartition
+ *
+ * Partition keys are hashed and compared by their binary images. Equal
+ * values with different images (like 0.0 and -0.0) make separate
+ * partitions, but it just keeps a superset of the Top-N rows.
+ */
+INLINE_FUNCTION(uint32_t)
+__xpuTopNHashPartition(const xpuTopNBuffer *tbuf,
+					   const kern_tupitem *tupitem)
+{
+	uint32_t	hash = 2166136261U;		/* FNV-1a */
+
+	for (int i=0; i < tbuf->topn->nparts; i++)
+	{
+		const char *addr;
+		uint32_t	len;
+
+		addr = __xpuTopNFetchPartKey(tbuf->kds_head, tupitem,
+									 tbuf->topn->keys[i].attnum, &len);
+		if (!addr)
+			hash = (hash ^ 0xffU) * 16777619U;
+		else
+		{
+			for (uint32_t j=0; j < len; j++)
+				hash = (hash ^ (uint8_t)addr[j]) * 16777619U;
+		}
+		hash = (hash ^ 0x5aU) * 16777619U;
+	}
+	return hash;
+}
+
+INLINE_FUNCTION(bool)
+__xpuTopNEqualPartition(const xpuTopNBuffer *tbuf,
+						const kern_tupitem *a,
+						const kern_tupitem *b)
+{
+	for (int i=0; i < tbuf->topn->nparts; i++)
+	{
+		int			attnum = tbuf->topn->keys[i].attnum;
+		const char *x, *y;
+		uint32_t	xlen, ylen;
+
+		x = __xpuTopNFetchPartKey(tbuf->kds_head, a, attnum, &xlen);
+		y = __xpuTopNFetchPartKey(tbuf->kds_head, b, attnum, &ylen);
+		if (!x || !y)
+		{
+			if (x || y)
+				return false;
+		}
+		else if (xlen != ylen || memcmp(x, y, xlen) != 0)
+			return false;
+	}
+	return true;
+}
+
+#define __XPU_TOPN_COMPARE(TYPE,a,b)					\
+	do {												\
+		TYPE	__x, __y;								\
+														\
+		memcpy(&__x, (a), sizeof(TYPE));				\
+		memcpy(&__y, (b), sizeof(TYPE));				\
+		comp = (__x < __y ? -1 : (__x > __y ? 1 : 0));	\
+	} while(0)
+
+#define __XPU_TOPN_COMPARE_FP(TYPE,a,b)					\
+	do {												\
+		TYPE	__x, __y;								\
+														\
+		memcpy(&__x, (a), sizeof(TYPE));				\
+		memcpy(&__y, (b), sizeof(TYPE));				\
+		/* NaN is larger than any other values */		\
+		if (__x != __x)									\
+			comp = (__y != __y ? 0 : 1);				\
+		else if (__y != __y)							\
+			comp = -1;									\
+		else											\
+			comp = (__x < __y ? -1 : (__x > __y ? 1 : 0)); \
+	} while(0)
+
+/*
+ * __xpuTopNCompare - negative, if @a is prior to @b in the sort order
+ */
+INLINE_FUNCTION(int)
+__xpuTopNCompare(const xpuTopNBuffer *tbuf,
+				 const kern_tupitem *a,
+				 const kern_tupitem *b)
+{
+	const kern_topn_desc *topn = tbuf->topn;
+
+	/* partition keys are not sort keys */
+	for (int i=topn->nparts; i < topn->nkeys; i++)
+	{
+		const kern_topn_key *tkey = &topn->keys[i];
+		const char *x = __xpuTopNFetchAttr(tbuf->kds_head, a, tkey->attnum);
+		const char *y = __xpuTopNFetchAttr(tbuf->kds_head, b, tkey->attnum);
+		int			comp;
+
+		if (!x || !y)
+		{
+			if (!x && !y)
+				continue;
+			comp = (!x ? 1 : -1);
+			if ((tkey->flags & KERN_TOPN_FLAG__NULLS_FIRST) != 0)
+				comp = -comp;
+			return comp;
+		}
+		switch (tkey->flags & KERN_TOPN_KEY__MASK)
+		{
+			case KERN_TOPN_KEY__INT16:
+				__XPU_TOPN_COMPARE(int16_t, x, y);
+				break;
+			case KERN_TOPN_KEY__INT32:
+				__XPU_TOPN_COMPARE(int32_t, x, y);
+				break;
+			case KERN_TOPN_KEY__INT64:
+				__XPU_TOPN_COMPARE(int64_t, x, y);
+				break;
+			case KERN_TOPN_KEY__FP32:
+				__XPU_TOPN_COMPARE_FP(float, x, y);
+				break;
+			case KERN_TOPN_KEY__FP64:
+				__XPU_TOPN_COMPARE_FP(double, x, y);
+				break;
+			default:
+				comp = 0;
+				break;
+		}
+		if ((tkey->flags & KERN_TOPN_FLAG__DESC) != 0)
+			comp = -comp;
+		if (comp != 0)
+			return comp;
+	}
+	return 0;
+}
+#undef __XPU_TOPN_COMPARE
+#undef __XPU_TOPN_COMPARE_FP
+
+/* sift-down from heap[index]; parent is never prior to the children */
+INLINE_FUNCTION(void)
+__xpuTopNSiftDown(xpuTopNBuffer *tbuf, xpuTopNPartition *tpart, uint32_t index)
+{
+	kern_tupitem  **heap = tpart->heap;
+	kern_tupitem   *curr = heap[index];
+
+	for (;;)
+	{
+		uint32_t	child = 2 * index + 1;
+
+		if (child >= tpart->nitems)
+			break;
+		if (child + 1 < tpart->nitems &&
+			__xpuTopNCompare(tbuf, heap[child], heap[child+1]) < 0)
+			child++;
+		if (__xpuTopNCompare(tbuf, curr, heap[child]) >= 0)
+			break;
+		heap[index] = heap[child];
+		index = child;
+	}
+	heap[index] = curr;
+}
+
+/* sift-up from heap[index] */
+INLINE_FUNCTION(void)
+__xpuTopNSiftUp(xpuTopNBuffer *tbuf, xpuTopNPartition *tpart, uint32_t index)
+{
+	kern_tupitem  **heap = tpart->heap;
+	kern_tupitem   *curr = heap[index];
+
+	while (index > 0)
+	{
+		uint32_t	parent = (index - 1) / 2;
+
+		if (__xpuTopNCompare(tbuf, heap[parent], curr) >= 0)
+			break;
+		heap[index] = heap[parent];
+		index = parent;
+	}
+	heap[index] = curr;
+}
+
+/*
+ * __xpuTopNLookupPartition - returns the partition of the row, or NULL
+ * on out of memory. A new partition is created on demand.
+ */
+INLINE_FUNCTION(xpuTopNPartition *)
+__xpuTopNLookupPartition(xpuTopNBuffer *tbuf, const kern_tupitem *tupitem)
+{
+	xpuTopNPartition *tpart;
+	uint32_t	hash = 0;
+
+	if (tbuf->topn->nparts == 0)
+	{
+		if (tbuf->slots[0])
+			return tbuf->slots[0];
+	}
+	else
+	{
+		hash = __xpuTopNHashPartition(tbuf, tupitem);
+		for (tpart = tbuf->slots[hash % tbuf->nslots];
+			 tpart != NULL;
+			 tpart = tpart->next)
+		{
+			if (tpart->hash == hash && tpart->nitems > 0 &&
+				__xpuTopNEqualPartition(tbuf, tupitem, tpart->heap[0]))
+				return tpart;
+		}
+		/* expand the hash slots, if too many partitions */
+		if (tbuf->nparts >= 2 * tbuf->nslots)
+		{
+			uint32_t	nslots = 2 * tbuf->nslots;
+			xpuTopNPartition **slots;
+
+			slots = (xpuTopNPartition **)calloc(nslots, sizeof(xpuTopNPartition *));
+			if (!slots)
+				return NULL;
+			for (uint32_t k=0; k < tbuf->nslots; k++)
+			{
+				while ((tpart = tbuf->slots[k]) != NULL)
+				{
+					tbuf->slots[k] = tpart->next;
+					tpart->next = slots[tpart->hash % nslots];
+					slots[tpart->hash % nslots] = tpart;
+				}
+			}
+			free(tbuf->slots);
+			tbuf->slots = slots;
+			tbuf->nslots = nslots;
+		}
+	}
+	tpart = (xpuTopNPartition *)calloc(1, sizeof(xpuTopNPartition));
+	if (!tpart)
+		return NULL;
+	tpart->hash = hash;
+	tpart->next = tbuf->slots[hash % tbuf->nslots];
+	tbuf->slots[hash % tbuf->nslots] = tpart;
+	tbuf->nparts++;
+	tbuf->usage += sizeof(xpuTopNPartition);
+	return tpart;
+}
+
+/* appends an item to the array; it returns false on out of memory */
+INLINE_FUNCTION(bool)
+__xpuTopNArrayAppend(kern_tupitem ***p_array,
+					 uint32_t *p_nitems,
+					 uint32_t *p_nalloc,
+					 uint32_t nlimit,
+					 kern_tupitem *titem)
+{
+	if (*p_nitems >= *p_nalloc)
+	{
+		uint32_t	nalloc = Max(2 * (*p_nalloc), 16);
+		kern_tupitem **array;
+
+		if (nlimit > 0)
+			nalloc = Min(nalloc, nlimit);
+		array = (kern_tupitem **)realloc(*p_array, sizeof(kern_tupitem *) * nalloc);
+		if (!array)
+			return false;
+		*p_array = array;
+		*p_nalloc = nalloc;
+	}
+	(*p_array)[(*p_nitems)++] = titem;
+	return true;
+}
+
+/*
+ * xpuTopNBufferAddResults
+ *
+ * It merges the rows in the result KDS (KDS_FORMAT_ROW) into the buffer.
+ * It returns false on out of memory.
+ */
+INLINE_FUNCTION(bool)
+xpuTopNBufferAddResults(xpuTopNBuffer *tbuf, kern_data_store *kds)
+{
+	const kern_topn_desc *topn = tbuf->topn;
+
+	assert(kds->format == KDS_FORMAT_ROW);
+	if (!tbuf->kds_head)
+	{
+		size_t	head_sz = KDS_HEAD_LENGTH(kds);
+
+		tbuf->kds_head = (kern_data_store *)malloc(head_sz);
+		if (!tbuf->kds_head)
+			return false;
+		memcpy(tbuf->kds_head, kds, head_sz);
+		tbuf->kds_head->nitems = 0;
+		tbuf->kds_head->usage = 0;
+		tbuf->kds_head->hash_nslots = 0;
+		tbuf->kds_head->length = head_sz;
+	}
+	for (uint32_t i=0; i < kds->nitems; i++)
+	{
+		kern_tupitem *tupitem = KDS_GET_TUPITEM(kds, i);
+		xpuTopNPartition *tpart;
+		kern_tupitem *titem;
+		kern_tupitem *oitem;
+		size_t		sz;
+		int			comp = -1;
+
+		if (!tupitem)
+			continue;
+		tpart = __xpuTopNLookupPartition(tbuf, tupitem);
+		if (!tpart)
+			return false;
+		if (tpart->nitems >= topn->nrows)
+		{
+			comp = __xpuTopNCompare(tbuf, tupitem, tpart->heap[0]);
+			if (comp > 0 || (comp == 0 && !topn->with_ties))
+				continue;	/* never in the Top-N */
+		}
+		sz = offsetof(kern_tupitem, htup) + tupitem->t_len;
+		titem = (kern_tupitem *)malloc(sz);
+		if (!titem)
+			return false;
+		memcpy(titem, tupitem, sz);
+		tbuf->usage += sz;
+		if (tpart->nitems < topn->nrows)
+		{
+			if (!__xpuTopNArrayAppend(&tpart->heap,
+									  &tpart->nitems,
+									  &tpart->nalloc,
+									  topn->nrows, titem))
+			{
+				__xpuTopNReleaseItem(tbuf, titem);
+				return false;
+			}
+			__xpuTopNSiftUp(tbuf, tpart, tpart->nitems - 1);
+		}
+		else if (comp == 0)
+		{
+			/* tied with the last row of the Top-N */
+			if (!__xpuTopNArrayAppend(&tpart->ties,
+									  &tpart->nties,
+									  &tpart->ties_nalloc,
+									  0, titem))
+			{
+				__xpuTopNReleaseItem(tbuf, titem);
+				return false;
+			}
+		}
+		else
+		{
+			oitem = tpart->heap[0];
+			tpart->heap[0] = titem;
+			__xpuTopNSiftDown(tbuf, tpart, 0);
+			/*
+			 * The evicted row (and the rows tied with it) are still kept,
+			 * if they are tied with the new last row.
+			 */
+			if (topn->with_ties &&
+				__xpuTopNCompare(tbuf, oitem, tpart->heap[0]) == 0)
+			{
+				if (!__xpuTopNArrayAppend(&tpart->ties,
+										  &tpart->nties,
+										  &tpart->ties_nalloc,
+										  0, oitem))
+				{
+					__xpuTopNReleaseItem(tbuf, oitem);
+					return false;
+				}
+			}
+			else
+			{
+				__xpuTopNReleaseItem(tbuf, oitem);
+				while (tpart->nties > 0)
+					__xpuTopNReleaseItem(tbuf, tpart->ties[--tpart->nties]);
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * xpuTopNBufferFinal
+ *
+ * It packs the rows on the buffer into a KDS_FORMAT_ROW (to be released
+ * by the caller), then resets the buffer for the next scan.
+ * *p_kds is set to NULL if no rows are kept. It returns false on out of
+ * memory; the caller must not take it as an empty result.
+ */
+INLINE_FUNCTION(bool)
+xpuTopNBufferFinal(xpuTopNBuffer *tbuf, kern_data_store **p_kds)
+{
+	kern_data_store *kds = NULL;
+	size_t		head_sz;
+	size_t		length;
+	size_t		usage = 0;
+	uint32_t	nitems = 0;
+	bool		retval = true;
+
+	if (tbuf->nparts == 0 || !tbuf->kds_head)
+		goto out;
+	length = 0;
+	for (uint32_t k=0; k < tbuf->nslots; k++)
+	{
+		for (xpuTopNPartition *tpart = tbuf->slots[k];
+			 tpart != NULL;
+			 tpart = tpart->next)
+		{
+			for (uint32_t i=0; i < tpart->nitems; i++)
+				length += MAXALIGN(offsetof(kern_tupitem, htup) +
+								   tpart->heap[i]->t_len);
+			for (uint32_t i=0; i < tpart->nties; i++)
+				length += MAXALIGN(offsetof(kern_tupitem, htup) +
+								   tpart->ties[i]->t_len);
+			nitems += tpart->nitems + tpart->nties;
+		}
+	}
+	if (nitems == 0)
+		goto out;
+	head_sz = KDS_HEAD_LENGTH(tbuf->kds_head);
+	length += head_sz + MAXALIGN(sizeof(uint32_t) * nitems);
+	kds = (kern_data_store *)malloc(length);
+	if (!kds)
+	{
+		retval = false;
+		goto out;
+	}
+	memcpy(kds, tbuf->kds_head, head_sz);
+	kds->length = length;
+	nitems = 0;
+	for (uint32_t k=0; k < tbuf->nslots; k++)
+	{
+		for (xpuTopNPartition *tpart = tbuf->slots[k];
+			 tpart != NULL;
+			 tpart = tpart->next)
+		{
+			for (uint32_t i=0; i < tpart->nitems + tpart->nties; i++)
+			{
+				kern_tupitem *titem = (i < tpart->nitems
+									   ? tpart->heap[i]
+									   : tpart->ties[i - tpart->nitems]);
+				size_t		sz = offsetof(kern_tupitem, htup) + titem->t_len;
+
+				usage += MAXALIGN(sz);
+				memcpy((char *)kds + length - usage, titem, sz);
+				((kern_tupitem *)((char *)kds + length - usage))->rowid = nitems;
+				KDS_GET_ROWINDEX(kds)[nitems++] = __kds_packed(usage);
+			}
+		}
+	}
+	kds->nitems = nitems;
+	kds->usage  = __kds_packed(usage);
+out:
+	__xpuTopNBufferReset(tbuf);
+	*p_kds = kds;
+	return retval;
+}
+#endif	/* !__CUDACC__ */
+
 /* ----------------------------------------------------------------
  *
  * Template for xPU connection commands receive
@@ -2368,6 +3806,47 @@ SESSION_ENCODE(kern_session_info *session)
  * ----------------------------------------------------------------
  */
 #define TEMPLATE_XPU_CONNECT_RECEIVE_COMMANDS(__XPU_PREFIX)				\
+	static XpuCommand *													\
+	__XPU_PREFIX##AllocReceivedCommand(void *priv, XpuCommand *temp)	\
+	{																	\
+		/* compressed command is released soon, once decompressed */	\
+		if (temp->tag == XpuCommandTag__Compressed)						\
+			return (XpuCommand *)malloc(temp->length);					\
+		return (XpuCommand *)__XPU_PREFIX##AllocCommand(priv, temp->length); \
+	}																	\
+																		\
+	static int															\
+	__XPU_PREFIX##AttachReceivedCommand(void *priv,						\
+										XpuCommand *xcmd,				\
+										const char *error_label)		\
+	{																	\
+		if (xcmd->tag == XpuCommandTag__Compressed)						\
+		{																\
+			XpuCommand *zcmd = xcmd;									\
+																		\
+			xcmd = (XpuCommand *)										\
+				__XPU_PREFIX##AllocCommand(priv, zcmd->u.compressed.rawsz); \
+			if (!xcmd)													\
+			{															\
+				fprintf(stderr, "[%s] out of memory (sz=%lu): %m\n",	\
+						error_label, zcmd->u.compressed.rawsz);			\
+				free(zcmd);												\
+				return -1;												\
+			}															\
+			if (!xpuWireDecompress(zcmd, xcmd))							\
+			{															\
+				fprintf(stderr, "[%s] failed on decompression of XpuCommand (method=%u)\n", \
+						error_label, zcmd->u.compressed.method);		\
+				__XPU_PREFIX##FreeCommand(priv, xcmd);					\
+				free(zcmd);												\
+				return -1;												\
+			}															\
+			free(zcmd);													\
+		}																\
+		__XPU_PREFIX##AttachCommand(priv, xcmd);						\
+		return 0;														\
+	}																	\
+																		\
 	static int															\
 	__XPU_PREFIX##ReceiveCommands(int sockfd,							\
 								  void *priv,							\
@@ -2450,7 +3929,7 @@ SESSION_ENCODE(kern_session_info *session)
 				if (temp->length <= offset)								\
 				{														\
 					assert(temp->magic == XpuCommandMagicNumber);		\
-					xcmd = __XPU_PREFIX##AllocCommand(priv, temp->length); \
+					xcmd = __XPU_PREFIX##AllocReceivedCommand(priv, temp); \
 					if (!xcmd)											\
 					{													\
 						fprintf(stderr, "[%s] out of memory (sz=%lu): %m\n", \
@@ -2458,7 +3937,9 @@ SESSION_ENCODE(kern_session_info *session)
 						return -1;										\
 					}													\
 					memcpy(xcmd, temp, temp->length);					\
-					__XPU_PREFIX##AttachCommand(priv, xcmd);			\
+					if (__XPU_PREFIX##AttachReceivedCommand(priv, xcmd,	\
+															error_label) < 0) \
+						return -1;										\
 					count++;											\
 																		\
 					if (temp->length == offset)							\
@@ -2470,7 +3951,7 @@ SESSION_ENCODE(kern_session_info *session)
 				}														\
 				else													\
 				{														\
-					curr = __XPU_PREFIX##AllocCommand(priv, temp->length); \
+					curr = __XPU_PREFIX##AllocReceivedCommand(priv, temp); \
 					if (!curr)											\
 					{													\
 						fprintf(stderr, "[%s] out of memory (sz=%lu): %m\n", \
@@ -2487,7 +3968,9 @@ SESSION_ENCODE(kern_session_info *session)
 			{															\
 				assert(curr->magic == XpuCommandMagicNumber);			\
 				assert(curr->length == offset);							\
-				__XPU_PREFIX##AttachCommand(priv, curr);				\
+				if (__XPU_PREFIX##AttachReceivedCommand(priv, curr,		\
+														error_label) < 0) \
+					return -1;											\
 				count++;												\
 				goto restart;											\
 			}															\
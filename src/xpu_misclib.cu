@@ -763,3 +763,100 @@ pgfn_network_overlap(XPU_PGFUNCTION_ARGS)
 	}
 	return true;
 }
+
+/*
+ * HyperLogLog hash functions
+ *
+ * Hash values must be identical to pgstrom_hll_hash_xxxx() on the host
+ * side, because the HLL registers are merged on the CPU later.
+ */
+#define PG_HLL_HASH_SIMPLE_TEMPLATE(NAME)								\
+	PUBLIC_FUNCTION(bool)												\
+	pgfn_hll_hash_##NAME(XPU_PGFUNCTION_ARGS)							\
+	{																	\
+		KEXP_PROCESS_ARGS1(int8, NAME, datum);							\
+																		\
+		if (XPU_DATUM_ISNULL(&datum))									\
+			result->expr_ops = NULL;									\
+		else															\
+		{																\
+			result->expr_ops = &xpu_int8_ops;							\
+			result->value = pg_hll_siphash_value(&datum.value,			\
+												 sizeof(datum.value));	\
+		}																\
+		return true;													\
+	}
+PG_HLL_HASH_SIMPLE_TEMPLATE(int1)
+PG_HLL_HASH_SIMPLE_TEMPLATE(int2)
+PG_HLL_HASH_SIMPLE_TEMPLATE(int4)
+PG_HLL_HASH_SIMPLE_TEMPLATE(int8)
+PG_HLL_HASH_SIMPLE_TEMPLATE(date)
+PG_HLL_HASH_SIMPLE_TEMPLATE(time)
+PG_HLL_HASH_SIMPLE_TEMPLATE(timestamp)
+PG_HLL_HASH_SIMPLE_TEMPLATE(timestamptz)
+PG_HLL_HASH_SIMPLE_TEMPLATE(uuid)
+
+PUBLIC_FUNCTION(bool)
+pgfn_hll_hash_numeric(XPU_PGFUNCTION_ARGS)
+{
+	KEXP_PROCESS_ARGS1(int8, numeric, datum);
+
+	if (XPU_DATUM_ISNULL(&datum))
+		result->expr_ops = NULL;
+	else
+	{
+		result->expr_ops = &xpu_int8_ops;
+		result->value = pg_hll_hash_numeric(&datum);
+	}
+	return true;
+}
+
+PUBLIC_FUNCTION(bool)
+pgfn_hll_hash_timetz(XPU_PGFUNCTION_ARGS)
+{
+	KEXP_PROCESS_ARGS1(int8, timetz, datum);
+
+	if (XPU_DATUM_ISNULL(&datum))
+		result->expr_ops = NULL;
+	else
+	{
+		TimeTzADT	tz;
+
+		/* padding bytes must be cleared, as the host code doing */
+		memset(&tz, 0, sizeof(TimeTzADT));
+		tz.time = datum.value.time;
+		tz.zone = datum.value.zone;
+		result->expr_ops = &xpu_int8_ops;
+		result->value = pg_hll_siphash_value(&tz, sizeof(TimeTzADT));
+	}
+	return true;
+}
+
+#define PG_HLL_HASH_VARLENA_TEMPLATE(NAME)								\
+	PUBLIC_FUNCTION(bool)												\
+	pgfn_hll_hash_##NAME(XPU_PGFUNCTION_ARGS)							\
+	{																	\
+		KEXP_PROCESS_ARGS1(int8, NAME, datum);							\
+																		\
+		if (XPU_DATUM_ISNULL(&datum))									\
+			result->expr_ops = NULL;									\
+		else if (!xpu_##NAME##_is_valid(kcxt, &datum))					\
+			return false;												\
+		else															\
+		{																\
+			int		len = datum.length;									\
+																		\
+			if (TypeOpCode__##NAME == TypeOpCode__bpchar)				\
+			{															\
+				/* trailing spaces are not significant */				\
+				while (len > 0 && datum.value[len-1] == ' ')			\
+					len--;												\
+			}															\
+			result->expr_ops = &xpu_int8_ops;							\
+			result->value = pg_hll_siphash_value(datum.value, len);		\
+		}																\
+		return true;													\
+	}
+PG_HLL_HASH_VARLENA_TEMPLATE(bpchar)
+PG_HLL_HASH_VARLENA_TEMPLATE(text)
+PG_HLL_HASH_VARLENA_TEMPLATE(bytea)
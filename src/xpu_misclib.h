@@ -74,4 +74,184 @@ xpu_interval_write_heap(kern_context *kcxt,
 						char *buffer,
 						const xpu_datum_t *arg);
 
+/*
+ * Hash-function based on Sip-Hash (for HyperLogLog)
+ *
+ * See https://en.wikipedia.org/wiki/SipHash
+ *     and https://github.com/veorq/SipHash
+ *
+ * NOTE: both of the host and device code must generate identical hash
+ * values, because HLL registers built on either side are merged later.
+ */
+#define __HLL_SIPHASH_CROUNDS	2	/* default: SipHash-2-4 */
+#define __HLL_SIPHASH_DROUNDS	4
+#define __HLL_SIPHASH_ROTL(x, b)	\
+	(uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define __HLL_SIPHASH_ROUND							\
+	do {											\
+		v0 += v1;									\
+		v1 = __HLL_SIPHASH_ROTL(v1, 13);			\
+		v1 ^= v0;									\
+		v0 = __HLL_SIPHASH_ROTL(v0, 32);			\
+		v2 += v3;									\
+		v3 = __HLL_SIPHASH_ROTL(v3, 16);			\
+		v3 ^= v2;									\
+		v0 += v3;									\
+		v3 = __HLL_SIPHASH_ROTL(v3, 21);			\
+		v3 ^= v0;									\
+		v2 += v1;									\
+		v1 = __HLL_SIPHASH_ROTL(v1, 17);			\
+		v1 ^= v2;									\
+		v2 = __HLL_SIPHASH_ROTL(v2, 32);			\
+	} while (0)
+
+INLINE_FUNCTION(uint64_t)
+pg_hll_siphash_value(const void *ptr, const size_t len)
+{
+	const unsigned char *ni = (const unsigned char *)ptr;
+	const unsigned char *end = ni + len - (len % sizeof(uint64_t));
+	const int	left = len & 7;
+	uint64_t	v0 = 0x736f6d6570736575UL;
+	uint64_t	v1 = 0x646f72616e646f6dUL;
+	uint64_t	v2 = 0x6c7967656e657261UL;
+	uint64_t	v3 = 0x7465646279746573UL;
+	uint64_t	k0 = 0x9c38151cda15a76bUL;	/* random key-0 */
+	uint64_t	k1 = 0xfb4ff68fbd3e6658UL;	/* random key-1 */
+	uint64_t	b = ((uint64_t)len) << 56;
+	uint64_t	m;
+	int			i;
+
+	v3 ^= k1;
+	v2 ^= k0;
+	v1 ^= k1;
+	v0 ^= k0;
+	for (; ni != end; ni += 8)
+	{
+		m = (((uint64_t)ni[0])       | ((uint64_t)ni[1] <<  8) |
+			 ((uint64_t)ni[2] << 16) | ((uint64_t)ni[3] << 24) |
+			 ((uint64_t)ni[4] << 32) | ((uint64_t)ni[5] << 40) |
+			 ((uint64_t)ni[6] << 48) | ((uint64_t)ni[7] << 56));
+		v3 ^= m;
+		for (i=0; i < __HLL_SIPHASH_CROUNDS; i++)
+			__HLL_SIPHASH_ROUND;
+		v0 ^= m;
+	}
+	for (i=0; i < left; i++)
+		b |= ((uint64_t)ni[i]) << (8 * i);
+
+	v3 ^= b;
+	for (i=0; i < __HLL_SIPHASH_CROUNDS; i++)
+		__HLL_SIPHASH_ROUND;
+	v0 ^= b;
+	v2 ^= 0xff;
+	for (i=0; i < __HLL_SIPHASH_DROUNDS; i++)
+		__HLL_SIPHASH_ROUND;
+
+	return (v0 ^ v1 ^ v2 ^ v3);
+}
+#undef __HLL_SIPHASH_CROUNDS
+#undef __HLL_SIPHASH_DROUNDS
+#undef __HLL_SIPHASH_ROTL
+#undef __HLL_SIPHASH_ROUND
+
+/*
+ * pg_hll_register_position - it returns the register value for the hash
+ * (number of trailing zeros + 1 after the index bits), and the index.
+ */
+INLINE_FUNCTION(uint32_t)
+pg_hll_register_position(uint64_t hash, int hll_regbits, uint32_t *p_index)
+{
+	uint64_t	hbits = (hash >> hll_regbits);
+	uint32_t	count = 1;
+
+	*p_index = (hash & ((1UL << hll_regbits) - 1));
+	while ((hbits & 1) == 0 && count < 64 - hll_regbits)
+	{
+		hbits >>= 1;
+		count++;
+	}
+	return count;
+}
+
+/*
+ * pg_hll_hash_numeric - numeric values are normalized prior to the hash,
+ * so 1.0 and 1.00 are considered as identical values.
+ */
+INLINE_FUNCTION(uint64_t)
+pg_hll_hash_numeric(const xpu_numeric_t *datum)
+{
+	xpu_numeric_t	num;
+
+	/* padding bytes must be cleared, for both of host and device */
+	memset(&num, 0, sizeof(xpu_numeric_t));
+	num.kind = datum->kind;
+	if (datum->kind == XPU_NUMERIC_KIND__VALID && datum->value != 0)
+	{
+		int128_t	value = datum->value;
+		int16_t		weight = datum->weight;
+
+		while (value % 10 == 0)
+		{
+			value /= 10;
+			weight--;
+		}
+		num.weight = weight;
+		num.value  = value;
+	}
+	return pg_hll_siphash_value(&num.kind,
+								offsetof(xpu_numeric_t, value)
+								+ sizeof(int128_t)
+								- offsetof(xpu_numeric_t, kind));
+}
+
+/*
+ * Quantile sketch (for percentile_cont / percentile_disc)
+ *
+ * It is a fixed-size histogram on the logarithmic scale; each bucket is
+ * identified by the exponent and the upper qsketch_bits of the mantissa
+ * of float8 value, so the relative error of the bucket's representative
+ * value is less than 2^-(qsketch_bits+1). Negative values use the mirror
+ * image of the positive buckets, and the center bucket is for (near-)zero.
+ * Values less than 2^QSKETCH_EXPONENT_MIN are considered zero, and values
+ * larger than 2^QSKETCH_EXPONENT_MAX are saturated to the edge bucket.
+ *
+ * NOTE: both of the host and device code must use identical bucket index,
+ * because the sketches built on either side are merged later.
+ */
+#define QSKETCH_EXPONENT_MIN	(-32)
+#define QSKETCH_EXPONENT_MAX	64
+
+INLINE_FUNCTION(uint32_t)
+pg_qsketch_nbuckets(int qsketch_bits)
+{
+	uint32_t	nrooms = ((QSKETCH_EXPONENT_MAX -
+						   QSKETCH_EXPONENT_MIN) << qsketch_bits);
+	return 2 * nrooms + 1;
+}
+
+INLINE_FUNCTION(uint32_t)
+pg_qsketch_bucket_index(float8_t fval, int qsketch_bits)
+{
+	uint64_t	ival = __double_as_longlong__(fval);
+	int32_t		expo = (int32_t)((ival >> 52) & 0x7ffU) - 1023;
+	uint32_t	nrooms = ((QSKETCH_EXPONENT_MAX -
+						   QSKETCH_EXPONENT_MIN) << qsketch_bits);
+	uint32_t	index;
+
+	if (expo < QSKETCH_EXPONENT_MIN)
+		return nrooms;		/* zero */
+	if (expo >= QSKETCH_EXPONENT_MAX)
+		index = nrooms - 1;	/* saturated, including Inf and NaN */
+	else
+		index = (((uint32_t)(expo - QSKETCH_EXPONENT_MIN) << qsketch_bits) |
+				 (uint32_t)((ival >> (52 - qsketch_bits)) &
+							((1U << qsketch_bits) - 1)));
+	if ((ival & (1ULL << 63)) == 0)
+		return nrooms + 1 + index;
+	/* NaN is larger than any other values in PostgreSQL */
+	if (fval != fval)
+		return 2 * nrooms;
+	return nrooms - 1 - index;
+}
+
 #endif	/* XPU_MISCLIB_H */
@@ -167,6 +167,42 @@ set_normalized_numeric(xpu_numeric_t *result, int128_t value, int16_t weight)
 	result->value = value;
 }
 
+/*
+ * __xpu_numeric_to_scaled_int128
+ *
+ * It converts the numeric value to the integer scaled by 10^scale.
+ * It returns false if the value cannot be represented exactly; that means
+ * more fractional digits than the scale, or 128bit integer overflow.
+ */
+INLINE_FUNCTION(bool)
+__xpu_numeric_to_scaled_int128(int128_t *p_ival,
+							   const xpu_numeric_t *num,
+							   int scale)
+{
+	const int128_t	limit = (int128_t)(~((unsigned __int128)0) >> 1) / 10;
+	int128_t	value = num->value;
+	int			shift = scale - num->weight;
+
+	assert(num->kind == XPU_NUMERIC_KIND__VALID);
+	if (value != 0)
+	{
+		for (; shift < 0; shift++)
+		{
+			if (value % 10 != 0)
+				return false;
+			value /= 10;
+		}
+		for (; shift > 0; shift--)
+		{
+			if (value > limit || value < -limit)
+				return false;
+			value *= 10;
+		}
+	}
+	*p_ival = value;
+	return true;
+}
+
 INLINE_FUNCTION(const char *)
 __xpu_numeric_from_varlena(xpu_numeric_t *result, const varlena *addr)
 {
@@ -226,6 +262,26 @@ error:
 	return "corrupted numeric header";
 }
 
+/*
+ * __xpu_numeric_dscale_from_varlena
+ *
+ * It returns the display scale of the numeric varlena, that is not kept in
+ * the normalized xpu_numeric_t.
+ */
+INLINE_FUNCTION(int)
+__xpu_numeric_dscale_from_varlena(const varlena *addr)
+{
+	if (VARSIZE_ANY_EXHDR(addr) >= sizeof(uint16_t))
+	{
+		NumericChoice *nc = (NumericChoice *)VARDATA_ANY(addr);
+		uint16_t	n_head = __Fetch(&nc->n_header);
+
+		if (!NUMERIC_IS_SPECIAL(n_head))
+			return NUMERIC_DSCALE(nc, n_head);
+	}
+	return 0;
+}
+
 INLINE_FUNCTION(int)
 __xpu_numeric_to_varlena(char *buffer, int16_t weight, int128_t value)
 {
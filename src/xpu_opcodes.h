@@ -79,6 +79,7 @@ FUNC_OPCODE(int2, float2, DEVKIND__ANY, float2_to_int2, 1, "pg_strom")
 FUNC_OPCODE(int2, float4, DEVKIND__ANY, float4_to_int2, 1, NULL)
 FUNC_OPCODE(int2, float8, DEVKIND__ANY, float8_to_int2, 1, NULL)
 
+FUNC_OPCODE(int4, bool,   DEVKIND__ANY, bool_to_int4, 1, NULL)
 FUNC_OPCODE(int4, int1,   DEVKIND__ANY, int1_to_int4, 1, "pg_strom")
 FUNC_OPCODE(int4, int2,   DEVKIND__ANY, int2_to_int4, 1, NULL)
 FUNC_OPCODE(int4, int8,   DEVKIND__ANY, int8_to_int4, 1, NULL)
@@ -715,6 +716,22 @@ DEVONLY_FUNC_OPCODE(float2, jsonb_array_element_as_float2,  jsonb/text, DEVKIND_
 DEVONLY_FUNC_OPCODE(float4, jsonb_array_element_as_float4,  jsonb/text, DEVKIND__ANY, 10)
 DEVONLY_FUNC_OPCODE(float8, jsonb_array_element_as_float8,  jsonb/text, DEVKIND__ANY, 10)
 
+/* HyperLogLog hash functions */
+FUNC_OPCODE(hll_hash, int1,        DEVKIND__ANY, hll_hash_int1,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, int2,        DEVKIND__ANY, hll_hash_int2,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, int4,        DEVKIND__ANY, hll_hash_int4,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, int8,        DEVKIND__ANY, hll_hash_int8,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, numeric,     DEVKIND__ANY, hll_hash_numeric,     10, "pg_strom")
+FUNC_OPCODE(hll_hash, date,        DEVKIND__ANY, hll_hash_date,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, time,        DEVKIND__ANY, hll_hash_time,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, timetz,      DEVKIND__ANY, hll_hash_timetz,      10, "pg_strom")
+FUNC_OPCODE(hll_hash, timestamp,   DEVKIND__ANY, hll_hash_timestamp,   10, "pg_strom")
+FUNC_OPCODE(hll_hash, timestamptz, DEVKIND__ANY, hll_hash_timestamptz, 10, "pg_strom")
+FUNC_OPCODE(hll_hash, bpchar,      DEVKIND__ANY, hll_hash_bpchar,      10, "pg_strom")
+FUNC_OPCODE(hll_hash, text,        DEVKIND__ANY, hll_hash_text,        10, "pg_strom")
+FUNC_OPCODE(hll_hash, bytea,       DEVKIND__ANY, hll_hash_bytea,       10, "pg_strom")
+FUNC_OPCODE(hll_hash, uuid,        DEVKIND__ANY, hll_hash_uuid,        10, "pg_strom")
+
 /* PostGIS functions */
 FUNC_OPCODE(st_point,     float8/float8,               DEVKIND__ANY, st_point,      5, "postgis")
 FUNC_OPCODE(st_makepoint, float8/float8,               DEVKIND__ANY, st_makepoint2, 5, "postgis")
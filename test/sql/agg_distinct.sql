@@ -0,0 +1,60 @@
+---
+--- Test for SELECT DISTINCT on GpuPreAgg
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_distinct_temp CASCADE;
+CREATE SCHEMA regtest_agg_distinct_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_distinct_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  a     int,
+  b     text,
+  c     date
+);
+INSERT INTO rt_data (
+  SELECT i, i % 37,
+         CASE WHEN i % 43 = 0 THEN NULL ELSE 'k' || (i % 11)::text END,
+         '2023-01-01'::date + (i % 30)
+    FROM generate_series(1,20000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+
+-- SELECT DISTINCT
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT DISTINCT a, b FROM rt_data',
+                             'GpuPreAgg') AS pushdown;
+SELECT DISTINCT a, b
+  INTO test01g
+  FROM rt_data;
+SET pg_strom.enabled = off;
+SELECT DISTINCT a, b
+  INTO test01p
+  FROM rt_data;
+SELECT (SELECT count(*) FROM test01g) = (SELECT count(*) FROM test01p) AS ok;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY a, b;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY a, b;
+
+-- SELECT DISTINCT on expressions
+SET pg_strom.enabled = on;
+SELECT DISTINCT b, c + a % 3 d
+  INTO test02g
+  FROM rt_data
+ WHERE id % 5 = 0;
+SET pg_strom.enabled = off;
+SELECT DISTINCT b, c + a % 3 d
+  INTO test02p
+  FROM rt_data
+ WHERE id % 5 = 0;
+SELECT (SELECT count(*) FROM test02g) = (SELECT count(*) FROM test02p) AS ok;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY b, d;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY b, d;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_distinct_temp CASCADE;
@@ -0,0 +1,103 @@
+---
+--- Test for eager pre-aggregation below the join
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_eager_preagg_temp CASCADE;
+CREATE SCHEMA regtest_agg_eager_preagg_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_eager_preagg_temp,pgstrom_regress,public;
+CREATE TABLE rt_fact (
+  id     int,
+  dim_id int,
+  x      int8,
+  y      numeric(10,2),
+  z      numeric
+);
+CREATE TABLE rt_dim (
+  dim_id int PRIMARY KEY,
+  cat    text
+);
+INSERT INTO rt_fact (
+  SELECT i, i % 120,
+         (i * 17) % 1000,
+         (i % 1000)::numeric / 100,
+         CASE WHEN i % 2 = 0
+              THEN (i % 5)::numeric(10,1)
+              ELSE (i % 5)::numeric(10,2)
+         END
+    FROM generate_series(1,40000) i);
+INSERT INTO rt_dim (
+  SELECT i, 'c' || (i % 6)::text
+    FROM generate_series(0,99) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enable_eager_preagg = on;
+
+-- inner join
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT d.cat, count(*), sum(f.x) FROM rt_fact f JOIN rt_dim d ON f.dim_id = d.dim_id GROUP BY d.cat',
+                             'GpuPreAgg') AS pushdown;
+SELECT d.cat, count(*) nr, sum(f.x) sx, sum(f.y) sy
+  INTO test01g
+  FROM rt_fact f JOIN rt_dim d ON f.dim_id = d.dim_id
+ GROUP BY d.cat;
+SET pg_strom.enabled = off;
+SELECT d.cat, count(*) nr, sum(f.x) sx, sum(f.y) sy
+  INTO test01p
+  FROM rt_fact f JOIN rt_dim d ON f.dim_id = d.dim_id
+ GROUP BY d.cat;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY cat;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY cat;
+
+-- left outer join; facts without dimension are grouped to NULL
+SET pg_strom.enabled = on;
+SELECT d.cat, count(*) nr, sum(f.x) sx, sum(f.y) sy
+  INTO test02g
+  FROM rt_fact f LEFT JOIN rt_dim d ON f.dim_id = d.dim_id
+ GROUP BY d.cat;
+SET pg_strom.enabled = off;
+SELECT d.cat, count(*) nr, sum(f.x) sx, sum(f.y) sy
+  INTO test02p
+  FROM rt_fact f LEFT JOIN rt_dim d ON f.dim_id = d.dim_id
+ GROUP BY d.cat;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY cat;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY cat;
+
+-- semi join is never pre-aggregated, but the results are identical
+SET pg_strom.enabled = on;
+SELECT f.dim_id, count(*) nr, sum(f.x) sx
+  INTO test03g
+  FROM rt_fact f
+ WHERE EXISTS (SELECT 1 FROM rt_dim d WHERE d.dim_id = f.dim_id AND d.cat = 'c1')
+ GROUP BY f.dim_id;
+SET pg_strom.enabled = off;
+SELECT f.dim_id, count(*) nr, sum(f.x) sx
+  INTO test03p
+  FROM rt_fact f
+ WHERE EXISTS (SELECT 1 FROM rt_dim d WHERE d.dim_id = f.dim_id AND d.cat = 'c1')
+ GROUP BY f.dim_id;
+(SELECT * FROM test03g EXCEPT SELECT * FROM test03p) ORDER BY dim_id;
+(SELECT * FROM test03p EXCEPT SELECT * FROM test03g) ORDER BY dim_id;
+
+-- numeric 1.0 and 1.00 are equal, but distinguished by the grouping-key
+SET pg_strom.enabled = on;
+SELECT d.cat, f.z::text zt, count(*) nr, sum(f.x) sx
+  INTO test04g
+  FROM rt_fact f JOIN rt_dim d ON f.dim_id = d.dim_id
+ GROUP BY d.cat, f.z::text;
+SET pg_strom.enabled = off;
+SELECT d.cat, f.z::text zt, count(*) nr, sum(f.x) sx
+  INTO test04p
+  FROM rt_fact f JOIN rt_dim d ON f.dim_id = d.dim_id
+ GROUP BY d.cat, f.z::text;
+(SELECT * FROM test04g EXCEPT SELECT * FROM test04p) ORDER BY cat, zt;
+(SELECT * FROM test04p EXCEPT SELECT * FROM test04g) ORDER BY cat, zt;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_eager_preagg_temp CASCADE;
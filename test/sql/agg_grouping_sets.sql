@@ -0,0 +1,78 @@
+---
+--- Test for GROUPING SETS, ROLLUP and CUBE on GpuPreAgg
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_grouping_sets_temp CASCADE;
+CREATE SCHEMA regtest_agg_grouping_sets_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_grouping_sets_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  a     int,
+  b     text,
+  x     int8,
+  y     float8
+);
+INSERT INTO rt_data (
+  SELECT i, i % 7,
+         CASE WHEN i % 61 = 0 THEN NULL ELSE 'k' || (i % 5)::text END,
+         (i * 13) % 1000,
+         (i % 100)::float8 / 4.0
+    FROM generate_series(1,20000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+
+-- ROLLUP
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT a, b, count(*) FROM rt_data GROUP BY ROLLUP(a, b)',
+                             'GpuPreAgg') AS pushdown;
+SELECT a, b, grouping(a, b) gs, count(*) nr, sum(x) sx, max(y) my
+  INTO test01g
+  FROM rt_data
+ GROUP BY ROLLUP(a, b);
+SET pg_strom.enabled = off;
+SELECT a, b, grouping(a, b) gs, count(*) nr, sum(x) sx, max(y) my
+  INTO test01p
+  FROM rt_data
+ GROUP BY ROLLUP(a, b);
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY a, b, gs;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY a, b, gs;
+
+-- CUBE
+SET pg_strom.enabled = on;
+SELECT a, b, grouping(a, b) gs, count(*) nr, sum(x) sx, max(y) my
+  INTO test02g
+  FROM rt_data
+ GROUP BY CUBE(a, b);
+SET pg_strom.enabled = off;
+SELECT a, b, grouping(a, b) gs, count(*) nr, sum(x) sx, max(y) my
+  INTO test02p
+  FROM rt_data
+ GROUP BY CUBE(a, b);
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY a, b, gs;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY a, b, gs;
+
+-- GROUPING SETS
+SET pg_strom.enabled = on;
+SELECT a, b, grouping(a, b) gs, count(*) nr, sum(x) sx, max(y) my
+  INTO test03g
+  FROM rt_data
+ WHERE id % 3 = 0
+ GROUP BY GROUPING SETS ((a), (b), ());
+SET pg_strom.enabled = off;
+SELECT a, b, grouping(a, b) gs, count(*) nr, sum(x) sx, max(y) my
+  INTO test03p
+  FROM rt_data
+ WHERE id % 3 = 0
+ GROUP BY GROUPING SETS ((a), (b), ());
+(SELECT * FROM test03g EXCEPT SELECT * FROM test03p) ORDER BY a, b, gs;
+(SELECT * FROM test03p EXCEPT SELECT * FROM test03g) ORDER BY a, b, gs;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_grouping_sets_temp CASCADE;
@@ -0,0 +1,80 @@
+---
+--- Test for COUNT(DISTINCT) by HyperLogLog on GpuPreAgg
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_hll_temp CASCADE;
+CREATE SCHEMA regtest_agg_hll_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_hll_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  g     int,
+  a     int4,
+  n     numeric,
+  t     text
+);
+INSERT INTO rt_data (
+  SELECT i, i % 4,
+         i % 5000,
+         CASE WHEN i % 2 = 0
+              THEN (i % 2000)::numeric(10,1)
+              ELSE (i % 2000)::numeric(10,2)
+         END,
+         md5((i % 3000)::text)
+    FROM generate_series(1,40000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enable_hll_count_distinct = on;
+SET pg_strom.hll_registers_bits = 12;
+
+-- COUNT(DISTINCT) is estimated by HLL_COUNT()
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT g, count(distinct a) FROM rt_data GROUP BY g',
+                             'hll_sketch_new') AS pushdown;
+SELECT g, count(distinct a) ca, count(distinct n) cn, count(distinct t) ct
+  INTO test01g
+  FROM rt_data
+ GROUP BY g;
+SET pg_strom.enabled = off;
+SELECT g, count(distinct a) ca, count(distinct n) cn, count(distinct t) ct
+  INTO test01p
+  FROM rt_data
+ GROUP BY g;
+-- 1.0 and 1.00 are the same value, so the estimation is close to 500
+SELECT count(*) = 4 AND
+       bool_and(@(g.ca - p.ca) <= p.ca * 0.05 AND
+                @(g.cn - p.cn) <= p.cn * 0.05 AND
+                @(g.ct - p.ct) <= p.ct * 0.05) AS ok
+  FROM test01g g JOIN test01p p ON g.g = p.g;
+
+-- the sketch size is fixed at the planner
+SET pg_strom.enabled = on;
+PREPARE q1 AS
+SELECT g, count(distinct a) ca FROM rt_data GROUP BY g;
+SET pg_strom.hll_registers_bits = 10;
+CREATE TABLE test02g AS EXECUTE q1;
+DEALLOCATE q1;
+SELECT count(*) = 4 AND
+       bool_and(@(g.ca - p.ca) <= p.ca * 0.05) AS ok
+  FROM test02g g JOIN test01p p ON g.g = p.g;
+
+-- pgstrom.hll_count() on the host
+SET pg_strom.enabled = off;
+SELECT g, pgstrom.hll_count(a) ca, pgstrom.hll_count(n) cn, pgstrom.hll_count(t) ct
+  INTO test03p
+  FROM rt_data
+ GROUP BY g;
+SELECT count(*) = 4 AND
+       bool_and(@(h.ca - p.ca) <= p.ca * 0.05 AND
+                @(h.cn - p.cn) <= p.cn * 0.05 AND
+                @(h.ct - p.ct) <= p.ct * 0.05) AS ok
+  FROM test03p h JOIN test01p p ON h.g = p.g;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_hll_temp CASCADE;
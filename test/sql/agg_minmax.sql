@@ -0,0 +1,83 @@
+---
+--- Test for MIN/MAX of uuid and text, BOOL_AND/BOOL_OR and BIT_AND/BIT_OR on GpuPreAgg
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_minmax_temp CASCADE;
+CREATE SCHEMA regtest_agg_minmax_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_minmax_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  g     int,
+  v     varchar(16) COLLATE "C",
+  u     uuid,
+  b     bool,
+  i2    int2,
+  i4    int4,
+  i8    int8
+);
+INSERT INTO rt_data (
+  SELECT i, i % 10,
+         CASE WHEN i % 53 = 0 THEN NULL ELSE substr(md5(i::text), 1, 4 + i % 12) END,
+         CASE WHEN i % 61 = 0 THEN NULL ELSE md5(i::text)::uuid END,
+         CASE WHEN i % 89 = 0 THEN NULL ELSE i % 10 <> 0 END,
+         (i * 37) % 32768,
+         (i * 7919) % 2147483647,
+         (i::int8 * 2654435761) % 9223372036854775807
+    FROM generate_series(1,20000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+
+-- MIN/MAX/BOOL_AND/BOOL_OR/BIT_AND/BIT_OR with GROUP BY
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT g, min(u), max(u) FROM rt_data GROUP BY g',
+                             'GpuPreAgg') AS pushdown;
+-- text of heap tables may be compressed, so MIN/MAX runs on CPU
+SELECT NOT regtest_plan_contains('SELECT g, min(v), max(v) FROM rt_data GROUP BY g',
+                                 'GpuPreAgg') AS ok;
+SELECT g, min(u) umin, max(u) umax,
+          bool_and(b) band, bool_or(b) bor, every(b) bevr,
+          bit_and(i2) a2, bit_or(i2) o2,
+          bit_and(i4) a4, bit_or(i4) o4,
+          bit_and(i8) a8, bit_or(i8) o8
+  INTO test01g
+  FROM rt_data
+ GROUP BY g;
+SET pg_strom.enabled = off;
+SELECT g, min(u) umin, max(u) umax,
+          bool_and(b) band, bool_or(b) bor, every(b) bevr,
+          bit_and(i2) a2, bit_or(i2) o2,
+          bit_and(i4) a4, bit_or(i4) o4,
+          bit_and(i8) a8, bit_or(i8) o8
+  INTO test01p
+  FROM rt_data
+ GROUP BY g;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY g;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY g;
+
+-- MIN/MAX/BOOL_AND/BOOL_OR/BIT_AND/BIT_OR without GROUP BY
+SET pg_strom.enabled = on;
+SELECT min(u) umin, max(u) umax,
+       bool_and(b) band, bool_or(b) bor,
+       bit_and(i4) a4, bit_or(i4) o4
+  INTO test02g
+  FROM rt_data
+ WHERE id % 3 = 0;
+SET pg_strom.enabled = off;
+SELECT min(u) umin, max(u) umax,
+       bool_and(b) band, bool_or(b) bor,
+       bit_and(i4) a4, bit_or(i4) o4
+  INTO test02p
+  FROM rt_data
+ WHERE id % 3 = 0;
+SELECT * FROM test02g EXCEPT SELECT * FROM test02p;
+SELECT * FROM test02p EXCEPT SELECT * FROM test02g;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_minmax_temp CASCADE;
@@ -0,0 +1,78 @@
+---
+--- Test for exact SUM/AVG(numeric) on GpuPreAgg
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_numeric_temp CASCADE;
+CREATE SCHEMA regtest_agg_numeric_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_numeric_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  g     int,
+  x     numeric(12,3),
+  y     numeric(10,2),
+  z     numeric,
+  w     numeric
+);
+INSERT INTO rt_data (
+  SELECT i, i % 50,
+         ((i * 7919) % 2000001 - 1000000)::numeric / 1000,
+         CASE WHEN i % 97 = 0 THEN NULL ELSE (i % 1000)::numeric / 100 END,
+         (i % 1000)::numeric / 8,
+         round((i % 1000)::numeric / 10, 2 + i % 3)
+    FROM generate_series(1,20000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+
+-- SUM/AVG with GROUP BY; results are compared as text, because the display
+-- scale (trailing zeros) also must be identical
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT g, sum(x), avg(x) FROM rt_data GROUP BY g',
+                             'GpuPreAgg') AS pushdown;
+SELECT g, sum(x) sx, sum(y) sy, sum(z) sz, sum(w) sw,
+         avg(x) ax, avg(y) ay, avg(z) az, avg(w) aw
+  INTO test01g
+  FROM rt_data
+ GROUP BY g;
+SET pg_strom.enabled = off;
+SELECT g, sum(x) sx, sum(y) sy, sum(z) sz, sum(w) sw,
+         avg(x) ax, avg(y) ay, avg(z) az, avg(w) aw
+  INTO test01p
+  FROM rt_data
+ GROUP BY g;
+SELECT g.*, p.*
+  FROM test01g g FULL OUTER JOIN test01p p ON g.g = p.g
+ WHERE g.g IS NULL OR p.g IS NULL OR g::text != p::text;
+
+-- SUM/AVG without GROUP BY
+SET pg_strom.enabled = on;
+SELECT sum(x) sx, sum(y) sy, sum(z) sz, sum(w) sw,
+       avg(x) ax, avg(y) ay, avg(z) az, avg(w) aw
+  INTO test02g
+  FROM rt_data
+ WHERE id % 3 = 0;
+SET pg_strom.enabled = off;
+SELECT sum(x) sx, sum(y) sy, sum(z) sz, sum(w) sw,
+       avg(x) ax, avg(y) ay, avg(z) az, avg(w) aw
+  INTO test02p
+  FROM rt_data
+ WHERE id % 3 = 0;
+SELECT g.*, p.*
+  FROM test02g g, test02p p
+ WHERE g::text != p::text;
+
+-- trailing zeros of the unconstrained numeric are kept;
+-- 1.1000 + 2.200 + 3.00
+SET pg_strom.enabled = on;
+SELECT sum(w)::text = '6.3000' AS ok
+  FROM rt_data
+ WHERE w IN (1.10, 2.2, 3.000) AND id < 40;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_numeric_temp CASCADE;
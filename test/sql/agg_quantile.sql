@@ -0,0 +1,65 @@
+---
+--- Test for PERCENTILE_CONT/PERCENTILE_DISC by quantile sketch on GpuPreAgg
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_agg_quantile_temp CASCADE;
+CREATE SCHEMA regtest_agg_quantile_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_agg_quantile_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  g     int,
+  x     float8
+);
+INSERT INTO rt_data (
+  SELECT i, i % 4,
+         CASE WHEN i % 101 = 0 THEN NULL ELSE (i % 1000) + 1.0 END
+    FROM generate_series(1,40000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enable_quantile_sketch = on;
+SET pg_strom.quantile_sketch_bits = 4;
+
+-- PERCENTILE_CONT/PERCENTILE_DISC are estimated by the quantile sketch
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT g, percentile_cont(0.5) WITHIN GROUP (ORDER BY x) FROM rt_data GROUP BY g',
+                             'pquantile') AS pushdown;
+SELECT g, percentile_cont(0.5) WITHIN GROUP (ORDER BY x) pc,
+          percentile_disc(0.9) WITHIN GROUP (ORDER BY x) pd
+  INTO test01g
+  FROM rt_data
+ GROUP BY g;
+SET pg_strom.enabled = off;
+SELECT g, percentile_cont(0.5) WITHIN GROUP (ORDER BY x) pc,
+          percentile_disc(0.9) WITHIN GROUP (ORDER BY x) pd
+  INTO test01p
+  FROM rt_data
+ GROUP BY g;
+SELECT count(*) = 4 AND
+       bool_and(@(g.pc - p.pc) <= p.pc * 0.05 AND
+                @(g.pd - p.pd) <= p.pd * 0.05) AS ok
+  FROM test01g g JOIN test01p p ON g.g = p.g;
+
+-- the sketch size is fixed at the planner
+SET pg_strom.enabled = on;
+PREPARE q1 AS
+SELECT g, percentile_cont(0.5) WITHIN GROUP (ORDER BY x) pc,
+          percentile_disc(0.9) WITHIN GROUP (ORDER BY x) pd
+  FROM rt_data
+ GROUP BY g;
+SET pg_strom.quantile_sketch_bits = 6;
+CREATE TABLE test02g AS EXECUTE q1;
+DEALLOCATE q1;
+SELECT count(*) = 4 AND
+       bool_and(@(g.pc - p.pc) <= p.pc * 0.05 AND
+                @(g.pd - p.pd) <= p.pd * 0.05) AS ok
+  FROM test02g g JOIN test01p p ON g.g = p.g;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_agg_quantile_temp CASCADE;
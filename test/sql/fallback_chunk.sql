@@ -0,0 +1,85 @@
+---
+--- Test for CPU fallback on the whole chunks returned by xPU
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_fallback_chunk_temp CASCADE;
+CREATE SCHEMA regtest_fallback_chunk_temp;
+RESET client_min_messages;
+
+-- this test uses pre-built test table
+SET search_path = regtest_fallback_chunk_temp,pgstrom_regress,public;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+
+-- GpuScan with CPU fallback on the chunks loaded through the shared buffer
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT id, memo FROM fallback_data WHERE memo LIKE ''%abc%''',
+                             'GpuScan') AS pushdown;
+SELECT id, x+y v, memo
+  INTO test01g
+  FROM fallback_data
+ WHERE memo LIKE '%abc%';	-- error
+SET pg_strom.cpu_fallback = on;
+SELECT id, x+y v, memo
+  INTO test01g
+  FROM fallback_data
+ WHERE memo LIKE '%abc%';
+SET pg_strom.enabled = off;
+SELECT id, x+y v, memo
+  INTO test01p
+  FROM fallback_data
+ WHERE memo LIKE '%abc%';
+-- no rows in the fallback chunks are lost or duplicated
+SELECT (SELECT count(*) FROM test01g) = (SELECT count(*) FROM test01p) AS ok;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY id;
+RESET pg_strom.cpu_fallback;
+
+-- GpuScan with CPU fallback on the chunks loaded by the direct path
+SET pg_strom.gpudirect_threshold = 0;
+SET pg_strom.enabled = on;
+SELECT id, x+y v, memo
+  INTO test02g
+  FROM fallback_data
+ WHERE memo LIKE '%abc%';	-- error
+SET pg_strom.cpu_fallback = on;
+SELECT id, x+y v, memo
+  INTO test02g
+  FROM fallback_data
+ WHERE memo LIKE '%abc%';
+SET pg_strom.enabled = off;
+SELECT id, x+y v, memo
+  INTO test02p
+  FROM fallback_data
+ WHERE memo LIKE '%abc%';
+SELECT (SELECT count(*) FROM test02g) = (SELECT count(*) FROM test02p) AS ok;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY id;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY id;
+RESET pg_strom.cpu_fallback;
+
+-- GpuJoin with CPU fallback on the chunks loaded by the direct path
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT id, memo FROM fallback_data d NATURAL JOIN fallback_small s WHERE memo LIKE ''%abc%''',
+                             'GpuJoin') AS pushdown;
+SET pg_strom.cpu_fallback = on;
+SELECT id, x+y+z v, memo
+  INTO test03g
+  FROM fallback_data d NATURAL JOIN fallback_small s
+ WHERE memo LIKE '%abc%';
+SET pg_strom.enabled = off;
+SELECT id, x+y+z v, memo
+  INTO test03p
+  FROM fallback_data d NATURAL JOIN fallback_small s
+ WHERE memo LIKE '%abc%';
+SELECT (SELECT count(*) FROM test03g) = (SELECT count(*) FROM test03p) AS ok;
+(SELECT * FROM test03g EXCEPT SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT SELECT * FROM test03g) ORDER BY id;
+RESET pg_strom.cpu_fallback;
+RESET pg_strom.gpudirect_threshold;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_fallback_chunk_temp CASCADE;
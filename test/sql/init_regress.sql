@@ -351,3 +351,23 @@ COMMIT;
 VACUUM ANALYZE;
 
 \endif
+
+--
+-- checks whether EXPLAIN of the query contains the label; used by the test
+-- cases to confirm the xPU pushdown without the whole plan
+--
+CREATE OR REPLACE FUNCTION
+pgstrom_regress.regtest_plan_contains(query text, label text)
+RETURNS bool AS $$
+DECLARE
+  line  text;
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (verbose, costs off) ' || query
+  LOOP
+    IF strpos(line, label) > 0 THEN
+      RETURN true;
+    END IF;
+  END LOOP;
+  RETURN false;
+END;
+$$ LANGUAGE plpgsql;
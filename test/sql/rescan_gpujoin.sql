@@ -0,0 +1,87 @@
+---
+--- Test for re-scan of GpuJoin under the parameterized nested loop
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_rescan_gpujoin_temp CASCADE;
+CREATE SCHEMA regtest_rescan_gpujoin_temp;
+RESET client_min_messages;
+
+-- this test uses pre-built test table
+SET search_path = regtest_rescan_gpujoin_temp,pgstrom_regress,public;
+
+-- disables SeqScan, parallel workers and the other join methods
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SET enable_material = off;
+
+-- re-scan without parameters; the session and inner buffer are reused
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT k, id FROM generate_series(1,4) v(k), fallback_data d NATURAL JOIN fallback_small s WHERE d.id < 2000',
+                             'GpuJoin') AS pushdown;
+SELECT k, id, x+z v
+  INTO test01g
+  FROM generate_series(1,4) v(k),
+       fallback_data d NATURAL JOIN fallback_small s
+ WHERE d.id < 2000;
+SET pg_strom.enabled = off;
+SELECT k, id, x+z v
+  INTO test01p
+  FROM generate_series(1,4) v(k),
+       fallback_data d NATURAL JOIN fallback_small s
+ WHERE d.id < 2000;
+SELECT (SELECT count(*) FROM test01g) = (SELECT count(*) FROM test01p) AS ok;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY k, id;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY k, id;
+
+-- re-scan with a parameter of the outer scan; the session is reopened
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT k, id FROM generate_series(1,4) v(k), LATERAL (SELECT id FROM fallback_data d NATURAL JOIN fallback_small s WHERE d.id % 1000 = v.k) j',
+                             'GpuJoin') AS pushdown;
+SELECT k, id, v
+  INTO test02g
+  FROM generate_series(1,4) v(k),
+       LATERAL (SELECT id, x+z v
+                  FROM fallback_data d NATURAL JOIN fallback_small s
+                 WHERE d.id % 1000 = v.k) j;
+SET pg_strom.enabled = off;
+SELECT k, id, v
+  INTO test02p
+  FROM generate_series(1,4) v(k),
+       LATERAL (SELECT id, x+z v
+                  FROM fallback_data d NATURAL JOIN fallback_small s
+                 WHERE d.id % 1000 = v.k) j;
+SELECT (SELECT count(*) FROM test02g) = (SELECT count(*) FROM test02p) AS ok;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY k, id;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY k, id;
+
+-- re-scan with a parameter of the inner relation; the inner buffer is rebuilt
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT k, id FROM generate_series(0,3) v(k), LATERAL (SELECT id FROM fallback_data d JOIN (SELECT * FROM fallback_small WHERE aid % 4 = v.k) s ON d.aid = s.aid WHERE d.id < 20000) j',
+                             'GpuJoin') AS pushdown;
+SELECT k, id, v
+  INTO test03g
+  FROM generate_series(0,3) v(k),
+       LATERAL (SELECT id, x+z v
+                  FROM fallback_data d
+                  JOIN (SELECT * FROM fallback_small WHERE aid % 4 = v.k) s
+                    ON d.aid = s.aid
+                 WHERE d.id < 20000) j;
+SET pg_strom.enabled = off;
+SELECT k, id, v
+  INTO test03p
+  FROM generate_series(0,3) v(k),
+       LATERAL (SELECT id, x+z v
+                  FROM fallback_data d
+                  JOIN (SELECT * FROM fallback_small WHERE aid % 4 = v.k) s
+                    ON d.aid = s.aid
+                 WHERE d.id < 20000) j;
+SELECT (SELECT count(*) FROM test03g) = (SELECT count(*) FROM test03p) AS ok;
+(SELECT * FROM test03g EXCEPT SELECT * FROM test03p) ORDER BY k, id;
+(SELECT * FROM test03p EXCEPT SELECT * FROM test03g) ORDER BY k, id;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_rescan_gpujoin_temp CASCADE;
@@ -0,0 +1,90 @@
+---
+--- Test for Top-N (ORDER BY ... LIMIT) pushdown
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_topn_pushdown_temp CASCADE;
+CREATE SCHEMA regtest_topn_pushdown_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_topn_pushdown_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  g     int,
+  x     float8,
+  t     text
+);
+CREATE TABLE rt_dim (
+  g     int,
+  label text
+);
+INSERT INTO rt_data (
+  SELECT i, i % 20,
+         CASE WHEN i % 100 = 0 THEN NULL ELSE ((i * 7919) % 10007)::float8 / 7.0 END,
+         md5(i::text)
+    FROM generate_series(1,40000) i);
+INSERT INTO rt_dim (
+  SELECT i, 'label-' || i::text
+    FROM generate_series(0,9) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enable_topn_pushdown = on;
+
+-- Top-N on GpuScan
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT id, x FROM rt_data ORDER BY x DESC NULLS LAST, id LIMIT 20',
+                             'Top-N') AS pushdown;
+SELECT id, x, t
+  INTO test01g
+  FROM rt_data
+ WHERE id % 7 <> 0
+ ORDER BY x DESC NULLS LAST, id
+ LIMIT 20;
+SET pg_strom.enabled = off;
+SELECT id, x, t
+  INTO test01p
+  FROM rt_data
+ WHERE id % 7 <> 0
+ ORDER BY x DESC NULLS LAST, id
+ LIMIT 20;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY id;
+
+-- NULLS FIRST
+SET pg_strom.enabled = on;
+SELECT id, x, t
+  INTO test02g
+  FROM rt_data
+ ORDER BY x NULLS FIRST, id
+ LIMIT 500;
+SET pg_strom.enabled = off;
+SELECT id, x, t
+  INTO test02p
+  FROM rt_data
+ ORDER BY x NULLS FIRST, id
+ LIMIT 500;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY id;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY id;
+
+-- Top-N on GpuJoin
+SET pg_strom.enabled = on;
+SELECT d.label, r.id, r.x
+  INTO test03g
+  FROM rt_data r JOIN rt_dim d ON r.g = d.g
+ ORDER BY r.x, r.id
+ LIMIT 30;
+SET pg_strom.enabled = off;
+SELECT d.label, r.id, r.x
+  INTO test03p
+  FROM rt_data r JOIN rt_dim d ON r.g = d.g
+ ORDER BY r.x, r.id
+ LIMIT 30;
+(SELECT * FROM test03g EXCEPT SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT SELECT * FROM test03g) ORDER BY id;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_topn_pushdown_temp CASCADE;
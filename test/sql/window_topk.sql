@@ -0,0 +1,66 @@
+---
+--- Test for per-partition Top-K pushdown of row_number() and rank()
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_window_topk_temp CASCADE;
+CREATE SCHEMA regtest_window_topk_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_window_topk_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  g     int,
+  x     int,
+  t     text
+);
+INSERT INTO rt_data (
+  SELECT i, i % 13,
+         (i * 31) % 97,
+         md5(i::text)
+    FROM generate_series(1,40000) i);
+VACUUM ANALYZE;
+
+-- disables SeqScan and parallel workers
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enable_window_topk = on;
+
+-- row_number() per partition
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT * FROM (SELECT id, g, x, row_number() OVER (PARTITION BY g ORDER BY x DESC, id) rn FROM rt_data) s WHERE rn <= 3',
+                             'Top-N') AS pushdown;
+SELECT *
+  INTO test01g
+  FROM (SELECT id, g, x, t, row_number() OVER (PARTITION BY g ORDER BY x DESC, id) rn
+          FROM rt_data) s
+ WHERE rn <= 3;
+SET pg_strom.enabled = off;
+SELECT *
+  INTO test01p
+  FROM (SELECT id, g, x, t, row_number() OVER (PARTITION BY g ORDER BY x DESC, id) rn
+          FROM rt_data) s
+ WHERE rn <= 3;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY g, rn;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY g, rn;
+
+-- rank() per partition keeps the ties
+SET pg_strom.enabled = on;
+SELECT *
+  INTO test02g
+  FROM (SELECT id, g, x, rank() OVER (PARTITION BY g ORDER BY x) rk
+          FROM rt_data) s
+ WHERE rk <= 2;
+SET pg_strom.enabled = off;
+SELECT *
+  INTO test02p
+  FROM (SELECT id, g, x, rank() OVER (PARTITION BY g ORDER BY x) rk
+          FROM rt_data) s
+ WHERE rk <= 2;
+SELECT (SELECT count(*) FROM test02g) = (SELECT count(*) FROM test02p) AS ok;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY g, id;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY g, id;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_window_topk_temp CASCADE;
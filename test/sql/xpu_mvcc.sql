@@ -0,0 +1,67 @@
+---
+--- Test for xPU MVCC visibility checks on the pages not all-visible
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_xpu_mvcc_temp CASCADE;
+CREATE SCHEMA regtest_xpu_mvcc_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_xpu_mvcc_temp,pgstrom_regress,public;
+CREATE TABLE rt_data (
+  id    int,
+  x     int,
+  memo  text
+);
+INSERT INTO rt_data (SELECT i, i % 1000, md5(i::text)
+                       FROM generate_series(1,200000) i);
+VACUUM ANALYZE rt_data;
+-- clears the all-visible bit of most pages
+UPDATE rt_data SET x = x + 1 WHERE id % 97 = 0;
+DELETE FROM rt_data WHERE id % 101 = 0;
+
+-- disables SeqScan and parallel workers, and prefers the direct path
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.gpudirect_threshold = 0;
+SET pg_strom.xpu_mvcc_checks = on;
+
+-- updated and deleted tuples by the committed transactions
+SET pg_strom.enabled = on;
+SELECT regtest_plan_contains('SELECT id, x, memo FROM rt_data WHERE x > 500',
+                             'GpuScan') AS pushdown;
+SELECT id, x, memo INTO test01g FROM rt_data WHERE x > 500;
+SET pg_strom.enabled = off;
+SELECT id, x, memo INTO test01p FROM rt_data WHERE x > 500;
+SELECT (SELECT count(*) FROM test01g) = (SELECT count(*) FROM test01p) AS ok;
+(SELECT * FROM test01g EXCEPT SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT SELECT * FROM test01g) ORDER BY id;
+
+-- no commit log on the device, so unhinted pages are rechecked by CPU
+SET pg_strom.xpu_mvcc_clog_xids = 0;
+UPDATE rt_data SET x = x + 1 WHERE id % 89 = 0;
+SET pg_strom.enabled = on;
+SELECT id, x, memo INTO test02g FROM rt_data WHERE x > 500;
+SET pg_strom.enabled = off;
+SELECT id, x, memo INTO test02p FROM rt_data WHERE x > 500;
+SELECT (SELECT count(*) FROM test02g) = (SELECT count(*) FROM test02p) AS ok;
+(SELECT * FROM test02g EXCEPT SELECT * FROM test02p) ORDER BY id;
+(SELECT * FROM test02p EXCEPT SELECT * FROM test02g) ORDER BY id;
+RESET pg_strom.xpu_mvcc_clog_xids;
+
+-- tuples updated by the current transaction are rechecked by CPU
+BEGIN;
+UPDATE rt_data SET x = x + 1 WHERE id % 83 = 0;
+DELETE FROM rt_data WHERE id % 79 = 0;
+SET pg_strom.enabled = on;
+SELECT id, x, memo INTO test03g FROM rt_data WHERE x > 500;
+SET pg_strom.enabled = off;
+SELECT id, x, memo INTO test03p FROM rt_data WHERE x > 500;
+SELECT (SELECT count(*) FROM test03g) = (SELECT count(*) FROM test03p) AS ok;
+(SELECT * FROM test03g EXCEPT SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT SELECT * FROM test03g) ORDER BY id;
+ROLLBACK;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_xpu_mvcc_temp CASCADE;